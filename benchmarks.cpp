@@ -0,0 +1,829 @@
+#include <fonge/bvh.hpp>
+#include <fonge/common_ops.hpp>
+#include <fonge/compress.hpp>
+#include <fonge/dual_quaternion_float.hpp>
+#include <fonge/frustum.hpp>
+#include <fonge/half.hpp>
+#include <fonge/matrix_double.hpp>
+#include <fonge/mapped_file.hpp>
+#include <fonge/overlap.hpp>
+#include <fonge/matrix_float.hpp>
+#include <fonge/packed.hpp>
+#include <fonge/packet_float.hpp>
+#include <fonge/pose_blend.hpp>
+#include <fonge/quaternion_batch.hpp>
+#include <fonge/ray.hpp>
+#include <fonge/soa_float.hpp>
+#include <fonge/spatial_grid.hpp>
+#include <fonge/sweep_prune.hpp>
+#include <fonge/transforms.hpp>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace fonge;
+
+// Runs f reps times and returns the average nanoseconds per item.
+template <typename F> double time_ns(size_t items, int reps, F f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        f();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+           (double(items) * reps);
+}
+
+// Keeps the optimizer from discarding benchmark results.
+template <typename T> void consume(T *data, size_t n) {
+    volatile float sink = reinterpret_cast<float *>(data)[n % 7];
+    (void)sink;
+}
+
+static float4x4 random_matrix() {
+    float4 c[4];
+    for (int i = 0; i < 4; i++) {
+        c[i] = float4(rand() % 17 - 8, rand() % 17 - 8, rand() % 17 - 8,
+                      rand() % 17 - 8) * (1.f / 8);
+    }
+    return float4x4(c[0], c[1], c[2], c[3]);
+}
+
+int main(int argc, char *argv[]) {
+    int which = argc > 1 ? atoi(argv[1]) : -1;
+    const size_t n = 4096;
+    const int reps = 2000;
+
+    if (which < 0 || which == 0) {
+        // float4x4 * float4x4 over arrays: operator* loop vs multiply_many
+        std::vector<float4x4> a(n), b(n), out(n);
+        for (size_t i = 0; i < n; i++) {
+            a[i] = random_matrix();
+            b[i] = random_matrix();
+        }
+        float4x4 parent = random_matrix();
+
+        double scalar = time_ns(n, reps, [&] {
+            for (size_t i = 0; i < n; i++) {
+                out[i] = a[i] * b[i];
+            }
+            consume(out.data(), n);
+        });
+        double batched = time_ns(n, reps, [&] {
+            multiply_many(a.data(), b.data(), out.data(), n);
+            consume(out.data(), n);
+        });
+        double scalar_parent = time_ns(n, reps, [&] {
+            for (size_t i = 0; i < n; i++) {
+                out[i] = parent * b[i];
+            }
+            consume(out.data(), n);
+        });
+        double batched_parent = time_ns(n, reps, [&] {
+            multiply_many(parent, b.data(), out.data(), n);
+            consume(out.data(), n);
+        });
+        printf("float4x4 a[i] * b[i]:   operator* %.2f ns, "
+               "multiply_many %.2f ns\n", scalar, batched);
+        printf("float4x4 parent * b[i]: operator* %.2f ns, "
+               "multiply_many %.2f ns\n", scalar_parent, batched_parent);
+    }
+
+    if (which < 0 || which == 1) {
+        // dot products: shuffle+add tree vs dpps/haddpd, and four dots at
+        // once with hsum4x4_ps
+        std::vector<float4> a(n), b(n);
+        std::vector<double4> da(n), db(n);
+        std::vector<float> out(n);
+        std::vector<double> dout(n);
+        for (size_t i = 0; i < n; i++) {
+            a[i] = float4(rand() % 7, rand() % 7, rand() % 7, rand() % 7);
+            b[i] = float4(rand() % 7, rand() % 7, rand() % 7, rand() % 7);
+            da[i] = double4(rand() % 7, rand() % 7, rand() % 7, rand() % 7);
+            db[i] = double4(rand() % 7, rand() % 7, rand() % 7, rand() % 7);
+        }
+
+        auto bench_ps = [&](float (*dot)(simde__m128, simde__m128)) {
+            return time_ns(n, reps, [&] {
+                for (size_t i = 0; i < n; i++) {
+                    out[i] = dot(a[i].simd, b[i].simd);
+                }
+                consume(out.data(), n);
+            });
+        };
+        auto bench_pd = [&](double (*dot)(simde__m256d, simde__m256d)) {
+            return time_ns(n, reps, [&] {
+                for (size_t i = 0; i < n; i++) {
+                    dout[i] = dot(da[i].simd, db[i].simd);
+                }
+                consume(dout.data(), n);
+            });
+        };
+        printf("float4 dot:  tree %.2f ns, dpps %.2f ns\n",
+               bench_ps(dot_ps_tree<4>), bench_ps(dot_ps_dpps<4>));
+        printf("float3 dot:  tree %.2f ns, dpps %.2f ns\n",
+               bench_ps(dot_ps_tree<3>), bench_ps(dot_ps_dpps<3>));
+        printf("double4 dot: tree %.2f ns, hadd %.2f ns\n",
+               bench_pd(dot_pd_tree<4>), bench_pd(dot_pd_hadd<4>));
+        printf("double3 dot: tree %.2f ns, hadd %.2f ns\n",
+               bench_pd(dot_pd_tree<3>), bench_pd(dot_pd_hadd<3>));
+
+        double separate = time_ns(n, reps, [&] {
+            for (size_t i = 0; i + 4 <= n; i += 4) {
+                for (int j = 0; j < 4; j++) {
+                    out[i + j] = dot_ps_dpps<4>(a[i + j].simd, b[i + j].simd);
+                }
+            }
+            consume(out.data(), n);
+        });
+        double vertical = time_ns(n, reps, [&] {
+            for (size_t i = 0; i + 4 <= n; i += 4) {
+                simde_mm_storeu_ps(
+                    &out[i],
+                    hsum4x4_ps(simde_mm_mul_ps(a[i].simd, b[i].simd),
+                               simde_mm_mul_ps(a[i + 1].simd, b[i + 1].simd),
+                               simde_mm_mul_ps(a[i + 2].simd, b[i + 2].simd),
+                               simde_mm_mul_ps(a[i + 3].simd, b[i + 3].simd)));
+            }
+            consume(out.data(), n);
+        });
+        printf("4 float4 dots: dpps %.2f ns, hsum4x4_ps %.2f ns\n", separate,
+               vertical);
+    }
+
+    if (which < 0 || which == 2) {
+        // normalize: sqrt + divide vs rsqrt + one Newton-Raphson step
+        std::vector<float3> v(n), out(n);
+        std::vector<double3> dv(n), dout(n);
+        for (size_t i = 0; i < n; i++) {
+            v[i] = float3(rand() % 17 - 8, rand() % 17 - 8, rand() % 17 + 1);
+            dv[i] = double3(rand() % 17 - 8, rand() % 17 - 8, rand() % 17 + 1);
+        }
+        float3_soa soa(v.data(), n), soa_out;
+
+        double exact = time_ns(n, reps, [&] {
+            for (size_t i = 0; i < n; i++) {
+                out[i] = v[i].normalized();
+            }
+            consume(out.data(), n);
+        });
+        double fast = time_ns(n, reps, [&] {
+            for (size_t i = 0; i < n; i++) {
+                out[i] = v[i].normalized_fast();
+            }
+            consume(out.data(), n);
+        });
+        double dexact = time_ns(n, reps, [&] {
+            for (size_t i = 0; i < n; i++) {
+                dout[i] = dv[i].normalized();
+            }
+            consume(dout.data(), n);
+        });
+        double dfast = time_ns(n, reps, [&] {
+            for (size_t i = 0; i < n; i++) {
+                dout[i] = dv[i].normalized_fast();
+            }
+            consume(dout.data(), n);
+        });
+        double soa_exact = time_ns(n, reps, [&] {
+            soa.normalized(soa_out);
+            consume(soa_out.x.data(), n);
+        });
+        double soa_fast = time_ns(n, reps, [&] {
+            soa.normalized_fast(soa_out);
+            consume(soa_out.x.data(), n);
+        });
+        printf("float3 normalize:     exact %.2f ns, fast %.2f ns\n", exact,
+               fast);
+        printf("double3 normalize:    exact %.2f ns, fast %.2f ns\n", dexact,
+               dfast);
+        printf("float3_soa normalize: exact %.2f ns, fast %.2f ns\n",
+               soa_exact, soa_fast);
+    }
+
+    if (which < 0 || which == 3) {
+        // sin and cos of n angles: libm vs float4 and float1x8 sincos, and
+        // quaternions from angle and axis
+        std::vector<float> angle(n), s(n), c(n);
+        std::vector<quat> q(n);
+        for (size_t i = 0; i < n; i++) {
+            angle[i] = (rand() % 20000 - 10000) * 1e-3f;
+        }
+
+        double libm = time_ns(n, reps, [&] {
+            for (size_t i = 0; i < n; i++) {
+                s[i] = sinf(angle[i]);
+                c[i] = cosf(angle[i]);
+            }
+            consume(s.data(), n);
+            consume(c.data(), n);
+        });
+        double x4 = time_ns(n, reps, [&] {
+            for (size_t i = 0; i < n; i += 4) {
+                float4 vs, vc;
+                sincos(float4(simde_mm_loadu_ps(&angle[i])), vs, vc);
+                simde_mm_storeu_ps(&s[i], vs.simd);
+                simde_mm_storeu_ps(&c[i], vc.simd);
+            }
+            consume(s.data(), n);
+            consume(c.data(), n);
+        });
+        double x8 = time_ns(n, reps, [&] {
+            for (size_t i = 0; i < n; i += 8) {
+                float1x8 vs, vc;
+                sincos(float1x8::load(&angle[i]), vs, vc);
+                vs.store(&s[i]);
+                vc.store(&c[i]);
+            }
+            consume(s.data(), n);
+            consume(c.data(), n);
+        });
+        double quats = time_ns(n, reps, [&] {
+            for (size_t i = 0; i < n; i++) {
+                q[i] = quat::from_angle_axis(angle[i], float3::y_axis());
+            }
+            consume(q.data(), n);
+        });
+        printf("sincos: libm %.2f ns, float4 %.2f ns, float1x8 %.2f ns\n",
+               libm, x4, x8);
+        printf("quat::from_angle_axis: %.2f ns\n", quats);
+    }
+
+    if (which < 0 || which == 4) {
+        // rotating points: quat::rotate vs the batched cross product form
+        std::vector<float3> pts(n), out(n);
+        std::vector<quat> qs(n);
+        for (size_t i = 0; i < n; i++) {
+            pts[i] = float3(rand() % 17 - 8, rand() % 17 - 8, rand() % 17 - 8);
+            qs[i] = quat::from_angle_axis(rand() % 628 * 0.01f,
+                                          float3(rand() % 7 - 3, 1,
+                                                 rand() % 5 - 2).normalized());
+        }
+        quat_soa qsoa(qs.data(), n);
+        float3_soa psoa(pts.data(), n), osoa;
+
+        double one = time_ns(n, reps, [&] {
+            for (size_t i = 0; i < n; i++) {
+                out[i] = qs[0].rotate(pts[i]);
+            }
+            consume(out.data(), n);
+        });
+        double one_batched = time_ns(n, reps, [&] {
+            rotate_points(qs[0], pts.data(), out.data(), n);
+            consume(out.data(), n);
+        });
+        double each = time_ns(n, reps, [&] {
+            for (size_t i = 0; i < n; i++) {
+                out[i] = qs[i].rotate(pts[i]);
+            }
+            consume(out.data(), n);
+        });
+        double each_batched = time_ns(n, reps, [&] {
+            rotate_points(qs.data(), pts.data(), out.data(), n);
+            consume(out.data(), n);
+        });
+        double each_soa = time_ns(n, reps, [&] {
+            qsoa.rotate_points(psoa, osoa);
+            consume(osoa.x.data(), n);
+        });
+        printf("one quat:      rotate %.2f ns, rotate_points %.2f ns\n", one,
+               one_batched);
+        printf("quat / point:  rotate %.2f ns, rotate_points %.2f ns, "
+               "quat_soa %.2f ns\n", each, each_batched, each_soa);
+    }
+
+    if (which < 0 || which == 5) {
+        // skinning four influences per vertex: dual quaternion blend vs the
+        // linear blend of bone matrices
+        const int n_bones = 64;
+        std::vector<dual_quat> bones(n_bones);
+        std::vector<float3x4> mats(n_bones);
+        for (int b = 0; b < n_bones; b++) {
+            quat r = quat::from_angle_axis(rand() % 628 * 0.01f,
+                                           float3(rand() % 7 - 3, 1,
+                                                  rand() % 5 - 2).normalized());
+            bones[b] = dual_quat::from_rotation_translation(
+                r, float3(rand() % 9, rand() % 9, rand() % 9));
+            mats[b] = bones[b].mat3x4_form();
+        }
+        std::vector<int4> joints(n);
+        std::vector<float4> weights(n);
+        std::vector<float3> pts(n), out(n);
+        for (size_t i = 0; i < n; i++) {
+            joints[i] = int4(rand() % n_bones, rand() % n_bones,
+                             rand() % n_bones, rand() % n_bones);
+            weights[i] = float4(0.4f, 0.3f, 0.2f, 0.1f);
+            pts[i] = float3(rand() % 17 - 8, rand() % 17 - 8, rand() % 17 - 8);
+        }
+
+        double lbs = time_ns(n, reps, [&] {
+            for (size_t i = 0; i < n; i++) {
+                float3x4 m(float4(0), float4(0), float4(0));
+                for (int k = 0; k < 4; k++) {
+                    float3x4 &b = mats[joints[i][k]];
+                    float w = weights[i][k];
+                    for (int r = 0; r < 3; r++) {
+                        m[r] += b[r] * w;
+                    }
+                }
+                out[i] = m.transform_point(pts[i]);
+            }
+            consume(out.data(), n);
+        });
+        double dqs = time_ns(n, reps, [&] {
+            skin_points(bones.data(), joints.data(), weights.data(), pts.data(),
+                        out.data(), n);
+            consume(out.data(), n);
+        });
+        printf("skinning: float3x4 blend %.2f ns, dual_quat %.2f ns\n", lbs,
+               dqs);
+    }
+
+    if (which < 0 || which == 6) {
+        // blending joint rotations: exact slerp vs the nlerp-based paths
+        std::vector<quat> qa(n), qb(n), out(n);
+        std::vector<float> t(n);
+        for (size_t i = 0; i < n; i++) {
+            qa[i] = quat::from_angle_axis(rand() % 314 * 0.01f,
+                                          float3(rand() % 7 - 3, 1,
+                                                 rand() % 5 - 2).normalized());
+            qb[i] = quat::from_angle_axis(rand() % 314 * 0.01f,
+                                          float3(1, rand() % 5 - 2,
+                                                 rand() % 7 - 3).normalized());
+            t[i] = rand() % 100 * 0.01f;
+        }
+        quat_soa sa(qa.data(), n), sb(qb.data(), n), so;
+
+        double exact = time_ns(n, reps, [&] {
+            for (size_t i = 0; i < n; i++) {
+                out[i] = slerp(qa[i], qb[i], t[i]);
+            }
+            consume(out.data(), n);
+        });
+        double nl = time_ns(n, reps, [&] {
+            nlerp_many(qa.data(), qb.data(), t.data(), out.data(), n);
+            consume(out.data(), n);
+        });
+        double sl = time_ns(n, reps, [&] {
+            slerp_many(qa.data(), qb.data(), t.data(), out.data(), n);
+            consume(out.data(), n);
+        });
+        double sl_soa = time_ns(n, reps, [&] {
+            slerp_many(sa, sb, t.data(), so);
+            consume(so.vec.x.data(), n);
+        });
+        printf("slerp %.2f ns, nlerp_many %.2f ns, slerp_many %.2f ns, "
+               "quat_soa %.2f ns\n", exact, nl, sl, sl_soa);
+    }
+
+    if (which < 0 || which == 7) {
+        // a streaming pass over normals too big for cache: float4 vs half4
+        const size_t big = 1 << 22;
+        std::vector<float4> nrm(big);
+        std::vector<half4> nrm_h(big);
+        std::vector<float> lit(big);
+        for (size_t i = 0; i < big; i++) {
+            nrm[i] = float4(rand() % 17 - 8, rand() % 17 - 8, 1, 0)
+                         .normalized();
+        }
+        pack_half(nrm.data(), nrm_h.data(), big);
+        float4 light = float4(1, 2, 3, 0).normalized();
+
+        double full = time_ns(big, 20, [&] {
+            for (size_t i = 0; i < big; i++) {
+                lit[i] = nrm[i].dot(light);
+            }
+            consume(lit.data(), big);
+        });
+        double half = time_ns(big, 20, [&] {
+            for (size_t i = 0; i < big; i++) {
+                lit[i] = half4(nrm_h[i]).unpack().dot(light);
+            }
+            consume(lit.data(), big);
+        });
+        double pack = time_ns(big, 20, [&] {
+            pack_half(nrm.data(), nrm_h.data(), big);
+            consume(nrm_h.data(), big);
+        });
+        double unpack = time_ns(big, 20, [&] {
+            unpack_half(nrm_h.data(), nrm.data(), big);
+            consume(nrm.data(), big);
+        });
+        printf("lighting pass: float4 %.2f ns, half4 %.2f ns\n", full, half);
+        printf("pack_half %.2f ns, unpack_half %.2f ns per float4\n", pack,
+               unpack);
+    }
+
+    if (which < 0 || which == 8) {
+        // quaternion and normal codecs, per item: one at a time vs batched
+        std::vector<quat> qs(n), qo(n);
+        std::vector<float3> ns(n), no(n);
+        std::vector<quat32> q32(n);
+        std::vector<oct32> o32(n);
+        for (size_t i = 0; i < n; i++) {
+            qs[i] = quat::from_angle_axis(rand() % 628 * 0.01f,
+                                          float3(rand() % 7 - 3, 1,
+                                                 rand() % 5 - 2).normalized());
+            ns[i] = float3(rand() % 17 - 8, rand() % 17 - 8, rand() % 9 - 4)
+                        .normalized();
+        }
+
+        double q_one = time_ns(n, reps, [&] {
+            for (size_t i = 0; i < n; i++) {
+                q32[i] = quat32(qs[i]);
+            }
+            consume(q32.data(), n);
+        });
+        double q_pack = time_ns(n, reps, [&] {
+            pack_quat32(qs.data(), q32.data(), n);
+            consume(q32.data(), n);
+        });
+        double q_unpack = time_ns(n, reps, [&] {
+            unpack_quat32(q32.data(), qo.data(), n);
+            consume(qo.data(), n);
+        });
+        double o_one = time_ns(n, reps, [&] {
+            for (size_t i = 0; i < n; i++) {
+                o32[i] = oct32(ns[i]);
+            }
+            consume(o32.data(), n);
+        });
+        double o_pack = time_ns(n, reps, [&] {
+            pack_oct32(ns.data(), o32.data(), n);
+            consume(o32.data(), n);
+        });
+        double o_unpack = time_ns(n, reps, [&] {
+            unpack_oct32(o32.data(), no.data(), n);
+            consume(no.data(), n);
+        });
+        printf("quat32: one at a time %.2f ns, pack %.2f ns, unpack %.2f ns\n",
+               q_one, q_pack, q_unpack);
+        printf("oct32:  one at a time %.2f ns, pack %.2f ns, unpack %.2f ns\n",
+               o_one, o_pack, o_unpack);
+    }
+
+    if (which < 0 || which == 9) {
+        // a streaming pass over positions too big for cache: translating
+        // padded double3 in place vs packed_double3 through load/store, and
+        // the bulk converters
+        const size_t big = 1 << 21;
+        std::vector<double3> pos(big);
+        std::vector<packed_double3> packed(big);
+        for (size_t i = 0; i < big; i++) {
+            pos[i] = double3(rand() % 100, rand() % 100, rand() % 100);
+        }
+        pack_double3(pos.data(), packed.data(), big);
+        double3 offset(0.5, -1, 2);
+
+        double padded = time_ns(big, 20, [&] {
+            for (size_t i = 0; i < big; i++) {
+                pos[i] = pos[i] + offset;
+            }
+            consume(pos.data(), big);
+        });
+        double dense = time_ns(big, 20, [&] {
+            for (size_t i = 0; i < big; i++) {
+                packed[i].store(packed[i].load() + offset);
+            }
+            consume(packed.data(), big);
+        });
+        double unpack = time_ns(big, 20, [&] {
+            unpack_double3(packed.data(), pos.data(), big);
+            consume(pos.data(), big);
+        });
+        double pack = time_ns(big, 20, [&] {
+            pack_double3(pos.data(), packed.data(), big);
+            consume(packed.data(), big);
+        });
+        printf("translate: double3 %.2f ns, packed_double3 %.2f ns\n", padded,
+               dense);
+        printf("unpack_double3 %.2f ns, pack_double3 %.2f ns\n", unpack, pack);
+    }
+
+    if (which < 0 || which == 10) {
+        // loading a 16 MB float4x4 snapshot from a warm page cache: reading
+        // it into a vector vs mapping it, each followed by one pass over the
+        // matrices
+        const size_t big = 1 << 18;
+        const char *path = "fonge_bench_snapshot.bin";
+        std::vector<float4x4> mats(big);
+        for (size_t i = 0; i < big; i++) {
+            mats[i] = random_matrix();
+        }
+        mapped_file_writer w;
+        w.open(path);
+        w.write("matrices", mats.data(), big);
+        w.close();
+        FILE *raw = fopen("fonge_bench_raw.bin", "wb");
+        fwrite(mats.data(), sizeof(float4x4), big, raw);
+        fclose(raw);
+
+        float4 sum;
+        double copied = time_ns(big, 20, [&] {
+            std::vector<float4x4> loaded(big);
+            FILE *in = fopen("fonge_bench_raw.bin", "rb");
+            size_t got = fread(loaded.data(), sizeof(float4x4), big, in);
+            fclose(in);
+            for (size_t i = 0; i < got; i++) {
+                sum += loaded[i].col4;
+            }
+            consume(&sum, 0);
+        });
+        double mapped = time_ns(big, 20, [&] {
+            mapped_file f;
+            f.open(path);
+            mapped_span<float4x4> loaded = f.find<float4x4>("matrices");
+            for (size_t i = 0; i < loaded.size(); i++) {
+                sum += loaded[i].col4;
+            }
+            consume(&sum, 0);
+        });
+        remove(path);
+        remove("fonge_bench_raw.bin");
+        printf("load + pass: fread %.2f ns, mapped_file %.2f ns\n", copied,
+               mapped);
+    }
+
+    if (which < 0 || which == 11) {
+        // 100k boxes against a view frustum: intersects() per box vs the
+        // eight-wide cull to a mask and to an index list
+        const size_t big = 100000;
+        std::vector<AABB3f> boxes;
+        for (size_t i = 0; i < big; i++) {
+            float3 c(rand() % 201 - 100, rand() % 201 - 100, -(rand() % 200));
+            float3 e(rand() % 4 + 1, rand() % 4 + 1, rand() % 4 + 1);
+            boxes.push_back(AABB3f(c - e, c + e));
+        }
+        frustum f = frustum::from_matrix(perspectivef(90, 1.5f, 1, 150));
+        std::vector<uint8_t> mask((big + 7) / 8);
+        std::vector<uint32_t> ids(big);
+
+        double scalar = time_ns(big, 200, [&] {
+            size_t count = 0;
+            for (size_t i = 0; i < big; i++) {
+                if (f.intersects(boxes[i])) {
+                    ids[count++] = uint32_t(i);
+                }
+            }
+            consume(ids.data(), count);
+        });
+        double masked = time_ns(big, 200, [&] {
+            cull_mask(f, boxes.data(), big, mask.data());
+            consume(mask.data(), 0);
+        });
+        double listed = time_ns(big, 200, [&] {
+            size_t count = cull(f, boxes.data(), big, ids.data());
+            consume(ids.data(), count);
+        });
+        printf("frustum vs AABB3f: intersects %.2f ns, cull_mask %.2f ns, "
+               "cull %.2f ns\n",
+               scalar, masked, listed);
+    }
+
+    if (which < 0 || which == 12) {
+        // 100k boxes: building a bvh on one thread and on all of them, then
+        // small box queries and rays against a linear scan, bvh and bvh8
+        const size_t big = 100000, queries = 1000;
+        std::vector<AABB3f> boxes, probes;
+        std::vector<float3> origins, dirs;
+        for (size_t i = 0; i < big; i++) {
+            float3 c(rand() % 1000, rand() % 1000, rand() % 1000);
+            float3 e(rand() % 4 + 1, rand() % 4 + 1, rand() % 4 + 1);
+            boxes.push_back(AABB3f(c - e, c + e));
+        }
+        for (size_t q = 0; q < queries; q++) {
+            float3 c(rand() % 1000, rand() % 1000, rand() % 1000);
+            probes.push_back(AABB3f(c - float3(10), c + float3(10)));
+            origins.push_back(float3(-1, rand() % 1000, rand() % 1000));
+            dirs.push_back(float3(1, (rand() % 101 - 50) * 0.01f,
+                                  (rand() % 101 - 50) * 0.01f));
+        }
+        bvh tree;
+        double serial =
+            time_ns(big, 5, [&] { tree.build(boxes.data(), big, 1); });
+        double parallel =
+            time_ns(big, 5, [&] { tree.build(boxes.data(), big); });
+        bvh8 wide(tree);
+        size_t found = 0;
+        auto count_box = [&](uint32_t) { found++; };
+        auto count_ray = [&](uint32_t, float &) { found++; };
+
+        double scan = time_ns(queries, 5, [&] {
+            for (size_t q = 0; q < queries; q++) {
+                for (size_t i = 0; i < big; i++) {
+                    found += bvh_overlaps(boxes[i].min_point.simd,
+                                          boxes[i].max_point.simd,
+                                          probes[q].min_point.simd,
+                                          probes[q].max_point.simd);
+                }
+            }
+        });
+        double binary = time_ns(queries, 50, [&] {
+            for (size_t q = 0; q < queries; q++) {
+                tree.query_box(probes[q], count_box);
+            }
+        });
+        double eight = time_ns(queries, 50, [&] {
+            for (size_t q = 0; q < queries; q++) {
+                wide.query_box(probes[q], count_box);
+            }
+        });
+        double ray_binary = time_ns(queries, 50, [&] {
+            for (size_t q = 0; q < queries; q++) {
+                tree.query_ray(origins[q], dirs[q], 2000, count_ray);
+            }
+        });
+        double ray_eight = time_ns(queries, 50, [&] {
+            for (size_t q = 0; q < queries; q++) {
+                wide.query_ray(origins[q], dirs[q], 2000, count_ray);
+            }
+        });
+        consume(&found, 0);
+        printf("bvh build: 1 thread %.1f ns, all threads %.1f ns per box\n",
+               serial, parallel);
+        printf("box query: scan %.0f ns, bvh %.0f ns, bvh8 %.0f ns\n", scan,
+               binary, eight);
+        printf("ray query: bvh %.0f ns, bvh8 %.0f ns\n", ray_binary,
+               ray_eight);
+    }
+    if (which < 0 || which == 13) {
+        // One ray against a triangle soup, and a batch of rays against one
+        // box and one triangle.
+        const size_t n = 1 << 14;
+        std::vector<float3> tris;
+        std::vector<ray> rays;
+        for (size_t i = 0; i < 3 * n; i++) {
+            tris.push_back(float3(rand() % 200 - 100, rand() % 200 - 100,
+                                  rand() % 200 - 100) * 0.01f);
+        }
+        for (size_t i = 0; i < n; i++) {
+            float3 o(rand() % 200 - 100, rand() % 200 - 100, -300);
+            rays.push_back(ray(o * 0.01f, float3(0, 0, 1) - o * 0.001f));
+        }
+        std::vector<float> t(n);
+        ray r(float3(0, 0, -3), float3(0.01f, 0.02f, 1));
+        AABB3f box(float3(-0.5f, -0.5f, -0.5f), float3(0.5f, 0.5f, 0.5f));
+        float3 a = tris[0], b = tris[1], c = tris[2];
+        double soup_scalar = time_ns(n, 50, [&] {
+            for (size_t i = 0; i < n; i++) {
+                r.intersects(tris[3 * i], tris[3 * i + 1], tris[3 * i + 2],
+                             t[i]);
+            }
+            consume(t.data(), n);
+        });
+        double soup_packet = time_ns(n, 50, [&] {
+            intersect_triangles(r, tris.data(), n, t.data());
+            consume(t.data(), n);
+        });
+        double box_scalar = time_ns(n, 50, [&] {
+            for (size_t i = 0; i < n; i++) {
+                ray ri = rays[i];
+                ri.intersects(box, t[i]);
+            }
+            consume(t.data(), n);
+        });
+        double box_packet = time_ns(n, 50, [&] {
+            intersect_rays(rays.data(), n, box, t.data());
+            consume(t.data(), n);
+        });
+        double tri_scalar = time_ns(n, 50, [&] {
+            for (size_t i = 0; i < n; i++) {
+                ray ri = rays[i];
+                ri.intersects(a, b, c, t[i]);
+            }
+            consume(t.data(), n);
+        });
+        double tri_packet = time_ns(n, 50, [&] {
+            intersect_rays(rays.data(), n, a, b, c, t.data());
+            consume(t.data(), n);
+        });
+        printf("ray vs triangles: scalar %.2f ns, x8 %.2f ns\n", soup_scalar,
+               soup_packet);
+        printf("rays vs box: scalar %.2f ns, x8 %.2f ns\n", box_scalar,
+               box_packet);
+        printf("rays vs triangle: scalar %.2f ns, x8 %.2f ns\n", tri_scalar,
+               tri_packet);
+    }
+    if (which < 0 || which == 14) {
+        // One query volume against many, scalar and eight at a time.
+        const size_t n = 1 << 14;
+        std::vector<sphere> spheres;
+        std::vector<AABB3f> boxes;
+        std::vector<OBB> obbs;
+        for (size_t i = 0; i < n; i++) {
+            float3 c(rand() % 200 - 100, rand() % 200 - 100,
+                     rand() % 200 - 100);
+            float3 e(rand() % 10 + 1, rand() % 10 + 1, rand() % 10 + 1);
+            spheres.push_back(sphere(c, e.x()));
+            boxes.push_back(AABB3f(c - e, c + e));
+            obbs.push_back(OBB(c, e, quat::from_angle_axis(
+                                         float(i), e.normalized())));
+        }
+        sphere qs(float3(0, 0, 0), 40);
+        plane qp = plane::from_point_normal(float3(0, 0, 0), float3(1, 2, 3));
+        OBB qo(float3(0, 0, 0), float3(60, 10, 20),
+               quat::from_angle_axis(0.5f, float3(0, 1, 0)));
+        std::vector<uint8_t> mask(n / 8);
+        auto scalar = [&](auto query, auto *shapes) {
+            return time_ns(n, 50, [&] {
+                for (size_t i = 0; i < n; i += 8) {
+                    int bits = 0;
+                    for (int k = 0; k < 8; k++) {
+                        bits |= int(query.intersects(shapes[i + k])) << k;
+                    }
+                    mask[i / 8] = uint8_t(bits);
+                }
+                consume(mask.data(), n / 8);
+            });
+        };
+        auto batch = [&](auto query, auto *shapes) {
+            return time_ns(n, 50, [&] {
+                overlap_mask(query, shapes, n, mask.data());
+                consume(mask.data(), n / 8);
+            });
+        };
+        printf("sphere-sphere: scalar %.2f ns, x8 %.2f ns\n",
+               scalar(qs, spheres.data()), batch(qs, spheres.data()));
+        printf("sphere-aabb: scalar %.2f ns, x8 %.2f ns\n",
+               scalar(qs, boxes.data()), batch(qs, boxes.data()));
+        printf("plane-aabb: scalar %.2f ns, x8 %.2f ns\n",
+               scalar(qp, boxes.data()), batch(qp, boxes.data()));
+        printf("obb-obb: scalar %.2f ns, x8 %.2f ns\n",
+               scalar(qo, obbs.data()), batch(qo, obbs.data()));
+    }
+    if (which < 0 || which == 15) {
+        // Boxes of about one unit in a 100^3 world, against all pairs.
+        const size_t n = 50000, brute_n = 5000;
+        std::vector<AABB3f> boxes;
+        for (size_t i = 0; i < n; i++) {
+            float3 c(rand() % 10000 * 0.01f, rand() % 10000 * 0.01f,
+                     rand() % 10000 * 0.01f);
+            float3 e(rand() % 50 + 10, rand() % 50 + 10, rand() % 50 + 10);
+            boxes.push_back(AABB3f(c - e * 0.01f, c + e * 0.01f));
+        }
+        spatial_grid grid(1.5f);
+        for (size_t i = 0; i < n; i++) {
+            grid.insert(boxes[i]);
+        }
+        size_t found = 0;
+        auto count = [&](const grid_pair *, size_t k) { found += k; };
+        double rebuild = time_ns(n, 20, [&] { grid.rebuild(1); });
+        double pairs = time_ns(n, 20, [&] { grid.pairs(count); });
+        float3 nudge(0.001f, 0, 0);
+        double move = time_ns(n, 20, [&] {
+            for (size_t i = 0; i < n; i++) {
+                boxes[i] = AABB3f(boxes[i].min_point + nudge,
+                                  boxes[i].max_point + nudge);
+                grid.move(uint32_t(i), boxes[i]);
+            }
+            grid.commit(1);
+        });
+        double brute = time_ns(brute_n, 2, [&] {
+            for (size_t a = 0; a < brute_n; a++) {
+                for (size_t b = a + 1; b < brute_n; b++) {
+                    found += boxes[a].intersects(boxes[b]);
+                }
+            }
+        });
+        consume(&found, 0);
+        printf("grid, per box: rebuild %.1f ns, pairs %.1f ns, move %.1f ns\n",
+               rebuild, pairs, move);
+        printf("all pairs of %zu boxes: %.1f ns per box\n", brute_n, brute);
+    }
+    if (which < 0 || which == 16) {
+        // 100k boxes drifting a little each frame.
+        const size_t n = 100000;
+        std::vector<AABB3f> boxes;
+        std::vector<float3> vel;
+        for (size_t i = 0; i < n; i++) {
+            float3 c(rand() % 10000 * 0.02f, rand() % 10000 * 0.02f,
+                     rand() % 10000 * 0.02f);
+            float3 e(rand() % 50 + 10, rand() % 50 + 10, rand() % 50 + 10);
+            boxes.push_back(AABB3f(c - e * 0.02f, c + e * 0.02f));
+            vel.push_back(float3(rand() % 21 - 10, rand() % 21 - 10,
+                                 rand() % 21 - 10) * 0.002f);
+        }
+        sweep_prune sap;
+        sap_pair_pool pool;
+        double build = time_ns(n, 5, [&] { sap.build(boxes.data(), n); });
+        double move = time_ns(n, 20, [&] {
+            for (size_t i = 0; i < n; i++) {
+                boxes[i] = AABB3f(boxes[i].min_point + vel[i],
+                                  boxes[i].max_point + vel[i]);
+            }
+        });
+        double frame = time_ns(n, 20, [&] {
+            for (size_t i = 0; i < n; i++) {
+                boxes[i] = AABB3f(boxes[i].min_point + vel[i],
+                                  boxes[i].max_point + vel[i]);
+            }
+            sap.update(boxes.data());
+            sap.find_pairs(pool);
+        });
+        printf("sap, per box: build %.1f ns, frame %.1f ns "
+               "(update + pairs, %zu pairs, %.2f ms per frame)\n",
+               build, frame - move, pool.size(), (frame - move) * n * 1e-6);
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace fonge {
+
+// Allocator returning storage aligned to Align bytes, so SIMD kernels can use
+// aligned loads and stores over a whole buffer.
+template <typename T, size_t Align = 64> struct aligned_allocator {
+  typedef T value_type;
+
+  template <typename U> struct rebind {
+    typedef aligned_allocator<U, Align> other;
+  };
+
+  inline aligned_allocator() {}
+
+  template <typename U>
+  inline aligned_allocator(const aligned_allocator<U, Align> &) {}
+
+  inline T *allocate(size_t n) {
+    return static_cast<T *>(
+        ::operator new(n * sizeof(T), std::align_val_t(Align)));
+  }
+
+  inline void deallocate(T *p, size_t) {
+    ::operator delete(p, std::align_val_t(Align));
+  }
+
+  template <typename U>
+  inline bool operator==(const aligned_allocator<U, Align> &) const {
+    return true;
+  }
+
+  template <typename U>
+  inline bool operator!=(const aligned_allocator<U, Align> &) const {
+    return false;
+  }
+};
+
+template <typename T>
+using aligned_vector = std::vector<T, aligned_allocator<T>>;
+
+} // namespace fonge
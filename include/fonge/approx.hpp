@@ -0,0 +1,101 @@
+#pragma once
+
+#include <simde/x86/avx512.h>
+
+namespace fonge {
+
+// Reciprocal and reciprocal square root estimates refined with Newton-Raphson
+// steps. They back normalized_fast(), rcp_len() and fast_div(). Defining
+// FONGE_FAST_MATH also routes normalized() through them; division stays
+// exact, as code such as ray slabs and box centers relies on it.
+//
+// Relative error bounds for normal inputs:
+//   float, one step on rsqrtps/rcpps:              rsqrt < 2^-21, rcp < 2^-22
+//   double, two steps on float rsqrtps/rcpps:      rsqrt < 2^-43, rcp < 2^-45
+//   double, two steps on AVX-512VL rsqrt14/rcp14:  both < 2^-51
+// The float-seeded double path only covers inputs inside the float range
+// (about 1e-38 to 3e38). The reciprocals keep the estimate where the Newton
+// step is NaN, so 1 / +-0 is +-inf and 1 / +-inf is +-0 as with a division;
+// the reciprocal square roots give NaN for zero and infinity.
+
+// 1 / sqrt(x)
+static inline simde__m128 rsqrt_nr_ps(simde__m128 x) {
+  simde__m128 r = simde_mm_rsqrt_ps(x);
+  simde__m128 hx = simde_mm_mul_ps(x, simde_mm_set1_ps(0.5f));
+  return simde_mm_mul_ps(
+      r, simde_mm_fnmadd_ps(simde_mm_mul_ps(hx, r), r, simde_mm_set1_ps(1.5f)));
+}
+
+// 1 / x
+static inline simde__m128 rcp_nr_ps(simde__m128 x) {
+  simde__m128 r = simde_mm_rcp_ps(x);
+  // 1 - x r is NaN for x = 0 or inf; the estimate stands there
+  simde__m128 e = simde_mm_fnmadd_ps(x, r, simde_mm_set1_ps(1));
+  return simde_mm_blendv_ps(r, simde_mm_fmadd_ps(r, e, r),
+                            simde_mm_cmpord_ps(e, e));
+}
+
+// 8- and 16-lane versions for the packet types. AVX-512 starts from
+// rsqrt14/rcp14, so one step there is within float rounding.
+static inline simde__m256 rsqrt_nr_ps(simde__m256 x) {
+  simde__m256 r = simde_mm256_rsqrt_ps(x);
+  simde__m256 hx = simde_mm256_mul_ps(x, simde_mm256_set1_ps(0.5f));
+  return simde_mm256_mul_ps(
+      r, simde_mm256_fnmadd_ps(simde_mm256_mul_ps(hx, r), r,
+                               simde_mm256_set1_ps(1.5f)));
+}
+
+static inline simde__m256 rcp_nr_ps(simde__m256 x) {
+  simde__m256 r = simde_mm256_rcp_ps(x);
+  simde__m256 e = simde_mm256_fnmadd_ps(x, r, simde_mm256_set1_ps(1));
+  return simde_mm256_blendv_ps(r, simde_mm256_fmadd_ps(r, e, r),
+                               simde_mm256_cmp_ps(e, e, SIMDE_CMP_ORD_Q));
+}
+
+static inline simde__m512 rsqrt_nr_ps(simde__m512 x) {
+  simde__m512 r = simde_mm512_rsqrt14_ps(x);
+  simde__m512 hx = simde_mm512_mul_ps(x, simde_mm512_set1_ps(0.5f));
+  return simde_mm512_mul_ps(
+      r, simde_mm512_fnmadd_ps(simde_mm512_mul_ps(hx, r), r,
+                               simde_mm512_set1_ps(1.5f)));
+}
+
+static inline simde__m512 rcp_nr_ps(simde__m512 x) {
+  simde__m512 r = simde_mm512_rcp14_ps(x);
+  simde__m512 e = simde_mm512_fnmadd_ps(x, r, simde_mm512_set1_ps(1));
+  simde__mmask16 ok = simde_mm512_cmp_ps_mask(e, e, SIMDE_CMP_ORD_Q);
+  return simde_mm512_mask_mov_ps(r, ok, simde_mm512_fmadd_ps(r, e, r));
+}
+
+static inline simde__m256d rsqrt_nr_pd(simde__m256d x) {
+#if defined(SIMDE_X86_AVX512VL_NATIVE)
+  simde__m256d r = _mm256_rsqrt14_pd(x);
+#else
+  simde__m256d r =
+      simde_mm256_cvtps_pd(simde_mm_rsqrt_ps(simde_mm256_cvtpd_ps(x)));
+#endif
+  simde__m256d hx = simde_mm256_mul_pd(x, simde_mm256_set1_pd(0.5));
+  for (int i = 0; i < 2; i++) {
+    r = simde_mm256_mul_pd(
+        r, simde_mm256_fnmadd_pd(simde_mm256_mul_pd(hx, r), r,
+                                 simde_mm256_set1_pd(1.5)));
+  }
+  return r;
+}
+
+static inline simde__m256d rcp_nr_pd(simde__m256d x) {
+#if defined(SIMDE_X86_AVX512VL_NATIVE)
+  simde__m256d r = _mm256_rcp14_pd(x);
+#else
+  simde__m256d r =
+      simde_mm256_cvtps_pd(simde_mm_rcp_ps(simde_mm256_cvtpd_ps(x)));
+#endif
+  for (int i = 0; i < 2; i++) {
+    simde__m256d e = simde_mm256_fnmadd_pd(x, r, simde_mm256_set1_pd(1));
+    r = simde_mm256_blendv_pd(r, simde_mm256_fmadd_pd(r, e, r),
+                              simde_mm256_cmp_pd(e, e, SIMDE_CMP_ORD_Q));
+  }
+  return r;
+}
+
+} // namespace fonge
@@ -0,0 +1,745 @@
+#pragma once
+
+#include "aligned_allocator.hpp"
+#include "shapes.hpp"
+#include "vector_float.hpp"
+#include <algorithm>
+#include <cmath>
+#include <simde/x86/avx2.h>
+#include <stdint.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace fonge {
+
+// Bounding volume hierarchy over AABB3f primitives.
+//
+// bvh is binary, built top-down with a binned surface area heuristic down to
+// leaves of at most bvh_max_leaf primitives; the first levels hand one side
+// of each split to another thread. Nodes are 32
+// bytes, two 16-byte rows of min xyz / max xyz with the links in the w
+// lanes, and both children of a node sit next to each other after it.
+// bvh_wide<N> collapses a bvh into nodes of 4 or 8 children whose bounds are
+// laid out by lane, so one node is tested against a query in one pass.
+//
+// Leaves refer to a run of indices; the primitive boxes are kept in the same
+// order, and every query checks them before calling visit with the index the
+// primitive had at build time. refit() takes boxes that moved and updates
+// the bounds without changing the tree, which stays valid but loosens as the
+// motion grows: rebuild once queries slow down.
+
+static const int bvh_bins = 16;
+static const uint32_t bvh_max_leaf = 4;
+// Ranges smaller than this are not worth a thread.
+static const uint32_t bvh_parallel_min = 1 << 12;
+// From this depth on SAH splits give way to median splits, which bounds the
+// depth by 32 + log2(n) and so the traversal stacks.
+static const int bvh_sah_depth = 32;
+static const int bvh_stack_size = 512;
+
+struct alignas(32) bvh_node {
+  inline bool is_leaf() const { return count != 0; }
+
+  // The w lanes are cleared: as floats the links are denormals, which would
+  // slow down any arithmetic on them.
+  inline simde__m128 lo() const {
+    return simde_mm_blend_ps(simde_mm_load_ps(min), simde_mm_setzero_ps(), 8);
+  }
+
+  inline simde__m128 hi() const {
+    return simde_mm_blend_ps(simde_mm_load_ps(max), simde_mm_setzero_ps(), 8);
+  }
+
+  inline void set_bounds(simde__m128 lo, simde__m128 hi) {
+    uint32_t f = first, c = count;
+    simde_mm_store_ps(min, lo);
+    simde_mm_store_ps(max, hi);
+    first = f;
+    count = c;
+  }
+
+  float min[3];
+  uint32_t first; // left child for inner nodes, first index for leaves
+  float max[3];
+  uint32_t count; // 0 for inner nodes
+};
+
+static_assert(sizeof(bvh_node) == 32, "two nodes per cache line");
+
+// Running bounds, starting out empty.
+struct bvh_bounds {
+  inline bvh_bounds()
+      : lo(simde_mm_set1_ps(INFINITY)), hi(simde_mm_set1_ps(-INFINITY)) {}
+
+  inline bvh_bounds(simde__m128 lo, simde__m128 hi) : lo(lo), hi(hi) {}
+
+  inline void grow(simde__m128 l, simde__m128 h) {
+    lo = simde_mm_min_ps(lo, l);
+    hi = simde_mm_max_ps(hi, h);
+  }
+
+  inline void grow(bvh_bounds b) { grow(b.lo, b.hi); }
+
+  // Half the surface area, the SAH's measure of hit probability.
+  inline float half_area() {
+    float3 e =
+        simde_mm_max_ps(simde_mm_sub_ps(hi, lo), simde_mm_setzero_ps());
+    return e.x() * e.y() + e.y() * e.z() + e.z() * e.x();
+  }
+
+  simde__m128 lo, hi;
+};
+
+static inline float bvh_hmax(simde__m128 v) {
+  v = simde_mm_max_ps(v, simde_mm_movehl_ps(v, v));
+  v = simde_mm_max_ps(v, simde_mm_movehdup_ps(v));
+  return simde_mm_cvtss_f32(v);
+}
+
+static inline float bvh_hmin(simde__m128 v) {
+  v = simde_mm_min_ps(v, simde_mm_movehl_ps(v, v));
+  v = simde_mm_min_ps(v, simde_mm_movehdup_ps(v));
+  return simde_mm_cvtss_f32(v);
+}
+
+// Slab test of the ray o + t d, inv = 1 / d, against lo..hi for t in
+// [0, tmax]. On a hit t_enter is where the ray enters the box, or 0.
+static inline bool bvh_ray_hits(simde__m128 lo, simde__m128 hi, simde__m128 o,
+                                simde__m128 inv, float tmax, float &t_enter) {
+  simde__m128 t1 = simde_mm_mul_ps(simde_mm_sub_ps(lo, o), inv);
+  simde__m128 t2 = simde_mm_mul_ps(simde_mm_sub_ps(hi, o), inv);
+  // The w lanes carry the ray's own interval instead of the links.
+  simde__m128 tn =
+      simde_mm_blend_ps(simde_mm_min_ps(t1, t2), simde_mm_setzero_ps(), 8);
+  simde__m128 tf =
+      simde_mm_blend_ps(simde_mm_max_ps(t1, t2), simde_mm_set1_ps(tmax), 8);
+  t_enter = bvh_hmax(tn);
+  return t_enter <= bvh_hmin(tf);
+}
+
+// Whether lo..hi and qlo..qhi overlap, touching included.
+static inline bool bvh_overlaps(simde__m128 lo, simde__m128 hi,
+                                simde__m128 qlo, simde__m128 qhi) {
+  simde__m128 in =
+      simde_mm_and_ps(simde_mm_cmple_ps(lo, qhi), simde_mm_cmple_ps(qlo, hi));
+  return (simde_mm_movemask_ps(in) & 7) == 7;
+}
+
+// Works on a copy of the primitive boxes held as leaf-shaped nodes, first
+// being the primitive index, so every pass reads and partitions them in
+// order.
+struct bvh_builder {
+  inline bvh_builder(const AABB3f *boxes, size_t n) : prims(n) {
+    for (size_t i = 0; i < n; i++) {
+      prims[i].set_bounds(boxes[i].min_point.simd, boxes[i].max_point.simd);
+      prims[i].first = uint32_t(i);
+      prims[i].count = 1;
+    }
+  }
+
+  // Builds the subtree over prims[begin, end), whose bounds and centroid
+  // bounds are given, into nodes[slot], appending its descendants to nodes.
+  // spawn_depth more levels may split off threads.
+  inline void build(aligned_vector<bvh_node> &nodes, uint32_t slot,
+                    uint32_t begin, uint32_t end, bvh_bounds bounds,
+                    bvh_bounds spread, int depth, int spawn_depth) {
+    nodes[slot].set_bounds(bounds.lo, bounds.hi);
+    uint32_t count = end - begin;
+    bvh_bounds halves[4];
+    uint32_t mid = split(spread, begin, end, depth, halves);
+    if (mid == begin) {
+      nodes[slot].first = begin;
+      nodes[slot].count = count;
+      return;
+    }
+    uint32_t left = uint32_t(nodes.size());
+    nodes.resize(left + 2);
+    nodes[slot].first = left;
+    nodes[slot].count = 0;
+    if (spawn_depth > 0 && count >= bvh_parallel_min) {
+      aligned_vector<bvh_node> left_nodes(1), right_nodes(1);
+      std::thread t([&] {
+        build(left_nodes, 0, begin, mid, halves[0], halves[1], depth + 1,
+              spawn_depth - 1);
+      });
+      build(right_nodes, 0, mid, end, halves[2], halves[3], depth + 1,
+            spawn_depth - 1);
+      t.join();
+      splice(nodes, left, left_nodes);
+      splice(nodes, left + 1, right_nodes);
+    } else {
+      build(nodes, left, begin, mid, halves[0], halves[1], depth + 1, 0);
+      build(nodes, left + 1, mid, end, halves[2], halves[3], depth + 1, 0);
+    }
+  }
+
+  // Bounds and centroid bounds of prims[begin, end).
+  inline void measure(uint32_t begin, uint32_t end, bvh_bounds &bounds,
+                      bvh_bounds &spread) {
+    bounds = spread = bvh_bounds();
+    for (uint32_t i = begin; i < end; i++) {
+      simde__m128 lo = prims[i].lo(), hi = prims[i].hi();
+      bounds.grow(lo, hi);
+      simde__m128 c = centroid(lo, hi);
+      spread.grow(c, c);
+    }
+  }
+
+  static inline simde__m128 centroid(simde__m128 lo, simde__m128 hi) {
+    return simde_mm_mul_ps(simde_mm_add_ps(lo, hi), simde_mm_set1_ps(0.5f));
+  }
+
+  // Partitions prims[begin, end) and returns where the right half starts,
+  // or begin for a leaf. halves gets the bounds and centroid bounds of the
+  // left half, then of the right one.
+  inline uint32_t split(bvh_bounds spread, uint32_t begin, uint32_t end,
+                        int depth, bvh_bounds *halves) {
+    uint32_t count = end - begin;
+    float3 extent = simde_mm_sub_ps(spread.hi, spread.lo);
+    int axis = extent.x() >= extent.y() ? 0 : 1;
+    axis = extent[axis] >= extent.z() ? axis : 2;
+    if (count <= bvh_max_leaf) {
+      return begin;
+    }
+    if (!(extent[axis] > 0) || depth >= bvh_sah_depth) {
+      return median(begin, end, axis, halves);
+    }
+
+    // Bins over twice the centroid, which is what min + max gives.
+    float lo = 2 * float3(spread.lo)[axis];
+    float scale = bvh_bins / (2 * extent[axis]);
+    auto bin_of = [&](const bvh_node &p) {
+      float c = p.min[axis] + p.max[axis];
+      return std::min(int((c - lo) * scale), bvh_bins - 1);
+    };
+    bvh_bounds bins[bvh_bins], bin_spread[bvh_bins];
+    uint32_t counts[bvh_bins] = {};
+    for (uint32_t i = begin; i < end; i++) {
+      int b = bin_of(prims[i]);
+      simde__m128 l = prims[i].lo(), h = prims[i].hi(), c = centroid(l, h);
+      bins[b].grow(l, h);
+      bin_spread[b].grow(c, c);
+      counts[b]++;
+    }
+    // Cost of splitting after bin k, as area times count on both sides.
+    float right_cost[bvh_bins];
+    bvh_bounds right;
+    uint32_t right_count = 0;
+    for (int k = bvh_bins - 1; k > 0; k--) {
+      right.grow(bins[k]);
+      right_count += counts[k];
+      right_cost[k - 1] = right_count ? right.half_area() * right_count : 0;
+    }
+    bvh_bounds left;
+    uint32_t left_count = 0;
+    float best_cost = INFINITY;
+    int best = -1;
+    for (int k = 0; k < bvh_bins - 1; k++) {
+      left.grow(bins[k]);
+      left_count += counts[k];
+      if (left_count == 0 || left_count == count) {
+        continue;
+      }
+      float cost = left.half_area() * left_count + right_cost[k];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best = k;
+      }
+    }
+    if (best < 0) {
+      return median(begin, end, axis, halves);
+    }
+    for (int k = 0; k < bvh_bins; k++) {
+      int half = k <= best ? 0 : 2;
+      halves[half].grow(bins[k]);
+      halves[half + 1].grow(bin_spread[k]);
+    }
+    bvh_node *mid =
+        std::partition(prims.data() + begin, prims.data() + end,
+                       [&](const bvh_node &p) { return bin_of(p) <= best; });
+    return uint32_t(mid - prims.data());
+  }
+
+  // Splits at the median centroid along axis.
+  inline uint32_t median(uint32_t begin, uint32_t end, int axis,
+                         bvh_bounds *halves) {
+    uint32_t mid = begin + (end - begin) / 2;
+    std::nth_element(prims.data() + begin, prims.data() + mid,
+                     prims.data() + end,
+                     [&](const bvh_node &a, const bvh_node &b) {
+                       return a.min[axis] + a.max[axis] <
+                              b.min[axis] + b.max[axis];
+                     });
+    measure(begin, mid, halves[0], halves[1]);
+    measure(mid, end, halves[2], halves[3]);
+    return mid;
+  }
+
+  // Moves a subtree built on its own, root first, into nodes: the root goes
+  // to slot and the rest is appended, with child links shifted to match.
+  static inline void splice(aligned_vector<bvh_node> &nodes, uint32_t slot,
+                            const aligned_vector<bvh_node> &sub) {
+    uint32_t base = uint32_t(nodes.size()) - 1;
+    for (size_t k = 0; k < sub.size(); k++) {
+      bvh_node node = sub[k];
+      if (!node.is_leaf()) {
+        node.first += base;
+      }
+      if (k == 0) {
+        nodes[slot] = node;
+      } else {
+        nodes.push_back(node);
+      }
+    }
+  }
+
+  aligned_vector<bvh_node> prims;
+};
+
+struct bvh {
+  inline bvh() {}
+
+  // threads = 0 uses every hardware thread.
+  inline bvh(const AABB3f *prims, size_t n, int threads = 0) {
+    build(prims, n, threads);
+  }
+
+  inline void build(const AABB3f *prims, size_t n, int threads = 0) {
+    nodes.clear();
+    indices.resize(n);
+    boxes.clear();
+    if (n == 0) {
+      return;
+    }
+    if (threads <= 0) {
+      threads = int(std::thread::hardware_concurrency());
+    }
+    int spawn_depth = 0;
+    while ((1 << spawn_depth) < threads) {
+      spawn_depth++;
+    }
+    bvh_builder builder(prims, n);
+    bvh_bounds bounds, spread;
+    builder.measure(0, uint32_t(n), bounds, spread);
+    nodes.resize(1);
+    builder.build(nodes, 0, 0, uint32_t(n), bounds, spread, 0, spawn_depth);
+    boxes.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+      indices[i] = builder.prims[i].first;
+      boxes.push_back(prims[indices[i]]);
+    }
+  }
+
+  // prims holds the same primitives as at build time, moved.
+  inline void refit(const AABB3f *prims) {
+    for (size_t i = 0; i < indices.size(); i++) {
+      boxes[i] = prims[indices[i]];
+    }
+    // Children come after their parents.
+    for (size_t k = nodes.size(); k-- > 0;) {
+      bvh_node &node = nodes[k];
+      bvh_bounds b;
+      if (node.is_leaf()) {
+        for (uint32_t i = node.first; i < node.first + node.count; i++) {
+          b.grow(boxes[i].min_point.simd, boxes[i].max_point.simd);
+        }
+      } else {
+        b.grow(nodes[node.first].lo(), nodes[node.first].hi());
+        b.grow(nodes[node.first + 1].lo(), nodes[node.first + 1].hi());
+      }
+      node.set_bounds(b.lo, b.hi);
+    }
+  }
+
+  inline size_t size() const { return indices.size(); }
+
+  // visit(i) for every primitive whose box overlaps box.
+  template <typename F> inline void query_box(AABB3f box, F visit) const {
+    if (nodes.empty()) {
+      return;
+    }
+    simde__m128 qlo = box.min_point.simd, qhi = box.max_point.simd;
+    uint32_t stack[bvh_stack_size];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+      const bvh_node &node = nodes[stack[--top]];
+      if (!bvh_overlaps(node.lo(), node.hi(), qlo, qhi)) {
+        continue;
+      }
+      if (!node.is_leaf()) {
+        stack[top++] = node.first + 1;
+        stack[top++] = node.first;
+        continue;
+      }
+      for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        if (bvh_overlaps(boxes[i].min_point.simd, boxes[i].max_point.simd, qlo,
+                         qhi)) {
+          visit(indices[i]);
+        }
+      }
+    }
+  }
+
+  // visit(i) for every primitive whose box contains point.
+  template <typename F> inline void query_point(float3 point, F visit) const {
+    query_box(AABB3f(point, point), visit);
+  }
+
+  // visit(i, tmax) for every primitive whose box the ray origin + t dir
+  // crosses for t in [0, tmax], nearer subtrees first. visit may lower tmax,
+  // say to the distance of a hit, and later primitives are culled against
+  // it.
+  template <typename F>
+  inline void query_ray(float3 origin, float3 dir, float tmax, F visit) const {
+    if (nodes.empty()) {
+      return;
+    }
+    simde__m128 o = origin.simd;
+    simde__m128 inv = simde_mm_div_ps(simde_mm_set1_ps(1), dir.simd);
+    std::pair<uint32_t, float> stack[bvh_stack_size];
+    int top = 0;
+    float t;
+    if (bvh_ray_hits(nodes[0].lo(), nodes[0].hi(), o, inv, tmax, t)) {
+      stack[top++] = std::make_pair(0u, t);
+    }
+    while (top > 0) {
+      std::pair<uint32_t, float> entry = stack[--top];
+      if (entry.second > tmax) {
+        continue;
+      }
+      const bvh_node &node = nodes[entry.first];
+      if (node.is_leaf()) {
+        for (uint32_t i = node.first; i < node.first + node.count; i++) {
+          if (bvh_ray_hits(boxes[i].min_point.simd, boxes[i].max_point.simd, o,
+                           inv, tmax, t)) {
+            visit(indices[i], tmax);
+          }
+        }
+        continue;
+      }
+      float tl, tr;
+      bool hl = bvh_ray_hits(nodes[node.first].lo(), nodes[node.first].hi(), o,
+                             inv, tmax, tl);
+      bool hr = bvh_ray_hits(nodes[node.first + 1].lo(),
+                             nodes[node.first + 1].hi(), o, inv, tmax, tr);
+      std::pair<uint32_t, float> l(node.first, tl), r(node.first + 1, tr);
+      // The nearer child is pushed last and popped first.
+      if (hl && hr) {
+        stack[top++] = tl < tr ? r : l;
+        stack[top++] = tl < tr ? l : r;
+      } else if (hl) {
+        stack[top++] = l;
+      } else if (hr) {
+        stack[top++] = r;
+      }
+    }
+  }
+
+  aligned_vector<bvh_node> nodes;
+  std::vector<uint32_t> indices;
+  aligned_vector<AABB3f> boxes;
+};
+
+// N-lane registers for the wide node tests.
+template <int N> struct bvh_lanes;
+
+template <> struct bvh_lanes<4> {
+  typedef simde__m128 type;
+
+  static inline type load(const float *p) { return simde_mm_load_ps(p); }
+
+  static inline type set1(float f) { return simde_mm_set1_ps(f); }
+
+  static inline type sub(type a, type b) { return simde_mm_sub_ps(a, b); }
+
+  static inline type mul(type a, type b) { return simde_mm_mul_ps(a, b); }
+
+  static inline type min(type a, type b) { return simde_mm_min_ps(a, b); }
+
+  static inline type max(type a, type b) { return simde_mm_max_ps(a, b); }
+
+  static inline void store(float *p, type a) { simde_mm_storeu_ps(p, a); }
+
+  // Bit k set when a <= b in lane k.
+  static inline int le(type a, type b) {
+    return simde_mm_movemask_ps(simde_mm_cmple_ps(a, b));
+  }
+};
+
+template <> struct bvh_lanes<8> {
+  typedef simde__m256 type;
+
+  static inline type load(const float *p) { return simde_mm256_load_ps(p); }
+
+  static inline type set1(float f) { return simde_mm256_set1_ps(f); }
+
+  static inline type sub(type a, type b) { return simde_mm256_sub_ps(a, b); }
+
+  static inline type mul(type a, type b) { return simde_mm256_mul_ps(a, b); }
+
+  static inline type min(type a, type b) { return simde_mm256_min_ps(a, b); }
+
+  static inline type max(type a, type b) { return simde_mm256_max_ps(a, b); }
+
+  static inline void store(float *p, type a) { simde_mm256_storeu_ps(p, a); }
+
+  static inline int le(type a, type b) {
+    return simde_mm256_movemask_ps(simde_mm256_cmp_ps(a, b, SIMDE_CMP_LE_OQ));
+  }
+};
+
+// Up to N children: bounds[0..2] hold the min x, y and z of every lane,
+// bounds[3..5] the max. Unused lanes have child bvh_no_child and bounds at
+// +infinity; an unbounded query still overlaps those, so queries mask them
+// out with used().
+template <int N> struct alignas(32) bvh_wide_node {
+  inline bool is_leaf(int k) const { return count[k] != 0; }
+
+  // Bit k set when lane k holds a child.
+  inline int used() const;
+
+  float bounds[6][N];
+  uint32_t child[N]; // wide node for inner lanes, first index for leaves
+  uint32_t count[N]; // 0 for inner and unused lanes
+};
+
+static const uint32_t bvh_no_child = ~0u;
+
+template <int N> inline int bvh_wide_node<N>::used() const {
+  int bits = 0;
+  for (int k = 0; k < N; k++) {
+    bits |= int(child[k] != bvh_no_child) << k;
+  }
+  return bits;
+}
+
+template <int N> struct bvh_wide {
+  typedef bvh_lanes<N> L;
+
+  inline bvh_wide() {}
+
+  inline bvh_wide(const bvh &tree) { build(tree); }
+
+  inline void build(const bvh &tree) {
+    nodes.clear();
+    indices = tree.indices;
+    boxes = tree.boxes;
+    if (tree.nodes.empty()) {
+      return;
+    }
+    nodes.resize(1);
+    collapse(tree, 0, 0);
+  }
+
+  // As bvh::refit.
+  inline void refit(const AABB3f *prims) {
+    for (size_t i = 0; i < indices.size(); i++) {
+      boxes[i] = prims[indices[i]];
+    }
+    for (size_t w = nodes.size(); w-- > 0;) {
+      for (int k = 0; k < N; k++) {
+        if (nodes[w].child[k] == bvh_no_child) {
+          continue;
+        }
+        bvh_bounds b;
+        uint32_t c = nodes[w].child[k];
+        if (nodes[w].is_leaf(k)) {
+          for (uint32_t i = c; i < c + nodes[w].count[k]; i++) {
+            b.grow(boxes[i].min_point.simd, boxes[i].max_point.simd);
+          }
+        } else {
+          for (int j = 0; j < N; j++) {
+            if (nodes[c].child[j] != bvh_no_child) {
+              b.grow(lane_lo(nodes[c], j), lane_hi(nodes[c], j));
+            }
+          }
+        }
+        set_lane(nodes[w], k, b);
+      }
+    }
+  }
+
+  inline size_t size() const { return indices.size(); }
+
+  template <typename F> inline void query_box(AABB3f box, F visit) const {
+    if (nodes.empty()) {
+      return;
+    }
+    simde__m128 qlo = box.min_point.simd, qhi = box.max_point.simd;
+    typename L::type q[6] = {L::set1(box.min_point.x()),
+                             L::set1(box.min_point.y()),
+                             L::set1(box.min_point.z()),
+                             L::set1(box.max_point.x()),
+                             L::set1(box.max_point.y()),
+                             L::set1(box.max_point.z())};
+    uint32_t stack[bvh_stack_size];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+      const bvh_wide_node<N> &node = nodes[stack[--top]];
+      int hits = node.used();
+      for (int j = 0; j < 3; j++) {
+        hits &= L::le(L::load(node.bounds[j]), q[3 + j]);
+        hits &= L::le(q[j], L::load(node.bounds[3 + j]));
+      }
+      for (; hits; hits &= hits - 1) {
+        int k = lowest_bit(hits);
+        uint32_t c = node.child[k];
+        if (!node.is_leaf(k)) {
+          stack[top++] = c;
+          continue;
+        }
+        for (uint32_t i = c; i < c + node.count[k]; i++) {
+          if (bvh_overlaps(boxes[i].min_point.simd, boxes[i].max_point.simd,
+                           qlo, qhi)) {
+            visit(indices[i]);
+          }
+        }
+      }
+    }
+  }
+
+  template <typename F> inline void query_point(float3 point, F visit) const {
+    query_box(AABB3f(point, point), visit);
+  }
+
+  // As bvh::query_ray, without ordering children by distance.
+  template <typename F>
+  inline void query_ray(float3 origin, float3 dir, float tmax, F visit) const {
+    if (nodes.empty()) {
+      return;
+    }
+    simde__m128 o = origin.simd;
+    simde__m128 inv = simde_mm_div_ps(simde_mm_set1_ps(1), dir.simd);
+    float3 inv3 = inv;
+    typename L::type org[3] = {L::set1(origin.x()), L::set1(origin.y()),
+                               L::set1(origin.z())};
+    typename L::type rcp[3] = {L::set1(inv3.x()), L::set1(inv3.y()),
+                               L::set1(inv3.z())};
+    std::pair<uint32_t, float> stack[bvh_stack_size];
+    int top = 0;
+    stack[top++] = std::make_pair(0u, 0.f);
+    float t_enter[N], t;
+    while (top > 0) {
+      std::pair<uint32_t, float> entry = stack[--top];
+      if (entry.second > tmax) {
+        continue;
+      }
+      const bvh_wide_node<N> &node = nodes[entry.first];
+      typename L::type tn = L::set1(0), tf = L::set1(tmax);
+      for (int j = 0; j < 3; j++) {
+        typename L::type t1 = L::mul(L::sub(L::load(node.bounds[j]), org[j]),
+                                     rcp[j]);
+        typename L::type t2 =
+            L::mul(L::sub(L::load(node.bounds[3 + j]), org[j]), rcp[j]);
+        tn = L::max(tn, L::min(t1, t2));
+        tf = L::min(tf, L::max(t1, t2));
+      }
+      L::store(t_enter, tn);
+      for (int hits = L::le(tn, tf) & node.used(); hits; hits &= hits - 1) {
+        int k = lowest_bit(hits);
+        uint32_t c = node.child[k];
+        if (!node.is_leaf(k)) {
+          stack[top++] = std::make_pair(c, t_enter[k]);
+          continue;
+        }
+        for (uint32_t i = c; i < c + node.count[k]; i++) {
+          if (bvh_ray_hits(boxes[i].min_point.simd, boxes[i].max_point.simd, o,
+                           inv, tmax, t)) {
+            visit(indices[i], tmax);
+          }
+        }
+      }
+    }
+  }
+
+  static inline int lowest_bit(int bits) {
+    int k = 0;
+    while (!(bits & (1 << k))) {
+      k++;
+    }
+    return k;
+  }
+
+  static inline simde__m128 lane_lo(const bvh_wide_node<N> &node, int k) {
+    return simde_mm_setr_ps(node.bounds[0][k], node.bounds[1][k],
+                            node.bounds[2][k], 0);
+  }
+
+  static inline simde__m128 lane_hi(const bvh_wide_node<N> &node, int k) {
+    return simde_mm_setr_ps(node.bounds[3][k], node.bounds[4][k],
+                            node.bounds[5][k], 0);
+  }
+
+  static inline void set_lane(bvh_wide_node<N> &node, int k, bvh_bounds b) {
+    float3 lo = b.lo, hi = b.hi;
+    for (int j = 0; j < 3; j++) {
+      node.bounds[j][k] = lo[j];
+      node.bounds[3 + j][k] = hi[j];
+    }
+  }
+
+  // Fills nodes[w] with the descendants of tree.nodes[b] closest to it: the
+  // inner child with the largest area is replaced by its two children until
+  // there are N, or only leaves.
+  inline void collapse(const bvh &tree, uint32_t b, uint32_t w) {
+    uint32_t kids[N];
+    int n = 0;
+    const bvh_node &root = tree.nodes[b];
+    if (root.is_leaf()) {
+      kids[n++] = b;
+    } else {
+      kids[n++] = root.first;
+      kids[n++] = root.first + 1;
+    }
+    while (n < N) {
+      int widest = -1;
+      float widest_area = -1;
+      for (int k = 0; k < n; k++) {
+        const bvh_node &kid = tree.nodes[kids[k]];
+        float area = bvh_bounds(kid.lo(), kid.hi()).half_area();
+        if (!kid.is_leaf() && area > widest_area) {
+          widest = k;
+          widest_area = area;
+        }
+      }
+      if (widest < 0) {
+        break;
+      }
+      uint32_t first = tree.nodes[kids[widest]].first;
+      kids[widest] = first;
+      kids[n++] = first + 1;
+    }
+    for (int k = 0; k < N; k++) {
+      for (int j = 0; j < 6; j++) {
+        nodes[w].bounds[j][k] = INFINITY;
+      }
+      nodes[w].child[k] = bvh_no_child;
+      nodes[w].count[k] = 0;
+    }
+    for (int k = 0; k < n; k++) {
+      const bvh_node &kid = tree.nodes[kids[k]];
+      set_lane(nodes[w], k, bvh_bounds(kid.lo(), kid.hi()));
+      if (kid.is_leaf()) {
+        nodes[w].child[k] = kid.first;
+        nodes[w].count[k] = kid.count;
+      } else {
+        uint32_t c = uint32_t(nodes.size());
+        nodes.emplace_back();
+        nodes[w].child[k] = c;
+        collapse(tree, kids[k], c);
+      }
+    }
+  }
+
+  aligned_vector<bvh_wide_node<N>> nodes;
+  std::vector<uint32_t> indices;
+  aligned_vector<AABB3f> boxes;
+};
+
+typedef bvh_wide<4> bvh4;
+typedef bvh_wide<8> bvh8;
+
+} // namespace fonge
@@ -6,12 +6,13 @@ template <typename T> static inline T min(T a, T b) { return (a < b) ? a : b; }
 
 template <typename T> static inline T max(T a, T b) { return (a > b) ? a : b; }
 
+// src at t = 0, dst at t = 1, as with slerp.
 template <typename T, typename F> static inline T lerp(T src, T dst, F t) {
-  return src * t + dst * (1 - t);
+  return src * (1 - t) + dst * t;
 }
 
 template <typename T, typename F> static inline T nlerp(T src, T dst, F t) {
-  return (src * t + dst * (1 - t)).normalized();
+  return (src * (1 - t) + dst * t).normalized();
 }
 
 template <typename T, typename F> static inline T slerp(T src, T dst, F t) {
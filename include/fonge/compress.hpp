@@ -0,0 +1,458 @@
+#pragma once
+
+#include "quaternion_batch.hpp"
+#include <cmath>
+#include <stdint.h>
+
+namespace fonge {
+
+// Compact encodings for unit quaternions and unit vectors. Each storage type
+// packs from its float type and unpack()s back; the batch functions run eight
+// items per iteration.
+//
+// quat32/quat48, smallest three: the largest component is dropped (its sign
+// folded into the others, since q and -q are the same rotation) and rebuilt
+// as sqrt(1 - a^2 - b^2 - c^2). Two bits hold its index and the other three
+// get 10 or 15 bits over [-1/sqrt 2, 1/sqrt 2]. Worst rotation error over
+// 2^20 random rotations: 0.25 degrees for quat32, 0.008 degrees for quat48.
+//
+// oct16/oct32, octahedral: the unit vector is projected onto the octahedron
+// |x| + |y| + |z| = 1 and the lower half folded over the upper one, leaving
+// two snorm coordinates of 8 or 16 bits. Worst angle error over 2^20 random
+// directions: 0.96 degrees for oct16, 0.004 degrees for oct32.
+
+// Codes 0 to 2^B - 2, so that 0 (and the identity quaternion) is exact.
+template <int B> struct smallest_three_scale {
+  static constexpr float max = float((1 << B) - 2);
+  // component to quantized value: v * enc + enc_bias
+  static constexpr float enc = max * 0.70710678f;
+  static constexpr float enc_bias = max * 0.5f;
+  // quantized value to component: q * dec - 1 / sqrt 2
+  static constexpr float dec = 1.41421356f / max;
+};
+
+// Index of the largest |component| (the first one on ties), the three others
+// with the sign of the largest folded in, quantized to B bits.
+template <int B>
+static inline void smallest_three_encode(quat q, uint32_t &index,
+                                         uint32_t abc[3]) {
+  typedef smallest_three_scale<B> k;
+  float v[4] = {q.vec.x(), q.vec.y(), q.vec.z(), q.vec.w()};
+  index = 0;
+  for (uint32_t i = 1; i < 4; i++) {
+    if (std::abs(v[i]) > std::abs(v[index])) {
+      index = i;
+    }
+  }
+  float sign = v[index] < 0 ? -1.0f : 1.0f;
+  // Clamped, as components of a quaternion off unit length can fall outside
+  // +-1/sqrt 2 and their codes would spill into the neighbouring field.
+  for (uint32_t i = 0, j = 0; i < 4; i++) {
+    if (i != index) {
+      float c = std::fmin(std::fmax(v[i] * sign * k::enc + k::enc_bias, 0.0f),
+                          k::max);
+      abc[j++] = uint32_t(std::lrint(c));
+    }
+  }
+}
+
+template <int B>
+static inline quat smallest_three_decode(uint32_t index,
+                                         const uint32_t abc[3]) {
+  typedef smallest_three_scale<B> k;
+  float v[4], sum = 0;
+  for (uint32_t i = 0, j = 0; i < 4; i++) {
+    if (i != index) {
+      float c = float(abc[j++]) * k::dec - 0.70710678f;
+      v[i] = c;
+      sum += c * c;
+    }
+  }
+  v[index] = std::sqrt(std::fmax(1 - sum, 0.0f));
+  return float4(v[0], v[1], v[2], v[3]);
+}
+
+// Eight quaternions at a time, with the same tie-breaking as above.
+template <int B>
+static inline void smallest_three_encode8(const quat *src, simde__m256i &index,
+                                          simde__m256i abc[3]) {
+  typedef smallest_three_scale<B> k;
+  quatx8 q = quatx8::load(src);
+  simde__m256 x = q.vec.comps[0].simd, y = q.vec.comps[1].simd,
+              z = q.vec.comps[2].simd, w = q.vec.comps[3].simd;
+  simde__m256 ax = simde_x_mm256_abs_ps(x), ay = simde_x_mm256_abs_ps(y),
+              az = simde_x_mm256_abs_ps(z), aw = simde_x_mm256_abs_ps(w);
+  simde__m256 m = simde_mm256_max_ps(simde_mm256_max_ps(ax, ay),
+                                     simde_mm256_max_ps(az, aw));
+  // index 0, index <= 1 and index <= 2
+  simde__m256 is0 = simde_mm256_cmp_ps(ax, m, SIMDE_CMP_EQ_OQ);
+  simde__m256 le1 =
+      simde_mm256_or_ps(is0, simde_mm256_cmp_ps(ay, m, SIMDE_CMP_EQ_OQ));
+  simde__m256 le2 =
+      simde_mm256_or_ps(le1, simde_mm256_cmp_ps(az, m, SIMDE_CMP_EQ_OQ));
+  index = simde_mm256_add_epi32(
+      simde_mm256_set1_epi32(3),
+      simde_mm256_add_epi32(
+          simde_mm256_castps_si256(is0),
+          simde_mm256_add_epi32(simde_mm256_castps_si256(le1),
+                                simde_mm256_castps_si256(le2))));
+
+  simde__m256 largest = simde_mm256_blendv_ps(
+      simde_mm256_blendv_ps(simde_mm256_blendv_ps(w, z, le2), y, le1), x, is0);
+  simde__m256 sign =
+      simde_mm256_and_ps(largest, simde_mm256_set1_ps(-0.0f));
+  simde__m256 a = simde_mm256_blendv_ps(x, y, is0);
+  simde__m256 b = simde_mm256_blendv_ps(y, z, le1);
+  simde__m256 c = simde_mm256_blendv_ps(z, w, le2);
+  simde__m256 enc = simde_mm256_set1_ps(k::enc);
+  simde__m256 bias = simde_mm256_set1_ps(k::enc_bias);
+  simde__m256 top = simde_mm256_set1_ps(k::max);
+  simde__m256 comps[3] = {a, b, c};
+  for (int j = 0; j < 3; j++) {
+    simde__m256 v = simde_mm256_xor_ps(comps[j], sign);
+    v = simde_mm256_max_ps(simde_mm256_fmadd_ps(v, enc, bias),
+                           simde_mm256_setzero_ps());
+    abc[j] = simde_mm256_cvtps_epi32(simde_mm256_min_ps(v, top));
+  }
+}
+
+template <int B>
+static inline void smallest_three_decode8(simde__m256i index,
+                                          const simde__m256i abc[3],
+                                          quat *dst) {
+  typedef smallest_three_scale<B> k;
+  simde__m256 dec = simde_mm256_set1_ps(k::dec);
+  simde__m256 bias = simde_mm256_set1_ps(-0.70710678f);
+  simde__m256 v[3];
+  simde__m256 rest = simde_mm256_set1_ps(1);
+  for (int j = 0; j < 3; j++) {
+    v[j] = simde_mm256_fmadd_ps(simde_mm256_cvtepi32_ps(abc[j]), dec, bias);
+    rest = simde_mm256_fnmadd_ps(v[j], v[j], rest);
+  }
+  simde__m256 largest = simde_mm256_sqrt_ps(
+      simde_mm256_max_ps(rest, simde_mm256_setzero_ps()));
+  simde__m256 is0 = simde_mm256_castsi256_ps(
+      simde_mm256_cmpeq_epi32(index, simde_mm256_setzero_si256()));
+  simde__m256 le1 = simde_mm256_castsi256_ps(
+      simde_mm256_cmpgt_epi32(simde_mm256_set1_epi32(2), index));
+  simde__m256 le2 = simde_mm256_castsi256_ps(
+      simde_mm256_cmpgt_epi32(simde_mm256_set1_epi32(3), index));
+  simde__m256 x = simde_mm256_blendv_ps(v[0], largest, is0);
+  simde__m256 y = simde_mm256_blendv_ps(
+      simde_mm256_blendv_ps(v[1], largest, le1), v[0], is0);
+  simde__m256 z = simde_mm256_blendv_ps(
+      simde_mm256_blendv_ps(v[2], largest, le2), v[1], le1);
+  simde__m256 w = simde_mm256_blendv_ps(largest, v[2], le2);
+  quatx8(float4x8(float1x8(x), float1x8(y), float1x8(z), float1x8(w)))
+      .store(dst);
+}
+
+// Smallest three in 32 bits: index in bits 30-31, then 10 bits per component.
+struct quat32 {
+  inline quat32() : quat32(quat()) {}
+
+  inline quat32(quat q) {
+    uint32_t index, abc[3];
+    smallest_three_encode<10>(q, index, abc);
+    bits = index << 30 | abc[0] << 20 | abc[1] << 10 | abc[2];
+  }
+
+  inline quat unpack() {
+    uint32_t abc[3] = {bits >> 20 & 0x3ff, bits >> 10 & 0x3ff, bits & 0x3ff};
+    return smallest_three_decode<10>(bits >> 30, abc);
+  }
+
+  uint32_t bits;
+};
+
+// Smallest three in 48 bits: index in bits 45-46, then 15 bits per component.
+struct quat48 {
+  inline quat48() : quat48(quat()) {}
+
+  inline quat48(quat q) {
+    uint32_t index, abc[3];
+    smallest_three_encode<15>(q, index, abc);
+    set(index, abc);
+  }
+
+  inline quat unpack() {
+    uint32_t abc[3];
+    uint32_t index = get(abc);
+    return smallest_three_decode<15>(index, abc);
+  }
+
+  inline void set(uint32_t index, const uint32_t abc[3]) {
+    uint64_t v = uint64_t(index) << 45 | uint64_t(abc[0]) << 30 |
+                 uint64_t(abc[1]) << 15 | abc[2];
+    bits[0] = uint16_t(v);
+    bits[1] = uint16_t(v >> 16);
+    bits[2] = uint16_t(v >> 32);
+  }
+
+  inline uint32_t get(uint32_t abc[3]) {
+    uint64_t v = uint64_t(bits[0]) | uint64_t(bits[1]) << 16 |
+                 uint64_t(bits[2]) << 32;
+    abc[0] = uint32_t(v >> 30) & 0x7fff;
+    abc[1] = uint32_t(v >> 15) & 0x7fff;
+    abc[2] = uint32_t(v) & 0x7fff;
+    return uint32_t(v >> 45);
+  }
+
+  uint16_t bits[3];
+};
+
+static_assert(sizeof(quat32) == 4 && sizeof(quat48) == 6,
+              "packed quaternions have no padding");
+
+template <int B> struct octahedral_scale {
+  static constexpr float max = float((1 << (B - 1)) - 1);
+  static constexpr float inv_max = 1 / max;
+};
+
+// n on the octahedron, lower half folded up, as two B-bit snorms.
+template <int B>
+static inline void octahedral_encode(float3 n, int32_t &u, int32_t &v) {
+  float x = n.x(), y = n.y(), z = n.z();
+  float inv = 1 / (std::abs(x) + std::abs(y) + std::abs(z));
+  float px = x * inv, py = y * inv;
+  if (z < 0) {
+    float fx = std::copysign(1 - std::abs(py), px);
+    py = std::copysign(1 - std::abs(px), py);
+    px = fx;
+  }
+  u = int32_t(std::lrint(px * octahedral_scale<B>::max));
+  v = int32_t(std::lrint(py * octahedral_scale<B>::max));
+}
+
+template <int B> static inline float3 octahedral_decode(int32_t u, int32_t v) {
+  float px = float(u) * octahedral_scale<B>::inv_max;
+  float py = float(v) * octahedral_scale<B>::inv_max;
+  float z = 1 - std::abs(px) - std::abs(py);
+  float t = std::fmax(-z, 0.0f);
+  return float3(px - std::copysign(t, px), py - std::copysign(t, py), z)
+      .normalized();
+}
+
+template <int B>
+static inline void octahedral_encode8(const float3 *src, simde__m256i &u,
+                                      simde__m256i &v) {
+  float3x8 n = float3x8::load(src);
+  simde__m256 x = n.comps[0].simd, y = n.comps[1].simd, z = n.comps[2].simd;
+  simde__m256 signs = simde_mm256_set1_ps(-0.0f);
+  simde__m256 inv = simde_mm256_div_ps(
+      simde_mm256_set1_ps(1),
+      simde_mm256_add_ps(
+          simde_mm256_add_ps(simde_x_mm256_abs_ps(x), simde_x_mm256_abs_ps(y)),
+          simde_x_mm256_abs_ps(z)));
+  simde__m256 px = simde_mm256_mul_ps(x, inv), py = simde_mm256_mul_ps(y, inv);
+  simde__m256 one = simde_mm256_set1_ps(1);
+  simde__m256 fx =
+      simde_mm256_or_ps(simde_mm256_sub_ps(one, simde_x_mm256_abs_ps(py)),
+                        simde_mm256_and_ps(px, signs));
+  simde__m256 fy =
+      simde_mm256_or_ps(simde_mm256_sub_ps(one, simde_x_mm256_abs_ps(px)),
+                        simde_mm256_and_ps(py, signs));
+  simde__m256 lower =
+      simde_mm256_cmp_ps(z, simde_mm256_setzero_ps(), SIMDE_CMP_LT_OQ);
+  simde__m256 scale = simde_mm256_set1_ps(octahedral_scale<B>::max);
+  u = simde_mm256_cvtps_epi32(
+      simde_mm256_mul_ps(simde_mm256_blendv_ps(px, fx, lower), scale));
+  v = simde_mm256_cvtps_epi32(
+      simde_mm256_mul_ps(simde_mm256_blendv_ps(py, fy, lower), scale));
+}
+
+template <int B>
+static inline void octahedral_decode8(simde__m256i u, simde__m256i v,
+                                      float3 *dst) {
+  simde__m256 scale = simde_mm256_set1_ps(octahedral_scale<B>::inv_max);
+  simde__m256 signs = simde_mm256_set1_ps(-0.0f);
+  simde__m256 px = simde_mm256_mul_ps(simde_mm256_cvtepi32_ps(u), scale);
+  simde__m256 py = simde_mm256_mul_ps(simde_mm256_cvtepi32_ps(v), scale);
+  simde__m256 z = simde_mm256_sub_ps(
+      simde_mm256_sub_ps(simde_mm256_set1_ps(1), simde_x_mm256_abs_ps(px)),
+      simde_x_mm256_abs_ps(py));
+  simde__m256 t = simde_mm256_max_ps(simde_mm256_xor_ps(z, signs),
+                                     simde_mm256_setzero_ps());
+  simde__m256 x = simde_mm256_sub_ps(
+      px, simde_mm256_or_ps(t, simde_mm256_and_ps(px, signs)));
+  simde__m256 y = simde_mm256_sub_ps(
+      py, simde_mm256_or_ps(t, simde_mm256_and_ps(py, signs)));
+  float3x8(float1x8(x), float1x8(y), float1x8(z)).normalized().store(dst);
+}
+
+// Octahedral in 16 bits: u in the low byte, v in the high one.
+struct oct16 {
+  inline oct16() : bits(0) {}
+
+  inline oct16(float3 n) {
+    int32_t u, v;
+    octahedral_encode<8>(n, u, v);
+    bits = uint16_t((u & 0xff) | (v & 0xff) << 8);
+  }
+
+  inline float3 unpack() {
+    return octahedral_decode<8>(int8_t(bits), int8_t(bits >> 8));
+  }
+
+  uint16_t bits;
+};
+
+// Octahedral in 32 bits: u in the low half, v in the high one.
+struct oct32 {
+  inline oct32() : bits(0) {}
+
+  inline oct32(float3 n) {
+    int32_t u, v;
+    octahedral_encode<16>(n, u, v);
+    bits = uint32_t(u & 0xffff) | uint32_t(v & 0xffff) << 16;
+  }
+
+  inline float3 unpack() {
+    return octahedral_decode<16>(int16_t(bits), int16_t(bits >> 16));
+  }
+
+  uint32_t bits;
+};
+
+inline void pack_quat32(const quat *src, quat32 *dst, size_t n) {
+  size_t body = n & ~size_t(7);
+  for (size_t i = 0; i < body; i += 8) {
+    simde__m256i index, abc[3];
+    smallest_three_encode8<10>(src + i, index, abc);
+    simde__m256i bits = simde_mm256_or_si256(
+        simde_mm256_or_si256(simde_mm256_slli_epi32(index, 30),
+                             simde_mm256_slli_epi32(abc[0], 20)),
+        simde_mm256_or_si256(simde_mm256_slli_epi32(abc[1], 10), abc[2]));
+    simde_mm256_storeu_si256(reinterpret_cast<simde__m256i *>(dst + i), bits);
+  }
+  for (size_t i = body; i < n; i++) {
+    dst[i] = quat32(src[i]);
+  }
+}
+
+inline void unpack_quat32(const quat32 *src, quat *dst, size_t n) {
+  size_t body = n & ~size_t(7);
+  for (size_t i = 0; i < body; i += 8) {
+    simde__m256i bits = simde_mm256_loadu_si256(
+        reinterpret_cast<const simde__m256i *>(src + i));
+    simde__m256i mask = simde_mm256_set1_epi32(0x3ff);
+    simde__m256i abc[3] = {
+        simde_mm256_and_si256(simde_mm256_srli_epi32(bits, 20), mask),
+        simde_mm256_and_si256(simde_mm256_srli_epi32(bits, 10), mask),
+        simde_mm256_and_si256(bits, mask)};
+    smallest_three_decode8<10>(simde_mm256_srli_epi32(bits, 30), abc, dst + i);
+  }
+  for (size_t i = body; i < n; i++) {
+    dst[i] = quat32(src[i]).unpack();
+  }
+}
+
+// 48-bit fields straddle lanes, so they are packed one lane at a time.
+inline void pack_quat48(const quat *src, quat48 *dst, size_t n) {
+  size_t body = n & ~size_t(7);
+  for (size_t i = 0; i < body; i += 8) {
+    simde__m256i index, abc[3];
+    smallest_three_encode8<15>(src + i, index, abc);
+    alignas(32) uint32_t lanes[4][8];
+    simde_mm256_store_si256(reinterpret_cast<simde__m256i *>(lanes[0]), index);
+    for (int j = 0; j < 3; j++) {
+      simde_mm256_store_si256(reinterpret_cast<simde__m256i *>(lanes[j + 1]),
+                              abc[j]);
+    }
+    for (int l = 0; l < 8; l++) {
+      uint32_t c[3] = {lanes[1][l], lanes[2][l], lanes[3][l]};
+      dst[i + l].set(lanes[0][l], c);
+    }
+  }
+  for (size_t i = body; i < n; i++) {
+    dst[i] = quat48(src[i]);
+  }
+}
+
+inline void unpack_quat48(const quat48 *src, quat *dst, size_t n) {
+  size_t body = n & ~size_t(7);
+  for (size_t i = 0; i < body; i += 8) {
+    alignas(32) uint32_t lanes[4][8];
+    for (int l = 0; l < 8; l++) {
+      uint32_t c[3];
+      lanes[0][l] = quat48(src[i + l]).get(c);
+      lanes[1][l] = c[0];
+      lanes[2][l] = c[1];
+      lanes[3][l] = c[2];
+    }
+    simde__m256i fields[4];
+    for (int j = 0; j < 4; j++) {
+      fields[j] = simde_mm256_load_si256(
+          reinterpret_cast<const simde__m256i *>(lanes[j]));
+    }
+    smallest_three_decode8<15>(fields[0], fields + 1, dst + i);
+  }
+  for (size_t i = body; i < n; i++) {
+    dst[i] = quat48(src[i]).unpack();
+  }
+}
+
+inline void pack_oct16(const float3 *src, oct16 *dst, size_t n) {
+  size_t body = n & ~size_t(7);
+  for (size_t i = 0; i < body; i += 8) {
+    simde__m256i u, v;
+    octahedral_encode8<8>(src + i, u, v);
+    simde__m256i mask = simde_mm256_set1_epi32(0xff);
+    simde__m256i bits = simde_mm256_or_si256(
+        simde_mm256_and_si256(u, mask),
+        simde_mm256_slli_epi32(simde_mm256_and_si256(v, mask), 8));
+    // packus works within 128-bit halves; gather both in the low one
+    bits = simde_mm256_permute4x64_epi64(simde_mm256_packus_epi32(bits, bits),
+                                         0x08);
+    simde_mm_storeu_si128(reinterpret_cast<simde__m128i *>(dst + i),
+                          simde_mm256_castsi256_si128(bits));
+  }
+  for (size_t i = body; i < n; i++) {
+    dst[i] = oct16(src[i]);
+  }
+}
+
+inline void unpack_oct16(const oct16 *src, float3 *dst, size_t n) {
+  size_t body = n & ~size_t(7);
+  for (size_t i = 0; i < body; i += 8) {
+    simde__m256i bits = simde_mm256_cvtepu16_epi32(
+        simde_mm_loadu_si128(reinterpret_cast<const simde__m128i *>(src + i)));
+    octahedral_decode8<8>(
+        simde_mm256_srai_epi32(simde_mm256_slli_epi32(bits, 24), 24),
+        simde_mm256_srai_epi32(simde_mm256_slli_epi32(bits, 16), 24), dst + i);
+  }
+  for (size_t i = body; i < n; i++) {
+    dst[i] = oct16(src[i]).unpack();
+  }
+}
+
+inline void pack_oct32(const float3 *src, oct32 *dst, size_t n) {
+  size_t body = n & ~size_t(7);
+  for (size_t i = 0; i < body; i += 8) {
+    simde__m256i u, v;
+    octahedral_encode8<16>(src + i, u, v);
+    simde__m256i bits = simde_mm256_or_si256(
+        simde_mm256_and_si256(u, simde_mm256_set1_epi32(0xffff)),
+        simde_mm256_slli_epi32(v, 16));
+    simde_mm256_storeu_si256(reinterpret_cast<simde__m256i *>(dst + i), bits);
+  }
+  for (size_t i = body; i < n; i++) {
+    dst[i] = oct32(src[i]);
+  }
+}
+
+inline void unpack_oct32(const oct32 *src, float3 *dst, size_t n) {
+  size_t body = n & ~size_t(7);
+  for (size_t i = 0; i < body; i += 8) {
+    simde__m256i bits = simde_mm256_loadu_si256(
+        reinterpret_cast<const simde__m256i *>(src + i));
+    octahedral_decode8<16>(
+        simde_mm256_srai_epi32(simde_mm256_slli_epi32(bits, 16), 16),
+        simde_mm256_srai_epi32(bits, 16), dst + i);
+  }
+  for (size_t i = body; i < n; i++) {
+    dst[i] = oct32(src[i]).unpack();
+  }
+}
+
+} // namespace fonge
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "matrix_double.hpp"
+#include "quaternion_double.hpp"
+#include "vector_double.hpp"
+#include "vector_int.hpp"
+#include <cmath>
+
+namespace fonge {
+
+// dual_quat in double precision.
+struct dual_dquat {
+  inline dual_dquat() : real(), dual(double4(0)) {}
+
+  inline dual_dquat(dquat real, dquat dual) : real(real), dual(dual) {}
+
+  static inline dual_dquat from_rotation_translation(dquat rotation,
+                                                     double3 translation) {
+    return dual_dquat(rotation, dquat(translation, 0) * rotation * 0.5);
+  }
+
+  static inline dual_dquat from_translation(double3 translation) {
+    return dual_dquat(dquat(), dquat(translation * 0.5, 0));
+  }
+
+  // The rotation and translation of m, whose upper 3x3 must be a rotation.
+  static inline dual_dquat from_mat(double4x4 m) {
+    return from_rotation_translation(dquat::from_rot_mat(double3x3(m)),
+                                     m.col4.xyz());
+  }
+
+  static inline dual_dquat from_mat(double3x4 m) {
+    return from_rotation_translation(dquat::from_rot_mat(m.basis()),
+                                     m.translation());
+  }
+
+  static inline dual_dquat identity() { return dual_dquat(); }
+
+  inline dual_dquat operator+(dual_dquat rhs) {
+    return dual_dquat(real + rhs.real, dual + rhs.dual);
+  }
+
+  inline dual_dquat operator-(dual_dquat rhs) {
+    return dual_dquat(real - rhs.real, dual - rhs.dual);
+  }
+
+  // Applies rhs first, then this.
+  inline dual_dquat operator*(dual_dquat rhs) {
+    return dual_dquat(real * rhs.real, real * rhs.dual + dual * rhs.real);
+  }
+
+  inline dual_dquat &operator*=(dual_dquat rhs) {
+    (*this) = (*this) * rhs;
+    return *this;
+  }
+
+  // Quaternion conjugate of both parts, the inverse of a unit dual_dquat.
+  inline dual_dquat conj() { return dual_dquat(real.conj(), dual.conj()); }
+
+  inline dual_dquat inverse() {
+    dquat inv = real.inverse();
+    return dual_dquat(inv, (inv * dual * inv) * -1.0);
+  }
+
+  // Scales to a unit real part and removes the dual part's component along
+  // it, so the result is a rigid transform again.
+  inline dual_dquat normalized() {
+    double4 r = real.vec, d = dual.vec;
+    double inv_len = 1 / r.len();
+    r *= inv_len;
+    d *= inv_len;
+    return dual_dquat(r, d - r * r.dot(d));
+  }
+
+  inline dquat rotation() { return real; }
+
+  inline double3 translation() {
+    double3 v = real.vec.xyz(), dv = dual.vec.xyz();
+    double w = real.vec.w(), dw = dual.vec.w();
+    return (dv * w - v * dw + v.cross(dv)) * 2;
+  }
+
+  // The rotation alone, for a unit real part.
+  inline double3 transform_direction(double3 dir) {
+    double3 v = real.vec.xyz();
+    double3 t = v.cross(dir) * 2;
+    return dir + t * real.vec.w() + v.cross(t);
+  }
+
+  // Rotation then translation, for a unit dual_dquat.
+  inline double3 transform_point(double3 point) {
+    return transform_direction(point) + translation();
+  }
+
+  inline double4x4 mat4_form() {
+    double4x4 m = real.rot_mat4_form();
+    m.col4 = double4(translation(), 1);
+    return m;
+  }
+
+  inline double3x4 mat3x4_form() {
+    return double3x4(real.rot_mat3_form(), translation());
+  }
+
+  dquat real;
+  dquat dual;
+};
+
+static inline dual_dquat operator*(dual_dquat lhs, double rhs) {
+  return dual_dquat(lhs.real * rhs, lhs.dual * rhs);
+}
+
+static inline dual_dquat operator*(double lhs, dual_dquat rhs) {
+  return rhs * lhs;
+}
+
+static inline dual_dquat blend_bones(const dual_dquat *bones, int4 joints,
+                                     double4 weights) {
+  dual_dquat first = bones[joints[0]];
+  double4 real = first.real.vec * weights[0];
+  double4 dual = first.dual.vec * weights[0];
+  for (int k = 1; k < 4; k++) {
+    dual_dquat b = bones[joints[k]];
+    double w = std::copysign(weights[k], b.real.vec.dot(first.real.vec));
+    real += b.real.vec * w;
+    dual += b.dual.vec * w;
+  }
+  double inv_len = 1 / real.len();
+  return dual_dquat(real * inv_len, dual * inv_len);
+}
+
+inline void skin_points(const dual_dquat *bones, const int4 *joints,
+                        const double4 *weights, const double3 *in, double3 *out,
+                        size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = blend_bones(bones, joints[i], weights[i])
+                 .transform_point(double3(in[i]));
+  }
+}
+
+inline void skin_points(const dual_dquat *bones, const int4 *joints,
+                        const double4 *weights, const double3 *in,
+                        const double3 *normals, double3 *out,
+                        double3 *out_normals, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    dual_dquat dq = blend_bones(bones, joints[i], weights[i]);
+    out[i] = dq.transform_point(double3(in[i]));
+    out_normals[i] = dq.transform_direction(double3(normals[i]));
+  }
+}
+
+} // namespace fonge
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "matrix_float.hpp"
+#include "quaternion_float.hpp"
+#include "vector_float.hpp"
+#include "vector_int.hpp"
+#include <cmath>
+
+namespace fonge {
+
+// Rigid transform as real + e dual: real is the rotation and dual = t real / 2
+// for a translation t applied after it. Eight floats against float4x4's
+// sixteen, and weighted sums of unit dual quaternions stay rigid once
+// normalized, which is what dual quaternion skinning relies on.
+struct dual_quat {
+  inline dual_quat() : real(), dual(float4(0)) {}
+
+  inline dual_quat(quat real, quat dual) : real(real), dual(dual) {}
+
+  static inline dual_quat from_rotation_translation(quat rotation,
+                                                    float3 translation) {
+    return dual_quat(rotation, quat(translation, 0) * rotation * 0.5f);
+  }
+
+  static inline dual_quat from_translation(float3 translation) {
+    return dual_quat(quat(), quat(translation * 0.5f, 0));
+  }
+
+  // The rotation and translation of m, whose upper 3x3 must be a rotation.
+  static inline dual_quat from_mat(float4x4 m) {
+    return from_rotation_translation(quat::from_rot_mat(float3x3(m)),
+                                     m.col4.xyz());
+  }
+
+  static inline dual_quat from_mat(float3x4 m) {
+    return from_rotation_translation(quat::from_rot_mat(m.basis()),
+                                     m.translation());
+  }
+
+  static inline dual_quat identity() { return dual_quat(); }
+
+  inline dual_quat operator+(dual_quat rhs) {
+    return dual_quat(real + rhs.real, dual + rhs.dual);
+  }
+
+  inline dual_quat operator-(dual_quat rhs) {
+    return dual_quat(real - rhs.real, dual - rhs.dual);
+  }
+
+  // Applies rhs first, then this.
+  inline dual_quat operator*(dual_quat rhs) {
+    return dual_quat(real * rhs.real, real * rhs.dual + dual * rhs.real);
+  }
+
+  inline dual_quat &operator*=(dual_quat rhs) {
+    (*this) = (*this) * rhs;
+    return *this;
+  }
+
+  // Quaternion conjugate of both parts, the inverse of a unit dual_quat.
+  inline dual_quat conj() { return dual_quat(real.conj(), dual.conj()); }
+
+  inline dual_quat inverse() {
+    quat inv = real.inverse();
+    return dual_quat(inv, (inv * dual * inv) * -1.0f);
+  }
+
+  // Scales to a unit real part and removes the dual part's component along
+  // it, so the result is a rigid transform again.
+  inline dual_quat normalized() {
+    float4 r = real.vec, d = dual.vec;
+    float inv_len = 1 / r.len();
+    r *= inv_len;
+    d *= inv_len;
+    return dual_quat(r, d - r * r.dot(d));
+  }
+
+  inline quat rotation() { return real; }
+
+  inline float3 translation() {
+    float3 v = real.vec.xyz(), dv = dual.vec.xyz();
+    float w = real.vec.w(), dw = dual.vec.w();
+    return (dv * w - v * dw + v.cross(dv)) * 2;
+  }
+
+  // The rotation alone, for a unit real part.
+  inline float3 transform_direction(float3 dir) {
+    float3 v = real.vec.xyz();
+    float3 t = v.cross(dir) * 2;
+    return dir + t * real.vec.w() + v.cross(t);
+  }
+
+  // Rotation then translation, for a unit dual_quat.
+  inline float3 transform_point(float3 point) {
+    return transform_direction(point) + translation();
+  }
+
+  inline float4x4 mat4_form() {
+    float4x4 m = real.rot_mat4_form();
+    m.col4 = float4(translation(), 1);
+    return m;
+  }
+
+  inline float3x4 mat3x4_form() {
+    return float3x4(real.rot_mat3_form(), translation());
+  }
+
+  quat real;
+  quat dual;
+};
+
+static inline dual_quat operator*(dual_quat lhs, float rhs) {
+  return dual_quat(lhs.real * rhs, lhs.dual * rhs);
+}
+
+static inline dual_quat operator*(float lhs, dual_quat rhs) {
+  return rhs * lhs;
+}
+
+// Weighted sum of bones[joints[k]] by weights[k] for the four influences of
+// one vertex, scaled to a unit real part. Bones on the opposite hemisphere
+// from the first one are negated first: q and -q are the same rotation but
+// would cancel; copysign on the non-negative weight keeps that branch-free.
+// The dual part's component along the real part is left in, translation()
+// does not see it.
+static inline dual_quat blend_bones(const dual_quat *bones, int4 joints,
+                                    float4 weights) {
+  dual_quat first = bones[joints[0]];
+  float4 real = first.real.vec * weights[0], dual = first.dual.vec * weights[0];
+  for (int k = 1; k < 4; k++) {
+    dual_quat b = bones[joints[k]];
+    float w = std::copysign(weights[k], b.real.vec.dot(first.real.vec));
+    real += b.real.vec * w;
+    dual += b.dual.vec * w;
+  }
+  float inv_len = 1 / real.len();
+  return dual_quat(real * inv_len, dual * inv_len);
+}
+
+// Dual quaternion skinning: out[i] is in[i] moved by the blend of its four
+// bone influences. Unused influences need a zero weight and a valid joint.
+inline void skin_points(const dual_quat *bones, const int4 *joints,
+                        const float4 *weights, const float3 *in, float3 *out,
+                        size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = blend_bones(bones, joints[i], weights[i])
+                 .transform_point(float3(in[i]));
+  }
+}
+
+// As above, also rotating the normals.
+inline void skin_points(const dual_quat *bones, const int4 *joints,
+                        const float4 *weights, const float3 *in,
+                        const float3 *normals, float3 *out,
+                        float3 *out_normals, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    dual_quat dq = blend_bones(bones, joints[i], weights[i]);
+    out[i] = dq.transform_point(float3(in[i]));
+    out_normals[i] = dq.transform_direction(float3(normals[i]));
+  }
+}
+
+} // namespace fonge
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "matrix_float.hpp"
+#include "packet_float.hpp"
+#include "shapes.hpp"
+#include "vector_float.hpp"
+#include <simde/x86/avx2.h>
+#include <stdint.h>
+
+namespace fonge {
+
+// View frustum as six planes (n, d), with n . p + d >= 0 on the inside.
+// Planes are normalized so d + n . p is a distance, except one with a zero
+// normal, the far plane of an infinite projection, which passes everything.
+struct frustum {
+  enum { left, right, bottom, top, depth_zero, depth_one, plane_count };
+
+  inline frustum() {}
+
+  // Gribb-Hartmann extraction from the rows of a view-projection m. Clip
+  // depth runs over 0..w as for perspectivef, so depth_zero is the far plane
+  // of a reverse-Z projection and the near plane otherwise. gl_depth selects
+  // -w..w.
+  static inline frustum from_matrix(float4x4 m, bool gl_depth = false) {
+    float4x4 rows = m.transposed();
+    float4 r1 = rows.cols[0], r2 = rows.cols[1], r3 = rows.cols[2],
+           r4 = rows.cols[3];
+    frustum f;
+    f.planes[left] = r4 + r1;
+    f.planes[right] = r4 - r1;
+    f.planes[bottom] = r4 + r2;
+    f.planes[top] = r4 - r2;
+    f.planes[depth_zero] = gl_depth ? r4 + r3 : r3;
+    f.planes[depth_one] = r4 - r3;
+    for (int i = 0; i < plane_count; i++) {
+      float len = f.planes[i].xyz().len();
+      if (len > 0) {
+        f.planes[i] = f.planes[i] / len;
+      }
+    }
+    return f;
+  }
+
+  inline bool contains(float3 point) {
+    for (int i = 0; i < plane_count; i++) {
+      if (planes[i].xyz().dot(point) + planes[i].w() < 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // False only when the box is entirely behind one plane; boxes near a
+  // corner of the frustum can pass without touching it.
+  inline bool intersects(AABB3f box) {
+    float3 center = box.centroid(), extent = box.dimensions() * 0.5f;
+    for (int i = 0; i < plane_count; i++) {
+      float3 n = planes[i].xyz();
+      if (n.dot(center) + n.abs().dot(extent) + planes[i].w() < 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  inline bool intersects(float3 center, float radius) {
+    for (int i = 0; i < plane_count; i++) {
+      if (planes[i].xyz().dot(center) + planes[i].w() < -radius) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  float4 planes[plane_count];
+};
+
+// The batch culls take eight boxes or spheres per iteration, transposed to
+// one register per coordinate, against each plane broadcast to all lanes.
+// Results match intersects() up to rounding at the planes.
+
+// One lane per plane coefficient, and per coefficient's absolute value.
+struct frustum_x8 {
+  inline frustum_x8(frustum f) {
+    for (int i = 0; i < frustum::plane_count; i++) {
+      float4 p = f.planes[i];
+      n[i][0] = simde_mm256_set1_ps(p.x());
+      n[i][1] = simde_mm256_set1_ps(p.y());
+      n[i][2] = simde_mm256_set1_ps(p.z());
+      d[i] = simde_mm256_set1_ps(p.w());
+      float4 a = p.abs();
+      abs_n[i][0] = simde_mm256_set1_ps(a.x());
+      abs_n[i][1] = simde_mm256_set1_ps(a.y());
+      abs_n[i][2] = simde_mm256_set1_ps(a.z());
+    }
+  }
+
+  // Bit k set when boxes[k] is not behind any plane.
+  inline int visible(const AABB3f *boxes) {
+    // Each box is a row of eight floats: min xyzw, max xyzw.
+    simde__m256 lo[3], hi[3];
+    packet_transpose_rows8(reinterpret_cast<const float *>(boxes), 8, lo, hi);
+    simde__m256 half = simde_mm256_set1_ps(0.5f);
+    simde__m256 c[3], e[3];
+    for (int j = 0; j < 3; j++) {
+      c[j] = simde_mm256_mul_ps(simde_mm256_add_ps(lo[j], hi[j]), half);
+      e[j] = simde_mm256_mul_ps(simde_mm256_sub_ps(hi[j], lo[j]), half);
+    }
+    simde__m256 outside = simde_mm256_setzero_ps();
+    for (int i = 0; i < frustum::plane_count; i++) {
+      simde__m256 dist = d[i];
+      for (int j = 0; j < 3; j++) {
+        dist = simde_mm256_fmadd_ps(n[i][j], c[j], dist);
+        dist = simde_mm256_fmadd_ps(abs_n[i][j], e[j], dist);
+      }
+      outside = simde_mm256_or_ps(
+          outside,
+          simde_mm256_cmp_ps(dist, simde_mm256_setzero_ps(), SIMDE_CMP_LT_OQ));
+    }
+    return ~simde_mm256_movemask_ps(outside) & 0xff;
+  }
+
+  // Bit k set when spheres[k], center xyz and radius w, is not behind any
+  // plane.
+  inline int visible(const float4 *spheres) {
+    simde__m256 r[4];
+    for (int k = 0; k < 4; k++) {
+      r[k] = simde_mm256_insertf128_ps(
+          simde_mm256_castps128_ps256(spheres[k].simd), spheres[k + 4].simd, 1);
+    }
+    simde__m256 t0 = simde_mm256_unpacklo_ps(r[0], r[1]),
+                t1 = simde_mm256_unpackhi_ps(r[0], r[1]),
+                t2 = simde_mm256_unpacklo_ps(r[2], r[3]),
+                t3 = simde_mm256_unpackhi_ps(r[2], r[3]);
+    simde__m256 c[3] = {simde_mm256_shuffle_ps(t0, t2, 0x44),
+                        simde_mm256_shuffle_ps(t0, t2, 0xee),
+                        simde_mm256_shuffle_ps(t1, t3, 0x44)};
+    simde__m256 neg_radius = simde_x_mm256_negate_ps(
+        simde_mm256_shuffle_ps(t1, t3, 0xee));
+    simde__m256 outside = simde_mm256_setzero_ps();
+    for (int i = 0; i < frustum::plane_count; i++) {
+      simde__m256 dist = d[i];
+      for (int j = 0; j < 3; j++) {
+        dist = simde_mm256_fmadd_ps(n[i][j], c[j], dist);
+      }
+      outside = simde_mm256_or_ps(
+          outside, simde_mm256_cmp_ps(dist, neg_radius, SIMDE_CMP_LT_OQ));
+    }
+    return ~simde_mm256_movemask_ps(outside) & 0xff;
+  }
+
+  simde__m256 n[frustum::plane_count][3];
+  simde__m256 abs_n[frustum::plane_count][3];
+  simde__m256 d[frustum::plane_count];
+};
+
+static inline bool frustum_visible(frustum &f, AABB3f box) {
+  return f.intersects(box);
+}
+
+static inline bool frustum_visible(frustum &f, float4 sphere) {
+  return f.intersects(sphere.xyz(), sphere.w());
+}
+
+// Bit i % 8 of mask[i / 8] is set when shapes[i] may be visible. T is
+// AABB3f, or float4 for spheres (center xyz, radius w).
+template <typename T>
+inline void cull_mask(frustum f, const T *shapes, size_t n, uint8_t *mask) {
+  frustum_x8 f8(f);
+  batch_mask(
+      shapes, n, mask, [&](const T *eight) { return f8.visible(eight); },
+      [&](const T &shape) { return frustum_visible(f, shape); });
+}
+
+// Writes the indices of the shapes that may be visible, in order, to
+// visible, which needs room for n. Returns how many there are.
+template <typename T>
+inline size_t cull(frustum f, const T *shapes, size_t n, uint32_t *visible) {
+  frustum_x8 f8(f);
+  return batch_list(
+      shapes, n, visible, [&](const T *eight) { return f8.visible(eight); },
+      [&](const T &shape) { return frustum_visible(f, shape); });
+}
+
+} // namespace fonge
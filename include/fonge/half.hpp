@@ -0,0 +1,298 @@
+#pragma once
+
+#include "vector_float.hpp"
+#include <simde/x86/avx512.h>
+#include <simde/x86/f16c.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace fonge {
+
+// Storage-only vectors for bandwidth-bound buffers such as normals, tangents
+// and colors. They hold raw bits; unpack to float2/float4 for arithmetic.
+//   half:     IEEE binary16, 11 significant bits, finite up to 65504.
+//   bfloat16: the top half of a float, 8 significant bits, float's range.
+// Packing rounds to nearest even. Batches convert 8 floats per instruction
+// through F16C, 16 on AVX-512F; simde emulates F16C where it is missing.
+
+#define FONGE_HALF_ROUND SIMDE_MM_FROUND_TO_NEAREST_INT
+
+static inline uint16_t float_to_half(float f) {
+  return uint16_t(simde_mm_cvtsi128_si32(
+      simde_mm_cvtps_ph(simde_mm_set_ss(f), FONGE_HALF_ROUND)));
+}
+
+static inline float half_to_float(uint16_t h) {
+  return simde_mm_cvtss_f32(simde_mm_cvtph_ps(simde_mm_cvtsi32_si128(h)));
+}
+
+static inline uint16_t float_to_bfloat16(float f) {
+  uint32_t u;
+  memcpy(&u, &f, sizeof(u));
+  if ((u & 0x7fffffff) > 0x7f800000) {
+    return uint16_t((u >> 16) | 0x40); // keep NaNs quiet
+  }
+  return uint16_t((u + 0x7fff + ((u >> 16) & 1)) >> 16);
+}
+
+static inline float bfloat16_to_float(uint16_t b) {
+  uint32_t u = uint32_t(b) << 16;
+  float f;
+  memcpy(&f, &u, sizeof(f));
+  return f;
+}
+
+// float_to_bfloat16 on each lane, leaving the result in the low 16 bits.
+static inline simde__m128i bfloat16_bits(simde__m128 v) {
+  simde__m128i u = simde_mm_castps_si128(v);
+  simde__m128i hi = simde_mm_srli_epi32(u, 16);
+  simde__m128i bias = simde_mm_add_epi32(
+      simde_mm_and_si128(hi, simde_mm_set1_epi32(1)),
+      simde_mm_set1_epi32(0x7fff));
+  simde__m128i rounded = simde_mm_srli_epi32(simde_mm_add_epi32(u, bias), 16);
+  simde__m128i nan = simde_mm_or_si128(hi, simde_mm_set1_epi32(0x40));
+  simde__m128 is_nan = simde_mm_cmpunord_ps(v, v);
+  return simde_mm_blendv_epi8(rounded, nan, simde_mm_castps_si128(is_nan));
+}
+
+static inline simde__m256i bfloat16_bits(simde__m256 v) {
+  simde__m256i u = simde_mm256_castps_si256(v);
+  simde__m256i hi = simde_mm256_srli_epi32(u, 16);
+  simde__m256i bias = simde_mm256_add_epi32(
+      simde_mm256_and_si256(hi, simde_mm256_set1_epi32(1)),
+      simde_mm256_set1_epi32(0x7fff));
+  simde__m256i rounded =
+      simde_mm256_srli_epi32(simde_mm256_add_epi32(u, bias), 16);
+  simde__m256i nan = simde_mm256_or_si256(hi, simde_mm256_set1_epi32(0x40));
+  simde__m256 is_nan = simde_mm256_cmp_ps(v, v, SIMDE_CMP_UNORD_Q);
+  return simde_mm256_blendv_epi8(rounded, nan,
+                                 simde_mm256_castps_si256(is_nan));
+}
+
+// Eight floats to bfloat16 and back. packus works within 128-bit halves, so
+// the permute gathers both results in the low one.
+static inline simde__m128i bfloat16_pack8(simde__m256 v) {
+  simde__m256i b = bfloat16_bits(v);
+  b = simde_mm256_permute4x64_epi64(simde_mm256_packus_epi32(b, b), 0x08);
+  return simde_mm256_castsi256_si128(b);
+}
+
+static inline simde__m256 bfloat16_unpack8(simde__m128i b) {
+  return simde_mm256_castsi256_ps(
+      simde_mm256_slli_epi32(simde_mm256_cvtepu16_epi32(b), 16));
+}
+
+// Four float2 in one register and back, keeping float2's zero upper lanes.
+static inline simde__m256 load_float2x4(const float2 *in) {
+  simde__m128 lo = simde_mm_movelh_ps(in[0].simd, in[1].simd);
+  simde__m128 hi = simde_mm_movelh_ps(in[2].simd, in[3].simd);
+  return simde_mm256_insertf128_ps(simde_mm256_castps128_ps256(lo), hi, 1);
+}
+
+static inline void store_float2x4(simde__m256 v, float2 *out) {
+  simde__m128 zero = simde_mm_setzero_ps();
+  simde__m128 lo = simde_mm256_castps256_ps128(v);
+  simde__m128 hi = simde_mm256_extractf128_ps(v, 1);
+  out[0] = simde_mm_movelh_ps(lo, zero);
+  out[1] = simde_mm_movehl_ps(zero, lo);
+  out[2] = simde_mm_movelh_ps(hi, zero);
+  out[3] = simde_mm_movehl_ps(zero, hi);
+}
+
+struct half2 {
+  inline half2() : bits{0, 0} {}
+
+  inline half2(float2 v) {
+    int32_t h =
+        simde_mm_cvtsi128_si32(simde_mm_cvtps_ph(v.simd, FONGE_HALF_ROUND));
+    memcpy(bits, &h, sizeof(bits));
+  }
+
+  inline float2 unpack() {
+    int32_t h;
+    memcpy(&h, bits, sizeof(h));
+    return simde_mm_cvtph_ps(simde_mm_cvtsi32_si128(h));
+  }
+
+  uint16_t bits[2];
+};
+
+struct half4 {
+  inline half4() : bits{0, 0, 0, 0} {}
+
+  inline half4(float4 v) {
+    simde_mm_storel_epi64(reinterpret_cast<simde__m128i *>(bits),
+                          simde_mm_cvtps_ph(v.simd, FONGE_HALF_ROUND));
+  }
+
+  inline float4 unpack() {
+    return simde_mm_cvtph_ps(
+        simde_mm_loadl_epi64(reinterpret_cast<const simde__m128i *>(bits)));
+  }
+
+  uint16_t bits[4];
+};
+
+struct bfloat2 {
+  inline bfloat2() : bits{0, 0} {}
+
+  inline bfloat2(float2 v)
+      : bits{float_to_bfloat16(v.x()), float_to_bfloat16(v.y())} {}
+
+  inline float2 unpack() {
+    return float2(bfloat16_to_float(bits[0]), bfloat16_to_float(bits[1]));
+  }
+
+  uint16_t bits[2];
+};
+
+struct bfloat4 {
+  inline bfloat4() : bits{0, 0, 0, 0} {}
+
+  inline bfloat4(float4 v) {
+    simde__m128i b = bfloat16_bits(v.simd);
+    simde_mm_storel_epi64(reinterpret_cast<simde__m128i *>(bits),
+                          simde_mm_packus_epi32(b, b));
+  }
+
+  inline float4 unpack() {
+    simde__m128i b =
+        simde_mm_loadl_epi64(reinterpret_cast<const simde__m128i *>(bits));
+    return simde_mm_castsi128_ps(
+        simde_mm_slli_epi32(simde_mm_cvtepu16_epi32(b), 16));
+  }
+
+  uint16_t bits[4];
+};
+
+static_assert(sizeof(half2) == 4 && sizeof(half4) == 8 &&
+                  sizeof(bfloat2) == 4 && sizeof(bfloat4) == 8,
+              "half arrays are tightly packed");
+
+// out[i] = half of in[i], for n floats.
+inline void pack_half(const float *in, uint16_t *out, size_t n) {
+  size_t i = 0;
+#if defined(SIMDE_X86_AVX512F_NATIVE)
+  for (; i + 16 <= n; i += 16) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                        _mm512_cvtps_ph(_mm512_loadu_ps(in + i),
+                                        FONGE_HALF_ROUND));
+  }
+#endif
+  for (; i + 8 <= n; i += 8) {
+    simde_mm_storeu_si128(
+        reinterpret_cast<simde__m128i *>(out + i),
+        simde_mm256_cvtps_ph(simde_mm256_loadu_ps(in + i), FONGE_HALF_ROUND));
+  }
+  for (; i < n; i++) {
+    out[i] = float_to_half(in[i]);
+  }
+}
+
+inline void unpack_half(const uint16_t *in, float *out, size_t n) {
+  size_t i = 0;
+#if defined(SIMDE_X86_AVX512F_NATIVE)
+  for (; i + 16 <= n; i += 16) {
+    _mm512_storeu_ps(out + i, _mm512_cvtph_ps(_mm256_loadu_si256(
+                                  reinterpret_cast<const __m256i *>(in + i))));
+  }
+#endif
+  for (; i + 8 <= n; i += 8) {
+    simde_mm256_storeu_ps(out + i,
+                          simde_mm256_cvtph_ps(simde_mm_loadu_si128(
+                              reinterpret_cast<const simde__m128i *>(in + i))));
+  }
+  for (; i < n; i++) {
+    out[i] = half_to_float(in[i]);
+  }
+}
+
+inline void pack_bfloat16(const float *in, uint16_t *out, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    simde_mm_storeu_si128(reinterpret_cast<simde__m128i *>(out + i),
+                          bfloat16_pack8(simde_mm256_loadu_ps(in + i)));
+  }
+  for (; i < n; i++) {
+    out[i] = float_to_bfloat16(in[i]);
+  }
+}
+
+inline void unpack_bfloat16(const uint16_t *in, float *out, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    simde_mm256_storeu_ps(out + i,
+                          bfloat16_unpack8(simde_mm_loadu_si128(
+                              reinterpret_cast<const simde__m128i *>(in + i))));
+  }
+  for (; i < n; i++) {
+    out[i] = bfloat16_to_float(in[i]);
+  }
+}
+
+// float4 arrays are dense, so they convert as 4 n floats.
+inline void pack_half(const float4 *in, half4 *out, size_t n) {
+  pack_half(reinterpret_cast<const float *>(in), out->bits, 4 * n);
+}
+
+inline void unpack_half(const half4 *in, float4 *out, size_t n) {
+  unpack_half(in->bits, reinterpret_cast<float *>(out), 4 * n);
+}
+
+inline void pack_bfloat16(const float4 *in, bfloat4 *out, size_t n) {
+  pack_bfloat16(reinterpret_cast<const float *>(in), out->bits, 4 * n);
+}
+
+inline void unpack_bfloat16(const bfloat4 *in, float4 *out, size_t n) {
+  unpack_bfloat16(in->bits, reinterpret_cast<float *>(out), 4 * n);
+}
+
+// float2 fills a 128-bit register, so four of them are merged per batch.
+inline void pack_half(const float2 *in, half2 *out, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    simde_mm_storeu_si128(
+        reinterpret_cast<simde__m128i *>(out + i),
+        simde_mm256_cvtps_ph(load_float2x4(in + i), FONGE_HALF_ROUND));
+  }
+  for (; i < n; i++) {
+    out[i] = half2(in[i]);
+  }
+}
+
+inline void unpack_half(const half2 *in, float2 *out, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    store_float2x4(simde_mm256_cvtph_ps(simde_mm_loadu_si128(
+                       reinterpret_cast<const simde__m128i *>(in + i))),
+                   out + i);
+  }
+  for (; i < n; i++) {
+    out[i] = half2(in[i]).unpack();
+  }
+}
+
+inline void pack_bfloat16(const float2 *in, bfloat2 *out, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    simde_mm_storeu_si128(reinterpret_cast<simde__m128i *>(out + i),
+                          bfloat16_pack8(load_float2x4(in + i)));
+  }
+  for (; i < n; i++) {
+    out[i] = bfloat2(in[i]);
+  }
+}
+
+inline void unpack_bfloat16(const bfloat2 *in, float2 *out, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    store_float2x4(bfloat16_unpack8(simde_mm_loadu_si128(
+                       reinterpret_cast<const simde__m128i *>(in + i))),
+                   out + i);
+  }
+  for (; i < n; i++) {
+    out[i] = bfloat2(in[i]).unpack();
+  }
+}
+
+} // namespace fonge
@@ -0,0 +1,347 @@
+#pragma once
+
+#include "compress.hpp"
+#include "dual_quaternion_double.hpp"
+#include "dual_quaternion_float.hpp"
+#include "half.hpp"
+#include "matrix_double.hpp"
+#include "matrix_float.hpp"
+#include "packed.hpp"
+#include "quaternion_double.hpp"
+#include "quaternion_float.hpp"
+#include "vector_double.hpp"
+#include "vector_float.hpp"
+#include "vector_int.hpp"
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace fonge {
+
+// A binary container of named arrays, read back zero-copy through mmap.
+//
+// Layout: a 64-byte file header, then for each array a 64-byte array header
+// followed by its elements, padded to a multiple of 64 bytes. Elements are
+// stored exactly as they are in memory (float3 keeps its w lane), so the
+// mapping is the array: every array starts 64-byte aligned and readers get
+// spans into it without parsing or copying. Byte order is the writer's; a
+// file written on a machine of the other endianness fails to open rather
+// than being swapped.
+//
+// POSIX only (open, mmap, pwrite). Nothing throws: open() and close()
+// report failure, and at() and find() return an empty span for a missing
+// array or one of a different type.
+
+static const size_t mapped_alignment = 64;
+static const uint32_t mapped_version = 1;
+static const uint32_t mapped_endian_tag = 0x01020304;
+
+// Element type codes written to the array headers. Codes are part of the
+// file format: add new types at the end and never renumber.
+template <typename T> struct mapped_type;
+
+#define FONGE_MAPPED_TYPE(T, code)                                             \
+  template <> struct mapped_type<T> {                                          \
+    static const uint32_t id = code;                                           \
+  };
+
+FONGE_MAPPED_TYPE(float, 1)
+FONGE_MAPPED_TYPE(double, 2)
+FONGE_MAPPED_TYPE(int32_t, 3)
+FONGE_MAPPED_TYPE(uint32_t, 4)
+FONGE_MAPPED_TYPE(uint16_t, 5)
+FONGE_MAPPED_TYPE(float2, 16)
+FONGE_MAPPED_TYPE(float3, 17)
+FONGE_MAPPED_TYPE(float4, 18)
+FONGE_MAPPED_TYPE(double2, 19)
+FONGE_MAPPED_TYPE(double3, 20)
+FONGE_MAPPED_TYPE(double4, 21)
+FONGE_MAPPED_TYPE(int2, 22)
+FONGE_MAPPED_TYPE(int3, 23)
+FONGE_MAPPED_TYPE(int4, 24)
+FONGE_MAPPED_TYPE(float2x2, 32)
+FONGE_MAPPED_TYPE(float3x3, 33)
+FONGE_MAPPED_TYPE(float4x4, 34)
+FONGE_MAPPED_TYPE(float3x4, 35)
+FONGE_MAPPED_TYPE(double2x2, 36)
+FONGE_MAPPED_TYPE(double3x3, 37)
+FONGE_MAPPED_TYPE(double4x4, 38)
+FONGE_MAPPED_TYPE(double3x4, 39)
+FONGE_MAPPED_TYPE(quat, 48)
+FONGE_MAPPED_TYPE(dquat, 49)
+FONGE_MAPPED_TYPE(dual_quat, 50)
+FONGE_MAPPED_TYPE(dual_dquat, 51)
+FONGE_MAPPED_TYPE(packed_float3, 64)
+FONGE_MAPPED_TYPE(packed_double3, 65)
+FONGE_MAPPED_TYPE(half2, 66)
+FONGE_MAPPED_TYPE(half4, 67)
+FONGE_MAPPED_TYPE(bfloat2, 68)
+FONGE_MAPPED_TYPE(bfloat4, 69)
+FONGE_MAPPED_TYPE(quat32, 70)
+FONGE_MAPPED_TYPE(quat48, 71)
+FONGE_MAPPED_TYPE(oct16, 72)
+FONGE_MAPPED_TYPE(oct32, 73)
+
+#undef FONGE_MAPPED_TYPE
+
+struct mapped_file_header {
+  char magic[8]; // "FONGEMAP"
+  uint32_t version;
+  uint32_t endian; // mapped_endian_tag in the writer's byte order
+  uint32_t alignment;
+  uint32_t reserved[11];
+};
+
+struct mapped_array_header {
+  uint32_t type;      // mapped_type<T>::id
+  uint32_t elem_size; // sizeof(T)
+  uint32_t alignment; // alignof(T), at most mapped_alignment
+  uint32_t reserved;
+  uint64_t count;
+  uint64_t bytes; // count * elem_size, before padding
+  char name[32];  // zero-terminated
+};
+
+static_assert(sizeof(mapped_file_header) == mapped_alignment &&
+                  sizeof(mapped_array_header) == mapped_alignment,
+              "headers keep the arrays aligned");
+
+static inline uint64_t mapped_padded(uint64_t bytes) {
+  return (bytes + mapped_alignment - 1) & ~uint64_t(mapped_alignment - 1);
+}
+
+// Read-only view of count elements inside a mapping.
+template <typename T> struct mapped_span {
+  inline mapped_span() : data(nullptr), count(0) {}
+
+  inline mapped_span(const T *data, size_t count) : data(data), count(count) {}
+
+  inline const T &operator[](size_t i) const { return data[i]; }
+
+  inline const T *begin() const { return data; }
+
+  inline const T *end() const { return data + count; }
+
+  inline size_t size() const { return count; }
+
+  inline bool empty() const { return count == 0; }
+
+  const T *data;
+  size_t count;
+};
+
+// Maps a container file and indexes its arrays. The spans stay valid until
+// close() or destruction.
+struct mapped_file {
+  inline mapped_file() : base(nullptr), length(0) {}
+
+  inline ~mapped_file() { close(); }
+
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  // False if the file is missing, truncated, from another version or of the
+  // other byte order.
+  inline bool open(const char *path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < mapped_alignment) {
+      ::close(fd);
+      return false;
+    }
+    length = size_t(st.st_size);
+    void *p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+      length = 0;
+      return false;
+    }
+    base = static_cast<const char *>(p);
+    if (!index()) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  inline void close() {
+    if (base) {
+      munmap(const_cast<char *>(base), length);
+    }
+    base = nullptr;
+    length = 0;
+    arrays.clear();
+  }
+
+  inline bool is_open() const { return base != nullptr; }
+
+  inline size_t array_count() const { return arrays.size(); }
+
+  inline const mapped_array_header &header(size_t i) const {
+    return *arrays[i];
+  }
+
+  // The i-th array, empty when it holds another type.
+  template <typename T> inline mapped_span<T> at(size_t i) const {
+    const mapped_array_header *h = arrays[i];
+    if (h->type != mapped_type<T>::id || h->elem_size != sizeof(T)) {
+      return mapped_span<T>();
+    }
+    return mapped_span<T>(reinterpret_cast<const T *>(h + 1),
+                          size_t(h->count));
+  }
+
+  // The first array called name, empty when there is none of type T.
+  template <typename T> inline mapped_span<T> find(const char *name) const {
+    for (size_t i = 0; i < arrays.size(); i++) {
+      if (strncmp(arrays[i]->name, name, sizeof(arrays[i]->name)) == 0) {
+        return at<T>(i);
+      }
+    }
+    return mapped_span<T>();
+  }
+
+  const char *base;
+  size_t length;
+  std::vector<const mapped_array_header *> arrays;
+
+  // Checks the file header and every array header against the file size,
+  // filling arrays.
+  inline bool index() {
+    const mapped_file_header *f =
+        reinterpret_cast<const mapped_file_header *>(base);
+    if (memcmp(f->magic, "FONGEMAP", 8) != 0 ||
+        f->version != mapped_version || f->endian != mapped_endian_tag ||
+        f->alignment != mapped_alignment) {
+      return false;
+    }
+    uint64_t at = mapped_alignment;
+    while (at < length) {
+      if (length - at < mapped_alignment) {
+        return false;
+      }
+      const mapped_array_header *h =
+          reinterpret_cast<const mapped_array_header *>(base + at);
+      // bytes is bounded before padding, which would wrap near 2^64, and
+      // count by bytes.
+      uint64_t room = length - at - mapped_alignment;
+      if (h->elem_size == 0 || h->bytes > room ||
+          h->bytes / h->elem_size != h->count ||
+          h->bytes % h->elem_size != 0 || mapped_padded(h->bytes) > room ||
+          h->name[sizeof(h->name) - 1] != 0) {
+        return false;
+      }
+      arrays.push_back(h);
+      at += mapped_alignment + mapped_padded(h->bytes);
+    }
+    return true;
+  }
+};
+
+// Streams arrays into a container file. write() stores a whole array;
+// begin(), append() and end() build one from chunks of unknown total size,
+// patching the count into its header at end(). Errors are sticky and
+// reported by close(), so a loop of appends needs no checks.
+struct mapped_file_writer {
+  inline mapped_file_writer() : fd(-1), at(0), header_at(0), failed(false) {}
+
+  inline ~mapped_file_writer() { close(); }
+
+  mapped_file_writer(const mapped_file_writer &) = delete;
+  mapped_file_writer &operator=(const mapped_file_writer &) = delete;
+
+  inline bool open(const char *path) {
+    close();
+    fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    failed = fd < 0;
+    at = 0;
+    if (failed) {
+      return false;
+    }
+    mapped_file_header f;
+    memset(&f, 0, sizeof(f));
+    memcpy(f.magic, "FONGEMAP", 8);
+    f.version = mapped_version;
+    f.endian = mapped_endian_tag;
+    f.alignment = mapped_alignment;
+    put(&f, sizeof(f));
+    return !failed;
+  }
+
+  // Starts an array of T called name, at most 31 characters.
+  template <typename T> inline void begin(const char *name) {
+    static_assert(alignof(T) <= mapped_alignment, "over-aligned element");
+    memset(&current, 0, sizeof(current));
+    current.type = mapped_type<T>::id;
+    current.elem_size = sizeof(T);
+    current.alignment = alignof(T);
+    strncpy(current.name, name, sizeof(current.name) - 1);
+    header_at = at;
+    put(&current, sizeof(current));
+  }
+
+  template <typename T> inline void append(const T *data, size_t n) {
+    put(data, n * sizeof(T));
+    current.count += n;
+    current.bytes += n * sizeof(T);
+  }
+
+  inline void end() {
+    static const char zeros[mapped_alignment] = {};
+    put(zeros, mapped_padded(current.bytes) - current.bytes);
+    if (!failed && pwrite(fd, &current, sizeof(current), off_t(header_at)) !=
+                       ssize_t(sizeof(current))) {
+      failed = true;
+    }
+  }
+
+  template <typename T>
+  inline void write(const char *name, const T *data, size_t n) {
+    begin<T>(name);
+    append(data, n);
+    end();
+  }
+
+  // False if anything since open() failed to reach the file.
+  inline bool close() {
+    if (fd < 0) {
+      return !failed;
+    }
+    if (::close(fd) != 0) {
+      failed = true;
+    }
+    fd = -1;
+    return !failed;
+  }
+
+  int fd;
+  uint64_t at;
+  uint64_t header_at;
+  bool failed;
+  mapped_array_header current;
+
+  // Writes all of data or sets failed.
+  inline void put(const void *data, size_t bytes) {
+    const char *p = static_cast<const char *>(data);
+    while (!failed && bytes > 0) {
+      ssize_t r = ::write(fd, p, bytes);
+      if (r <= 0) {
+        failed = true;
+        return;
+      }
+      p += r;
+      bytes -= size_t(r);
+      at += uint64_t(r);
+    }
+  }
+};
+
+} // namespace fonge
@@ -8,6 +8,33 @@ namespace fonge {
 struct double2x2;
 struct double3x3;
 struct double4x4;
+struct double3x4;
+
+// c1 * v.x + c2 * v.y + ..., split into two independent FMA chains.
+static inline simde__m256d lincomb_pd(simde__m256d v, simde__m256d c1,
+                                      simde__m256d c2) {
+  return simde_mm256_fmadd_pd(
+      c2, swizzle_pd<1, 1, 1, 1>(v),
+      simde_mm256_mul_pd(c1, swizzle_pd<0, 0, 0, 0>(v)));
+}
+
+static inline simde__m256d lincomb_pd(simde__m256d v, simde__m256d c1,
+                                      simde__m256d c2, simde__m256d c3) {
+  return simde_mm256_fmadd_pd(
+      c2, swizzle_pd<1, 1, 1, 1>(v),
+      simde_mm256_fmadd_pd(c3, swizzle_pd<2, 2, 2, 2>(v),
+                           simde_mm256_mul_pd(c1, swizzle_pd<0, 0, 0, 0>(v))));
+}
+
+static inline simde__m256d lincomb_pd(simde__m256d v, simde__m256d c1,
+                                      simde__m256d c2, simde__m256d c3,
+                                      simde__m256d c4) {
+  return simde_mm256_add_pd(
+      simde_mm256_fmadd_pd(c2, swizzle_pd<1, 1, 1, 1>(v),
+                           simde_mm256_mul_pd(c1, swizzle_pd<0, 0, 0, 0>(v))),
+      simde_mm256_fmadd_pd(c4, swizzle_pd<3, 3, 3, 3>(v),
+                           simde_mm256_mul_pd(c3, swizzle_pd<2, 2, 2, 2>(v))));
+}
 
 inline double2x2 operator*(double2x2 lhs, double rhs);
 
@@ -32,7 +59,7 @@ struct double2x2 {
   }
 
   inline double2 operator*(double2 rhs) {
-    return rhs.xx() * col1 + rhs.yy() * col2;
+    return lincomb_pd(rhs.simd, col1.simd, col2.simd);
   }
 
   inline double2x2 operator*(double2x2 rhs) {
@@ -42,7 +69,7 @@ struct double2x2 {
   inline double2 &operator[](size_t i) { return cols[i]; }
 
   inline bool operator==(double2x2 rhs) {
-    return (col1 == rhs.col1).all() && (col2 == rhs.col2).all();
+    return (col1 == rhs.col1) && (col2 == rhs.col2);
   }
 
   inline double2x2 transposed() {
@@ -50,7 +77,10 @@ struct double2x2 {
     return double2x2(tmp.xy(), tmp.zw());
   }
 
-  inline double trace() { return col1.x() + col2.y(); }
+  inline double trace() {
+    return reduce_add_pd<2>(
+        simde_mm256_blend_pd(col1.simd, col2.simd, 0b0010));
+  }
 
   inline double determinant() { return col1.dot(col2.cross()); }
 
@@ -109,7 +139,7 @@ struct double3x3 {
   }
 
   inline double3 operator*(double3 rhs) {
-    return rhs.xxx() * col1 + rhs.yyy() * col2 + rhs.zzz() * col3;
+    return lincomb_pd(rhs.simd, col1.simd, col2.simd, col3.simd);
   }
 
   inline double3x3 operator*(double3x3 rhs) {
@@ -120,8 +150,7 @@ struct double3x3 {
   inline double3 &operator[](size_t i) { return cols[i]; }
 
   inline bool operator==(double3x3 rhs) {
-    return (col1 == rhs.col1).all() && (col2 == rhs.col2).all() &&
-           (col3 == rhs.col3).all();
+    return (col1 == rhs.col1) && (col2 == rhs.col2) && (col3 == rhs.col3);
   }
 
   inline double3x3 transposed() {
@@ -133,7 +162,11 @@ struct double3x3 {
                      double3(tmp2, col3.z()));
   }
 
-  inline double trace() { return col1.x() + col2.y() + col3.z(); }
+  inline double trace() {
+    return reduce_add_pd<3>(simde_mm256_blend_pd(
+        simde_mm256_blend_pd(col1.simd, col2.simd, 0b0010), col3.simd,
+        0b0100));
+  }
 
   inline double determinant() { return col1.dot(col2.cross(col3)); }
 
@@ -159,7 +192,12 @@ struct double3x3 {
 };
 
 inline double3 operator*(double3 lhs, double3x3 rhs) {
-  return rhs.transposed() * lhs;
+  simde__m256d v =
+      simde_mm256_blend_pd(lhs.simd, simde_mm256_setzero_pd(), 0b1000);
+  return hsum4x4_pd(simde_mm256_mul_pd(v, rhs.col1.simd),
+                    simde_mm256_mul_pd(v, rhs.col2.simd),
+                    simde_mm256_mul_pd(v, rhs.col3.simd),
+                    simde_mm256_setzero_pd());
 }
 
 inline double3x3 operator*(double3x3 lhs, double rhs) {
@@ -175,6 +213,62 @@ inline double2x2::double2x2(double3x3 rhs) {
   col2 = rhs.col2.xy();
 }
 
+// Picks (lhs[x], lhs[y], rhs[z], rhs[w]).
+#define shuffle_pd_custom(lhs, rhs, x, y, z, w)                                \
+  simde_mm256_blend_pd(                                                        \
+      permute_pd_custom((lhs), SIMDE_MM_SHUFFLE(3, 2, y, x)),                  \
+      permute_pd_custom((rhs), SIMDE_MM_SHUFFLE(w, z, 1, 0)), 0b1100)
+
+// Picks (v[x], v[y], v[z], v[w]).
+#define swizzle_pd_custom(v, x, y, z, w)                                       \
+  permute_pd_custom((v), SIMDE_MM_SHUFFLE(w, z, y, x))
+
+static inline void transpose4_pd(simde__m256d &a, simde__m256d &b,
+                                 simde__m256d &c, simde__m256d &d) {
+  simde__m256d t0 = simde_mm256_unpacklo_pd(a, b),
+               t1 = simde_mm256_unpackhi_pd(a, b),
+               t2 = simde_mm256_unpacklo_pd(c, d),
+               t3 = simde_mm256_unpackhi_pd(c, d);
+  a = simde_mm256_permute2f128_pd(t0, t2, 0x20);
+  b = simde_mm256_permute2f128_pd(t1, t3, 0x20);
+  c = simde_mm256_permute2f128_pd(t0, t2, 0x31);
+  d = simde_mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+static inline simde__m256d cross3_pd(simde__m256d a, simde__m256d b) {
+  return simde_mm256_fmsub_pd(
+      swizzle_pd_custom(a, 1, 2, 0, 3), swizzle_pd_custom(b, 2, 0, 1, 3),
+      simde_mm256_mul_pd(swizzle_pd_custom(a, 2, 0, 1, 3),
+                         swizzle_pd_custom(b, 1, 2, 0, 3)));
+}
+
+// 2x2 block helpers for double4x4::inverse(), see mat2_mul in
+// matrix_float.hpp.
+
+// A * B
+static inline simde__m256d dmat2_mul(simde__m256d a, simde__m256d b) {
+  return simde_mm256_fmadd_pd(
+      a, swizzle_pd_custom(b, 0, 3, 0, 3),
+      simde_mm256_mul_pd(swizzle_pd_custom(a, 1, 0, 3, 2),
+                         swizzle_pd_custom(b, 2, 1, 2, 1)));
+}
+
+// adj(A) * B
+static inline simde__m256d dmat2_adj_mul(simde__m256d a, simde__m256d b) {
+  return simde_mm256_fmsub_pd(
+      swizzle_pd_custom(a, 3, 3, 0, 0), b,
+      simde_mm256_mul_pd(swizzle_pd_custom(a, 1, 1, 2, 2),
+                         swizzle_pd_custom(b, 2, 3, 0, 1)));
+}
+
+// A * adj(B)
+static inline simde__m256d dmat2_mul_adj(simde__m256d a, simde__m256d b) {
+  return simde_mm256_fmsub_pd(
+      a, swizzle_pd_custom(b, 3, 0, 3, 0),
+      simde_mm256_mul_pd(swizzle_pd_custom(a, 1, 0, 3, 2),
+                         swizzle_pd_custom(b, 2, 1, 2, 1)));
+}
+
 struct double4x4 {
   inline double4x4(const double4x4 &m)
       : cols{m.col1, m.col2, m.col3, m.col4} {};
@@ -193,6 +287,8 @@ struct double4x4 {
   inline double4x4(double4 col1, double4 col2, double4 col3, double4 col4)
       : cols{col1, col2, col3, col4} {}
 
+  inline double4x4(double3x4 rhs);
+
   inline double4x4 operator+(double4x4 rhs) {
     return double4x4(col1 + rhs.col1, col2 + rhs.col2, col3 + rhs.col3,
                      col4 + rhs.col4);
@@ -204,8 +300,7 @@ struct double4x4 {
   }
 
   inline double4 operator*(double4 rhs) {
-    return rhs.xxxx() * col1 + rhs.yyyy() * col2 + rhs.zzzz() * col3 +
-           rhs.wwww() * col4;
+    return lincomb_pd(rhs.simd, col1.simd, col2.simd, col3.simd, col4.simd);
   }
 
   inline double4x4 operator*(double4x4 rhs) {
@@ -216,28 +311,21 @@ struct double4x4 {
   inline double4 &operator[](size_t i) { return cols[i]; }
 
   inline bool operator==(double4x4 rhs) {
-    return (col1 == rhs.col1).all() && (col2 == rhs.col2).all() &&
-           (col3 == rhs.col3).all() && (col4 == rhs.col4).all();
+    return (col1 == rhs.col1) && (col2 == rhs.col2) && (col3 == rhs.col3) &&
+           (col4 == rhs.col4);
   }
 
   inline double4x4 transposed() {
-    double4x4 out;
-    // top-left minor, already transposed.
-    double4 tmp1 = simde_mm256_unpacklo_pd(col1.simd, col2.simd);
-    // top-right minor, already transposed.
-    double4 tmp2 = simde_mm256_unpacklo_pd(col3.simd, col4.simd);
-    // bottom-left minor, already transposed.
-    double4 tmp3 = simde_mm256_unpackhi_pd(col1.simd, col2.simd);
-    // bottom-right minor, already transposed.
-    double4 tmp4 = simde_mm256_unpackhi_pd(col3.simd, col4.simd);
-    out.col1 = double4(tmp1.xy(), tmp3.xy());
-    out.col2 = double4(tmp1.zw(), tmp3.zw());
-    out.col3 = double4(tmp2.xy(), tmp4.xy());
-    out.col4 = double4(tmp2.zw(), tmp4.zw());
-    return out;
+    simde__m256d a = col1.simd, b = col2.simd, c = col3.simd, d = col4.simd;
+    transpose4_pd(a, b, c, d);
+    return double4x4(a, b, c, d);
   }
 
-  inline double trace() { return col1.x() + col2.y() + col3.z() + col4.w(); }
+  inline double trace() {
+    return reduce_add_pd<4>(simde_mm256_blend_pd(
+        simde_mm256_blend_pd(col1.simd, col2.simd, 0b0010),
+        simde_mm256_blend_pd(col3.simd, col4.simd, 0b1000), 0b1100));
+  }
 
   inline double determinant() { return col1.dot(col2.cross(col3, col4)); }
 
@@ -250,7 +338,89 @@ struct double4x4 {
     return double4x4(col1 / rhs, col2 / rhs, col3 / rhs, col4 / rhs);
   }
 
-  inline double4x4 inverse() { return cofactor().transposed() / determinant(); }
+  // General inverse by 2x2 blocks, see float4x4::inverse().
+  inline double4x4 inverse() {
+    simde__m256d a = simde_mm256_permute2f128_pd(col1.simd, col2.simd, 0x20),
+                 b = simde_mm256_permute2f128_pd(col1.simd, col2.simd, 0x31),
+                 c = simde_mm256_permute2f128_pd(col3.simd, col4.simd, 0x20),
+                 d = simde_mm256_permute2f128_pd(col3.simd, col4.simd, 0x31);
+
+    // (|A|, |B|, |C|, |D|)
+    simde__m256d dets = simde_mm256_fmsub_pd(
+        shuffle_pd_custom(col1.simd, col3.simd, 0, 2, 0, 2),
+        shuffle_pd_custom(col2.simd, col4.simd, 1, 3, 1, 3),
+        simde_mm256_mul_pd(
+            shuffle_pd_custom(col1.simd, col3.simd, 1, 3, 1, 3),
+            shuffle_pd_custom(col2.simd, col4.simd, 0, 2, 0, 2)));
+    simde__m256d det_a = swizzle_pd_custom(dets, 0, 0, 0, 0),
+                 det_b = swizzle_pd_custom(dets, 1, 1, 1, 1),
+                 det_c = swizzle_pd_custom(dets, 2, 2, 2, 2),
+                 det_d = swizzle_pd_custom(dets, 3, 3, 3, 3);
+
+    simde__m256d d_c = dmat2_adj_mul(d, c), a_b = dmat2_adj_mul(a, b);
+    simde__m256d x = simde_mm256_fmsub_pd(det_d, a, dmat2_mul(b, d_c)),
+                 w = simde_mm256_fmsub_pd(det_a, d, dmat2_mul(c, a_b)),
+                 y = simde_mm256_fmsub_pd(det_b, c, dmat2_mul_adj(d, a_b)),
+                 z = simde_mm256_fmsub_pd(det_c, b, dmat2_mul_adj(a, d_c));
+
+    // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+    simde__m256d tr =
+        simde_mm256_mul_pd(a_b, swizzle_pd_custom(d_c, 0, 2, 1, 3));
+    tr = simde_mm256_add_pd(tr, swizzle_pd_custom(tr, 1, 0, 3, 2));
+    tr = simde_mm256_add_pd(tr, swizzle_pd_custom(tr, 2, 3, 0, 1));
+    simde__m256d det = simde_mm256_sub_pd(
+        simde_mm256_fmadd_pd(det_a, det_d, simde_mm256_mul_pd(det_b, det_c)),
+        tr);
+
+    simde__m256d rdet =
+        simde_mm256_div_pd(simde_mm256_setr_pd(1, -1, -1, 1), det);
+    x = simde_mm256_mul_pd(x, rdet);
+    y = simde_mm256_mul_pd(y, rdet);
+    z = simde_mm256_mul_pd(z, rdet);
+    w = simde_mm256_mul_pd(w, rdet);
+
+    return double4x4(shuffle_pd_custom(x, y, 3, 1, 3, 1),
+                     shuffle_pd_custom(x, y, 2, 0, 2, 0),
+                     shuffle_pd_custom(z, w, 3, 1, 3, 1),
+                     shuffle_pd_custom(z, w, 2, 0, 2, 0));
+  }
+
+  // Inverse of a matrix whose last row is (0, 0, 0, 1).
+  inline double4x4 inverse_affine() {
+    simde__m256d r1 = cross3_pd(col2.simd, col3.simd),
+                 r2 = cross3_pd(col3.simd, col1.simd),
+                 r3 = cross3_pd(col1.simd, col2.simd);
+    alignas(32) double prod[4];
+    simde_mm256_store_pd(prod, simde_mm256_mul_pd(col1.simd, r1));
+    simde__m256d rdet = simde_mm256_set1_pd(1 / (prod[0] + prod[1] + prod[2]));
+    simde__m256d a = simde_mm256_mul_pd(r1, rdet),
+                 b = simde_mm256_mul_pd(r2, rdet),
+                 c = simde_mm256_mul_pd(r3, rdet),
+                 d = simde_mm256_setzero_pd();
+    transpose4_pd(a, b, c, d);
+    return double4x4(a, b, c, affine_translation(a, b, c));
+  }
+
+  // Inverse of a rotation followed by a translation: the transposed rotation
+  // and the translation rotated back.
+  inline double4x4 inverse_rigid() {
+    simde__m256d a = col1.simd, b = col2.simd, c = col3.simd,
+                 d = simde_mm256_setzero_pd();
+    transpose4_pd(a, b, c, d);
+    return double4x4(a, b, c, affine_translation(a, b, c));
+  }
+
+  // -(a, b, c) * col4.xyz() with w = 1, for the inverses above.
+  inline double4 affine_translation(simde__m256d a, simde__m256d b,
+                                    simde__m256d c) {
+    simde__m256d t = simde_x_mm256_negate_pd(col4.simd);
+    simde__m256d out = simde_mm256_fmadd_pd(
+        a, swizzle_pd_custom(t, 0, 0, 0, 0),
+        simde_mm256_fmadd_pd(
+            b, swizzle_pd_custom(t, 1, 1, 1, 1),
+            simde_mm256_mul_pd(c, swizzle_pd_custom(t, 2, 2, 2, 2))));
+    return simde_mm256_blend_pd(out, simde_mm256_set1_pd(1), 0b1000);
+  }
 
   static inline double4x4 identity() { return double4x4(); }
 
@@ -264,7 +434,10 @@ struct double4x4 {
 };
 
 inline double4 operator*(double4 lhs, double4x4 rhs) {
-  return rhs.transposed() * lhs;
+  return hsum4x4_pd(simde_mm256_mul_pd(lhs.simd, rhs.col1.simd),
+                    simde_mm256_mul_pd(lhs.simd, rhs.col2.simd),
+                    simde_mm256_mul_pd(lhs.simd, rhs.col3.simd),
+                    simde_mm256_mul_pd(lhs.simd, rhs.col4.simd));
 }
 
 inline double4x4 operator*(double4x4 lhs, double rhs) {
@@ -287,4 +460,140 @@ inline double3x3::double3x3(double4x4 rhs) {
   col3 = rhs.col3.xyz();
 }
 
+// Affine transform with an implied last row of (0, 0, 0, 1), stored by rows.
+// See float3x4.
+struct double3x4 {
+  inline double3x4()
+      : rows{double4(1, 0, 0, 0), double4(0, 1, 0, 0), double4(0, 0, 1, 0)} {}
+
+  inline double3x4(double4 row1, double4 row2, double4 row3)
+      : rows{row1, row2, row3} {}
+
+  inline double3x4(double3x3 basis, double3 translation) {
+    simde__m256d a = basis.col1.simd, b = basis.col2.simd,
+                 c = basis.col3.simd, d = translation.simd;
+    transpose4_pd(a, b, c, d);
+    row1 = a;
+    row2 = b;
+    row3 = c;
+  }
+
+  // Drops the last row of rhs.
+  inline double3x4(double4x4 rhs) {
+    simde__m256d a = rhs.col1.simd, b = rhs.col2.simd, c = rhs.col3.simd,
+                 d = rhs.col4.simd;
+    transpose4_pd(a, b, c, d);
+    row1 = a;
+    row2 = b;
+    row3 = c;
+  }
+
+  inline double4 operator*(double4 rhs) {
+    simde__m256d out = hsum4x4_pd(simde_mm256_mul_pd(row1.simd, rhs.simd),
+                                  simde_mm256_mul_pd(row2.simd, rhs.simd),
+                                  simde_mm256_mul_pd(row3.simd, rhs.simd),
+                                  simde_mm256_setzero_pd());
+    return simde_mm256_blend_pd(out, rhs.simd, 0b1000);
+  }
+
+  inline double3x4 operator*(double3x4 rhs) {
+    return double3x4(rhs.row_mul(row1), rhs.row_mul(row2), rhs.row_mul(row3));
+  }
+
+  inline double3 transform_point(double3 rhs) {
+    return ((*this) * double4(rhs, 1)).simd;
+  }
+
+  inline double3 transform_direction(double3 rhs) {
+    return ((*this) * double4(rhs, 0)).simd;
+  }
+
+  inline double4 &operator[](size_t i) { return rows[i]; }
+
+  inline bool operator==(double3x4 rhs) {
+    return (row1 == rhs.row1) && (row2 == rhs.row2) && (row3 == rhs.row3);
+  }
+
+  inline double3x3 basis() {
+    simde__m256d a = row1.simd, b = row2.simd, c = row3.simd,
+                 d = simde_mm256_setzero_pd();
+    transpose4_pd(a, b, c, d);
+    return double3x3(a, b, c);
+  }
+
+  inline double3 translation() {
+    simde__m256d a = row1.simd, b = row2.simd, c = row3.simd,
+                 d = simde_mm256_setzero_pd();
+    transpose4_pd(a, b, c, d);
+    return d;
+  }
+
+  inline double determinant() {
+    alignas(32) double prod[4];
+    simde_mm256_store_pd(
+        prod, simde_mm256_mul_pd(row1.simd, cross3_pd(row2.simd, row3.simd)));
+    return prod[0] + prod[1] + prod[2];
+  }
+
+  inline double3x4 inverse() {
+    simde__m256d rdet = simde_mm256_set1_pd(1 / determinant());
+    return transposed_inverse(
+        simde_mm256_mul_pd(cross3_pd(row2.simd, row3.simd), rdet),
+        simde_mm256_mul_pd(cross3_pd(row3.simd, row1.simd), rdet),
+        simde_mm256_mul_pd(cross3_pd(row1.simd, row2.simd), rdet));
+  }
+
+  // Inverse of a rotation followed by a translation.
+  inline double3x4 inverse_rigid() {
+    return transposed_inverse(row1.simd, row2.simd, row3.simd);
+  }
+
+  static inline double3x4 identity() { return double3x4(); }
+
+  union {
+    double4 rows[3];
+
+    struct {
+      double4 row1, row2, row3;
+    };
+  };
+
+  // r * (*this), treating r as a row of a 4x4 affine matrix.
+  inline double4 row_mul(double4 r) {
+    return simde_mm256_fmadd_pd(
+        swizzle_pd_custom(r.simd, 0, 0, 0, 0), row1.simd,
+        simde_mm256_fmadd_pd(
+            swizzle_pd_custom(r.simd, 1, 1, 1, 1), row2.simd,
+            simde_mm256_fmadd_pd(
+                swizzle_pd_custom(r.simd, 2, 2, 2, 2), row3.simd,
+                simde_mm256_blend_pd(simde_mm256_setzero_pd(), r.simd,
+                                     0b1000))));
+  }
+
+  // Builds the inverse from the columns a, b, c of the inverted basis.
+  inline double3x4 transposed_inverse(simde__m256d a, simde__m256d b,
+                                      simde__m256d c) {
+    simde__m256d t = translation().simd;
+    simde__m256d d = simde_x_mm256_negate_pd(simde_mm256_fmadd_pd(
+        a, swizzle_pd_custom(t, 0, 0, 0, 0),
+        simde_mm256_fmadd_pd(
+            b, swizzle_pd_custom(t, 1, 1, 1, 1),
+            simde_mm256_mul_pd(c, swizzle_pd_custom(t, 2, 2, 2, 2)))));
+    transpose4_pd(a, b, c, d);
+    return double3x4(a, b, c);
+  }
+};
+
+typedef double3x4 affine3d;
+
+inline double4x4::double4x4(double3x4 rhs) {
+  simde__m256d a = rhs.row1.simd, b = rhs.row2.simd, c = rhs.row3.simd,
+               d = double4::w_axis().simd;
+  transpose4_pd(a, b, c, d);
+  col1 = a;
+  col2 = b;
+  col3 = c;
+  col4 = d;
+}
+
 } // namespace fonge
@@ -1,11 +1,38 @@
 #pragma once
 
 #include "vector_float.hpp"
+#include <simde/x86/fma.h>
 
 namespace fonge {
 
 struct float3x3;
 struct float4x4;
+struct float3x4;
+
+// c1 * v.x + c2 * v.y + ..., split into two independent FMA chains.
+static inline simde__m128 lincomb_ps(simde__m128 v, simde__m128 c1,
+                                     simde__m128 c2) {
+  return simde_mm_fmadd_ps(c2, swizzle_ps<1, 1, 1, 1>(v),
+                           simde_mm_mul_ps(c1, swizzle_ps<0, 0, 0, 0>(v)));
+}
+
+static inline simde__m128 lincomb_ps(simde__m128 v, simde__m128 c1,
+                                     simde__m128 c2, simde__m128 c3) {
+  return simde_mm_fmadd_ps(
+      c2, swizzle_ps<1, 1, 1, 1>(v),
+      simde_mm_fmadd_ps(c3, swizzle_ps<2, 2, 2, 2>(v),
+                        simde_mm_mul_ps(c1, swizzle_ps<0, 0, 0, 0>(v))));
+}
+
+static inline simde__m128 lincomb_ps(simde__m128 v, simde__m128 c1,
+                                     simde__m128 c2, simde__m128 c3,
+                                     simde__m128 c4) {
+  return simde_mm_add_ps(
+      simde_mm_fmadd_ps(c2, swizzle_ps<1, 1, 1, 1>(v),
+                        simde_mm_mul_ps(c1, swizzle_ps<0, 0, 0, 0>(v))),
+      simde_mm_fmadd_ps(c4, swizzle_ps<3, 3, 3, 3>(v),
+                        simde_mm_mul_ps(c3, swizzle_ps<2, 2, 2, 2>(v))));
+}
 
 struct float2x2 {
   inline float2x2() : cols{float2(1, 0), float2(0, 1)} {}
@@ -31,7 +58,7 @@ struct float2x2 {
   }
 
   inline float2 operator*(float2 rhs) {
-    return rhs.xx() * col1 + rhs.yy() * col2;
+    return lincomb_ps(rhs.simd, col1.simd, col2.simd);
   }
 
   inline float2x2 operator*(float2x2 rhs) {
@@ -48,7 +75,9 @@ struct float2x2 {
     return float2x2(float4(simde_mm_unpacklo_ps(col1.simd, col2.simd)));
   }
 
-  inline float trace() { return col1.x() + col2.y(); }
+  inline float trace() {
+    return reduce_add_ps<2>(simde_mm_blend_ps(col1.simd, col2.simd, 0b0010));
+  }
 
   inline float determinant() { return col1.dot(col2.cross()); }
 
@@ -102,7 +131,7 @@ struct float3x3 {
   }
 
   inline float3 operator*(float3 rhs) {
-    return rhs.xxx() * col1 + rhs.yyy() * col2 + rhs.zzz() * col3;
+    return lincomb_ps(rhs.simd, col1.simd, col2.simd, col3.simd);
   }
 
   inline float3x3 operator*(float3x3 rhs) {
@@ -122,7 +151,10 @@ struct float3x3 {
     return float3x3(a, b, c);
   }
 
-  inline float trace() { return col1.x() + col2.y() + col3.z(); }
+  inline float trace() {
+    return reduce_add_ps<3>(simde_mm_blend_ps(
+        simde_mm_blend_ps(col1.simd, col2.simd, 0b0010), col3.simd, 0b0100));
+  }
 
   inline float determinant() { return col1.dot(col2.cross(col3)); }
 
@@ -148,7 +180,10 @@ struct float3x3 {
 };
 
 inline float3 operator*(float3 lhs, float3x3 rhs) {
-  return float3(lhs.dot(rhs.col1), lhs.dot(rhs.col2), lhs.dot(rhs.col3));
+  simde__m128 v = simde_mm_blend_ps(lhs.simd, simde_mm_setzero_ps(), 0b1000);
+  return hsum4x4_ps(simde_mm_mul_ps(v, rhs.col1.simd),
+                    simde_mm_mul_ps(v, rhs.col2.simd),
+                    simde_mm_mul_ps(v, rhs.col3.simd), simde_mm_setzero_ps());
 }
 
 inline float3x3 operator*(float3x3 lhs, float rhs) {
@@ -164,6 +199,38 @@ inline float2x2::float2x2(float3x3 rhs) {
   col2 = rhs.col2.xy();
 }
 
+// 2x2 block helpers for float4x4::inverse(). Each __m128 holds a 2x2 block
+// (a, b, c, d) of the matrix as stored, i.e. of its transpose, which is fine
+// since inverse(M^T) = inverse(M)^T.
+
+// Picks (lhs[x], lhs[y], rhs[z], rhs[w]).
+#define shuffle_ps_custom(lhs, rhs, x, y, z, w)                                \
+  simde_mm_shuffle_ps((lhs), (rhs), SIMDE_MM_SHUFFLE(w, z, y, x))
+
+// A * B
+static inline simde__m128 mat2_mul(simde__m128 a, simde__m128 b) {
+  return simde_mm_fmadd_ps(
+      a, shuffle_ps_custom(b, b, 0, 3, 0, 3),
+      simde_mm_mul_ps(shuffle_ps_custom(a, a, 1, 0, 3, 2),
+                      shuffle_ps_custom(b, b, 2, 1, 2, 1)));
+}
+
+// adj(A) * B
+static inline simde__m128 mat2_adj_mul(simde__m128 a, simde__m128 b) {
+  return simde_mm_fmsub_ps(
+      shuffle_ps_custom(a, a, 3, 3, 0, 0), b,
+      simde_mm_mul_ps(shuffle_ps_custom(a, a, 1, 1, 2, 2),
+                      shuffle_ps_custom(b, b, 2, 3, 0, 1)));
+}
+
+// A * adj(B)
+static inline simde__m128 mat2_mul_adj(simde__m128 a, simde__m128 b) {
+  return simde_mm_fmsub_ps(
+      a, shuffle_ps_custom(b, b, 3, 0, 3, 0),
+      simde_mm_mul_ps(shuffle_ps_custom(a, a, 1, 0, 3, 2),
+                      shuffle_ps_custom(b, b, 2, 1, 2, 1)));
+}
+
 struct float4x4 {
   inline float4x4(const float4x4 &m)
       : col1(m.col1), col2(m.col2), col3(m.col3), col4(m.col4) {};
@@ -182,6 +249,8 @@ struct float4x4 {
   inline float4x4(float4 col1, float4 col2, float4 col3, float4 col4)
       : cols{col1, col2, col3, col4} {}
 
+  inline float4x4(float3x4 rhs);
+
   inline float4x4 operator+(float4x4 rhs) {
     return float4x4(col1 + rhs.col1, col2 + rhs.col2, col3 + rhs.col3,
                     col4 + rhs.col4);
@@ -193,8 +262,7 @@ struct float4x4 {
   }
 
   inline float4 operator*(float4 rhs) {
-    return rhs.xxxx() * col1 + rhs.yyyy() * col2 + rhs.zzzz() * col3 +
-           rhs.wwww() * col4;
+    return lincomb_ps(rhs.simd, col1.simd, col2.simd, col3.simd, col4.simd);
   }
 
   inline float4x4 operator*(float4x4 rhs) {
@@ -215,7 +283,12 @@ struct float4x4 {
     return float4x4(a, b, c, d);
   }
 
-  inline float trace() { return col1.x() + col2.y() + col3.z() + col4.w(); }
+  inline float trace() {
+    return reduce_add_ps<4>(
+        simde_mm_blend_ps(simde_mm_blend_ps(col1.simd, col2.simd, 0b0010),
+                          simde_mm_blend_ps(col3.simd, col4.simd, 0b1000),
+                          0b1100));
+  }
 
   inline float determinant() { return col1.dot(col2.cross(col3, col4)); }
 
@@ -228,7 +301,85 @@ struct float4x4 {
     return float4x4(col1 / rhs, col2 / rhs, col3 / rhs, col4 / rhs);
   }
 
-  inline float4x4 inverse() { return cofactor().transposed() / determinant(); }
+  // General inverse by 2x2 blocks, as in Intel's SSE 4x4 inversion.
+  inline float4x4 inverse() {
+    simde__m128 a = simde_mm_movelh_ps(col1.simd, col2.simd),
+                b = simde_mm_movehl_ps(col2.simd, col1.simd),
+                c = simde_mm_movelh_ps(col3.simd, col4.simd),
+                d = simde_mm_movehl_ps(col4.simd, col3.simd);
+
+    // (|A|, |B|, |C|, |D|)
+    simde__m128 dets = simde_mm_fmsub_ps(
+        shuffle_ps_custom(col1.simd, col3.simd, 0, 2, 0, 2),
+        shuffle_ps_custom(col2.simd, col4.simd, 1, 3, 1, 3),
+        simde_mm_mul_ps(shuffle_ps_custom(col1.simd, col3.simd, 1, 3, 1, 3),
+                        shuffle_ps_custom(col2.simd, col4.simd, 0, 2, 0, 2)));
+    simde__m128 det_a = permute_ps_custom(dets, SIMDE_MM_SHUFFLE(0, 0, 0, 0)),
+                det_b = permute_ps_custom(dets, SIMDE_MM_SHUFFLE(1, 1, 1, 1)),
+                det_c = permute_ps_custom(dets, SIMDE_MM_SHUFFLE(2, 2, 2, 2)),
+                det_d = permute_ps_custom(dets, SIMDE_MM_SHUFFLE(3, 3, 3, 3));
+
+    simde__m128 d_c = mat2_adj_mul(d, c), a_b = mat2_adj_mul(a, b);
+    simde__m128 x = simde_mm_fmsub_ps(det_d, a, mat2_mul(b, d_c)),
+                w = simde_mm_fmsub_ps(det_a, d, mat2_mul(c, a_b)),
+                y = simde_mm_fmsub_ps(det_b, c, mat2_mul_adj(d, a_b)),
+                z = simde_mm_fmsub_ps(det_c, b, mat2_mul_adj(a, d_c));
+
+    // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+    simde__m128 tr = simde_mm_mul_ps(
+        a_b, permute_ps_custom(d_c, SIMDE_MM_SHUFFLE(3, 1, 2, 0)));
+    tr = simde_mm_add_ps(tr,
+                         permute_ps_custom(tr, SIMDE_MM_SHUFFLE(2, 3, 0, 1)));
+    tr = simde_mm_add_ps(tr,
+                         permute_ps_custom(tr, SIMDE_MM_SHUFFLE(1, 0, 3, 2)));
+    simde__m128 det = simde_mm_sub_ps(
+        simde_mm_fmadd_ps(det_a, det_d, simde_mm_mul_ps(det_b, det_c)), tr);
+
+    simde__m128 rdet = simde_mm_div_ps(simde_mm_setr_ps(1, -1, -1, 1), det);
+    x = simde_mm_mul_ps(x, rdet);
+    y = simde_mm_mul_ps(y, rdet);
+    z = simde_mm_mul_ps(z, rdet);
+    w = simde_mm_mul_ps(w, rdet);
+
+    return float4x4(shuffle_ps_custom(x, y, 3, 1, 3, 1),
+                    shuffle_ps_custom(x, y, 2, 0, 2, 0),
+                    shuffle_ps_custom(z, w, 3, 1, 3, 1),
+                    shuffle_ps_custom(z, w, 2, 0, 2, 0));
+  }
+
+  // Inverse of a matrix whose last row is (0, 0, 0, 1).
+  inline float4x4 inverse_affine() {
+    float3 c1 = col1.xyz(), c2 = col2.xyz(), c3 = col3.xyz();
+    float3 r1 = c2.cross(c3), r2 = c3.cross(c1), r3 = c1.cross(c2);
+    simde__m128 rdet = simde_mm_set1_ps(1 / c1.dot(r1));
+    simde__m128 a = simde_mm_mul_ps(r1.simd, rdet),
+                b = simde_mm_mul_ps(r2.simd, rdet),
+                c = simde_mm_mul_ps(r3.simd, rdet), d = simde_mm_setzero_ps();
+    SIMDE_MM_TRANSPOSE4_PS(a, b, c, d);
+    return float4x4(a, b, c, affine_translation(a, b, c));
+  }
+
+  // Inverse of a rotation followed by a translation: the transposed rotation
+  // and the translation rotated back.
+  inline float4x4 inverse_rigid() {
+    simde__m128 a = col1.simd, b = col2.simd, c = col3.simd,
+                d = simde_mm_setzero_ps();
+    SIMDE_MM_TRANSPOSE4_PS(a, b, c, d);
+    return float4x4(a, b, c, affine_translation(a, b, c));
+  }
+
+  // -(a, b, c) * col4.xyz() with w = 1, for the inverses above.
+  inline float4 affine_translation(simde__m128 a, simde__m128 b,
+                                   simde__m128 c) {
+    simde__m128 t = simde_x_mm_negate_ps(col4.simd);
+    simde__m128 out = simde_mm_fmadd_ps(
+        a, permute_ps_custom(t, SIMDE_MM_SHUFFLE(0, 0, 0, 0)),
+        simde_mm_fmadd_ps(
+            b, permute_ps_custom(t, SIMDE_MM_SHUFFLE(1, 1, 1, 1)),
+            simde_mm_mul_ps(
+                c, permute_ps_custom(t, SIMDE_MM_SHUFFLE(2, 2, 2, 2)))));
+    return simde_mm_blend_ps(out, simde_mm_set1_ps(1), 0b1000);
+  }
 
   static inline float4x4 identity() { return float4x4(); }
 
@@ -242,8 +393,10 @@ struct float4x4 {
 };
 
 inline float4 operator*(float4 lhs, float4x4 rhs) {
-  return float4(lhs.dot(rhs.col1), lhs.dot(rhs.col2), lhs.dot(rhs.col3),
-                lhs.dot(rhs.col4));
+  return hsum4x4_ps(simde_mm_mul_ps(lhs.simd, rhs.col1.simd),
+                    simde_mm_mul_ps(lhs.simd, rhs.col2.simd),
+                    simde_mm_mul_ps(lhs.simd, rhs.col3.simd),
+                    simde_mm_mul_ps(lhs.simd, rhs.col4.simd));
 }
 
 inline float4x4 operator*(float4x4 lhs, float rhs) {
@@ -266,4 +419,347 @@ inline float3x3::float3x3(float4x4 rhs) {
   col3 = rhs.col3.xyz();
 }
 
+// Affine transform with an implied last row of (0, 0, 0, 1). Unlike the other
+// matrices it is stored by rows, which keeps it at 48 bytes.
+struct float3x4 {
+  inline float3x4()
+      : rows{float4(1, 0, 0, 0), float4(0, 1, 0, 0), float4(0, 0, 1, 0)} {}
+
+  inline float3x4(float4 row1, float4 row2, float4 row3)
+      : rows{row1, row2, row3} {}
+
+  inline float3x4(float3x3 basis, float3 translation) {
+    simde__m128 a = basis.col1.simd, b = basis.col2.simd, c = basis.col3.simd,
+                d = translation.simd;
+    SIMDE_MM_TRANSPOSE4_PS(a, b, c, d);
+    row1 = a;
+    row2 = b;
+    row3 = c;
+  }
+
+  // Drops the last row of rhs.
+  inline float3x4(float4x4 rhs) {
+    simde__m128 a = rhs.col1.simd, b = rhs.col2.simd, c = rhs.col3.simd,
+                d = rhs.col4.simd;
+    SIMDE_MM_TRANSPOSE4_PS(a, b, c, d);
+    row1 = a;
+    row2 = b;
+    row3 = c;
+  }
+
+  inline float4 operator*(float4 rhs) {
+    simde__m128 out = hsum4x4_ps(simde_mm_mul_ps(row1.simd, rhs.simd),
+                                 simde_mm_mul_ps(row2.simd, rhs.simd),
+                                 simde_mm_mul_ps(row3.simd, rhs.simd),
+                                 simde_mm_setzero_ps());
+    return simde_mm_blend_ps(out, rhs.simd, 0b1000);
+  }
+
+  inline float3x4 operator*(float3x4 rhs) {
+    return float3x4(rhs.row_mul(row1), rhs.row_mul(row2), rhs.row_mul(row3));
+  }
+
+  inline float3 transform_point(float3 rhs) {
+    return ((*this) * float4(rhs, 1)).xyz();
+  }
+
+  inline float3 transform_direction(float3 rhs) {
+    return ((*this) * float4(rhs, 0)).xyz();
+  }
+
+  inline float4 &operator[](size_t i) { return rows[i]; }
+
+  inline bool operator==(float3x4 rhs) {
+    return (row1 == rhs.row1) && (row2 == rhs.row2) && (row3 == rhs.row3);
+  }
+
+  inline float3x3 basis() {
+    simde__m128 a = row1.simd, b = row2.simd, c = row3.simd,
+                d = simde_mm_setzero_ps();
+    SIMDE_MM_TRANSPOSE4_PS(a, b, c, d);
+    return float3x3(a, b, c);
+  }
+
+  inline float3 translation() {
+    return simde_mm_movehl_ps(simde_mm_unpackhi_ps(row3.simd, row3.simd),
+                              simde_mm_unpackhi_ps(row1.simd, row2.simd));
+  }
+
+  inline float determinant() {
+    return row1.xyz().dot(row2.xyz().cross(row3.xyz()));
+  }
+
+  inline float3x4 inverse() {
+    float3 r1 = row1.xyz(), r2 = row2.xyz(), r3 = row3.xyz();
+    float3 c1 = r2.cross(r3), c2 = r3.cross(r1), c3 = r1.cross(r2);
+    float rdet = 1 / r1.dot(c1);
+    return transposed_inverse((c1 * rdet).simd, (c2 * rdet).simd,
+                              (c3 * rdet).simd);
+  }
+
+  // Inverse of a rotation followed by a translation.
+  inline float3x4 inverse_rigid() {
+    return transposed_inverse(row1.simd, row2.simd, row3.simd);
+  }
+
+  static inline float3x4 identity() { return float3x4(); }
+
+  union {
+    float4 rows[3];
+
+    struct {
+      float4 row1, row2, row3;
+    };
+  };
+
+  // r * (*this), treating r as a row of a 4x4 affine matrix.
+  inline float4 row_mul(float4 r) {
+    return simde_mm_fmadd_ps(
+        permute_ps_custom(r.simd, SIMDE_MM_SHUFFLE(0, 0, 0, 0)), row1.simd,
+        simde_mm_fmadd_ps(
+            permute_ps_custom(r.simd, SIMDE_MM_SHUFFLE(1, 1, 1, 1)), row2.simd,
+            simde_mm_fmadd_ps(
+                permute_ps_custom(r.simd, SIMDE_MM_SHUFFLE(2, 2, 2, 2)),
+                row3.simd,
+                simde_mm_blend_ps(simde_mm_setzero_ps(), r.simd, 0b1000))));
+  }
+
+  // Builds the inverse from the columns a, b, c of the inverted basis.
+  inline float3x4 transposed_inverse(simde__m128 a, simde__m128 b,
+                                     simde__m128 c) {
+    simde__m128 t = translation().simd;
+    simde__m128 d = simde_x_mm_negate_ps(simde_mm_fmadd_ps(
+        a, permute_ps_custom(t, SIMDE_MM_SHUFFLE(0, 0, 0, 0)),
+        simde_mm_fmadd_ps(
+            b, permute_ps_custom(t, SIMDE_MM_SHUFFLE(1, 1, 1, 1)),
+            simde_mm_mul_ps(
+                c, permute_ps_custom(t, SIMDE_MM_SHUFFLE(2, 2, 2, 2))))));
+    SIMDE_MM_TRANSPOSE4_PS(a, b, c, d);
+    return float3x4(a, b, c);
+  }
+};
+
+typedef float3x4 affine3f;
+
+inline float4x4::float4x4(float3x4 rhs) {
+  simde__m128 a = rhs.row1.simd, b = rhs.row2.simd, c = rhs.row3.simd,
+              d = float4::w_axis().simd;
+  SIMDE_MM_TRANSPOSE4_PS(a, b, c, d);
+  col1 = a;
+  col2 = b;
+  col3 = c;
+  col4 = d;
+}
+
+// Batched matrix-vector products. The matrix columns are kept in registers
+// for the whole batch, and two vectors are handled per 256-bit operation.
+// in and out may be the same array, but must not otherwise overlap.
+
+static inline simde__m256 broadcast_col(float4 col) {
+  return simde_mm256_set_m128(col.simd, col.simd);
+}
+
+// Multiplies the vectors in v by the matrix c0..c3. W is 0 to treat the
+// inputs as directions, 1 as points and 2 to use their own w component.
+template <int W>
+static inline simde__m256 transform_pair(simde__m256 c0, simde__m256 c1,
+                                         simde__m256 c2, simde__m256 c3,
+                                         simde__m256 v) {
+  simde__m256 out = simde_mm256_mul_ps(
+      c0, simde_mm256_permute_ps(v, SIMDE_MM_SHUFFLE(0, 0, 0, 0)));
+  out = simde_mm256_fmadd_ps(
+      c1, simde_mm256_permute_ps(v, SIMDE_MM_SHUFFLE(1, 1, 1, 1)), out);
+  out = simde_mm256_fmadd_ps(
+      c2, simde_mm256_permute_ps(v, SIMDE_MM_SHUFFLE(2, 2, 2, 2)), out);
+  if (W == 1) {
+    out = simde_mm256_add_ps(out, c3);
+  } else if (W == 2) {
+    out = simde_mm256_fmadd_ps(
+        c3, simde_mm256_permute_ps(v, SIMDE_MM_SHUFFLE(3, 3, 3, 3)), out);
+  }
+  return out;
+}
+
+template <int W>
+static inline void transform_batch(float4x4 m, const simde__m128 *in,
+                                   simde__m128 *out, size_t n) {
+  simde__m256 c0 = broadcast_col(m.col1), c1 = broadcast_col(m.col2),
+              c2 = broadcast_col(m.col3), c3 = broadcast_col(m.col4);
+  const float *src = reinterpret_cast<const float *>(in);
+  float *dst = reinterpret_cast<float *>(out);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    simde_mm_prefetch(reinterpret_cast<const char *>(src + 4 * i + 64),
+                      SIMDE_MM_HINT_T0);
+    simde__m256 a = simde_mm256_loadu_ps(src + 4 * i);
+    simde__m256 b = simde_mm256_loadu_ps(src + 4 * i + 8);
+    a = transform_pair<W>(c0, c1, c2, c3, a);
+    b = transform_pair<W>(c0, c1, c2, c3, b);
+    simde_mm256_storeu_ps(dst + 4 * i, a);
+    simde_mm256_storeu_ps(dst + 4 * i + 8, b);
+  }
+  for (; i < n; i++) {
+    simde__m256 a = simde_mm256_castps128_ps256(in[i]);
+    out[i] = simde_mm256_castps256_ps128(transform_pair<W>(c0, c1, c2, c3, a));
+  }
+}
+
+// m * float4(in[i], 1) for n points, written back as float3.
+inline void transform_points(float4x4 m, const float3 *in, float3 *out,
+                             size_t n) {
+  transform_batch<1>(m, &in->simd, &out->simd, n);
+}
+
+// m * float4(in[i], 0) for n directions, written back as float3.
+inline void transform_directions(float4x4 m, const float3 *in, float3 *out,
+                                 size_t n) {
+  transform_batch<0>(m, &in->simd, &out->simd, n);
+}
+
+// m * float4(in[i].xyz(), 1) for n points.
+inline void transform_points(float4x4 m, const float4 *in, float4 *out,
+                             size_t n) {
+  transform_batch<1>(m, &in->simd, &out->simd, n);
+}
+
+// m * float4(in[i].xyz(), 0) for n directions.
+inline void transform_directions(float4x4 m, const float4 *in, float4 *out,
+                                 size_t n) {
+  transform_batch<0>(m, &in->simd, &out->simd, n);
+}
+
+// m * in[i] for n vectors.
+inline void transform(float4x4 m, const float4 *in, float4 *out, size_t n) {
+  transform_batch<2>(m, &in->simd, &out->simd, n);
+}
+
+template <int W>
+static inline void transform_strided(float4x4 m, const float *in,
+                                     size_t in_stride, float *out,
+                                     size_t out_stride, size_t n) {
+  simde__m128 c0 = m.col1.simd, c1 = m.col2.simd, c2 = m.col3.simd,
+              c3 = m.col4.simd;
+  const char *src = reinterpret_cast<const char *>(in);
+  char *dst = reinterpret_cast<char *>(out);
+  for (size_t i = 0; i < n; i++, src += in_stride, dst += out_stride) {
+    simde_mm_prefetch(src + 8 * in_stride, SIMDE_MM_HINT_T0);
+    const float *p = reinterpret_cast<const float *>(src);
+    simde__m128 r = simde_mm_fmadd_ps(
+        c0, simde_mm_set1_ps(p[0]),
+        simde_mm_fmadd_ps(c1, simde_mm_set1_ps(p[1]),
+                          simde_mm_mul_ps(c2, simde_mm_set1_ps(p[2]))));
+    if (W == 1) {
+      r = simde_mm_add_ps(r, c3);
+    }
+    float *q = reinterpret_cast<float *>(dst);
+    simde_mm_storel_pi(reinterpret_cast<simde__m64 *>(q), r);
+    q[2] = simde_mm_cvtss_f32(simde_mm_movehl_ps(r, r));
+  }
+}
+
+// Transforms n points stored as three consecutive floats every in_stride
+// bytes (an interleaved vertex buffer), writing three floats every out_stride
+// bytes.
+inline void transform_points(float4x4 m, const float *in, size_t in_stride,
+                             float *out, size_t out_stride, size_t n) {
+  transform_strided<1>(m, in, in_stride, out, out_stride, n);
+}
+
+// Like transform_points, with the translation ignored.
+inline void transform_directions(float4x4 m, const float *in, size_t in_stride,
+                                 float *out, size_t out_stride, size_t n) {
+  transform_strided<0>(m, in, in_stride, out, out_stride, n);
+}
+
+// Batched matrix products, out[i] = lhs * rhs over arrays of matrices. Each
+// product is the lhs columns applied to the rhs columns, two columns per
+// 256-bit register, or all four per 512-bit register when AVX-512 is
+// available natively. out may alias either input array.
+
+#if defined(SIMDE_X86_AVX512F_NATIVE)
+static inline simde__m512 broadcast_col4(float4 col) {
+  return simde_mm512_broadcast_f32x4(col.simd);
+}
+
+static inline simde__m512 multiply_cols4(simde__m512 c0, simde__m512 c1,
+                                         simde__m512 c2, simde__m512 c3,
+                                         simde__m512 v) {
+  simde__m512 out = simde_mm512_mul_ps(
+      c0, simde_mm512_permute_ps(v, SIMDE_MM_SHUFFLE(0, 0, 0, 0)));
+  out = simde_mm512_fmadd_ps(
+      c1, simde_mm512_permute_ps(v, SIMDE_MM_SHUFFLE(1, 1, 1, 1)), out);
+  out = simde_mm512_fmadd_ps(
+      c2, simde_mm512_permute_ps(v, SIMDE_MM_SHUFFLE(2, 2, 2, 2)), out);
+  return simde_mm512_fmadd_ps(
+      c3, simde_mm512_permute_ps(v, SIMDE_MM_SHUFFLE(3, 3, 3, 3)), out);
+}
+#endif
+
+static inline void multiply_one(float4x4 &lhs, const float *rhs, float *out) {
+#if defined(SIMDE_X86_AVX512F_NATIVE)
+  simde__m512 r = multiply_cols4(
+      broadcast_col4(lhs.col1), broadcast_col4(lhs.col2),
+      broadcast_col4(lhs.col3), broadcast_col4(lhs.col4),
+      simde_mm512_loadu_ps(rhs));
+  simde_mm512_storeu_ps(out, r);
+#else
+  simde__m256 c0 = broadcast_col(lhs.col1), c1 = broadcast_col(lhs.col2),
+              c2 = broadcast_col(lhs.col3), c3 = broadcast_col(lhs.col4);
+  simde__m256 a = transform_pair<2>(c0, c1, c2, c3, simde_mm256_loadu_ps(rhs));
+  simde__m256 b =
+      transform_pair<2>(c0, c1, c2, c3, simde_mm256_loadu_ps(rhs + 8));
+  simde_mm256_storeu_ps(out, a);
+  simde_mm256_storeu_ps(out + 8, b);
+#endif
+}
+
+// out[i] = lhs[i] * rhs[i] for n pairs.
+inline void multiply_many(const float4x4 *lhs, const float4x4 *rhs,
+                          float4x4 *out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    simde_mm_prefetch(reinterpret_cast<const char *>(lhs + i + 4),
+                      SIMDE_MM_HINT_T0);
+    simde_mm_prefetch(reinterpret_cast<const char *>(rhs + i + 4),
+                      SIMDE_MM_HINT_T0);
+    float4x4 a = lhs[i];
+    multiply_one(a, reinterpret_cast<const float *>(rhs + i),
+                 reinterpret_cast<float *>(out + i));
+  }
+}
+
+// out[i] = lhs * rhs[i] for n matrices, e.g. a parent transform applied to
+// all of its children.
+inline void multiply_many(float4x4 lhs, const float4x4 *rhs, float4x4 *out,
+                          size_t n) {
+#if defined(SIMDE_X86_AVX512F_NATIVE)
+  const float *src = reinterpret_cast<const float *>(rhs);
+  float *dst = reinterpret_cast<float *>(out);
+  simde__m512 c0 = broadcast_col4(lhs.col1), c1 = broadcast_col4(lhs.col2),
+              c2 = broadcast_col4(lhs.col3), c3 = broadcast_col4(lhs.col4);
+  for (size_t i = 0; i < n; i++) {
+    simde_mm_prefetch(reinterpret_cast<const char *>(src + 16 * i + 64),
+                      SIMDE_MM_HINT_T0);
+    simde_mm512_storeu_ps(
+        dst + 16 * i,
+        multiply_cols4(c0, c1, c2, c3, simde_mm512_loadu_ps(src + 16 * i)));
+  }
+#else
+  // Every column of every rhs is just another vector to transform.
+  transform_batch<2>(lhs, &rhs->cols[0].simd, &out->cols[0].simd, 4 * n);
+#endif
+}
+
+// out[i] = lhs[i] * rhs for n matrices, e.g. a bone palette multiplied by a
+// shared bind matrix.
+inline void multiply_many(const float4x4 *lhs, float4x4 rhs, float4x4 *out,
+                          size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    simde_mm_prefetch(reinterpret_cast<const char *>(lhs + i + 4),
+                      SIMDE_MM_HINT_T0);
+    float4x4 a = lhs[i];
+    multiply_one(a, reinterpret_cast<const float *>(&rhs),
+                 reinterpret_cast<float *>(out + i));
+  }
+}
+
 } // namespace fonge
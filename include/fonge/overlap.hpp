@@ -0,0 +1,121 @@
+#pragma once
+
+#include "packet_float.hpp"
+#include "shapes.hpp"
+#include <stdint.h>
+
+namespace fonge {
+
+// Batch overlap tests: one query volume against eight at a time, transposed
+// to one register per coordinate, with the query broadcast. Results match
+// intersects() up to rounding at the boundaries.
+//
+// Pairs: sphere-sphere, sphere-AABB, plane-AABB and OBB-OBB.
+
+static_assert(sizeof(sphere) == 8 * sizeof(float) &&
+                  sizeof(AABB3f) == 8 * sizeof(float) &&
+                  sizeof(OBB) == 20 * sizeof(float),
+              "records are transposed as rows of floats");
+
+// Bit k set when query overlaps spheres[k].
+static inline int overlaps_x8(sphere query, const sphere *spheres) {
+  simde__m256 c[3], r[3];
+  packet_transpose_rows8(reinterpret_cast<const float *>(spheres), 8, c, r);
+  float3xN<float1x8> d =
+      float3xN<float1x8>(c[0], c[1], c[2]) - float3xN<float1x8>(query.center);
+  float1x8 reach = float1x8(r[0]) + float1x8(query.radius);
+  return d.dot(d).le(reach * reach).mask();
+}
+
+// Bit k set when query overlaps boxes[k].
+static inline int overlaps_x8(sphere query, const AABB3f *boxes) {
+  simde__m256 lo[3], hi[3];
+  packet_transpose_rows8(reinterpret_cast<const float *>(boxes), 8, lo, hi);
+  float3xN<float1x8> c(query.center);
+  float1x8 dist2(0.f);
+  for (int j = 0; j < 3; j++) {
+    float1x8 d =
+        c.comps[j].max(float1x8(lo[j])).min(float1x8(hi[j])) - c.comps[j];
+    dist2 = d.fmadd(d, dist2);
+  }
+  return dist2.le(float1x8(query.radius * query.radius)).mask();
+}
+
+// Bit k set when boxes[k] touches the plane.
+static inline int overlaps_x8(plane query, const AABB3f *boxes) {
+  simde__m256 lo[3], hi[3];
+  packet_transpose_rows8(reinterpret_cast<const float *>(boxes), 8, lo, hi);
+  float3 n = query.normal, abs_n = n.abs();
+  float1x8 half(0.5f), dist(query.d), reach(0.f);
+  for (int j = 0; j < 3; j++) {
+    float1x8 center = (float1x8(lo[j]) + float1x8(hi[j])) * half;
+    float1x8 extent = (float1x8(hi[j]) - float1x8(lo[j])) * half;
+    dist = center.fmadd(float1x8(n[j]), dist);
+    reach = extent.fmadd(float1x8(abs_n[j]), reach);
+  }
+  return dist.abs().le(reach).mask();
+}
+
+// Bit k set when query overlaps boxes[k]; OBB::intersects() in lanes.
+static inline int overlaps_x8(OBB query, const OBB *boxes) {
+  const float *rows = reinterpret_cast<const float *>(boxes);
+  simde__m256 center[3], extent[3], axes[3][3], unused[3];
+  packet_transpose_rows8(rows, 20, center, extent);
+  packet_transpose_rows8(rows + 8, 20, axes[0], axes[1]);
+  packet_transpose_rows8(rows + 12, 20, unused, axes[2]);
+  typedef float1x8 S;
+  float3xN<S> d =
+      float3xN<S>(center[0], center[1], center[2]) - float3xN<S>(query.center);
+  S r[3][3], abs_r[3][3], t[3], ea[3], eb[3];
+  for (int i = 0; i < 3; i++) {
+    float3xN<S> u(query.axes[i]);
+    for (int j = 0; j < 3; j++) {
+      r[i][j] = u.dot(float3xN<S>(axes[j][0], axes[j][1], axes[j][2]));
+      abs_r[i][j] = r[i][j].abs() + S(1e-6f);
+    }
+    t[i] = d.dot(u);
+    ea[i] = S(query.extent[i]);
+    eb[i] = S(extent[i]);
+  }
+  S hit = S(0.f).le(S(0.f));
+  for (int i = 0; i < 3; i++) {
+    S rb = eb[0] * abs_r[i][0] + eb[1] * abs_r[i][1] + eb[2] * abs_r[i][2];
+    hit = hit & t[i].abs().le(ea[i] + rb);
+  }
+  for (int j = 0; j < 3; j++) {
+    S ra = ea[0] * abs_r[0][j] + ea[1] * abs_r[1][j] + ea[2] * abs_r[2][j];
+    S dist = t[0] * r[0][j] + t[1] * r[1][j] + t[2] * r[2][j];
+    hit = hit & dist.abs().le(ra + eb[j]);
+  }
+  for (int i = 0; i < 3; i++) {
+    int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+    for (int j = 0; j < 3; j++) {
+      int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+      S ra = ea[i1] * abs_r[i2][j] + ea[i2] * abs_r[i1][j];
+      S rb = eb[j1] * abs_r[i][j2] + eb[j2] * abs_r[i][j1];
+      S dist = t[i2] * r[i1][j] - t[i1] * r[i2][j];
+      hit = hit & dist.abs().le(ra + rb);
+    }
+  }
+  return hit.mask();
+}
+
+// batch_mask and batch_list over the pairs above, for Q, T one of them.
+template <typename Q, typename T>
+inline void overlap_mask(Q query, const T *shapes, size_t n, uint8_t *mask) {
+  batch_mask(
+      shapes, n, mask,
+      [&](const T *eight) { return overlaps_x8(query, eight); },
+      [&](const T &shape) { return query.intersects(shape); });
+}
+
+template <typename Q, typename T>
+inline size_t overlap_list(Q query, const T *shapes, size_t n,
+                           uint32_t *hits) {
+  return batch_list(
+      shapes, n, hits,
+      [&](const T *eight) { return overlaps_x8(query, eight); },
+      [&](const T &shape) { return query.intersects(shape); });
+}
+
+} // namespace fonge
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "soa_float.hpp"
+#include "vector_double.hpp"
+#include "vector_float.hpp"
+
+namespace fonge {
+
+// Unpadded 12- and 24-byte storage for float3 and double3, the interchange
+// format for mesh data. load() and store() move between them and registers.
+//
+// Bulk conversions use overlapping accesses: every element but the last is
+// loaded with a full-width load that runs into the next element (its w lane
+// is cleared afterwards), and stored with a full-width store that the next
+// element's store overwrites. Only the last element needs a narrow access.
+struct packed_float3 {
+  inline packed_float3() : x(0), y(0), z(0) {}
+
+  inline packed_float3(float3 v) { store(v); }
+
+  // One access for x and y, another for z.
+  inline float3 load() const {
+    simde__m128 xy = simde_mm_castpd_ps(
+        simde_mm_load_sd(reinterpret_cast<const double *>(&x)));
+    return simde_mm_movelh_ps(xy, simde_mm_load_ss(&z));
+  }
+
+  inline void store(float3 v) {
+    simde_mm_store_sd(reinterpret_cast<double *>(&x),
+                      simde_mm_castps_pd(v.simd));
+    simde_mm_store_ss(&z, simde_mm_movehl_ps(v.simd, v.simd));
+  }
+
+  float x, y, z;
+};
+
+struct packed_double3 {
+  inline packed_double3() : x(0), y(0), z(0) {}
+
+  inline packed_double3(double3 v) { store(v); }
+
+  inline double3 load() const {
+    simde__m256d xy = simde_mm256_castpd128_pd256(simde_mm_loadu_pd(&x));
+    return simde_mm256_insertf128_pd(xy, simde_mm_load_sd(&z), 1);
+  }
+
+  inline void store(double3 v) {
+    simde_mm_storeu_pd(&x, simde_mm256_castpd256_pd128(v.simd));
+    simde_mm_store_sd(&z, simde_mm256_extractf128_pd(v.simd, 1));
+  }
+
+  double x, y, z;
+};
+
+static_assert(sizeof(packed_float3) == 12 && sizeof(packed_double3) == 24,
+              "packed vectors have no padding");
+
+inline void unpack_float3(const packed_float3 *in, float3 *out, size_t n) {
+  if (n == 0) {
+    return;
+  }
+  simde__m128 zero = simde_mm_setzero_ps();
+  for (size_t i = 0; i + 1 < n; i++) {
+    out[i] = simde_mm_blend_ps(simde_mm_loadu_ps(&in[i].x), zero, 8);
+  }
+  out[n - 1] = in[n - 1].load();
+}
+
+inline void pack_float3(const float3 *in, packed_float3 *out, size_t n) {
+  if (n == 0) {
+    return;
+  }
+  for (size_t i = 0; i + 1 < n; i++) {
+    simde_mm_storeu_ps(&out[i].x, in[i].simd);
+  }
+  out[n - 1].store(in[n - 1]);
+}
+
+inline void unpack_double3(const packed_double3 *in, double3 *out, size_t n) {
+  if (n == 0) {
+    return;
+  }
+  simde__m256d zero = simde_mm256_setzero_pd();
+  for (size_t i = 0; i + 1 < n; i++) {
+    out[i] = simde_mm256_blend_pd(simde_mm256_loadu_pd(&in[i].x), zero, 8);
+  }
+  out[n - 1] = in[n - 1].load();
+}
+
+inline void pack_double3(const double3 *in, packed_double3 *out, size_t n) {
+  if (n == 0) {
+    return;
+  }
+  for (size_t i = 0; i + 1 < n; i++) {
+    simde_mm256_storeu_pd(&out[i].x, in[i].simd);
+  }
+  out[n - 1].store(in[n - 1]);
+}
+
+// Packed float3 to and from float3_soa, eight at a time: three 256-bit
+// registers of x0 y0 z0 x1 ... z7 are deinterleaved with shuffles inside
+// 128-bit halves, the halves holding elements 0-3 and 4-7.
+inline void unpack_float3(const packed_float3 *in, float3_soa &out, size_t n) {
+  out.resize(n);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const float *p = &in[i].x;
+    simde__m256 m03 = simde_mm256_insertf128_ps(
+        simde_mm256_castps128_ps256(simde_mm_loadu_ps(p)),
+        simde_mm_loadu_ps(p + 12), 1);
+    simde__m256 m14 = simde_mm256_insertf128_ps(
+        simde_mm256_castps128_ps256(simde_mm_loadu_ps(p + 4)),
+        simde_mm_loadu_ps(p + 16), 1);
+    simde__m256 m25 = simde_mm256_insertf128_ps(
+        simde_mm256_castps128_ps256(simde_mm_loadu_ps(p + 8)),
+        simde_mm_loadu_ps(p + 20), 1);
+    simde__m256 xy =
+        simde_mm256_shuffle_ps(m14, m25, SIMDE_MM_SHUFFLE(2, 1, 3, 2));
+    simde__m256 yz =
+        simde_mm256_shuffle_ps(m03, m14, SIMDE_MM_SHUFFLE(1, 0, 2, 1));
+    simde__m256 x =
+        simde_mm256_shuffle_ps(m03, xy, SIMDE_MM_SHUFFLE(2, 0, 3, 0));
+    simde__m256 y =
+        simde_mm256_shuffle_ps(yz, xy, SIMDE_MM_SHUFFLE(3, 1, 2, 0));
+    simde__m256 z =
+        simde_mm256_shuffle_ps(yz, m25, SIMDE_MM_SHUFFLE(3, 0, 3, 1));
+    simde_mm256_store_ps(&out.x[i], x);
+    simde_mm256_store_ps(&out.y[i], y);
+    simde_mm256_store_ps(&out.z[i], z);
+  }
+  for (; i < n; i++) {
+    out.set(i, in[i].load());
+  }
+}
+
+inline void pack_float3(float3_soa &in, packed_float3 *out) {
+  size_t n = in.size(), i = 0;
+  for (; i + 8 <= n; i += 8) {
+    simde__m256 x = simde_mm256_load_ps(&in.x[i]),
+                y = simde_mm256_load_ps(&in.y[i]),
+                z = simde_mm256_load_ps(&in.z[i]);
+    simde__m256 xy =
+        simde_mm256_shuffle_ps(x, y, SIMDE_MM_SHUFFLE(2, 0, 2, 0));
+    simde__m256 yz =
+        simde_mm256_shuffle_ps(y, z, SIMDE_MM_SHUFFLE(3, 1, 3, 1));
+    simde__m256 zx =
+        simde_mm256_shuffle_ps(z, x, SIMDE_MM_SHUFFLE(3, 1, 2, 0));
+    simde__m256 r03 =
+        simde_mm256_shuffle_ps(xy, zx, SIMDE_MM_SHUFFLE(2, 0, 2, 0));
+    simde__m256 r14 =
+        simde_mm256_shuffle_ps(yz, xy, SIMDE_MM_SHUFFLE(3, 1, 2, 0));
+    simde__m256 r25 =
+        simde_mm256_shuffle_ps(zx, yz, SIMDE_MM_SHUFFLE(3, 1, 3, 1));
+    float *p = &out[i].x;
+    simde_mm_storeu_ps(p, simde_mm256_castps256_ps128(r03));
+    simde_mm_storeu_ps(p + 4, simde_mm256_castps256_ps128(r14));
+    simde_mm_storeu_ps(p + 8, simde_mm256_castps256_ps128(r25));
+    simde_mm_storeu_ps(p + 12, simde_mm256_extractf128_ps(r03, 1));
+    simde_mm_storeu_ps(p + 16, simde_mm256_extractf128_ps(r14, 1));
+    simde_mm_storeu_ps(p + 20, simde_mm256_extractf128_ps(r25, 1));
+  }
+  for (; i < n; i++) {
+    out[i].store(in[i]);
+  }
+}
+
+} // namespace fonge
@@ -0,0 +1,859 @@
+#pragma once
+
+#include "soa_float.hpp"
+#include "swizzle.hpp"
+#include "transcendental.hpp"
+#include "vector_float.hpp"
+#include <simde/x86/avx512.h>
+
+namespace fonge {
+
+// Four floats, one per lane. Plays the role of float1 for the x4 packets,
+// which fit SSE registers. They have no typedefs: float3x4 is a matrix.
+struct float1x4 {
+  static constexpr size_t lanes = 4;
+
+  inline float1x4() : simd(simde_mm_setzero_ps()) {}
+
+  inline float1x4(float all) : simd(simde_mm_set1_ps(all)) {}
+
+  inline float1x4(simde__m128 vec) : simd(vec) {}
+
+  static inline float1x4 load(const float *src) {
+    return simde_mm_loadu_ps(src);
+  }
+
+  inline void store(float *dst) { simde_mm_storeu_ps(dst, simd); }
+
+  inline float1x4 operator+(float1x4 rhs) {
+    return simde_mm_add_ps(simd, rhs.simd);
+  }
+
+  inline float1x4 operator-(float1x4 rhs) {
+    return simde_mm_sub_ps(simd, rhs.simd);
+  }
+
+  inline float1x4 operator*(float1x4 rhs) {
+    return simde_mm_mul_ps(simd, rhs.simd);
+  }
+
+  inline float1x4 operator/(float1x4 rhs) {
+    return simde_mm_div_ps(simd, rhs.simd);
+  }
+
+  inline float1x4 operator-() { return simde_x_mm_negate_ps(simd); }
+
+  inline float1x4 abs() { return simde_x_mm_abs_ps(simd); }
+
+  inline float1x4 copysign(float1x4 sign) {
+    simde__m128 mask = simde_mm_set1_ps(-0.0f);
+    return simde_mm_or_ps(simde_mm_andnot_ps(mask, simd),
+                          simde_mm_and_ps(mask, sign.simd));
+  }
+
+  inline float1x4 sqrt() { return simde_mm_sqrt_ps(simd); }
+
+  // Approximate 1 / sqrt(this) and 1 / this (see approx.hpp).
+  inline float1x4 rsqrt() { return rsqrt_nr_ps(simd); }
+
+  inline float1x4 rcp() { return rcp_nr_ps(simd); }
+
+  // this * a + b
+  inline float1x4 fmadd(float1x4 a, float1x4 b) {
+    return simde_mm_fmadd_ps(simd, a.simd, b.simd);
+  }
+
+  inline float1x4 min(float1x4 rhs) { return simde_mm_min_ps(simd, rhs.simd); }
+
+  inline float1x4 max(float1x4 rhs) { return simde_mm_max_ps(simd, rhs.simd); }
+
+  // Lane masks, all bits set where the comparison holds. NaNs compare false.
+  inline float1x4 lt(float1x4 rhs) { return simde_mm_cmplt_ps(simd, rhs.simd); }
+
+  inline float1x4 le(float1x4 rhs) { return simde_mm_cmple_ps(simd, rhs.simd); }
+
+  inline float1x4 operator&(float1x4 rhs) {
+    return simde_mm_and_ps(simd, rhs.simd);
+  }
+
+  // One bit per lane of a lane mask.
+  inline int mask() { return simde_mm_movemask_ps(simd); }
+
+  // rhs in the lanes where mask is set, this in the others.
+  inline float1x4 blend(float1x4 rhs, float1x4 mask) {
+    return simde_mm_blendv_ps(simd, rhs.simd, mask.simd);
+  }
+
+  inline float operator[](size_t i) {
+    alignas(16) float out[4];
+    simde_mm_store_ps(out, simd);
+    return out[i];
+  }
+
+  simde__m128 simd;
+};
+
+// Eight floats, one per lane. Plays the role of float1 for the x8 packets.
+struct float1x8 {
+  static constexpr size_t lanes = 8;
+
+  inline float1x8() : simd(simde_mm256_setzero_ps()) {}
+
+  inline float1x8(float all) : simd(simde_mm256_set1_ps(all)) {}
+
+  inline float1x8(simde__m256 vec) : simd(vec) {}
+
+  static inline float1x8 load(const float *src) {
+    return simde_mm256_loadu_ps(src);
+  }
+
+  inline void store(float *dst) { simde_mm256_storeu_ps(dst, simd); }
+
+  inline float1x8 operator+(float1x8 rhs) {
+    return simde_mm256_add_ps(simd, rhs.simd);
+  }
+
+  inline float1x8 operator-(float1x8 rhs) {
+    return simde_mm256_sub_ps(simd, rhs.simd);
+  }
+
+  inline float1x8 operator*(float1x8 rhs) {
+    return simde_mm256_mul_ps(simd, rhs.simd);
+  }
+
+  inline float1x8 operator/(float1x8 rhs) {
+    return simde_mm256_div_ps(simd, rhs.simd);
+  }
+
+  inline float1x8 operator-() { return simde_x_mm256_negate_ps(simd); }
+
+  inline float1x8 abs() { return simde_x_mm256_abs_ps(simd); }
+
+  // |this| with the sign of sign.
+  inline float1x8 copysign(float1x8 sign) {
+    simde__m256 mask = simde_mm256_set1_ps(-0.0f);
+    return simde_mm256_or_ps(simde_mm256_andnot_ps(mask, simd),
+                             simde_mm256_and_ps(mask, sign.simd));
+  }
+
+  inline float1x8 sqrt() { return simde_mm256_sqrt_ps(simd); }
+
+  // Approximate 1 / sqrt(this) and 1 / this (see approx.hpp).
+  inline float1x8 rsqrt() { return rsqrt_nr_ps(simd); }
+
+  inline float1x8 rcp() { return rcp_nr_ps(simd); }
+
+  // this * a + b
+  inline float1x8 fmadd(float1x8 a, float1x8 b) {
+    return simde_mm256_fmadd_ps(simd, a.simd, b.simd);
+  }
+
+  inline float1x8 min(float1x8 rhs) {
+    return simde_mm256_min_ps(simd, rhs.simd);
+  }
+
+  inline float1x8 max(float1x8 rhs) {
+    return simde_mm256_max_ps(simd, rhs.simd);
+  }
+
+  // Lane masks, all bits set where the comparison holds. NaNs compare false.
+  inline float1x8 lt(float1x8 rhs) {
+    return simde_mm256_cmp_ps(simd, rhs.simd, SIMDE_CMP_LT_OQ);
+  }
+
+  inline float1x8 le(float1x8 rhs) {
+    return simde_mm256_cmp_ps(simd, rhs.simd, SIMDE_CMP_LE_OQ);
+  }
+
+  inline float1x8 operator&(float1x8 rhs) {
+    return simde_mm256_and_ps(simd, rhs.simd);
+  }
+
+  // One bit per lane of a lane mask.
+  inline int mask() { return simde_mm256_movemask_ps(simd); }
+
+  // rhs in the lanes where mask is set, this in the others.
+  inline float1x8 blend(float1x8 rhs, float1x8 mask) {
+    return simde_mm256_blendv_ps(simd, rhs.simd, mask.simd);
+  }
+
+  inline float operator[](size_t i) {
+    alignas(32) float out[8];
+    simde_mm256_store_ps(out, simd);
+    return out[i];
+  }
+
+  simde__m256 simd;
+};
+
+// Sixteen floats, one per lane. Plays the role of float1 for the x16 packets.
+struct float1x16 {
+  static constexpr size_t lanes = 16;
+
+  inline float1x16() : simd(simde_mm512_setzero_ps()) {}
+
+  inline float1x16(float all) : simd(simde_mm512_set1_ps(all)) {}
+
+  inline float1x16(simde__m512 vec) : simd(vec) {}
+
+  static inline float1x16 load(const float *src) {
+    return simde_mm512_loadu_ps(src);
+  }
+
+  inline void store(float *dst) { simde_mm512_storeu_ps(dst, simd); }
+
+  inline float1x16 operator+(float1x16 rhs) {
+    return simde_mm512_add_ps(simd, rhs.simd);
+  }
+
+  inline float1x16 operator-(float1x16 rhs) {
+    return simde_mm512_sub_ps(simd, rhs.simd);
+  }
+
+  inline float1x16 operator*(float1x16 rhs) {
+    return simde_mm512_mul_ps(simd, rhs.simd);
+  }
+
+  inline float1x16 operator/(float1x16 rhs) {
+    return simde_mm512_div_ps(simd, rhs.simd);
+  }
+
+  inline float1x16 operator-() {
+    return simde_mm512_sub_ps(simde_mm512_setzero_ps(), simd);
+  }
+
+  inline float1x16 abs() { return simde_mm512_abs_ps(simd); }
+
+  inline float1x16 copysign(float1x16 sign) {
+    simde__m512 mask = simde_mm512_set1_ps(-0.0f);
+    return simde_mm512_or_ps(simde_mm512_andnot_ps(mask, simd),
+                             simde_mm512_and_ps(mask, sign.simd));
+  }
+
+  inline float1x16 sqrt() { return simde_mm512_sqrt_ps(simd); }
+
+  // Approximate 1 / sqrt(this) and 1 / this (see approx.hpp).
+  inline float1x16 rsqrt() { return rsqrt_nr_ps(simd); }
+
+  inline float1x16 rcp() { return rcp_nr_ps(simd); }
+
+  // this * a + b
+  inline float1x16 fmadd(float1x16 a, float1x16 b) {
+    return simde_mm512_fmadd_ps(simd, a.simd, b.simd);
+  }
+
+  inline float1x16 min(float1x16 rhs) {
+    return simde_mm512_min_ps(simd, rhs.simd);
+  }
+
+  inline float1x16 max(float1x16 rhs) {
+    return simde_mm512_max_ps(simd, rhs.simd);
+  }
+
+  // Lane masks as for float1x8, expanded from AVX-512 mask registers.
+  inline float1x16 lt(float1x16 rhs) {
+    return expand(simde_mm512_cmp_ps_mask(simd, rhs.simd, SIMDE_CMP_LT_OQ));
+  }
+
+  inline float1x16 le(float1x16 rhs) {
+    return expand(simde_mm512_cmp_ps_mask(simd, rhs.simd, SIMDE_CMP_LE_OQ));
+  }
+
+  inline float1x16 operator&(float1x16 rhs) {
+    return simde_mm512_castsi512_ps(
+        simde_mm512_and_si512(simde_mm512_castps_si512(simd),
+                              simde_mm512_castps_si512(rhs.simd)));
+  }
+
+  inline int mask() {
+    simde__m512i bits = simde_mm512_castps_si512(simd);
+    return simde_mm512_test_epi32_mask(bits, bits);
+  }
+
+  inline float1x16 blend(float1x16 rhs, float1x16 mask) {
+    return simde_mm512_mask_blend_ps(simde__mmask16(mask.mask()), simd,
+                                     rhs.simd);
+  }
+
+  static inline float1x16 expand(simde__mmask16 k) {
+    return simde_mm512_castsi512_ps(
+        simde_mm512_maskz_mov_epi32(k, simde_mm512_set1_epi32(-1)));
+  }
+
+  inline float operator[](size_t i) {
+    alignas(64) float out[16];
+    simde_mm512_store_ps(out, simd);
+    return out[i];
+  }
+
+  simde__m512 simd;
+};
+
+template <typename S> struct float2xN;
+template <typename S> struct float3xN;
+template <typename S> struct float4xN;
+
+// Swizzles on packets only rename registers, no shuffles are involved.
+#define FONGE_PACKET_SWIZZLE1(name, i)                                         \
+  inline S name() { return comps[i]; }
+#define FONGE_PACKET_SWIZZLE2(name, i, j)                                      \
+  inline float2xN<S> name() { return float2xN<S>(comps[i], comps[j]); }
+#define FONGE_PACKET_SWIZZLE3(name, i, j, k)                                   \
+  inline float3xN<S> name() {                                                  \
+    return float3xN<S>(comps[i], comps[j], comps[k]);                          \
+  }
+#define FONGE_PACKET_SWIZZLE4(name, i, j, k, l)                                \
+  inline float4xN<S> name() {                                                  \
+    return float4xN<S>(comps[i], comps[j], comps[k], comps[l]);                \
+  }
+
+// Gathers S::lanes AoS vectors (simd registers of 4 floats) into one array of
+// lanes floats per component.
+template <typename S>
+static inline void packet_transpose_in(const simde__m128 *vecs, float *planes) {
+  for (size_t i = 0; i < S::lanes; i += 4) {
+    simde__m128 a = vecs[i], b = vecs[i + 1], c = vecs[i + 2], d = vecs[i + 3];
+    SIMDE_MM_TRANSPOSE4_PS(a, b, c, d);
+    simde_mm_storeu_ps(planes + i, a);
+    simde_mm_storeu_ps(planes + S::lanes + i, b);
+    simde_mm_storeu_ps(planes + 2 * S::lanes + i, c);
+    simde_mm_storeu_ps(planes + 3 * S::lanes + i, d);
+  }
+}
+
+template <typename S>
+static inline void packet_transpose_out(const float *planes,
+                                        simde__m128 *vecs) {
+  for (size_t i = 0; i < S::lanes; i += 4) {
+    simde__m128 a = simde_mm_loadu_ps(planes + i),
+                b = simde_mm_loadu_ps(planes + S::lanes + i),
+                c = simde_mm_loadu_ps(planes + 2 * S::lanes + i),
+                d = simde_mm_loadu_ps(planes + 3 * S::lanes + i);
+    SIMDE_MM_TRANSPOSE4_PS(a, b, c, d);
+    vecs[i] = a;
+    vecs[i + 1] = b;
+    vecs[i + 2] = c;
+    vecs[i + 3] = d;
+  }
+}
+
+// Transposes eight rows of eight floats, stride floats apart, keeping columns
+// 0-2 in lo and 4-6 in hi: the xyz of two consecutive float3 in each of eight
+// records, such as the corners of AABB3f.
+static inline void packet_transpose_rows8(const float *rows, size_t stride,
+                                          simde__m256 lo[3],
+                                          simde__m256 hi[3]) {
+  simde__m256 r[8];
+  for (int k = 0; k < 8; k++) {
+    r[k] = simde_mm256_loadu_ps(rows + k * stride);
+  }
+  simde__m256 t0 = simde_mm256_unpacklo_ps(r[0], r[1]),
+              t1 = simde_mm256_unpackhi_ps(r[0], r[1]),
+              t2 = simde_mm256_unpacklo_ps(r[2], r[3]),
+              t3 = simde_mm256_unpackhi_ps(r[2], r[3]),
+              t4 = simde_mm256_unpacklo_ps(r[4], r[5]),
+              t5 = simde_mm256_unpackhi_ps(r[4], r[5]),
+              t6 = simde_mm256_unpacklo_ps(r[6], r[7]),
+              t7 = simde_mm256_unpackhi_ps(r[6], r[7]);
+  simde__m256 x03 = simde_mm256_shuffle_ps(t0, t2, 0x44),
+              y03 = simde_mm256_shuffle_ps(t0, t2, 0xee),
+              z03 = simde_mm256_shuffle_ps(t1, t3, 0x44),
+              x47 = simde_mm256_shuffle_ps(t4, t6, 0x44),
+              y47 = simde_mm256_shuffle_ps(t4, t6, 0xee),
+              z47 = simde_mm256_shuffle_ps(t5, t7, 0x44);
+  lo[0] = simde_mm256_permute2f128_ps(x03, x47, 0x20);
+  lo[1] = simde_mm256_permute2f128_ps(y03, y47, 0x20);
+  lo[2] = simde_mm256_permute2f128_ps(z03, z47, 0x20);
+  hi[0] = simde_mm256_permute2f128_ps(x03, x47, 0x31);
+  hi[1] = simde_mm256_permute2f128_ps(y03, y47, 0x31);
+  hi[2] = simde_mm256_permute2f128_ps(z03, z47, 0x31);
+}
+
+// Drivers for batch tests of eight records at a time: test8(shapes + i)
+// returns bit k set for a hit on shapes[i + k], test1(shapes[i]) is the
+// scalar test used for the tail.
+
+// Bit i % 8 of mask[i / 8] is set on a hit on shapes[i].
+template <typename T, typename X8, typename X1>
+inline void batch_mask(const T *shapes, size_t n, uint8_t *mask, X8 test8,
+                       X1 test1) {
+  size_t body = n & ~size_t(7);
+  for (size_t i = 0; i < body; i += 8) {
+    mask[i / 8] = uint8_t(test8(shapes + i));
+  }
+  if (body < n) {
+    int bits = 0;
+    for (size_t k = body; k < n; k++) {
+      bits |= int(test1(shapes[k])) << (k - body);
+    }
+    mask[body / 8] = uint8_t(bits);
+  }
+}
+
+// Writes the indices of the hits, in order, to hits, which needs room for n.
+// Returns how many there are.
+template <typename T, typename X8, typename X1>
+inline size_t batch_list(const T *shapes, size_t n, uint32_t *hits, X8 test8,
+                         X1 test1) {
+  size_t count = 0, body = n & ~size_t(7);
+  for (size_t i = 0; i < body; i += 8) {
+    int bits = test8(shapes + i);
+    // Branch-free compaction: every index is written, only hits advance the
+    // count.
+    for (int k = 0; k < 8; k++) {
+      hits[count] = uint32_t(i + k);
+      count += (bits >> k) & 1;
+    }
+  }
+  for (size_t i = body; i < n; i++) {
+    hits[count] = uint32_t(i);
+    count += test1(shapes[i]);
+  }
+  return count;
+}
+
+// S::lanes float2 values in structure-of-arrays registers.
+template <typename S> struct float2xN {
+  inline float2xN() {}
+
+  inline float2xN(S all) : comps{all, all} {}
+
+  inline float2xN(float all) : comps{S(all), S(all)} {}
+
+  inline float2xN(S x, S y) : comps{x, y} {}
+
+  inline float2xN(float2 v) : comps{S(v.x()), S(v.y())} {}
+
+  inline float2xN operator+(float2xN rhs) {
+    return float2xN(comps[0] + rhs.comps[0], comps[1] + rhs.comps[1]);
+  }
+
+  inline float2xN operator-(float2xN rhs) {
+    return float2xN(comps[0] - rhs.comps[0], comps[1] - rhs.comps[1]);
+  }
+
+  inline float2xN operator*(float2xN rhs) {
+    return float2xN(comps[0] * rhs.comps[0], comps[1] * rhs.comps[1]);
+  }
+
+  inline float2xN operator/(float2xN rhs) {
+    return float2xN(comps[0] / rhs.comps[0], comps[1] / rhs.comps[1]);
+  }
+
+  inline float2xN operator*(S rhs) {
+    return float2xN(comps[0] * rhs, comps[1] * rhs);
+  }
+
+  inline float2xN operator/(S rhs) {
+    return float2xN(comps[0] / rhs, comps[1] / rhs);
+  }
+
+  // Exact-match overloads, so literals pick these over converting to S or
+  // float2xN.
+  inline float2xN operator*(float rhs) { return (*this) * S(rhs); }
+
+  inline float2xN operator/(float rhs) { return (*this) / S(rhs); }
+
+  inline float2xN &operator+=(float2xN rhs) {
+    (*this) = (*this) + rhs;
+    return *this;
+  }
+
+  inline float2xN &operator-=(float2xN rhs) {
+    (*this) = (*this) - rhs;
+    return *this;
+  }
+
+  inline float2xN &operator*=(float2xN rhs) {
+    (*this) = (*this) * rhs;
+    return *this;
+  }
+
+  inline float2xN &operator/=(float2xN rhs) {
+    (*this) = (*this) / rhs;
+    return *this;
+  }
+
+  inline float2xN operator-() { return float2xN(-comps[0], -comps[1]); }
+
+  inline float2xN abs() { return float2xN(comps[0].abs(), comps[1].abs()); }
+
+  inline S dot(float2xN rhs) {
+    return comps[0].fmadd(rhs.comps[0], comps[1] * rhs.comps[1]);
+  }
+
+  inline float2xN cross() { return float2xN(comps[1], -comps[0]); }
+
+  FONGE_SWIZZLES_2(FONGE_PACKET_SWIZZLE)
+
+  inline S len2() { return dot(*this); }
+
+  inline S len() { return len2().sqrt(); }
+
+  // 1 / len(), approximated (see approx.hpp).
+  inline S rcp_len() { return len2().rsqrt(); }
+
+  inline float2xN normalized() {
+#if defined(FONGE_FAST_MATH)
+    return normalized_fast();
+#else
+    return (*this) / len();
+#endif
+  }
+
+  inline float2xN normalized_fast() { return (*this) * rcp_len(); }
+
+  // Lane i as a float2.
+  inline float2 operator[](size_t i) {
+    return float2(comps[0][i], comps[1][i]);
+  }
+
+  S comps[2];
+};
+
+// S::lanes float3 values in structure-of-arrays registers.
+template <typename S> struct float3xN {
+  inline float3xN() {}
+
+  inline float3xN(S all) : comps{all, all, all} {}
+
+  inline float3xN(float all) : comps{S(all), S(all), S(all)} {}
+
+  inline float3xN(S x, S y, S z) : comps{x, y, z} {}
+
+  inline float3xN(float3 v) : comps{S(v.x()), S(v.y()), S(v.z())} {}
+
+  // Loads S::lanes consecutive AoS vectors.
+  static inline float3xN load(const float3 *src) {
+    alignas(64) float planes[4 * S::lanes];
+    packet_transpose_in<S>(&src->simd, planes);
+    return float3xN(S::load(planes), S::load(planes + S::lanes),
+                    S::load(planes + 2 * S::lanes));
+  }
+
+  // Loads lanes i .. i + S::lanes of a SoA container.
+  static inline float3xN load(float3_soa &src, size_t i) {
+    return float3xN(S::load(&src.x[i]), S::load(&src.y[i]),
+                    S::load(&src.z[i]));
+  }
+
+  inline void store(float3 *dst) {
+    alignas(64) float planes[4 * S::lanes] = {};
+    comps[0].store(planes);
+    comps[1].store(planes + S::lanes);
+    comps[2].store(planes + 2 * S::lanes);
+    packet_transpose_out<S>(planes, &dst->simd);
+  }
+
+  inline void store(float3_soa &dst, size_t i) {
+    comps[0].store(&dst.x[i]);
+    comps[1].store(&dst.y[i]);
+    comps[2].store(&dst.z[i]);
+  }
+
+  inline float3xN operator+(float3xN rhs) {
+    return float3xN(comps[0] + rhs.comps[0], comps[1] + rhs.comps[1],
+                    comps[2] + rhs.comps[2]);
+  }
+
+  inline float3xN operator-(float3xN rhs) {
+    return float3xN(comps[0] - rhs.comps[0], comps[1] - rhs.comps[1],
+                    comps[2] - rhs.comps[2]);
+  }
+
+  inline float3xN operator*(float3xN rhs) {
+    return float3xN(comps[0] * rhs.comps[0], comps[1] * rhs.comps[1],
+                    comps[2] * rhs.comps[2]);
+  }
+
+  inline float3xN operator/(float3xN rhs) {
+    return float3xN(comps[0] / rhs.comps[0], comps[1] / rhs.comps[1],
+                    comps[2] / rhs.comps[2]);
+  }
+
+  inline float3xN operator*(S rhs) {
+    return float3xN(comps[0] * rhs, comps[1] * rhs, comps[2] * rhs);
+  }
+
+  inline float3xN operator/(S rhs) {
+    return float3xN(comps[0] / rhs, comps[1] / rhs, comps[2] / rhs);
+  }
+
+  inline float3xN operator*(float rhs) { return (*this) * S(rhs); }
+
+  inline float3xN operator/(float rhs) { return (*this) / S(rhs); }
+
+  inline float3xN &operator+=(float3xN rhs) {
+    (*this) = (*this) + rhs;
+    return *this;
+  }
+
+  inline float3xN &operator-=(float3xN rhs) {
+    (*this) = (*this) - rhs;
+    return *this;
+  }
+
+  inline float3xN &operator*=(float3xN rhs) {
+    (*this) = (*this) * rhs;
+    return *this;
+  }
+
+  inline float3xN &operator/=(float3xN rhs) {
+    (*this) = (*this) / rhs;
+    return *this;
+  }
+
+  inline float3xN operator-() {
+    return float3xN(-comps[0], -comps[1], -comps[2]);
+  }
+
+  inline float3xN abs() {
+    return float3xN(comps[0].abs(), comps[1].abs(), comps[2].abs());
+  }
+
+  inline S dot(float3xN rhs) {
+    return comps[0].fmadd(
+        rhs.comps[0], comps[1].fmadd(rhs.comps[1], comps[2] * rhs.comps[2]));
+  }
+
+  inline float3xN cross(float3xN rhs) {
+    return float3xN(comps[1] * rhs.comps[2] - comps[2] * rhs.comps[1],
+                    comps[2] * rhs.comps[0] - comps[0] * rhs.comps[2],
+                    comps[0] * rhs.comps[1] - comps[1] * rhs.comps[0]);
+  }
+
+  FONGE_SWIZZLES_3(FONGE_PACKET_SWIZZLE)
+
+  inline S len2() { return dot(*this); }
+
+  inline S len() { return len2().sqrt(); }
+
+  // 1 / len(), approximated (see approx.hpp).
+  inline S rcp_len() { return len2().rsqrt(); }
+
+  inline float3xN normalized() {
+#if defined(FONGE_FAST_MATH)
+    return normalized_fast();
+#else
+    return (*this) / len();
+#endif
+  }
+
+  inline float3xN normalized_fast() { return (*this) * rcp_len(); }
+
+  // Lane i as a float3.
+  inline float3 operator[](size_t i) {
+    return float3(comps[0][i], comps[1][i], comps[2][i]);
+  }
+
+  static inline float3xN one() { return float3xN(1.f); }
+
+  static inline float3xN x_axis() { return float3xN(S(1), S(0), S(0)); }
+
+  static inline float3xN y_axis() { return float3xN(S(0), S(1), S(0)); }
+
+  static inline float3xN z_axis() { return float3xN(S(0), S(0), S(1)); }
+
+  S comps[3];
+};
+
+// S::lanes float4 values in structure-of-arrays registers.
+template <typename S> struct float4xN {
+  inline float4xN() {}
+
+  inline float4xN(S all) : comps{all, all, all, all} {}
+
+  inline float4xN(float all) : comps{S(all), S(all), S(all), S(all)} {}
+
+  inline float4xN(S x, S y, S z, S w) : comps{x, y, z, w} {}
+
+  inline float4xN(float3xN<S> xyz, S w)
+      : comps{xyz.comps[0], xyz.comps[1], xyz.comps[2], w} {}
+
+  inline float4xN(float4 v)
+      : comps{S(v.x()), S(v.y()), S(v.z()), S(v.w())} {}
+
+  // Loads S::lanes consecutive AoS vectors.
+  static inline float4xN load(const float4 *src) {
+    alignas(64) float planes[4 * S::lanes];
+    packet_transpose_in<S>(&src->simd, planes);
+    return float4xN(S::load(planes), S::load(planes + S::lanes),
+                    S::load(planes + 2 * S::lanes),
+                    S::load(planes + 3 * S::lanes));
+  }
+
+  // Loads lanes i .. i + S::lanes of a SoA container.
+  static inline float4xN load(float4_soa &src, size_t i) {
+    return float4xN(S::load(&src.x[i]), S::load(&src.y[i]),
+                    S::load(&src.z[i]), S::load(&src.w[i]));
+  }
+
+  inline void store(float4 *dst) {
+    alignas(64) float planes[4 * S::lanes];
+    comps[0].store(planes);
+    comps[1].store(planes + S::lanes);
+    comps[2].store(planes + 2 * S::lanes);
+    comps[3].store(planes + 3 * S::lanes);
+    packet_transpose_out<S>(planes, &dst->simd);
+  }
+
+  inline void store(float4_soa &dst, size_t i) {
+    comps[0].store(&dst.x[i]);
+    comps[1].store(&dst.y[i]);
+    comps[2].store(&dst.z[i]);
+    comps[3].store(&dst.w[i]);
+  }
+
+  inline float4xN operator+(float4xN rhs) {
+    return float4xN(comps[0] + rhs.comps[0], comps[1] + rhs.comps[1],
+                    comps[2] + rhs.comps[2], comps[3] + rhs.comps[3]);
+  }
+
+  inline float4xN operator-(float4xN rhs) {
+    return float4xN(comps[0] - rhs.comps[0], comps[1] - rhs.comps[1],
+                    comps[2] - rhs.comps[2], comps[3] - rhs.comps[3]);
+  }
+
+  inline float4xN operator*(float4xN rhs) {
+    return float4xN(comps[0] * rhs.comps[0], comps[1] * rhs.comps[1],
+                    comps[2] * rhs.comps[2], comps[3] * rhs.comps[3]);
+  }
+
+  inline float4xN operator/(float4xN rhs) {
+    return float4xN(comps[0] / rhs.comps[0], comps[1] / rhs.comps[1],
+                    comps[2] / rhs.comps[2], comps[3] / rhs.comps[3]);
+  }
+
+  inline float4xN operator*(S rhs) {
+    return float4xN(comps[0] * rhs, comps[1] * rhs, comps[2] * rhs,
+                    comps[3] * rhs);
+  }
+
+  inline float4xN operator/(S rhs) {
+    return float4xN(comps[0] / rhs, comps[1] / rhs, comps[2] / rhs,
+                    comps[3] / rhs);
+  }
+
+  inline float4xN operator*(float rhs) { return (*this) * S(rhs); }
+
+  inline float4xN operator/(float rhs) { return (*this) / S(rhs); }
+
+  inline float4xN &operator+=(float4xN rhs) {
+    (*this) = (*this) + rhs;
+    return *this;
+  }
+
+  inline float4xN &operator-=(float4xN rhs) {
+    (*this) = (*this) - rhs;
+    return *this;
+  }
+
+  inline float4xN &operator*=(float4xN rhs) {
+    (*this) = (*this) * rhs;
+    return *this;
+  }
+
+  inline float4xN &operator/=(float4xN rhs) {
+    (*this) = (*this) / rhs;
+    return *this;
+  }
+
+  inline float4xN operator-() {
+    return float4xN(-comps[0], -comps[1], -comps[2], -comps[3]);
+  }
+
+  inline float4xN abs() {
+    return float4xN(comps[0].abs(), comps[1].abs(), comps[2].abs(),
+                    comps[3].abs());
+  }
+
+  inline S dot(float4xN rhs) {
+    return comps[0].fmadd(
+        rhs.comps[0],
+        comps[1].fmadd(rhs.comps[1],
+                       comps[2].fmadd(rhs.comps[2], comps[3] * rhs.comps[3])));
+  }
+
+  FONGE_SWIZZLES_4(FONGE_PACKET_SWIZZLE)
+
+  inline S len2() { return dot(*this); }
+
+  inline S len() { return len2().sqrt(); }
+
+  // 1 / len(), approximated (see approx.hpp).
+  inline S rcp_len() { return len2().rsqrt(); }
+
+  inline float4xN normalized() {
+#if defined(FONGE_FAST_MATH)
+    return normalized_fast();
+#else
+    return (*this) / len();
+#endif
+  }
+
+  inline float4xN normalized_fast() { return (*this) * rcp_len(); }
+
+  // Lane i as a float4.
+  inline float4 operator[](size_t i) {
+    return float4(comps[0][i], comps[1][i], comps[2][i], comps[3][i]);
+  }
+
+  static inline float4xN one() { return float4xN(1.f); }
+
+  S comps[4];
+};
+
+template <typename S>
+static inline float2xN<S> operator*(S lhs, float2xN<S> rhs) {
+  return rhs * lhs;
+}
+
+template <typename S>
+static inline float2xN<S> operator*(float lhs, float2xN<S> rhs) {
+  return rhs * lhs;
+}
+
+template <typename S>
+static inline float3xN<S> operator*(S lhs, float3xN<S> rhs) {
+  return rhs * lhs;
+}
+
+template <typename S>
+static inline float3xN<S> operator*(float lhs, float3xN<S> rhs) {
+  return rhs * lhs;
+}
+
+template <typename S>
+static inline float4xN<S> operator*(S lhs, float4xN<S> rhs) {
+  return rhs * lhs;
+}
+
+template <typename S>
+static inline float4xN<S> operator*(float lhs, float4xN<S> rhs) {
+  return rhs * lhs;
+}
+
+static inline float1x4 operator*(float lhs, float1x4 rhs) {
+  return float1x4(lhs) * rhs;
+}
+
+static inline float1x8 operator*(float lhs, float1x8 rhs) {
+  return float1x8(lhs) * rhs;
+}
+
+static inline float1x16 operator*(float lhs, float1x16 rhs) {
+  return float1x16(lhs) * rhs;
+}
+
+FONGE_TRANSCENDENTALS(float1x4)
+FONGE_TRANSCENDENTALS(float1x8)
+FONGE_TRANSCENDENTALS(float1x16)
+
+typedef float2xN<float1x8> float2x8;
+typedef float3xN<float1x8> float3x8;
+typedef float4xN<float1x8> float4x8;
+typedef float2xN<float1x16> float2x16;
+typedef float3xN<float1x16> float3x16;
+typedef float4xN<float1x16> float4x16;
+
+} // namespace fonge
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "quaternion_batch.hpp"
+#include <cmath>
+
+namespace fonge {
+
+// Pose blending. t runs from a (t = 0) to b (t = 1) everywhere, and rotations
+// take the shorter arc: b is negated when it is on the other hemisphere from
+// a. Weights are non-negative.
+//
+// slerp_approx is nlerp at a corrected t, t + t (t - 1/2) (t - 1) k, with k
+// fitted against slerp over |cos| of the half angle (Kapoulkine,
+// "Approximating slerp"). It stays within 4e-4 radians of slerp's half angle,
+// about 0.05 degrees of rotation, for a few multiplies more than nlerp.
+
+// The corrected t for |cos| d between the two quaternions.
+template <typename S> static inline S slerp_approx_t(S d, S t) {
+  S a = S(1.0904f) + d * (S(-3.2452f) + d * (S(3.55645f) - d * S(1.43519f)));
+  S b = S(0.848013f) + d * (S(-1.06021f) + d * S(0.215638f));
+  S u = t - S(0.5f);
+  return t + t * u * (t - S(1)) * (a * u * u + b);
+}
+
+static inline quat nlerp_shortest(quat a, quat b, float t) {
+  float bt = std::copysign(t, a.vec.dot(b.vec));
+  return (a.vec * (1 - t) + b.vec * bt).normalized();
+}
+
+static inline quat slerp_approx(quat a, quat b, float t) {
+  float d = a.vec.dot(b.vec);
+  float ct = slerp_approx_t(std::abs(d), t);
+  return (a.vec * (1 - ct) + b.vec * std::copysign(ct, d)).normalized();
+}
+
+template <typename S>
+static inline quatxN<S> nlerp_shortest(quatxN<S> a, quatxN<S> b, S t) {
+  S bt = t.copysign(a.vec.dot(b.vec));
+  return (a.vec * (S(1) - t) + b.vec * bt).normalized();
+}
+
+template <typename S>
+static inline quatxN<S> slerp_approx(quatxN<S> a, quatxN<S> b, S t) {
+  S d = a.vec.dot(b.vec);
+  S ct = slerp_approx_t(d.abs(), t);
+  return (a.vec * (S(1) - ct) + b.vec * ct.copysign(d)).normalized();
+}
+
+// The batch functions take t as one float for every joint, or as an array
+// holding one weight per joint.
+static inline float blend_weight(float t, size_t) { return t; }
+
+static inline float blend_weight(const float *t, size_t i) { return t[i]; }
+
+static inline float1x8 blend_weights(float t, size_t, size_t) { return t; }
+
+static inline float1x8 blend_weights(const float *t, size_t i, size_t n) {
+  return soa_load_tail(t, i, n);
+}
+
+// out[i] = nlerp_shortest(a[i], b[i], t)
+template <typename W>
+inline void nlerp_many(const quat *a, const quat *b, W t, quat *out,
+                       size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = nlerp_shortest(a[i], b[i], blend_weight(t, i));
+  }
+}
+
+// out[i] = slerp_approx(a[i], b[i], t)
+template <typename W>
+inline void slerp_many(const quat *a, const quat *b, W t, quat *out,
+                       size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = slerp_approx(a[i], b[i], blend_weight(t, i));
+  }
+}
+
+// out[i] = a[i] + (b[i] - a[i]) t, for translations and scales.
+template <typename W>
+inline void lerp_many(const float3 *a, const float3 *b, W t, float3 *out,
+                      size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    float3 from = a[i];
+    out[i] = from + (float3(b[i]) - from) * blend_weight(t, i);
+  }
+}
+
+template <typename W>
+inline void nlerp_many(quat_soa &a, quat_soa &b, W t, quat_soa &out) {
+  out.resize(a.size());
+  for (size_t i = 0; i < a.padded_size(); i += 8) {
+    nlerp_shortest(quatx8::load(a, i), quatx8::load(b, i),
+                   blend_weights(t, i, a.size()))
+        .store(out, i);
+  }
+}
+
+template <typename W>
+inline void slerp_many(quat_soa &a, quat_soa &b, W t, quat_soa &out) {
+  out.resize(a.size());
+  for (size_t i = 0; i < a.padded_size(); i += 8) {
+    slerp_approx(quatx8::load(a, i), quatx8::load(b, i),
+                 blend_weights(t, i, a.size()))
+        .store(out, i);
+  }
+}
+
+// Joint transforms of a skeleton pose, one aligned plane per component.
+struct pose_soa {
+  inline pose_soa() {}
+
+  inline pose_soa(size_t n) : rotation(n), translation(n), scale(n) {}
+
+  inline void resize(size_t n) {
+    rotation.resize(n);
+    translation.resize(n);
+    scale.resize(n);
+  }
+
+  inline size_t size() { return rotation.size(); }
+
+  inline size_t padded_size() { return rotation.padded_size(); }
+
+  quat_soa rotation;
+  float3_soa translation;
+  float3_soa scale;
+};
+
+// out = a blended towards b: rotations by slerp_approx, translations and
+// scales by lerp, eight joints per iteration.
+template <typename W>
+inline void blend_poses(pose_soa &a, pose_soa &b, W t, pose_soa &out) {
+  out.resize(a.size());
+  for (size_t i = 0; i < a.padded_size(); i += 8) {
+    float1x8 w = blend_weights(t, i, a.size());
+    slerp_approx(quatx8::load(a.rotation, i), quatx8::load(b.rotation, i), w)
+        .store(out.rotation, i);
+    float3x8 ta = float3x8::load(a.translation, i);
+    (ta + (float3x8::load(b.translation, i) - ta) * w)
+        .store(out.translation, i);
+    float3x8 sa = float3x8::load(a.scale, i);
+    (sa + (float3x8::load(b.scale, i) - sa) * w).store(out.scale, i);
+  }
+}
+
+} // namespace fonge
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "packet_float.hpp"
+#include "quaternion_double.hpp"
+#include "quaternion_float.hpp"
+#include "soa_float.hpp"
+
+namespace fonge {
+
+static_assert(sizeof(quat) == sizeof(float4), "quat arrays load as float4");
+
+struct quat_soa;
+
+// v rotated by the unit quaternion (q, w): v + 2w (q x v) + 2q x (q x v).
+// One cross product pair instead of the two quaternion products of
+// quat::rotate, and only equal to it for unit quaternions.
+template <typename V, typename S>
+static inline V rotate_unit(V q, S w, V v) {
+  V t = q.cross(v) * S(2);
+  return v + t * w + q.cross(t);
+}
+
+// S::lanes quaternions in structure-of-arrays registers, with quat's layout
+// and conventions (x, y, z complex part, w real part).
+template <typename S> struct quatxN {
+  inline quatxN() : vec(S(0), S(0), S(0), S(1)) {}
+
+  inline quatxN(float4xN<S> a) : vec(a) {}
+
+  inline quatxN(float3xN<S> complex_part, S real_part)
+      : vec(complex_part, real_part) {}
+
+  inline quatxN(quat q) : vec(q.vec) {}
+
+  // Loads S::lanes consecutive quaternions.
+  static inline quatxN load(const quat *src) {
+    return float4xN<S>::load(&src->vec);
+  }
+
+  static inline quatxN load(quat_soa &src, size_t i);
+
+  inline void store(quat *dst) { vec.store(&dst->vec); }
+
+  inline void store(quat_soa &dst, size_t i);
+
+  inline quatxN conj() { return quatxN(-vec.xyz(), vec.w()); }
+
+  inline quatxN operator*(quatxN rhs) {
+    float3xN<S> a = vec.xyz(), b = rhs.vec.xyz();
+    S aw = vec.w(), bw = rhs.vec.w();
+    return quatxN(a.cross(b) + b * aw + a * bw, aw * bw - a.dot(b));
+  }
+
+  inline quatxN normalized() { return vec.normalized(); }
+
+  inline quatxN normalized_fast() { return vec.normalized_fast(); }
+
+  // Rotates v by these quaternions, which must be unit length.
+  inline float3xN<S> rotate(float3xN<S> v) {
+    return rotate_unit(vec.xyz(), vec.w(), v);
+  }
+
+  // Lane i as a quat.
+  inline quat operator[](size_t i) { return vec[i]; }
+
+  float4xN<S> vec;
+};
+
+typedef quatxN<float1x8> quatx8;
+typedef quatxN<float1x16> quatx16;
+
+// Structure-of-arrays storage for quat, one aligned plane per component.
+struct quat_soa {
+  inline quat_soa() {}
+
+  inline quat_soa(size_t n) : vec(n) {}
+
+  inline quat_soa(const quat *quats, size_t n) : vec(&quats->vec, n) {}
+
+  inline void resize(size_t n) { vec.resize(n); }
+
+  inline size_t size() { return vec.size(); }
+
+  inline size_t padded_size() { return vec.padded_size(); }
+
+  inline quat operator[](size_t i) { return vec[i]; }
+
+  inline void set(size_t i, quat q) { vec.set(i, q.vec); }
+
+  inline void to_aos(quat *quats) { vec.to_aos(&quats->vec); }
+
+  // out[i] = this[i] * rhs[i]
+  inline void multiply(quat_soa &rhs, quat_soa &out) {
+    out.resize(size());
+    for (size_t i = 0; i < padded_size(); i += 8) {
+      (quatx8::load(*this, i) * quatx8::load(rhs, i)).store(out, i);
+    }
+  }
+
+  inline void conj(quat_soa &out) {
+    out.resize(size());
+    for (size_t i = 0; i < padded_size(); i += 8) {
+      quatx8::load(*this, i).conj().store(out, i);
+    }
+  }
+
+  inline void normalized(quat_soa &out) {
+    out.resize(size());
+    for (size_t i = 0; i < padded_size(); i += 8) {
+      quatx8::load(*this, i).normalized().store(out, i);
+    }
+  }
+
+  // out[i] = this[i].rotate(points[i]), for unit quaternions.
+  inline void rotate_points(float3_soa &points, float3_soa &out) {
+    out.resize(size());
+    for (size_t i = 0; i < padded_size(); i += 8) {
+      quatx8::load(*this, i).rotate(float3x8::load(points, i)).store(out, i);
+    }
+  }
+
+  float4_soa vec;
+};
+
+template <typename S>
+inline quatxN<S> quatxN<S>::load(quat_soa &src, size_t i) {
+  return float4xN<S>::load(src.vec, i);
+}
+
+template <typename S>
+inline void quatxN<S>::store(quat_soa &dst, size_t i) {
+  vec.store(dst.vec, i);
+}
+
+// Batches over AoS arrays run one quaternion per iteration: transposing to
+// packets and back costs more than the rotation itself. Keep hot data in
+// quat_soa/float3_soa to get the eight-wide kernels.
+
+// out[i] = lhs[i] * rhs[i]
+inline void multiply_many(const quat *lhs, const quat *rhs, quat *out,
+                          size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = quat(lhs[i]) * rhs[i];
+  }
+}
+
+// out[i] = q.rotate(in[i]) for a unit q.
+inline void rotate_points(quat q, const float3 *in, float3 *out, size_t n) {
+  float3 v = q.vec.xyz();
+  float w = q.vec.w();
+  for (size_t i = 0; i < n; i++) {
+    out[i] = rotate_unit(v, w, float3(in[i]));
+  }
+}
+
+// out[i] = qs[i].rotate(in[i]) for unit qs[i].
+inline void rotate_points(const quat *qs, const float3 *in, float3 *out,
+                          size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    quat q = qs[i];
+    out[i] = rotate_unit(q.vec.xyz(), q.vec.w(), float3(in[i]));
+  }
+}
+
+inline void multiply_many(const dquat *lhs, const dquat *rhs, dquat *out,
+                          size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = dquat(lhs[i]) * rhs[i];
+  }
+}
+
+inline void rotate_points(dquat q, const double3 *in, double3 *out, size_t n) {
+  double3 v = q.vec.xyz();
+  double w = q.vec.w();
+  for (size_t i = 0; i < n; i++) {
+    out[i] = rotate_unit(v, w, double3(in[i]));
+  }
+}
+
+inline void rotate_points(const dquat *qs, const double3 *in, double3 *out,
+                          size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    dquat q = qs[i];
+    out[i] = rotate_unit(q.vec.xyz(), q.vec.w(), double3(in[i]));
+  }
+}
+
+} // namespace fonge
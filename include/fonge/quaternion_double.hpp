@@ -1,5 +1,9 @@
+#pragma once
+
 #include "matrix_double.hpp"
+#include "transcendental.hpp"
 #include "vector_double.hpp"
+#include <cmath>
 
 namespace fonge {
 
@@ -12,7 +16,9 @@ struct dquat {
       : vec(complex_part, real_part) {}
 
   static inline dquat from_angle_axis(double angle, double3 axis) {
-    return double4(axis * sinf(angle / 2), cosf(angle / 2));
+    double4 s, c;
+    sincos(double4(angle / 2), s, c);
+    return double4(axis * double3(s.simd), c.x());
   }
 
   static inline dquat from_cosangle_axis(double cosangle, double3 axis) {
@@ -25,6 +31,40 @@ struct dquat {
            from_angle_axis(yaw, double3::y_axis());
   }
 
+  // Quaternion of the rotation matrix m (Shepperd's method: the largest of
+  // w, x, y, z is taken from the diagonal, the rest from off-diagonal sums).
+  static inline dquat from_rot_mat(double3x3 m) {
+    double m00 = m[0][0], m11 = m[1][1], m22 = m[2][2];
+    double trace = m00 + m11 + m22;
+    double x, y, z, w, s;
+    if (trace > 0) {
+      s = 0.5 / std::sqrt(trace + 1);
+      w = 0.25 / s;
+      x = (m[1][2] - m[2][1]) * s;
+      y = (m[2][0] - m[0][2]) * s;
+      z = (m[0][1] - m[1][0]) * s;
+    } else if (m00 > m11 && m00 > m22) {
+      s = 0.5 / std::sqrt(1 + m00 - m11 - m22);
+      x = 0.25 / s;
+      y = (m[1][0] + m[0][1]) * s;
+      z = (m[2][0] + m[0][2]) * s;
+      w = (m[1][2] - m[2][1]) * s;
+    } else if (m11 > m22) {
+      s = 0.5 / std::sqrt(1 + m11 - m00 - m22);
+      y = 0.25 / s;
+      x = (m[1][0] + m[0][1]) * s;
+      z = (m[2][1] + m[1][2]) * s;
+      w = (m[2][0] - m[0][2]) * s;
+    } else {
+      s = 0.5 / std::sqrt(1 + m22 - m00 - m11);
+      z = 0.25 / s;
+      x = (m[2][0] + m[0][2]) * s;
+      y = (m[2][1] + m[1][2]) * s;
+      w = (m[0][1] - m[1][0]) * s;
+    }
+    return double4(x, y, z, w);
+  }
+
   inline dquat conj() { return vec * double4(double3(-1), 1); }
 
   inline double norm() { return vec.len2(); }
@@ -66,6 +106,8 @@ struct dquat {
 
   inline double4 operator>(dquat rhs) { return (vec > rhs.vec); }
 
+  inline dquat inverse() { return conj().vec / vec.len2(); }
+
   inline double4 rotate(double4 vec) {
     return ((*this) * dquat(vec) * conj()).vec;
   }
@@ -86,8 +128,9 @@ struct dquat {
 
   inline double3x3 rot_mat3_form() { return double3x3(rot_mat4_form()); }
   inline dquat exponent(double t) {
-    double angle = acos(vec.w());
-    return dquat(sinf(t * angle) * vec.xyz().normalized(), cosf(t * angle));
+    double4 s, c;
+    sincos(acos(vec.wwww()) * t, s, c);
+    return dquat(vec.xyz().normalized() * double3(s.simd), c.x());
   }
 
   inline dquat normalized() { return vec.normalized(); }
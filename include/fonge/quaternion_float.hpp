@@ -1,4 +1,7 @@
+#pragma once
+
 #include "matrix_float.hpp"
+#include "transcendental.hpp"
 #include "vector_float.hpp"
 #include <cmath>
 
@@ -13,7 +16,9 @@ struct quat {
       : vec(complex_part, real_part) {}
 
   static inline quat from_angle_axis(float angle, float3 axis) {
-    return float4(axis * sinf(angle / 2), cosf(angle / 2));
+    float4 s, c;
+    sincos(float4(angle / 2), s, c);
+    return float4(axis * float3(s.simd), c.x());
   }
 
   static inline quat from_cosangle_axis(float cosangle, float3 axis) {
@@ -26,6 +31,40 @@ struct quat {
            from_angle_axis(yaw, float3::y_axis());
   }
 
+  // Quaternion of the rotation matrix m (Shepperd's method: the largest of
+  // w, x, y, z is taken from the diagonal, the rest from off-diagonal sums).
+  static inline quat from_rot_mat(float3x3 m) {
+    float m00 = m[0][0], m11 = m[1][1], m22 = m[2][2];
+    float trace = m00 + m11 + m22;
+    float x, y, z, w, s;
+    if (trace > 0) {
+      s = 0.5f / std::sqrt(trace + 1);
+      w = 0.25f / s;
+      x = (m[1][2] - m[2][1]) * s;
+      y = (m[2][0] - m[0][2]) * s;
+      z = (m[0][1] - m[1][0]) * s;
+    } else if (m00 > m11 && m00 > m22) {
+      s = 0.5f / std::sqrt(1 + m00 - m11 - m22);
+      x = 0.25f / s;
+      y = (m[1][0] + m[0][1]) * s;
+      z = (m[2][0] + m[0][2]) * s;
+      w = (m[1][2] - m[2][1]) * s;
+    } else if (m11 > m22) {
+      s = 0.5f / std::sqrt(1 + m11 - m00 - m22);
+      y = 0.25f / s;
+      x = (m[1][0] + m[0][1]) * s;
+      z = (m[2][1] + m[1][2]) * s;
+      w = (m[2][0] - m[0][2]) * s;
+    } else {
+      s = 0.5f / std::sqrt(1 + m22 - m00 - m11);
+      z = 0.25f / s;
+      x = (m[2][0] + m[0][2]) * s;
+      y = (m[2][1] + m[1][2]) * s;
+      w = (m[0][1] - m[1][0]) * s;
+    }
+    return float4(x, y, z, w);
+  }
+
   inline quat conj() { return vec * float4(float3(-1), 1); }
 
   inline float norm() { return vec.len(); }
@@ -92,8 +131,9 @@ struct quat {
   inline float3x3 rot_mat3_form() { return float3x3(rot_mat4_form()); }
 
   inline quat exponent(float t) {
-    float angle = acosf(vec.w());
-    return quat(sinf(t * angle) * vec.xyz().normalized(), cosf(t * angle));
+    float4 s, c;
+    sincos(acos(vec.wwww()) * t, s, c);
+    return quat(vec.xyz().normalized() * float3(s.simd), c.x());
   }
   inline quat operator/(float rhs) { return vec * 1 / rhs; }
 
@@ -0,0 +1,240 @@
+#pragma once
+
+#include "packet_float.hpp"
+#include "shapes.hpp"
+#include "vector_float.hpp"
+#include <cmath>
+#include <stdint.h>
+
+namespace fonge {
+
+// Rays origin + t dir for t in [0, tmax], and their tests against boxes and
+// triangles. Every test reports a hit with the distance t at which the ray
+// enters the box or meets the triangle, and a miss with t = infinity.
+//
+// Triangles use Moller-Trumbore and are two-sided. A ray in the plane of a
+// triangle divides by a zero determinant; the infinities and NaNs that come
+// out fail the range checks, so it misses without a special case.
+
+struct ray {
+  inline ray() : tmax(INFINITY) {}
+
+  inline ray(float3 origin, float3 dir, float tmax = INFINITY)
+      : origin(origin), dir(dir), tmax(tmax) {}
+
+  inline float3 at(float t) { return origin + dir * t; }
+
+  // Slab test.
+  inline bool intersects(AABB3f box, float &t) {
+    float3 inv = float3(1) / dir;
+    float3 t1 = (box.min_point - origin) * inv;
+    float3 t2 = (box.max_point - origin) * inv;
+    float near = 0, far = tmax;
+    for (int k = 0; k < 3; k++) {
+      near = std::fmax(near, std::fmin(t1[k], t2[k]));
+      far = std::fmin(far, std::fmax(t1[k], t2[k]));
+    }
+    t = near <= far ? near : INFINITY;
+    return near <= far;
+  }
+
+  inline bool intersects(float3 a, float3 b, float3 c, float &t) {
+    float3 e1 = b - a, e2 = c - a;
+    float3 p = dir.cross(e2);
+    float inv_det = 1 / e1.dot(p);
+    float3 s = origin - a;
+    float u = s.dot(p) * inv_det;
+    float3 q = s.cross(e1);
+    float v = dir.dot(q) * inv_det;
+    float d = e2.dot(q) * inv_det;
+    bool hit = u >= 0 && v >= 0 && u + v <= 1 && d >= 0 && d <= tmax;
+    t = hit ? d : INFINITY;
+    return hit;
+  }
+
+  float3 origin;
+  float3 dir;
+  float tmax;
+};
+
+// S::lanes rays in structure-of-arrays registers: float1x4, float1x8 or
+// float1x16 lanes for 4, 8 or 16 rays. The reciprocal directions are kept
+// for the slab tests.
+template <typename S> struct ray_packet {
+  inline ray_packet() {}
+
+  inline ray_packet(float3xN<S> origin, float3xN<S> dir, S tmax)
+      : origin(origin), dir(dir), inv_dir(float3xN<S>(1.f) / dir),
+        tmax(tmax) {}
+
+  // S::lanes rays from an array.
+  static inline ray_packet load(const ray *rays) {
+    alignas(64) float planes[7 * S::lanes];
+    for (size_t k = 0; k < S::lanes; k++) {
+      ray r = rays[k];
+      for (int j = 0; j < 3; j++) {
+        planes[j * S::lanes + k] = r.origin[j];
+        planes[(3 + j) * S::lanes + k] = r.dir[j];
+      }
+      planes[6 * S::lanes + k] = r.tmax;
+    }
+    float3xN<S> o(S::load(planes), S::load(planes + S::lanes),
+                  S::load(planes + 2 * S::lanes));
+    float3xN<S> d(S::load(planes + 3 * S::lanes),
+                  S::load(planes + 4 * S::lanes),
+                  S::load(planes + 5 * S::lanes));
+    return ray_packet(o, d, S::load(planes + 6 * S::lanes));
+  }
+
+  // Every ray against one box. Bit k of the result is set when ray k hits.
+  inline int intersects(AABB3f box, S &t) {
+    S near(0.f), far = tmax;
+    for (int j = 0; j < 3; j++) {
+      S t1 = (S(box.min_point[j]) - origin.comps[j]) * inv_dir.comps[j];
+      S t2 = (S(box.max_point[j]) - origin.comps[j]) * inv_dir.comps[j];
+      near = near.max(t1.min(t2));
+      far = far.min(t1.max(t2));
+    }
+    S hit = near.le(far);
+    t = S(INFINITY).blend(near, hit);
+    return hit.mask();
+  }
+
+  // Every ray against one triangle.
+  inline int intersects(float3 a, float3 b, float3 c, S &t) {
+    float3xN<S> e1(b - a), e2(c - a);
+    float3xN<S> p = dir.cross(e2);
+    S inv_det = S(1.f) / e1.dot(p);
+    float3xN<S> s = origin - float3xN<S>(a);
+    S u = s.dot(p) * inv_det;
+    float3xN<S> q = s.cross(e1);
+    S v = dir.dot(q) * inv_det;
+    S d = e2.dot(q) * inv_det;
+    S zero(0.f);
+    S hit = zero.le(u) & zero.le(v) & (u + v).le(S(1.f)) & zero.le(d) &
+            d.le(tmax);
+    t = S(INFINITY).blend(d, hit);
+    return hit.mask();
+  }
+
+  float3xN<S> origin;
+  float3xN<S> dir;
+  float3xN<S> inv_dir;
+  S tmax;
+};
+
+typedef ray_packet<float1x4> ray_packet4;
+typedef ray_packet<float1x8> ray_packet8;
+typedef ray_packet<float1x16> ray_packet16;
+
+// One ray against S::lanes triangles with vertices a, b and c. Bit k of the
+// result is set when triangle k is hit.
+template <typename S>
+static inline int intersect_triangles(ray r, float3xN<S> a, float3xN<S> b,
+                                      float3xN<S> c, S &t) {
+  float3xN<S> dir(r.dir);
+  float3xN<S> e1 = b - a, e2 = c - a;
+  float3xN<S> p = dir.cross(e2);
+  S inv_det = S(1.f) / e1.dot(p);
+  float3xN<S> s = float3xN<S>(r.origin) - a;
+  S u = s.dot(p) * inv_det;
+  float3xN<S> q = s.cross(e1);
+  S v = dir.dot(q) * inv_det;
+  S d = e2.dot(q) * inv_det;
+  S zero(0.f);
+  S hit = zero.le(u) & zero.le(v) & (u + v).le(S(1.f)) & zero.le(d) &
+          d.le(S(r.tmax));
+  t = S(INFINITY).blend(d, hit);
+  return hit.mask();
+}
+
+// Vertex k of the S::lanes triangles starting at tris, three float3 each.
+template <typename S>
+static inline float3xN<S> triangle_vertices(const float3 *tris, int k) {
+  simde__m128 vecs[S::lanes];
+  for (size_t i = 0; i < S::lanes; i++) {
+    vecs[i] = tris[3 * i + k].simd;
+  }
+  alignas(64) float planes[4 * S::lanes];
+  packet_transpose_in<S>(vecs, planes);
+  return float3xN<S>(S::load(planes), S::load(planes + S::lanes),
+                     S::load(planes + 2 * S::lanes));
+}
+
+// t[i] = distance along r to triangle i of a soup of n, vertices
+// tris[3 i .. 3 i + 2], or infinity on a miss.
+inline void intersect_triangles(ray r, const float3 *tris, size_t n,
+                                float *t) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const float3 *batch = tris + 3 * i;
+    float1x8 d;
+    intersect_triangles(r, triangle_vertices<float1x8>(batch, 0),
+                        triangle_vertices<float1x8>(batch, 1),
+                        triangle_vertices<float1x8>(batch, 2), d);
+    d.store(t + i);
+  }
+  for (; i < n; i++) {
+    r.intersects(tris[3 * i], tris[3 * i + 1], tris[3 * i + 2], t[i]);
+  }
+}
+
+// The nearest triangle hit by r, or -1, with its distance in t.
+inline long closest_triangle(ray r, const float3 *tris, size_t n, float &t) {
+  long best = -1;
+  t = INFINITY;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const float3 *batch = tris + 3 * i;
+    float1x8 d;
+    int hits = intersect_triangles(r, triangle_vertices<float1x8>(batch, 0),
+                                   triangle_vertices<float1x8>(batch, 1),
+                                   triangle_vertices<float1x8>(batch, 2), d);
+    for (int k = 0; hits; k++, hits >>= 1) {
+      if ((hits & 1) && d[k] < t) {
+        t = d[k];
+        best = long(i + k);
+      }
+    }
+  }
+  for (; i < n; i++) {
+    float d;
+    if (r.intersects(tris[3 * i], tris[3 * i + 1], tris[3 * i + 2], d) &&
+        d < t) {
+      t = d;
+      best = long(i);
+    }
+  }
+  return best;
+}
+
+// t[i] = distance along rays[i] to the triangle a, b, c, or infinity.
+inline void intersect_rays(const ray *rays, size_t n, float3 a, float3 b,
+                           float3 c, float *t) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    float1x8 d;
+    ray_packet8::load(rays + i).intersects(a, b, c, d);
+    d.store(t + i);
+  }
+  for (; i < n; i++) {
+    ray r = rays[i];
+    r.intersects(a, b, c, t[i]);
+  }
+}
+
+// t[i] = distance along rays[i] into box, or infinity.
+inline void intersect_rays(const ray *rays, size_t n, AABB3f box, float *t) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    float1x8 d;
+    ray_packet8::load(rays + i).intersects(box, d);
+    d.store(t + i);
+  }
+  for (; i < n; i++) {
+    ray r = rays[i];
+    r.intersects(box, t[i]);
+  }
+}
+
+} // namespace fonge
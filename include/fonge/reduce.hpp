@@ -0,0 +1,126 @@
+#pragma once
+
+#include <simde/x86/avx2.h>
+
+namespace fonge {
+
+// Horizontal reductions behind dot(), len2(), trace() and the matrix-vector
+// products. The default is a shuffle+add tree, which beats dpps/haddpd on
+// current x86 cores and lowers to plain adds on other targets. Define
+// FONGE_REDUCE_DPPS to use dpps/haddpd instead on targets where those win.
+
+// Sum of lanes 0..N-1 of v, in lane 0.
+template <int N> static inline simde__m128 hsum_ps_tree(simde__m128 v) {
+  if constexpr (N == 2) {
+    return simde_mm_add_ss(v, simde_mm_movehdup_ps(v));
+  } else if constexpr (N == 3) {
+    return simde_mm_add_ss(simde_mm_add_ss(v, simde_mm_movehdup_ps(v)),
+                           simde_mm_movehl_ps(v, v));
+  } else {
+    simde__m128 s = simde_mm_add_ps(v, simde_mm_movehdup_ps(v));
+    return simde_mm_add_ss(s, simde_mm_movehl_ps(s, s));
+  }
+}
+
+template <int N> static inline simde__m128d hsum_pd_tree(simde__m256d v) {
+  if constexpr (N == 2) {
+    simde__m128d lo = simde_mm256_castpd256_pd128(v);
+    return simde_mm_add_sd(lo, simde_mm_unpackhi_pd(lo, lo));
+  } else {
+    if constexpr (N == 3) {
+      v = simde_mm256_blend_pd(v, simde_mm256_setzero_pd(), 0b1000);
+    }
+    simde__m128d s = simde_mm_add_pd(simde_mm256_castpd256_pd128(v),
+                                     simde_mm256_extractf128_pd(v, 1));
+    return simde_mm_add_sd(s, simde_mm_unpackhi_pd(s, s));
+  }
+}
+
+template <int N>
+static inline float dot_ps_tree(simde__m128 a, simde__m128 b) {
+  return simde_mm_cvtss_f32(hsum_ps_tree<N>(simde_mm_mul_ps(a, b)));
+}
+
+template <int N>
+static inline float dot_ps_dpps(simde__m128 a, simde__m128 b) {
+  return simde_mm_cvtss_f32(simde_mm_dp_ps(a, b, (((1 << N) - 1) << 4) | 1));
+}
+
+template <int N>
+static inline double dot_pd_tree(simde__m256d a, simde__m256d b) {
+  return simde_mm_cvtsd_f64(hsum_pd_tree<N>(simde_mm256_mul_pd(a, b)));
+}
+
+template <int N>
+static inline double dot_pd_hadd(simde__m256d a, simde__m256d b) {
+  simde__m256d p = simde_mm256_mul_pd(a, b);
+  if constexpr (N == 3) {
+    p = simde_mm256_blend_pd(p, simde_mm256_setzero_pd(), 0b1000);
+  }
+  simde__m256d h = simde_mm256_hadd_pd(p, p);
+  if constexpr (N == 2) {
+    return simde_mm256_cvtsd_f64(h);
+  } else {
+    return simde_mm_cvtsd_f64(
+        simde_mm_add_sd(simde_mm256_castpd256_pd128(h),
+                        simde_mm256_extractf128_pd(h, 1)));
+  }
+}
+
+// Dot product of lanes 0..N-1.
+template <int N> static inline float dot_ps(simde__m128 a, simde__m128 b) {
+#if defined(FONGE_REDUCE_DPPS)
+  return dot_ps_dpps<N>(a, b);
+#else
+  return dot_ps_tree<N>(a, b);
+#endif
+}
+
+template <int N> static inline double dot_pd(simde__m256d a, simde__m256d b) {
+#if defined(FONGE_REDUCE_DPPS)
+  return dot_pd_hadd<N>(a, b);
+#else
+  return dot_pd_tree<N>(a, b);
+#endif
+}
+
+// Sum of lanes 0..N-1.
+template <int N> static inline float reduce_add_ps(simde__m128 v) {
+#if defined(FONGE_REDUCE_DPPS)
+  return dot_ps_dpps<N>(v, simde_mm_set1_ps(1));
+#else
+  return simde_mm_cvtss_f32(hsum_ps_tree<N>(v));
+#endif
+}
+
+template <int N> static inline double reduce_add_pd(simde__m256d v) {
+#if defined(FONGE_REDUCE_DPPS)
+  return dot_pd_hadd<N>(v, simde_mm256_set1_pd(1));
+#else
+  return simde_mm_cvtsd_f64(hsum_pd_tree<N>(v));
+#endif
+}
+
+// (sum(a), sum(b), sum(c), sum(d)): adds vertically before the final
+// horizontal step, so four reductions cost about as much as two.
+static inline simde__m128 hsum4x4_ps(simde__m128 a, simde__m128 b,
+                                     simde__m128 c, simde__m128 d) {
+  simde__m128 ab = simde_mm_add_ps(simde_mm_unpacklo_ps(a, b),
+                                   simde_mm_unpackhi_ps(a, b));
+  simde__m128 cd = simde_mm_add_ps(simde_mm_unpacklo_ps(c, d),
+                                   simde_mm_unpackhi_ps(c, d));
+  return simde_mm_add_ps(simde_mm_movelh_ps(ab, cd),
+                         simde_mm_movehl_ps(cd, ab));
+}
+
+static inline simde__m256d hsum4x4_pd(simde__m256d a, simde__m256d b,
+                                      simde__m256d c, simde__m256d d) {
+  simde__m256d ab = simde_mm256_add_pd(simde_mm256_unpacklo_pd(a, b),
+                                       simde_mm256_unpackhi_pd(a, b));
+  simde__m256d cd = simde_mm256_add_pd(simde_mm256_unpacklo_pd(c, d),
+                                       simde_mm256_unpackhi_pd(c, d));
+  return simde_mm256_add_pd(simde_mm256_permute2f128_pd(ab, cd, 0x20),
+                            simde_mm256_permute2f128_pd(ab, cd, 0x31));
+}
+
+} // namespace fonge
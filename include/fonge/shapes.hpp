@@ -1,8 +1,11 @@
 #pragma once
 
 #include "common_ops.hpp"
+#include "matrix_float.hpp"
+#include "quaternion_float.hpp"
 #include "vector_double.hpp"
 #include "vector_float.hpp"
+#include <cmath>
 
 namespace fonge {
 
@@ -13,14 +16,28 @@ template <typename T> struct AABB {
     return AABB<T>(center - dimensions / 2, center + dimensions / 2);
   }
 
+  // The smallest box around n > 0 points.
+  static inline AABB<T> from_points(const T *points, size_t n) {
+    AABB<T> box(points[0], points[0]);
+    for (size_t i = 1; i < n; i++) {
+      box.min_point = box.min_point.min(points[i]);
+      box.max_point = box.max_point.max(points[i]);
+    }
+    return box;
+  }
+
   inline AABB<T> collide(AABB<T> other) {
-    return AABB2f(max(min_point, other.min_point),
-                  min(max_point, other.max_point));
+    return AABB<T>(min_point.max(other.min_point),
+                   max_point.min(other.max_point));
   }
 
   inline AABB<T> merge(AABB<T> other) {
-    return AABB2f(min(min_point, other.min_point),
-                  max(max_point, other.max_point));
+    return AABB<T>(min_point.min(other.min_point),
+                   max_point.max(other.max_point));
+  }
+
+  inline bool intersects(AABB<T> other) {
+    return min_point <= other.max_point && other.min_point <= max_point;
   }
 
   inline T dimensions() { return max_point - min_point; }
@@ -35,4 +52,364 @@ typedef AABB<float3> AABB3f;
 typedef AABB<double2> AABB2d;
 typedef AABB<double3> AABB3d;
 
+static inline float3 points_mean(const float3 *points, size_t n) {
+  float3 sum(0, 0, 0);
+  for (size_t i = 0; i < n; i++) {
+    sum = sum + points[i];
+  }
+  return sum / float(n);
+}
+
+// Eigenvectors of the covariance of n > 0 points, as the columns of a
+// rotation, ordered by decreasing variance. Cyclic Jacobi: each rotation
+// zeroes one off-diagonal element of the symmetric 3x3.
+static inline float3x3 principal_axes(const float3 *points, size_t n) {
+  float3 mean = points_mean(points, n);
+  float a[3][3] = {}, v[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+  for (size_t i = 0; i < n; i++) {
+    float3 p = points[i];
+    float3 d = p - mean;
+    float c[3] = {d.x(), d.y(), d.z()};
+    for (int j = 0; j < 3; j++) {
+      for (int k = 0; k < 3; k++) {
+        a[j][k] += c[j] * c[k];
+      }
+    }
+  }
+  for (int sweep = 0; sweep < 16; sweep++) {
+    float off = fabsf(a[0][1]) + fabsf(a[0][2]) + fabsf(a[1][2]);
+    if (off <= 1e-9f * (fabsf(a[0][0]) + fabsf(a[1][1]) + fabsf(a[2][2]))) {
+      break;
+    }
+    for (int p = 0; p < 2; p++) {
+      for (int q = p + 1; q < 3; q++) {
+        if (a[p][q] == 0) {
+          continue;
+        }
+        float theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+        float t = std::copysign(1.f, theta) /
+                  (fabsf(theta) + sqrtf(theta * theta + 1));
+        float c = 1 / sqrtf(t * t + 1), s = t * c;
+        for (int k = 0; k < 3; k++) {
+          float kp = a[k][p], kq = a[k][q];
+          a[k][p] = c * kp - s * kq;
+          a[k][q] = s * kp + c * kq;
+        }
+        for (int k = 0; k < 3; k++) {
+          float pk = a[p][k], qk = a[q][k];
+          a[p][k] = c * pk - s * qk;
+          a[q][k] = s * pk + c * qk;
+        }
+        for (int k = 0; k < 3; k++) {
+          float kp = v[k][p], kq = v[k][q];
+          v[k][p] = c * kp - s * kq;
+          v[k][q] = s * kp + c * kq;
+        }
+      }
+    }
+  }
+  int order[3] = {0, 1, 2};
+  for (int i = 0; i < 2; i++) {
+    for (int j = i + 1; j < 3; j++) {
+      if (a[order[j]][order[j]] > a[order[i]][order[i]]) {
+        int swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+      }
+    }
+  }
+  float3 x(v[0][order[0]], v[1][order[0]], v[2][order[0]]);
+  float3 y(v[0][order[1]], v[1][order[1]], v[2][order[1]]);
+  return float3x3(x, y, x.cross(y));
+}
+
+struct sphere {
+  inline sphere() : radius(0) {}
+
+  inline sphere(float3 center, float radius) : center(center), radius(radius) {}
+
+  // Ritter's bounding sphere of n > 0 points: the diameter between two far
+  // apart points, grown to take in any point left outside. Usually within a
+  // few percent of the smallest sphere.
+  static inline sphere from_points(const float3 *points, size_t n) {
+    float3 x = points[0], y = x;
+    float far2 = 0;
+    for (size_t i = 1; i < n; i++) {
+      float3 p = points[i];
+      if ((p - points[0]).len2() > far2) {
+        far2 = (p - points[0]).len2();
+        x = p;
+      }
+    }
+    far2 = 0;
+    for (size_t i = 0; i < n; i++) {
+      float3 p = points[i];
+      if ((p - x).len2() > far2) {
+        far2 = (p - x).len2();
+        y = p;
+      }
+    }
+    sphere s((x + y) * 0.5f, sqrtf(far2) * 0.5f);
+    for (size_t i = 0; i < n; i++) {
+      float3 p = points[i];
+      float3 d = p - s.center;
+      float dist2 = d.len2();
+      if (dist2 > s.radius * s.radius) {
+        float dist = sqrtf(dist2);
+        float radius = (s.radius + dist) * 0.5f;
+        s.center = s.center + d * ((radius - s.radius) / dist);
+        s.radius = radius;
+      }
+    }
+    return s;
+  }
+
+  inline bool contains(float3 point) {
+    return (point - center).len2() <= radius * radius;
+  }
+
+  inline bool intersects(sphere other) {
+    float r = radius + other.radius;
+    return (other.center - center).len2() <= r * r;
+  }
+
+  inline bool intersects(AABB3f box) {
+    float3 closest = center.max(box.min_point).min(box.max_point);
+    return (closest - center).len2() <= radius * radius;
+  }
+
+  inline AABB3f bounds() {
+    return AABB3f(center - float3(radius, radius, radius),
+                  center + float3(radius, radius, radius));
+  }
+
+  float3 center;
+  float radius;
+};
+
+// Points p with normal . p + d = 0; distance() is signed, positive on the
+// side the unit normal points to.
+struct plane {
+  inline plane() : normal(0, 0, 1), d(0) {}
+
+  inline plane(float3 normal, float d) : normal(normal), d(d) {}
+
+  static inline plane from_point_normal(float3 point, float3 normal) {
+    float3 n = normal.normalized();
+    return plane(n, -n.dot(point));
+  }
+
+  // Counter-clockwise a, b, c face the normal.
+  static inline plane from_points(float3 a, float3 b, float3 c) {
+    return from_point_normal(a, (b - a).cross(c - a));
+  }
+
+  inline float distance(float3 point) { return normal.dot(point) + d; }
+
+  // True when the box touches the plane, that is has corners on both sides.
+  inline bool intersects(AABB3f box) {
+    float3 extent = box.dimensions() * 0.5f;
+    return fabsf(distance(box.centroid())) <= normal.abs().dot(extent);
+  }
+
+  inline bool intersects(sphere s) {
+    return fabsf(distance(s.center)) <= s.radius;
+  }
+
+  float3 normal;
+  float d;
+};
+
+// Oriented box: center + axes * p for |p| <= extent in every component. The
+// columns of axes are orthonormal.
+struct OBB {
+  inline OBB() {}
+
+  inline OBB(float3 center, float3 extent, float3x3 axes)
+      : center(center), extent(extent), axes(axes) {}
+
+  inline OBB(float3 center, float3 extent, quat rotation)
+      : center(center), extent(extent), axes(rotation.rot_mat3_form()) {}
+
+  inline OBB(AABB3f box)
+      : center(box.centroid()), extent(box.dimensions() * 0.5f) {}
+
+  // A box around n > 0 points along their principal axes. Tighter than an
+  // AABB for elongated, rotated sets, though not always the smallest OBB.
+  static inline OBB from_points(const float3 *points, size_t n) {
+    float3x3 axes = principal_axes(points, n);
+    float3x3 to_local = axes.transposed();
+    float3 lo = to_local * points[0], hi = lo;
+    for (size_t i = 1; i < n; i++) {
+      float3 p = to_local * points[i];
+      lo = lo.min(p);
+      hi = hi.max(p);
+    }
+    return OBB(axes * ((lo + hi) * 0.5f), (hi - lo) * 0.5f, axes);
+  }
+
+  inline bool contains(float3 point) {
+    float3 local = axes.transposed() * (point - center);
+    return local.abs() <= extent;
+  }
+
+  inline AABB3f bounds() {
+    float3 half = axes.cols[0].abs() * extent.x() +
+                  axes.cols[1].abs() * extent.y() +
+                  axes.cols[2].abs() * extent.z();
+    return AABB3f(center - half, center + half);
+  }
+
+  // Separating axis test over the 15 candidate axes: the face normals of
+  // both boxes and the cross products of their edges, in this box's frame.
+  inline bool intersects(OBB other) {
+    // The epsilon keeps near-parallel edge pairs, whose cross products are
+    // close to zero, from separating boxes that overlap.
+    float r[3][3], abs_r[3][3];
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        r[i][j] = axes.cols[i].dot(other.axes.cols[j]);
+        abs_r[i][j] = fabsf(r[i][j]) + 1e-6f;
+      }
+    }
+    float3 d = other.center - center;
+    float t[3] = {d.dot(axes.cols[0]), d.dot(axes.cols[1]),
+                  d.dot(axes.cols[2])};
+    float ea[3] = {extent.x(), extent.y(), extent.z()};
+    float eb[3] = {other.extent.x(), other.extent.y(), other.extent.z()};
+    for (int i = 0; i < 3; i++) {
+      float rb = eb[0] * abs_r[i][0] + eb[1] * abs_r[i][1] +
+                 eb[2] * abs_r[i][2];
+      if (fabsf(t[i]) > ea[i] + rb) {
+        return false;
+      }
+    }
+    for (int j = 0; j < 3; j++) {
+      float ra = ea[0] * abs_r[0][j] + ea[1] * abs_r[1][j] +
+                 ea[2] * abs_r[2][j];
+      if (fabsf(t[0] * r[0][j] + t[1] * r[1][j] + t[2] * r[2][j]) >
+          ra + eb[j]) {
+        return false;
+      }
+    }
+    for (int i = 0; i < 3; i++) {
+      int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+      for (int j = 0; j < 3; j++) {
+        int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+        float ra = ea[i1] * abs_r[i2][j] + ea[i2] * abs_r[i1][j];
+        float rb = eb[j1] * abs_r[i][j2] + eb[j2] * abs_r[i][j1];
+        if (fabsf(t[i2] * r[i1][j] - t[i1] * r[i2][j]) > ra + rb) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  float3 center;
+  float3 extent;
+  float3x3 axes;
+};
+
+// The point of segment a, b closest to point.
+static inline float3 closest_on_segment(float3 a, float3 b, float3 point) {
+  float3 ab = b - a;
+  float len2 = ab.len2();
+  float t = len2 > 0 ? (point - a).dot(ab) / len2 : 0;
+  return a + ab * fminf(fmaxf(t, 0.f), 1.f);
+}
+
+// Squared distance between segments p0, p1 and q0, q1 (Ericson, Real-Time
+// Collision Detection 5.1.9).
+static inline float segment_distance2(float3 p0, float3 p1, float3 q0,
+                                      float3 q1) {
+  float3 d1 = p1 - p0, d2 = q1 - q0, r = p0 - q0;
+  float a = d1.len2(), e = d2.len2(), f = d2.dot(r);
+  float s = 0, t = 0;
+  if (a <= 0 && e <= 0) {
+    return r.len2();
+  }
+  if (a <= 0) {
+    t = fminf(fmaxf(f / e, 0.f), 1.f);
+  } else {
+    float c = d1.dot(r);
+    if (e <= 0) {
+      s = fminf(fmaxf(-c / a, 0.f), 1.f);
+    } else {
+      float b = d1.dot(d2), denom = a * e - b * b;
+      s = denom > 0 ? fminf(fmaxf((b * f - c * e) / denom, 0.f), 1.f) : 0;
+      t = (b * s + f) / e;
+      if (t < 0) {
+        t = 0;
+        s = fminf(fmaxf(-c / a, 0.f), 1.f);
+      } else if (t > 1) {
+        t = 1;
+        s = fminf(fmaxf((b - c) / a, 0.f), 1.f);
+      }
+    }
+  }
+  return ((p0 + d1 * s) - (q0 + d2 * t)).len2();
+}
+
+// Points within radius of the segment a, b.
+struct capsule {
+  inline capsule() : radius(0) {}
+
+  inline capsule(float3 a, float3 b, float radius)
+      : a(a), b(b), radius(radius) {}
+
+  // A capsule around n > 0 points along their principal axis. The radius is
+  // the farthest distance from the axis; the segment is then as short as the
+  // hemispherical caps allow.
+  static inline capsule from_points(const float3 *points, size_t n) {
+    float3 axis = principal_axes(points, n)[0];
+    float3 origin = points_mean(points, n);
+    float radius2 = 0;
+    for (size_t i = 0; i < n; i++) {
+      float3 p = points[i];
+      float3 d = p - origin;
+      float s = d.dot(axis);
+      radius2 = fmaxf(radius2, d.len2() - s * s);
+    }
+    // Point i is inside the cap around end s1 when its projection s is at
+    // most s1 + sqrt(radius^2 - its distance^2 from the axis).
+    float s0 = INFINITY, s1 = -INFINITY;
+    for (size_t i = 0; i < n; i++) {
+      float3 p = points[i];
+      float3 d = p - origin;
+      float s = d.dot(axis);
+      float reach = sqrtf(fmaxf(radius2 - (d.len2() - s * s), 0.f));
+      s0 = fminf(s0, s + reach);
+      s1 = fmaxf(s1, s - reach);
+    }
+    if (s0 > s1) {
+      s0 = s1 = (s0 + s1) * 0.5f;
+    }
+    return capsule(origin + axis * s0, origin + axis * s1, sqrtf(radius2));
+  }
+
+  inline bool contains(float3 point) {
+    return (closest_on_segment(a, b, point) - point).len2() <=
+           radius * radius;
+  }
+
+  inline bool intersects(sphere s) {
+    float r = radius + s.radius;
+    return (closest_on_segment(a, b, s.center) - s.center).len2() <= r * r;
+  }
+
+  inline bool intersects(capsule other) {
+    float r = radius + other.radius;
+    return segment_distance2(a, b, other.a, other.b) <= r * r;
+  }
+
+  inline AABB3f bounds() {
+    float3 r(radius, radius, radius);
+    return AABB3f(a.min(b) - r, a.max(b) + r);
+  }
+
+  float3 a, b;
+  float radius;
+};
+
 } // namespace fonge
@@ -0,0 +1,636 @@
+#pragma once
+
+#include "aligned_allocator.hpp"
+#include "vector_float.hpp"
+#include <simde/x86/fma.h>
+
+namespace fonge {
+
+// Planes are padded to a multiple of this many floats (one cache line), so the
+// kernels below always run over whole blocks and never need a scalar tail.
+constexpr size_t SOA_BLOCK = 16;
+
+static inline size_t soa_padded(size_t n) {
+  return (n + SOA_BLOCK - 1) & ~(SOA_BLOCK - 1);
+}
+
+template <typename Op>
+static inline void soa_planewise(const float *a, const float *b, float *out,
+                                 size_t padded, Op op) {
+  for (size_t i = 0; i < padded; i += 8) {
+    simde_mm256_store_ps(out + i, op(simde_mm256_load_ps(a + i),
+                                     simde_mm256_load_ps(b + i)));
+  }
+}
+
+template <typename Op>
+static inline void soa_planewise(const float *a, float b, float *out,
+                                 size_t padded, Op op) {
+  simde__m256 bb = simde_mm256_set1_ps(b);
+  for (size_t i = 0; i < padded; i += 8) {
+    simde_mm256_store_ps(out + i, op(simde_mm256_load_ps(a + i), bb));
+  }
+}
+
+// Loads in[i..i + 8) from a caller-sized array of n floats, zero past n.
+static inline simde__m256 soa_load_tail(const float *in, size_t i, size_t n) {
+  if (i + 8 <= n) {
+    return simde_mm256_loadu_ps(in + i);
+  }
+  alignas(32) float tmp[8] = {};
+  for (size_t j = 0; i + j < n; j++) {
+    tmp[j] = in[i + j];
+  }
+  return simde_mm256_load_ps(tmp);
+}
+
+// Writes a full block of 8 results, or only the first n - i of them when the
+// block straddles the end of a caller-sized output array.
+static inline void soa_store_tail(float *out, size_t i, size_t n,
+                                  simde__m256 v) {
+  if (i + 8 <= n) {
+    simde_mm256_storeu_ps(out + i, v);
+  } else {
+    alignas(32) float tmp[8];
+    simde_mm256_store_ps(tmp, v);
+    for (size_t j = 0; i + j < n; j++) {
+      out[i + j] = tmp[j];
+    }
+  }
+}
+
+static inline simde__m256 soa_add(simde__m256 a, simde__m256 b) {
+  return simde_mm256_add_ps(a, b);
+}
+
+static inline simde__m256 soa_sub(simde__m256 a, simde__m256 b) {
+  return simde_mm256_sub_ps(a, b);
+}
+
+static inline simde__m256 soa_mul(simde__m256 a, simde__m256 b) {
+  return simde_mm256_mul_ps(a, b);
+}
+
+static inline simde__m256 soa_div(simde__m256 a, simde__m256 b) {
+  return simde_mm256_div_ps(a, b);
+}
+
+// Structure-of-arrays storage for float3, one aligned plane per component.
+struct float3_soa {
+  inline float3_soa() : count(0) {}
+
+  inline float3_soa(size_t n) : count(0) { resize(n); }
+
+  inline float3_soa(const float3 *vecs, size_t n) : count(0) {
+    resize(n);
+    from_aos(vecs);
+  }
+
+  inline void resize(size_t n) {
+    count = n;
+    x.resize(soa_padded(n));
+    y.resize(soa_padded(n));
+    z.resize(soa_padded(n));
+  }
+
+  inline size_t size() { return count; }
+
+  inline size_t padded_size() { return x.size(); }
+
+  inline float3 operator[](size_t i) { return float3(x[i], y[i], z[i]); }
+
+  inline void set(size_t i, float3 v) {
+    alignas(16) float tmp[4];
+    simde_mm_store_ps(tmp, v.simd);
+    x[i] = tmp[0];
+    y[i] = tmp[1];
+    z[i] = tmp[2];
+  }
+
+  // Fills the planes from size() AoS vectors, transposing four at a time.
+  inline void from_aos(const float3 *vecs) {
+    for (size_t i = 0; i < count; i += 4) {
+      simde__m128 a = vecs[i].simd;
+      simde__m128 b = i + 1 < count ? vecs[i + 1].simd : simde_mm_setzero_ps();
+      simde__m128 c = i + 2 < count ? vecs[i + 2].simd : simde_mm_setzero_ps();
+      simde__m128 d = i + 3 < count ? vecs[i + 3].simd : simde_mm_setzero_ps();
+      SIMDE_MM_TRANSPOSE4_PS(a, b, c, d);
+      simde_mm_store_ps(&x[i], a);
+      simde_mm_store_ps(&y[i], b);
+      simde_mm_store_ps(&z[i], c);
+    }
+  }
+
+  // Writes size() AoS vectors, transposing four at a time.
+  inline void to_aos(float3 *vecs) {
+    for (size_t i = 0; i < count; i += 4) {
+      simde__m128 a = simde_mm_load_ps(&x[i]), b = simde_mm_load_ps(&y[i]),
+                  c = simde_mm_load_ps(&z[i]), d = simde_mm_setzero_ps();
+      SIMDE_MM_TRANSPOSE4_PS(a, b, c, d);
+      vecs[i] = a;
+      if (i + 1 < count)
+        vecs[i + 1] = b;
+      if (i + 2 < count)
+        vecs[i + 2] = c;
+      if (i + 3 < count)
+        vecs[i + 3] = d;
+    }
+  }
+
+  inline float3_soa operator+(float3_soa &rhs);
+
+  inline float3_soa operator-(float3_soa &rhs);
+
+  inline float3_soa operator*(float3_soa &rhs);
+
+  inline float3_soa operator/(float3_soa &rhs);
+
+  inline float3_soa &operator+=(float3_soa &rhs);
+
+  inline float3_soa &operator-=(float3_soa &rhs);
+
+  inline float3_soa &operator*=(float3_soa &rhs);
+
+  inline float3_soa &operator/=(float3_soa &rhs);
+
+  inline float3_soa &operator*=(float rhs);
+
+  inline float3_soa &operator/=(float rhs);
+
+  // out must hold size() floats.
+  inline void dot(float3_soa &rhs, float *out) {
+    for (size_t i = 0; i < count; i += 8) {
+      simde__m256 d = simde_mm256_fmadd_ps(
+          simde_mm256_load_ps(&x[i]), simde_mm256_load_ps(&rhs.x[i]),
+          simde_mm256_fmadd_ps(
+              simde_mm256_load_ps(&y[i]), simde_mm256_load_ps(&rhs.y[i]),
+              simde_mm256_mul_ps(simde_mm256_load_ps(&z[i]),
+                                 simde_mm256_load_ps(&rhs.z[i]))));
+      soa_store_tail(out, i, count, d);
+    }
+  }
+
+  inline void cross(float3_soa &rhs, float3_soa &out) {
+    out.resize(count);
+    for (size_t i = 0; i < padded_size(); i += 8) {
+      simde__m256 ax = simde_mm256_load_ps(&x[i]),
+                  ay = simde_mm256_load_ps(&y[i]),
+                  az = simde_mm256_load_ps(&z[i]),
+                  bx = simde_mm256_load_ps(&rhs.x[i]),
+                  by = simde_mm256_load_ps(&rhs.y[i]),
+                  bz = simde_mm256_load_ps(&rhs.z[i]);
+      simde_mm256_store_ps(&out.x[i], simde_mm256_fmsub_ps(
+                                          ay, bz, simde_mm256_mul_ps(az, by)));
+      simde_mm256_store_ps(&out.y[i], simde_mm256_fmsub_ps(
+                                          az, bx, simde_mm256_mul_ps(ax, bz)));
+      simde_mm256_store_ps(&out.z[i], simde_mm256_fmsub_ps(
+                                          ax, by, simde_mm256_mul_ps(ay, bx)));
+    }
+  }
+
+  inline void len2(float *out) { dot(*this, out); }
+
+  inline void len(float *out) {
+    for (size_t i = 0; i < count; i += 8) {
+      soa_store_tail(out, i, count, simde_mm256_sqrt_ps(len2_block(i)));
+    }
+  }
+
+  // 1 / len(), approximated (see approx.hpp).
+  inline void rcp_len(float *out) {
+    for (size_t i = 0; i < count; i += 8) {
+      soa_store_tail(out, i, count, rsqrt_nr_ps(len2_block(i)));
+    }
+  }
+
+  inline void normalized(float3_soa &out) {
+#if defined(FONGE_FAST_MATH)
+    normalized_fast(out);
+#else
+    out.resize(count);
+    for (size_t i = 0; i < padded_size(); i += 8) {
+      simde__m256 l = simde_mm256_sqrt_ps(len2_block(i));
+      simde_mm256_store_ps(&out.x[i],
+                           simde_mm256_div_ps(simde_mm256_load_ps(&x[i]), l));
+      simde_mm256_store_ps(&out.y[i],
+                           simde_mm256_div_ps(simde_mm256_load_ps(&y[i]), l));
+      simde_mm256_store_ps(&out.z[i],
+                           simde_mm256_div_ps(simde_mm256_load_ps(&z[i]), l));
+    }
+#endif
+  }
+
+  inline float3_soa normalized() {
+    float3_soa out;
+    normalized(out);
+    return out;
+  }
+
+  inline void normalized_fast(float3_soa &out) {
+    out.resize(count);
+    for (size_t i = 0; i < padded_size(); i += 8) {
+      simde__m256 r = rsqrt_nr_ps(len2_block(i));
+      simde_mm256_store_ps(&out.x[i],
+                           simde_mm256_mul_ps(simde_mm256_load_ps(&x[i]), r));
+      simde_mm256_store_ps(&out.y[i],
+                           simde_mm256_mul_ps(simde_mm256_load_ps(&y[i]), r));
+      simde_mm256_store_ps(&out.z[i],
+                           simde_mm256_mul_ps(simde_mm256_load_ps(&z[i]), r));
+    }
+  }
+
+  inline float3_soa normalized_fast() {
+    float3_soa out;
+    normalized_fast(out);
+    return out;
+  }
+
+  inline simde__m256 len2_block(size_t i) {
+    simde__m256 vx = simde_mm256_load_ps(&x[i]),
+                vy = simde_mm256_load_ps(&y[i]),
+                vz = simde_mm256_load_ps(&z[i]);
+    return simde_mm256_fmadd_ps(
+        vx, vx, simde_mm256_fmadd_ps(vy, vy, simde_mm256_mul_ps(vz, vz)));
+  }
+
+  aligned_vector<float> x, y, z;
+  size_t count;
+};
+
+// Structure-of-arrays storage for float4, one aligned plane per component.
+struct float4_soa {
+  inline float4_soa() : count(0) {}
+
+  inline float4_soa(size_t n) : count(0) { resize(n); }
+
+  inline float4_soa(const float4 *vecs, size_t n) : count(0) {
+    resize(n);
+    from_aos(vecs);
+  }
+
+  inline void resize(size_t n) {
+    count = n;
+    x.resize(soa_padded(n));
+    y.resize(soa_padded(n));
+    z.resize(soa_padded(n));
+    w.resize(soa_padded(n));
+  }
+
+  inline size_t size() { return count; }
+
+  inline size_t padded_size() { return x.size(); }
+
+  inline float4 operator[](size_t i) { return float4(x[i], y[i], z[i], w[i]); }
+
+  inline void set(size_t i, float4 v) {
+    alignas(16) float tmp[4];
+    simde_mm_store_ps(tmp, v.simd);
+    x[i] = tmp[0];
+    y[i] = tmp[1];
+    z[i] = tmp[2];
+    w[i] = tmp[3];
+  }
+
+  // Fills the planes from size() AoS vectors, transposing four at a time.
+  inline void from_aos(const float4 *vecs) {
+    for (size_t i = 0; i < count; i += 4) {
+      simde__m128 a = vecs[i].simd;
+      simde__m128 b = i + 1 < count ? vecs[i + 1].simd : simde_mm_setzero_ps();
+      simde__m128 c = i + 2 < count ? vecs[i + 2].simd : simde_mm_setzero_ps();
+      simde__m128 d = i + 3 < count ? vecs[i + 3].simd : simde_mm_setzero_ps();
+      SIMDE_MM_TRANSPOSE4_PS(a, b, c, d);
+      simde_mm_store_ps(&x[i], a);
+      simde_mm_store_ps(&y[i], b);
+      simde_mm_store_ps(&z[i], c);
+      simde_mm_store_ps(&w[i], d);
+    }
+  }
+
+  // Writes size() AoS vectors, transposing four at a time.
+  inline void to_aos(float4 *vecs) {
+    for (size_t i = 0; i < count; i += 4) {
+      simde__m128 a = simde_mm_load_ps(&x[i]), b = simde_mm_load_ps(&y[i]),
+                  c = simde_mm_load_ps(&z[i]), d = simde_mm_load_ps(&w[i]);
+      SIMDE_MM_TRANSPOSE4_PS(a, b, c, d);
+      vecs[i] = a;
+      if (i + 1 < count)
+        vecs[i + 1] = b;
+      if (i + 2 < count)
+        vecs[i + 2] = c;
+      if (i + 3 < count)
+        vecs[i + 3] = d;
+    }
+  }
+
+  inline float4_soa operator+(float4_soa &rhs);
+
+  inline float4_soa operator-(float4_soa &rhs);
+
+  inline float4_soa operator*(float4_soa &rhs);
+
+  inline float4_soa operator/(float4_soa &rhs);
+
+  inline float4_soa &operator+=(float4_soa &rhs);
+
+  inline float4_soa &operator-=(float4_soa &rhs);
+
+  inline float4_soa &operator*=(float4_soa &rhs);
+
+  inline float4_soa &operator/=(float4_soa &rhs);
+
+  inline float4_soa &operator*=(float rhs);
+
+  inline float4_soa &operator/=(float rhs);
+
+  // out must hold size() floats.
+  inline void dot(float4_soa &rhs, float *out) {
+    for (size_t i = 0; i < count; i += 8) {
+      simde__m256 d = simde_mm256_fmadd_ps(
+          simde_mm256_load_ps(&x[i]), simde_mm256_load_ps(&rhs.x[i]),
+          simde_mm256_fmadd_ps(
+              simde_mm256_load_ps(&y[i]), simde_mm256_load_ps(&rhs.y[i]),
+              simde_mm256_fmadd_ps(
+                  simde_mm256_load_ps(&z[i]), simde_mm256_load_ps(&rhs.z[i]),
+                  simde_mm256_mul_ps(simde_mm256_load_ps(&w[i]),
+                                     simde_mm256_load_ps(&rhs.w[i])))));
+      soa_store_tail(out, i, count, d);
+    }
+  }
+
+  inline void len2(float *out) { dot(*this, out); }
+
+  inline void len(float *out) {
+    for (size_t i = 0; i < count; i += 8) {
+      soa_store_tail(out, i, count, simde_mm256_sqrt_ps(len2_block(i)));
+    }
+  }
+
+  // 1 / len(), approximated (see approx.hpp).
+  inline void rcp_len(float *out) {
+    for (size_t i = 0; i < count; i += 8) {
+      soa_store_tail(out, i, count, rsqrt_nr_ps(len2_block(i)));
+    }
+  }
+
+  inline void normalized(float4_soa &out) {
+#if defined(FONGE_FAST_MATH)
+    normalized_fast(out);
+#else
+    out.resize(count);
+    for (size_t i = 0; i < padded_size(); i += 8) {
+      simde__m256 l = simde_mm256_sqrt_ps(len2_block(i));
+      simde_mm256_store_ps(&out.x[i],
+                           simde_mm256_div_ps(simde_mm256_load_ps(&x[i]), l));
+      simde_mm256_store_ps(&out.y[i],
+                           simde_mm256_div_ps(simde_mm256_load_ps(&y[i]), l));
+      simde_mm256_store_ps(&out.z[i],
+                           simde_mm256_div_ps(simde_mm256_load_ps(&z[i]), l));
+      simde_mm256_store_ps(&out.w[i],
+                           simde_mm256_div_ps(simde_mm256_load_ps(&w[i]), l));
+    }
+#endif
+  }
+
+  inline float4_soa normalized() {
+    float4_soa out;
+    normalized(out);
+    return out;
+  }
+
+  inline void normalized_fast(float4_soa &out) {
+    out.resize(count);
+    for (size_t i = 0; i < padded_size(); i += 8) {
+      simde__m256 r = rsqrt_nr_ps(len2_block(i));
+      simde_mm256_store_ps(&out.x[i],
+                           simde_mm256_mul_ps(simde_mm256_load_ps(&x[i]), r));
+      simde_mm256_store_ps(&out.y[i],
+                           simde_mm256_mul_ps(simde_mm256_load_ps(&y[i]), r));
+      simde_mm256_store_ps(&out.z[i],
+                           simde_mm256_mul_ps(simde_mm256_load_ps(&z[i]), r));
+      simde_mm256_store_ps(&out.w[i],
+                           simde_mm256_mul_ps(simde_mm256_load_ps(&w[i]), r));
+    }
+  }
+
+  inline float4_soa normalized_fast() {
+    float4_soa out;
+    normalized_fast(out);
+    return out;
+  }
+
+  inline simde__m256 len2_block(size_t i) {
+    simde__m256 vx = simde_mm256_load_ps(&x[i]),
+                vy = simde_mm256_load_ps(&y[i]),
+                vz = simde_mm256_load_ps(&z[i]),
+                vw = simde_mm256_load_ps(&w[i]);
+    return simde_mm256_fmadd_ps(
+        vx, vx,
+        simde_mm256_fmadd_ps(
+            vy, vy, simde_mm256_fmadd_ps(vz, vz, simde_mm256_mul_ps(vw, vw))));
+  }
+
+  aligned_vector<float> x, y, z, w;
+  size_t count;
+};
+
+// Bulk component-wise kernels. out is resized to match lhs.
+
+template <typename Op>
+static inline void soa_apply(float3_soa &lhs, float3_soa &rhs, float3_soa &out,
+                             Op op) {
+  out.resize(lhs.size());
+  size_t n = lhs.padded_size();
+  soa_planewise(lhs.x.data(), rhs.x.data(), out.x.data(), n, op);
+  soa_planewise(lhs.y.data(), rhs.y.data(), out.y.data(), n, op);
+  soa_planewise(lhs.z.data(), rhs.z.data(), out.z.data(), n, op);
+}
+
+template <typename Op>
+static inline void soa_apply(float3_soa &lhs, float rhs, float3_soa &out,
+                             Op op) {
+  out.resize(lhs.size());
+  size_t n = lhs.padded_size();
+  soa_planewise(lhs.x.data(), rhs, out.x.data(), n, op);
+  soa_planewise(lhs.y.data(), rhs, out.y.data(), n, op);
+  soa_planewise(lhs.z.data(), rhs, out.z.data(), n, op);
+}
+
+template <typename Op>
+static inline void soa_apply(float4_soa &lhs, float4_soa &rhs, float4_soa &out,
+                             Op op) {
+  out.resize(lhs.size());
+  size_t n = lhs.padded_size();
+  soa_planewise(lhs.x.data(), rhs.x.data(), out.x.data(), n, op);
+  soa_planewise(lhs.y.data(), rhs.y.data(), out.y.data(), n, op);
+  soa_planewise(lhs.z.data(), rhs.z.data(), out.z.data(), n, op);
+  soa_planewise(lhs.w.data(), rhs.w.data(), out.w.data(), n, op);
+}
+
+template <typename Op>
+static inline void soa_apply(float4_soa &lhs, float rhs, float4_soa &out,
+                             Op op) {
+  out.resize(lhs.size());
+  size_t n = lhs.padded_size();
+  soa_planewise(lhs.x.data(), rhs, out.x.data(), n, op);
+  soa_planewise(lhs.y.data(), rhs, out.y.data(), n, op);
+  soa_planewise(lhs.z.data(), rhs, out.z.data(), n, op);
+  soa_planewise(lhs.w.data(), rhs, out.w.data(), n, op);
+}
+
+inline void add(float3_soa &lhs, float3_soa &rhs, float3_soa &out) {
+  soa_apply(lhs, rhs, out, soa_add);
+}
+
+inline void sub(float3_soa &lhs, float3_soa &rhs, float3_soa &out) {
+  soa_apply(lhs, rhs, out, soa_sub);
+}
+
+inline void mul(float3_soa &lhs, float3_soa &rhs, float3_soa &out) {
+  soa_apply(lhs, rhs, out, soa_mul);
+}
+
+inline void div(float3_soa &lhs, float3_soa &rhs, float3_soa &out) {
+  soa_apply(lhs, rhs, out, soa_div);
+}
+
+inline void mul(float3_soa &lhs, float rhs, float3_soa &out) {
+  soa_apply(lhs, rhs, out, soa_mul);
+}
+
+inline void div(float3_soa &lhs, float rhs, float3_soa &out) {
+  soa_apply(lhs, 1 / rhs, out, soa_mul);
+}
+
+inline void add(float4_soa &lhs, float4_soa &rhs, float4_soa &out) {
+  soa_apply(lhs, rhs, out, soa_add);
+}
+
+inline void sub(float4_soa &lhs, float4_soa &rhs, float4_soa &out) {
+  soa_apply(lhs, rhs, out, soa_sub);
+}
+
+inline void mul(float4_soa &lhs, float4_soa &rhs, float4_soa &out) {
+  soa_apply(lhs, rhs, out, soa_mul);
+}
+
+inline void div(float4_soa &lhs, float4_soa &rhs, float4_soa &out) {
+  soa_apply(lhs, rhs, out, soa_div);
+}
+
+inline void mul(float4_soa &lhs, float rhs, float4_soa &out) {
+  soa_apply(lhs, rhs, out, soa_mul);
+}
+
+inline void div(float4_soa &lhs, float rhs, float4_soa &out) {
+  soa_apply(lhs, 1 / rhs, out, soa_mul);
+}
+
+inline float3_soa float3_soa::operator+(float3_soa &rhs) {
+  float3_soa out;
+  add(*this, rhs, out);
+  return out;
+}
+
+inline float3_soa float3_soa::operator-(float3_soa &rhs) {
+  float3_soa out;
+  sub(*this, rhs, out);
+  return out;
+}
+
+inline float3_soa float3_soa::operator*(float3_soa &rhs) {
+  float3_soa out;
+  mul(*this, rhs, out);
+  return out;
+}
+
+inline float3_soa float3_soa::operator/(float3_soa &rhs) {
+  float3_soa out;
+  div(*this, rhs, out);
+  return out;
+}
+
+inline float3_soa &float3_soa::operator+=(float3_soa &rhs) {
+  add(*this, rhs, *this);
+  return *this;
+}
+
+inline float3_soa &float3_soa::operator-=(float3_soa &rhs) {
+  sub(*this, rhs, *this);
+  return *this;
+}
+
+inline float3_soa &float3_soa::operator*=(float3_soa &rhs) {
+  mul(*this, rhs, *this);
+  return *this;
+}
+
+inline float3_soa &float3_soa::operator/=(float3_soa &rhs) {
+  div(*this, rhs, *this);
+  return *this;
+}
+
+inline float3_soa &float3_soa::operator*=(float rhs) {
+  mul(*this, rhs, *this);
+  return *this;
+}
+
+inline float3_soa &float3_soa::operator/=(float rhs) {
+  div(*this, rhs, *this);
+  return *this;
+}
+
+inline float4_soa float4_soa::operator+(float4_soa &rhs) {
+  float4_soa out;
+  add(*this, rhs, out);
+  return out;
+}
+
+inline float4_soa float4_soa::operator-(float4_soa &rhs) {
+  float4_soa out;
+  sub(*this, rhs, out);
+  return out;
+}
+
+inline float4_soa float4_soa::operator*(float4_soa &rhs) {
+  float4_soa out;
+  mul(*this, rhs, out);
+  return out;
+}
+
+inline float4_soa float4_soa::operator/(float4_soa &rhs) {
+  float4_soa out;
+  div(*this, rhs, out);
+  return out;
+}
+
+inline float4_soa &float4_soa::operator+=(float4_soa &rhs) {
+  add(*this, rhs, *this);
+  return *this;
+}
+
+inline float4_soa &float4_soa::operator-=(float4_soa &rhs) {
+  sub(*this, rhs, *this);
+  return *this;
+}
+
+inline float4_soa &float4_soa::operator*=(float4_soa &rhs) {
+  mul(*this, rhs, *this);
+  return *this;
+}
+
+inline float4_soa &float4_soa::operator/=(float4_soa &rhs) {
+  div(*this, rhs, *this);
+  return *this;
+}
+
+inline float4_soa &float4_soa::operator*=(float rhs) {
+  mul(*this, rhs, *this);
+  return *this;
+}
+
+inline float4_soa &float4_soa::operator/=(float rhs) {
+  div(*this, rhs, *this);
+  return *this;
+}
+
+} // namespace fonge
@@ -0,0 +1,395 @@
+#pragma once
+
+#include "shapes.hpp"
+#include "vector_float.hpp"
+#include <algorithm>
+#include <simde/x86/sse4.1.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace fonge {
+
+// Uniform grid broad phase over AABB3f, for scenes of many objects of
+// similar size. Space is cut into cubes of cell_size and the cells are
+// hashed into a table, so the grid is unbounded and its memory follows the
+// number of objects, not the extent of the scene.
+//
+// Every object is entered into each cell its box touches. The index is a
+// counting sort of those entries by bucket: bucket b is the run of entries
+// offsets[b] .. offsets[b + 1], one array for the whole grid. Entries keep
+// their cell, so cells that collide in the table are told apart, and a pair
+// of objects sharing several cells is only reported from the first of them.
+//
+// insert(), move() and remove() only mark the index stale when the cells of
+// an object change; a move within the same cells just stores the box. The
+// next query, or commit(), rebuilds the index in one pass over the entries,
+// split over threads for large grids. Objects touching more than
+// grid_max_cells cells are not entered but kept in a list every query scans.
+
+static const uint64_t grid_max_cells = 64;
+// Each thread of a rebuild takes at least this many objects.
+static const size_t grid_parallel_min = 1 << 14;
+// Bound on the per-thread counts of a threaded rebuild.
+static const size_t grid_parts = 1 << 12;
+// pairs() hands out candidates in batches of this many.
+static const size_t grid_pair_batch = 256;
+// Cell coordinates are clamped to +-grid_coord_limit.
+static const int32_t grid_coord_limit = 1 << 20;
+
+// Cells lo .. hi inclusive. Removed objects have lo > hi.
+struct grid_range {
+  inline uint64_t cells() {
+    if (lo[0] > hi[0]) {
+      return 0;
+    }
+    return uint64_t(hi[0] - lo[0] + 1) * uint64_t(hi[1] - lo[1] + 1) *
+           uint64_t(hi[2] - lo[2] + 1);
+  }
+
+  inline bool operator==(grid_range rhs) {
+    for (int k = 0; k < 3; k++) {
+      if (lo[k] != rhs.lo[k] || hi[k] != rhs.hi[k]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  int32_t lo[3];
+  int32_t hi[3];
+};
+
+struct grid_entry {
+  int32_t cell[3];
+  uint32_t id;
+};
+
+struct grid_pair {
+  uint32_t a, b;
+};
+
+static inline uint32_t grid_hash(const int32_t *cell) {
+  return (uint32_t(cell[0]) * 73856093u) ^ (uint32_t(cell[1]) * 19349663u) ^
+         (uint32_t(cell[2]) * 83492791u);
+}
+
+// True when cell is the lowest cell shared by ranges a and b, which is where
+// their pair is reported.
+static inline bool grid_first_shared(const int32_t *cell, grid_range &a,
+                                     grid_range &b) {
+  for (int k = 0; k < 3; k++) {
+    int32_t lo = a.lo[k] > b.lo[k] ? a.lo[k] : b.lo[k];
+    if (cell[k] != lo) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Runs f(t) for t in 0 .. threads - 1, the last on the calling thread.
+template <typename F> static inline void grid_parallel(int threads, F f) {
+  std::vector<std::thread> pool;
+  for (int t = 0; t + 1 < threads; t++) {
+    pool.emplace_back(f, t);
+  }
+  f(threads - 1);
+  for (std::thread &th : pool) {
+    th.join();
+  }
+}
+
+struct spatial_grid {
+  inline spatial_grid(float cell_size = 1)
+      : cell_size(cell_size), inv_cell_size(1 / cell_size), entry_count(0),
+        stale(false) {
+    offsets.assign(2, 0);
+  }
+
+  // The cells box touches.
+  inline grid_range range_of(AABB3f box) {
+    simde__m128 inv = simde_mm_set1_ps(inv_cell_size);
+    simde__m128 top = simde_mm_set1_ps(float(grid_coord_limit));
+    simde__m128 bottom = simde_mm_set1_ps(-float(grid_coord_limit));
+    simde__m128 lo = simde_mm_mul_ps(box.min_point.simd, inv);
+    simde__m128 hi = simde_mm_mul_ps(box.max_point.simd, inv);
+    lo = simde_mm_max_ps(simde_mm_min_ps(simde_mm_floor_ps(lo), top), bottom);
+    hi = simde_mm_max_ps(simde_mm_min_ps(simde_mm_floor_ps(hi), top), bottom);
+    int32_t l[4], h[4];
+    simde_mm_storeu_si128(reinterpret_cast<simde__m128i *>(l),
+                          simde_mm_cvtps_epi32(lo));
+    simde_mm_storeu_si128(reinterpret_cast<simde__m128i *>(h),
+                          simde_mm_cvtps_epi32(hi));
+    return grid_range{{l[0], l[1], l[2]}, {h[0], h[1], h[2]}};
+  }
+
+  // Adds an object and returns its id. Ids of removed objects are reused.
+  inline uint32_t insert(AABB3f box) {
+    uint32_t id;
+    if (!free_ids.empty()) {
+      id = free_ids.back();
+      free_ids.pop_back();
+      boxes[id] = box;
+      ranges[id] = range_of(box);
+    } else {
+      id = uint32_t(boxes.size());
+      boxes.push_back(box);
+      ranges.push_back(range_of(box));
+    }
+    entry_count += entered_cells(ranges[id]);
+    stale = true;
+    return id;
+  }
+
+  inline void move(uint32_t id, AABB3f box) {
+    boxes[id] = box;
+    grid_range range = range_of(box);
+    if (range == ranges[id]) {
+      return;
+    }
+    entry_count += entered_cells(range) - entered_cells(ranges[id]);
+    ranges[id] = range;
+    stale = true;
+  }
+
+  inline void remove(uint32_t id) {
+    entry_count -= entered_cells(ranges[id]);
+    ranges[id] = grid_range{{1, 1, 1}, {0, 0, 0}};
+    free_ids.push_back(id);
+    stale = true;
+  }
+
+  inline void clear() {
+    boxes.clear();
+    ranges.clear();
+    free_ids.clear();
+    entry_count = 0;
+    stale = true;
+  }
+
+  // Rebuilds the index if anything changed cells. threads = 0 uses every
+  // hardware thread.
+  inline void commit(int threads = 0) {
+    if (stale) {
+      rebuild(threads);
+    }
+  }
+
+  inline void rebuild(int threads = 0) {
+    if (threads <= 0) {
+      threads = int(std::thread::hardware_concurrency());
+    }
+    size_t n = boxes.size();
+    threads = int(std::min<size_t>(std::max(threads, 1),
+                                   std::max<size_t>(n / grid_parallel_min, 1)));
+    size_t buckets = 64;
+    while (buckets < entry_count) {
+      buckets *= 2;
+    }
+    uint32_t mask = uint32_t(buckets - 1);
+    large.clear();
+    for (size_t id = 0; id < n; id++) {
+      if (ranges[id].cells() > grid_max_cells) {
+        large.push_back(uint32_t(id));
+      }
+    }
+
+    // Each thread counts and then scatters the entries of its share of the
+    // objects; starts[t * parts + p] is where thread t writes part p, so the
+    // result is the same for any number of threads. On one thread a part is
+    // a bucket. On several, a part is the run of buckets sharing their top
+    // bits, which keeps the counts of every thread at grid_parts however
+    // large the table, and each part is then sorted by bucket on its own.
+    int shift = 0;
+    while (threads > 1 && (buckets >> shift) > grid_parts) {
+      shift++;
+    }
+    size_t parts = buckets >> shift;
+    std::vector<uint32_t> starts(threads * parts, 0);
+    grid_parallel(threads, [&](int t) {
+      uint32_t *count = &starts[t * parts];
+      for (size_t id = n * t / threads; id < n * (t + 1) / threads; id++) {
+        for_each_cell(uint32_t(id), [&](const int32_t *cell) {
+          count[(grid_hash(cell) & mask) >> shift]++;
+        });
+      }
+    });
+    std::vector<uint32_t> part_starts(parts + 1);
+    uint32_t at = 0;
+    for (size_t p = 0; p < parts; p++) {
+      part_starts[p] = at;
+      for (int t = 0; t < threads; t++) {
+        uint32_t c = starts[t * parts + p];
+        starts[t * parts + p] = at;
+        at += c;
+      }
+    }
+    part_starts[parts] = at;
+    std::vector<grid_entry> &out = shift > 0 ? scratch : entries;
+    out.resize(at);
+    grid_parallel(threads, [&](int t) {
+      uint32_t *next = &starts[t * parts];
+      for (size_t id = n * t / threads; id < n * (t + 1) / threads; id++) {
+        for_each_cell(uint32_t(id), [&](const int32_t *cell) {
+          out[next[(grid_hash(cell) & mask) >> shift]++] =
+              grid_entry{{cell[0], cell[1], cell[2]}, uint32_t(id)};
+        });
+      }
+    });
+
+    offsets.resize(buckets + 1);
+    offsets[buckets] = at;
+    if (shift == 0) {
+      std::copy(part_starts.begin(), part_starts.end() - 1, offsets.begin());
+      stale = false;
+      return;
+    }
+    entries.resize(at);
+    grid_parallel(threads, [&](int t) {
+      std::vector<uint32_t> next(size_t(1) << shift);
+      for (size_t p = parts * t / threads; p < parts * (t + 1) / threads; p++) {
+        size_t first = p << shift;
+        std::fill(next.begin(), next.end(), 0);
+        for (uint32_t i = part_starts[p]; i < part_starts[p + 1]; i++) {
+          next[(grid_hash(scratch[i].cell) & mask) - first]++;
+        }
+        uint32_t slot = part_starts[p];
+        for (size_t k = 0; k < next.size(); k++) {
+          offsets[first + k] = slot;
+          slot += next[k];
+          next[k] = offsets[first + k];
+        }
+        for (uint32_t i = part_starts[p]; i < part_starts[p + 1]; i++) {
+          grid_entry e = scratch[i];
+          entries[next[(grid_hash(e.cell) & mask) - first]++] = e;
+        }
+      }
+    });
+    stale = false;
+  }
+
+  // Calls visit(id) once for every object whose box overlaps box.
+  template <typename F> inline void query_box(AABB3f box, F visit) {
+    commit();
+    grid_range range = range_of(box);
+    if (range.cells() > entries.size()) {
+      // Cheaper to look at every object than at every cell.
+      for (size_t id = 0; id < boxes.size(); id++) {
+        if (ranges[id].cells() > 0 && boxes[id].intersects(box)) {
+          visit(uint32_t(id));
+        }
+      }
+      return;
+    }
+    uint32_t mask = uint32_t(offsets.size() - 2);
+    int32_t cell[3];
+    for (cell[2] = range.lo[2]; cell[2] <= range.hi[2]; cell[2]++) {
+      for (cell[1] = range.lo[1]; cell[1] <= range.hi[1]; cell[1]++) {
+        for (cell[0] = range.lo[0]; cell[0] <= range.hi[0]; cell[0]++) {
+          uint32_t b = grid_hash(cell) & mask;
+          for (uint32_t i = offsets[b]; i < offsets[b + 1]; i++) {
+            grid_entry &e = entries[i];
+            if (e.cell[0] == cell[0] && e.cell[1] == cell[1] &&
+                e.cell[2] == cell[2] &&
+                grid_first_shared(cell, range, ranges[e.id]) &&
+                boxes[e.id].intersects(box)) {
+              visit(e.id);
+            }
+          }
+        }
+      }
+    }
+    for (uint32_t id : large) {
+      if (boxes[id].intersects(box)) {
+        visit(id);
+      }
+    }
+  }
+
+  // Calls visit(id) for every object whose box contains point.
+  template <typename F> inline void query_point(float3 point, F visit) {
+    query_box(AABB3f(point, point), visit);
+  }
+
+  // Every pair of overlapping boxes, once, as visit(const grid_pair *pairs,
+  // size_t count) with up to grid_pair_batch pairs per call. The order
+  // within a pair and between pairs is unspecified.
+  template <typename F> inline void pairs(F visit) {
+    commit();
+    grid_pair batch[grid_pair_batch];
+    size_t count = 0;
+    auto emit = [&](uint32_t a, uint32_t b) {
+      batch[count++] = grid_pair{a, b};
+      if (count == grid_pair_batch) {
+        visit(batch, count);
+        count = 0;
+      }
+    };
+    for (size_t b = 0; b + 1 < offsets.size(); b++) {
+      for (uint32_t i = offsets[b]; i < offsets[b + 1]; i++) {
+        grid_entry &e = entries[i];
+        AABB3f box = boxes[e.id];
+        for (uint32_t j = i + 1; j < offsets[b + 1]; j++) {
+          grid_entry &f = entries[j];
+          if (e.cell[0] == f.cell[0] && e.cell[1] == f.cell[1] &&
+              e.cell[2] == f.cell[2] &&
+              grid_first_shared(e.cell, ranges[e.id], ranges[f.id]) &&
+              box.intersects(boxes[f.id])) {
+            emit(e.id, f.id);
+          }
+        }
+      }
+    }
+    // Large objects against everything, and each other once.
+    for (size_t i = 0; i < large.size(); i++) {
+      uint32_t a = large[i];
+      for (size_t id = 0; id < boxes.size(); id++) {
+        uint64_t cells = ranges[id].cells();
+        bool other_large = cells > grid_max_cells;
+        if (cells > 0 && id != a && (!other_large || id > a) &&
+            boxes[a].intersects(boxes[id])) {
+          emit(a, uint32_t(id));
+        }
+      }
+    }
+    if (count > 0) {
+      visit(batch, count);
+    }
+  }
+
+  float cell_size;
+  float inv_cell_size;
+  std::vector<AABB3f> boxes;
+  std::vector<grid_range> ranges;
+  std::vector<uint32_t> free_ids;
+  size_t entry_count;
+  bool stale;
+  // The index, valid when not stale.
+  std::vector<uint32_t> offsets;
+  std::vector<grid_entry> entries;
+  std::vector<uint32_t> large;
+  // Entries sorted by part only, during a threaded rebuild.
+  std::vector<grid_entry> scratch;
+
+  inline size_t entered_cells(grid_range range) {
+    uint64_t cells = range.cells();
+    return cells > grid_max_cells ? 0 : size_t(cells);
+  }
+
+  template <typename F> inline void for_each_cell(uint32_t id, F f) {
+    grid_range range = ranges[id];
+    if (range.cells() > grid_max_cells) {
+      return;
+    }
+    int32_t cell[3];
+    for (cell[2] = range.lo[2]; cell[2] <= range.hi[2]; cell[2]++) {
+      for (cell[1] = range.lo[1]; cell[1] <= range.hi[1]; cell[1]++) {
+        for (cell[0] = range.lo[0]; cell[0] <= range.hi[0]; cell[0]++) {
+          f(cell);
+        }
+      }
+    }
+  }
+};
+
+} // namespace fonge
@@ -0,0 +1,331 @@
+#pragma once
+
+#include "packet_float.hpp"
+#include "shapes.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include <vector>
+
+namespace fonge {
+
+// Sweep and prune broad phase over AABB3f, for scenes of coherent motion.
+//
+// Boxes are sorted by their minimum along the axis their centers spread most
+// along at build(). Each box then only meets the boxes after it that start
+// before it ends, and those are tested a packet at a time on the other two
+// axes. On its own a sort axis leaves every box a run of hundreds of
+// candidates in a large scene, so space is also cut into bands along the
+// second axis, each with its own sorted arrays: a box is in every band it
+// touches, and a pair is only reported from the first band both are in.
+//
+// A band keeps the ids of its boxes in sorted order, and the bounds of each
+// slot in structure-of-arrays form: lo[k] and hi[k] along axis
+// (sort axis + k) % 3, padded with boxes at infinity so packets can read past
+// the end. update() takes the boxes of the next frame, moves the few that
+// changed bands, and restores the order by insertion sort, which is close to
+// linear when boxes move little relative to each other. Past
+// sap_shift_budget shifts per box a band falls back to a full sort. Adding or
+// removing boxes takes a new build().
+
+static const size_t sap_pair_block = 4096;
+static const size_t sap_shift_budget = 16;
+// Bands aim at this many boxes each, and are at least two average boxes wide.
+static const size_t sap_band_boxes = 1024;
+static const int sap_max_bands = 256;
+
+struct sap_pair {
+  uint32_t a, b;
+};
+
+// Pairs in blocks of sap_pair_block that are kept across clear(), so a
+// steady frame allocates nothing and a growing one never copies.
+struct sap_pair_pool {
+  inline sap_pair_pool() : count(0) {}
+
+  inline void clear() { count = 0; }
+
+  inline size_t size() { return count; }
+
+  inline sap_pair &operator[](size_t i) {
+    return blocks[i / sap_pair_block][i % sap_pair_block];
+  }
+
+  inline void push(uint32_t a, uint32_t b) {
+    if (count == blocks.size() * sap_pair_block) {
+      blocks.emplace_back(sap_pair_block);
+    }
+    blocks[count / sap_pair_block][count % sap_pair_block] = sap_pair{a, b};
+    count++;
+  }
+
+  // Calls visit(const sap_pair *pairs, size_t n) for each filled block.
+  template <typename F> inline void for_each_block(F visit) {
+    for (size_t at = 0; at < count; at += sap_pair_block) {
+      size_t n = count - at < sap_pair_block ? count - at : sap_pair_block;
+      visit(blocks[at / sap_pair_block].data(), n);
+    }
+  }
+
+  std::vector<std::vector<sap_pair>> blocks;
+  size_t count;
+};
+
+struct sap_band {
+  inline sap_band() : departed(false) {}
+
+  std::vector<uint32_t> ids;
+  std::vector<float> lo[3];
+  std::vector<float> hi[3];
+  // Set when boxes left the band since the last update().
+  bool departed;
+};
+
+struct sweep_prune {
+  // Candidate runs are short once banded; 16 lanes still beat 8 on them.
+  typedef float1x16 S;
+
+  inline sweep_prune() : axis(0), band_axis(1), band_origin(0), band_scale(0) {}
+
+  inline void build(const AABB3f *boxes, size_t n) {
+    // Unbounded boxes are left out of the choice of axes and bands; they
+    // still go into every band they reach.
+    float3 sum(0, 0, 0), sum2(0, 0, 0), size(0, 0, 0);
+    size_t bounded_count = 0;
+    for (size_t i = 0; i < n; i++) {
+      AABB3f b = boxes[i];
+      if (!bounded(b)) {
+        continue;
+      }
+      bounded_count++;
+      float3 c = b.min_point + b.max_point;
+      sum = sum + c;
+      sum2 = sum2 + c * c;
+      size = size + b.dimensions();
+    }
+    float3 spread = sum2 * float(bounded_count) - sum * sum;
+    float s[3] = {spread.x(), spread.y(), spread.z()};
+    axis = s[0] >= s[1] && s[0] >= s[2] ? 0 : s[1] >= s[2] ? 1 : 2;
+    band_axis = s[(axis + 1) % 3] >= s[(axis + 2) % 3] ? (axis + 1) % 3
+                                                        : (axis + 2) % 3;
+
+    // Bands over the extent of the centers on band_axis.
+    float lo_c = INFINITY, hi_c = -INFINITY;
+    for (size_t i = 0; i < n; i++) {
+      if (!bounded(boxes[i])) {
+        continue;
+      }
+      float c = center(boxes[i], band_axis);
+      lo_c = std::min(lo_c, c);
+      hi_c = std::max(hi_c, c);
+    }
+    float average =
+        bounded_count > 0 ? size[band_axis] / float(bounded_count) : 0;
+    int count = int(std::min<size_t>(n / sap_band_boxes + 1, sap_max_bands));
+    if (average > 0) {
+      count = std::min(count, int((hi_c - lo_c) / (2 * average)) + 1);
+    }
+    count = std::max(count, 1);
+    band_origin = lo_c;
+    band_scale = hi_c > lo_c ? float(count) / (hi_c - lo_c) : 0;
+    bands.assign(count, sap_band());
+    first_band.resize(n);
+    last_band.resize(n);
+    for (size_t i = 0; i < n; i++) {
+      band_range(boxes[i], first_band[i], last_band[i]);
+      for (int b = first_band[i]; b <= last_band[i]; b++) {
+        bands[b].ids.push_back(uint32_t(i));
+      }
+    }
+    for (sap_band &band : bands) {
+      gather(band, boxes);
+      sort(band);
+    }
+  }
+
+  // The same n boxes, moved.
+  inline void update(const AABB3f *boxes) {
+    for (size_t i = 0; i < first_band.size(); i++) {
+      int first, last;
+      band_range(boxes[i], first, last);
+      if (first == first_band[i] && last == last_band[i]) {
+        continue;
+      }
+      for (int b = first_band[i]; b <= last_band[i]; b++) {
+        bands[b].departed |= b < first || b > last;
+      }
+      for (int b = first; b <= last; b++) {
+        if (b < first_band[i] || b > last_band[i]) {
+          bands[b].ids.push_back(uint32_t(i));
+        }
+      }
+      first_band[i] = first;
+      last_band[i] = last;
+    }
+    for (int b = 0; b < int(bands.size()); b++) {
+      sap_band &band = bands[b];
+      if (band.departed) {
+        size_t kept = 0;
+        for (uint32_t id : band.ids) {
+          if (first_band[id] <= b && b <= last_band[id]) {
+            band.ids[kept++] = id;
+          }
+        }
+        band.ids.resize(kept);
+        band.departed = false;
+      }
+      gather(band, boxes);
+      insertion_sort(band);
+    }
+  }
+
+  // Every overlapping pair, once, into pairs after clearing it.
+  inline void find_pairs(sap_pair_pool &pairs) {
+    pairs.clear();
+    for (int b = 0; b < int(bands.size()); b++) {
+      sap_band &band = bands[b];
+      const uint32_t *ids = band.ids.data();
+      size_t n = band.ids.size();
+      const float *lo0 = band.lo[0].data(), *lo1 = band.lo[1].data(),
+                  *hi1 = band.hi[1].data(), *lo2 = band.lo[2].data(),
+                  *hi2 = band.hi[2].data();
+      for (size_t i = 0; i < n; i++) {
+        S end0(band.hi[0][i]), a_lo1(lo1[i]), a_hi1(hi1[i]), a_lo2(lo2[i]),
+            a_hi2(hi2[i]);
+        int a_first = first_band[ids[i]];
+        for (size_t j = i + 1; j < n; j += S::lanes) {
+          // The padding only ends runs of finite boxes; one reaching +inf
+          // would read on past it.
+          int along = S::load(lo0 + j).le(end0).mask();
+          if (n - j < size_t(S::lanes)) {
+            along &= (1 << (n - j)) - 1;
+          }
+          if (along == 0) {
+            break;
+          }
+          S hit = S::load(lo1 + j).le(a_hi1) & a_lo1.le(S::load(hi1 + j)) &
+                  S::load(lo2 + j).le(a_hi2) & a_lo2.le(S::load(hi2 + j));
+          int bits = along & hit.mask();
+          for (int k = 0; bits; k++, bits >>= 1) {
+            if ((bits & 1) && std::max(a_first, first_band[ids[j + k]]) == b) {
+              pairs.push(ids[i], ids[j + k]);
+            }
+          }
+          // Sorted by start, so the first box past the end ends the run.
+          if (along != (1 << S::lanes) - 1) {
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  int axis;
+  int band_axis;
+  float band_origin;
+  float band_scale;
+  std::vector<sap_band> bands;
+  std::vector<int> first_band;
+  std::vector<int> last_band;
+
+  static inline bool bounded(AABB3f box) {
+    float3 d = box.dimensions();
+    return std::isfinite(d.x()) && std::isfinite(d.y()) && std::isfinite(d.z());
+  }
+
+  static inline float center(AABB3f box, int k) {
+    return (box.min_point[k] + box.max_point[k]) * 0.5f;
+  }
+
+  inline int band_of(float v) {
+    float b = std::floor((v - band_origin) * band_scale);
+    int last = int(bands.size()) - 1;
+    return b < 0 ? 0 : b > float(last) ? last : int(b);
+  }
+
+  inline void band_range(AABB3f box, int &first, int &last) {
+    first = band_of(box.min_point[band_axis]);
+    last = band_of(box.max_point[band_axis]);
+  }
+
+  // Refreshes the bounds of every slot from boxes[ids[slot]].
+  inline void gather(sap_band &band, const AABB3f *boxes) {
+    size_t n = band.ids.size();
+    for (int k = 0; k < 3; k++) {
+      band.lo[k].resize(n + S::lanes);
+      band.hi[k].resize(n + S::lanes);
+      std::fill(band.lo[k].begin() + n, band.lo[k].end(), INFINITY);
+    }
+    for (size_t i = 0; i < n; i++) {
+      float mn[4], mx[4];
+      AABB3f b = boxes[band.ids[i]];
+      simde_mm_storeu_ps(mn, b.min_point.simd);
+      simde_mm_storeu_ps(mx, b.max_point.simd);
+      for (int k = 0; k < 3; k++) {
+        band.lo[k][i] = mn[(axis + k) % 3];
+        band.hi[k][i] = mx[(axis + k) % 3];
+      }
+    }
+  }
+
+  inline void insertion_sort(sap_band &band) {
+    size_t n = band.ids.size(), budget = n * sap_shift_budget;
+    std::vector<float> *lo = band.lo, *hi = band.hi;
+    for (size_t i = 1; i < n; i++) {
+      float key = lo[0][i];
+      if (lo[0][i - 1] <= key) {
+        continue;
+      }
+      float l1 = lo[1][i], l2 = lo[2][i];
+      float h0 = hi[0][i], h1 = hi[1][i], h2 = hi[2][i];
+      uint32_t id = band.ids[i];
+      size_t j = i;
+      for (; j > 0 && lo[0][j - 1] > key; j--) {
+        for (int k = 0; k < 3; k++) {
+          lo[k][j] = lo[k][j - 1];
+          hi[k][j] = hi[k][j - 1];
+        }
+        band.ids[j] = band.ids[j - 1];
+      }
+      lo[0][j] = key;
+      lo[1][j] = l1;
+      lo[2][j] = l2;
+      hi[0][j] = h0;
+      hi[1][j] = h1;
+      hi[2][j] = h2;
+      band.ids[j] = id;
+      if (i - j > budget) {
+        sort(band);
+        return;
+      }
+      budget -= i - j;
+    }
+  }
+
+  inline void sort(sap_band &band) {
+    size_t n = band.ids.size();
+    std::vector<uint32_t> order(n);
+    for (size_t i = 0; i < n; i++) {
+      order[i] = uint32_t(i);
+    }
+    std::vector<float> &key = band.lo[0];
+    std::sort(order.begin(), order.end(),
+              [&](uint32_t a, uint32_t b) { return key[a] < key[b]; });
+    std::vector<float> sorted(n);
+    for (int k = 0; k < 3; k++) {
+      for (std::vector<float> *v : {&band.lo[k], &band.hi[k]}) {
+        for (size_t i = 0; i < n; i++) {
+          sorted[i] = (*v)[order[i]];
+        }
+        std::copy(sorted.begin(), sorted.end(), v->begin());
+      }
+    }
+    std::vector<uint32_t> ids(n);
+    for (size_t i = 0; i < n; i++) {
+      ids[i] = band.ids[order[i]];
+    }
+    band.ids.swap(ids);
+  }
+};
+
+} // namespace fonge
@@ -0,0 +1,101 @@
+#pragma once
+
+namespace fonge {
+
+// Compile-time swizzle helpers. A swizzle pattern is four source lanes, with
+// -1 marking a lane whose value does not matter (the unused lanes of a
+// float2/float3 result), so a pattern can be matched to the cheapest
+// instruction.
+
+constexpr bool swizzle_fits(int i, int lane) { return i < 0 || i == lane; }
+
+constexpr bool swizzle_matches(int x, int y, int z, int w, int a, int b, int c,
+                               int d) {
+  return swizzle_fits(x, a) && swizzle_fits(y, b) && swizzle_fits(z, c) &&
+         swizzle_fits(w, d);
+}
+
+// Source lane for a shuffle immediate, leaving unused lanes in place.
+constexpr int swizzle_lane(int i, int lane) { return i < 0 ? lane : i; }
+
+} // namespace fonge
+
+// Named swizzles forwarding to swizzle<...>(). They are templates so that the
+// result type only has to be complete where a swizzle is used, and only used
+// swizzles are instantiated. The including struct provides
+// swizzle_type<N>, the N-component vector (or scalar) of its kind.
+#define FONGE_SWZ_ALIAS1(name, i)                                              \
+  template <int N = 1> inline swizzle_type<N> name() { return swizzle<i>(); }
+#define FONGE_SWZ_ALIAS2(name, i, j)                                           \
+  template <int N = 2> inline swizzle_type<N> name() {                         \
+    return swizzle<i, j>();                                                    \
+  }
+#define FONGE_SWZ_ALIAS3(name, i, j, k)                                        \
+  template <int N = 3> inline swizzle_type<N> name() {                         \
+    return swizzle<i, j, k>();                                                 \
+  }
+#define FONGE_SWZ_ALIAS4(name, i, j, k, l)                                     \
+  template <int N = 4> inline swizzle_type<N> name() {                         \
+    return swizzle<i, j, k, l>();                                              \
+  }
+
+// Swizzle name generator. FONGE_SWIZZLES_D(F) expands
+//   F##1(name, i), F##2(name, i, j), F##3(name, i, j, k) and
+//   F##4(name, i, j, k, l)
+// once for every swizzle of a D-component vector, in both the xyzw and the
+// rgba spelling, so a type only has to say how one swizzle is built.
+
+#define FONGE_SWZ_L5(F, n, m, i, j, k, l)                                      \
+  F##4(n, i, j, k, l) F##4(m, i, j, k, l)
+
+#define FONGE_SWZ_L4_2(F, n, m, i, j, k)                                       \
+  F##3(n, i, j, k) F##3(m, i, j, k)                                            \
+  FONGE_SWZ_L5(F, n##x, m##r, i, j, k, 0)                                      \
+  FONGE_SWZ_L5(F, n##y, m##g, i, j, k, 1)
+#define FONGE_SWZ_L3_2(F, n, m, i, j)                                          \
+  F##2(n, i, j) F##2(m, i, j)                                                  \
+  FONGE_SWZ_L4_2(F, n##x, m##r, i, j, 0)                                       \
+  FONGE_SWZ_L4_2(F, n##y, m##g, i, j, 1)
+#define FONGE_SWZ_L2_2(F, n, m, i)                                             \
+  F##1(n, i) F##1(m, i) FONGE_SWZ_L3_2(F, n##x, m##r, i, 0)                    \
+  FONGE_SWZ_L3_2(F, n##y, m##g, i, 1)
+#define FONGE_SWIZZLES_2(F)                                                    \
+  FONGE_SWZ_L2_2(F, x, r, 0) FONGE_SWZ_L2_2(F, y, g, 1)
+
+#define FONGE_SWZ_L4_3(F, n, m, i, j, k)                                       \
+  F##3(n, i, j, k) F##3(m, i, j, k)                                            \
+  FONGE_SWZ_L5(F, n##x, m##r, i, j, k, 0)                                      \
+  FONGE_SWZ_L5(F, n##y, m##g, i, j, k, 1)                                      \
+  FONGE_SWZ_L5(F, n##z, m##b, i, j, k, 2)
+#define FONGE_SWZ_L3_3(F, n, m, i, j)                                          \
+  F##2(n, i, j) F##2(m, i, j)                                                  \
+  FONGE_SWZ_L4_3(F, n##x, m##r, i, j, 0)                                       \
+  FONGE_SWZ_L4_3(F, n##y, m##g, i, j, 1)                                       \
+  FONGE_SWZ_L4_3(F, n##z, m##b, i, j, 2)
+#define FONGE_SWZ_L2_3(F, n, m, i)                                             \
+  F##1(n, i) F##1(m, i) FONGE_SWZ_L3_3(F, n##x, m##r, i, 0)                    \
+  FONGE_SWZ_L3_3(F, n##y, m##g, i, 1) FONGE_SWZ_L3_3(F, n##z, m##b, i, 2)
+#define FONGE_SWIZZLES_3(F)                                                    \
+  FONGE_SWZ_L2_3(F, x, r, 0)                                                   \
+  FONGE_SWZ_L2_3(F, y, g, 1) FONGE_SWZ_L2_3(F, z, b, 2)
+
+#define FONGE_SWZ_L4_4(F, n, m, i, j, k)                                       \
+  F##3(n, i, j, k) F##3(m, i, j, k)                                            \
+  FONGE_SWZ_L5(F, n##x, m##r, i, j, k, 0)                                      \
+  FONGE_SWZ_L5(F, n##y, m##g, i, j, k, 1)                                      \
+  FONGE_SWZ_L5(F, n##z, m##b, i, j, k, 2)                                      \
+  FONGE_SWZ_L5(F, n##w, m##a, i, j, k, 3)
+#define FONGE_SWZ_L3_4(F, n, m, i, j)                                          \
+  F##2(n, i, j) F##2(m, i, j)                                                  \
+  FONGE_SWZ_L4_4(F, n##x, m##r, i, j, 0)                                       \
+  FONGE_SWZ_L4_4(F, n##y, m##g, i, j, 1)                                       \
+  FONGE_SWZ_L4_4(F, n##z, m##b, i, j, 2)                                       \
+  FONGE_SWZ_L4_4(F, n##w, m##a, i, j, 3)
+#define FONGE_SWZ_L2_4(F, n, m, i)                                             \
+  F##1(n, i) F##1(m, i) FONGE_SWZ_L3_4(F, n##x, m##r, i, 0)                    \
+  FONGE_SWZ_L3_4(F, n##y, m##g, i, 1) FONGE_SWZ_L3_4(F, n##z, m##b, i, 2)      \
+  FONGE_SWZ_L3_4(F, n##w, m##a, i, 3)
+#define FONGE_SWIZZLES_4(F)                                                    \
+  FONGE_SWZ_L2_4(F, x, r, 0)                                                   \
+  FONGE_SWZ_L2_4(F, y, g, 1)                                                   \
+  FONGE_SWZ_L2_4(F, z, b, 2) FONGE_SWZ_L2_4(F, w, a, 3)
@@ -0,0 +1,604 @@
+#pragma once
+
+#include "vector_double.hpp"
+#include "vector_float.hpp"
+#include <limits>
+#include <simde/x86/avx512.h>
+
+namespace fonge {
+
+// Vectorized sin, cos, sincos, tan, atan2, acos, exp and log. The same
+// polynomial kernels (Cephes coefficients) run on every register width
+// through the simd_ops adapters below.
+//
+// Max error in ulp against a correctly rounded result, measured over 2M
+// random inputs per range:
+//              float   double
+//   sin, cos     2       2      |x| < 1e6 float, |x| < 1e9 double
+//   tan          4       4      same ranges
+//   atan2        4       2
+//   acos         2       2
+//   exp          2       2
+//   log          1       1
+// sin, cos and tan use a three-part Cody-Waite reduction by pi/2 and lose
+// accuracy past those ranges. exp underflows gradually to 0 and overflows to
+// inf. log gives -inf for 0, NaN for negative inputs and handles denormals.
+// NaN propagates. atan2(+-inf, +-inf) returns NaN.
+
+// Adapters are keyed on scalar type and lane count: raw register types as
+// template arguments lose their attributes, which -Wignored-attributes
+// reports. simd_ops_of<V> finds the adapter for a register type.
+template <typename S, int N> struct simd_ops;
+
+template <> struct simd_ops<float, 4> {
+  typedef float scalar;
+  typedef simde__m128 mask;
+  typedef simde__m128 V;
+
+  static inline V set1(float a) { return simde_mm_set1_ps(a); }
+  static inline V add(V a, V b) { return simde_mm_add_ps(a, b); }
+  static inline V sub(V a, V b) { return simde_mm_sub_ps(a, b); }
+  static inline V mul(V a, V b) { return simde_mm_mul_ps(a, b); }
+  static inline V div(V a, V b) { return simde_mm_div_ps(a, b); }
+  // a * b + c and c - a * b
+  static inline V fmadd(V a, V b, V c) { return simde_mm_fmadd_ps(a, b, c); }
+  static inline V fnmadd(V a, V b, V c) { return simde_mm_fnmadd_ps(a, b, c); }
+  static inline V sqrt(V a) { return simde_mm_sqrt_ps(a); }
+  static inline V min(V a, V b) { return simde_mm_min_ps(a, b); }
+  static inline V max(V a, V b) { return simde_mm_max_ps(a, b); }
+  static inline V round(V a) {
+    return simde_mm_round_ps(a, SIMDE_MM_FROUND_TO_NEAREST_INT |
+                                    SIMDE_MM_FROUND_NO_EXC);
+  }
+  static inline V floor(V a) { return simde_mm_floor_ps(a); }
+  static inline V abs(V a) { return simde_x_mm_abs_ps(a); }
+  // a with its sign flipped where m is set
+  static inline V xor_sign(V a, mask m) {
+    return simde_mm_xor_ps(a, simde_mm_and_ps(m, simde_mm_set1_ps(-0.0f)));
+  }
+  // |a| with the sign of s
+  static inline V copysign(V a, V s) {
+    return simde_mm_or_ps(abs(a), simde_mm_and_ps(s, simde_mm_set1_ps(-0.0f)));
+  }
+  static inline mask lt(V a, V b) { return simde_mm_cmplt_ps(a, b); }
+  static inline mask gt(V a, V b) { return simde_mm_cmpgt_ps(a, b); }
+  static inline mask eq(V a, V b) { return simde_mm_cmpeq_ps(a, b); }
+  // !(a >= b), so true for NaN
+  static inline mask nge(V a, V b) { return simde_mm_cmpnge_ps(a, b); }
+  // m ? a : b
+  static inline V select(mask m, V a, V b) {
+    return simde_mm_blendv_ps(b, a, m);
+  }
+  // 2^n for integral n in [-126, 127]
+  static inline V pow2n(V n) {
+    simde__m128i t = simde_mm_castps_si128(
+        simde_mm_add_ps(n, simde_mm_set1_ps(8388608.f + 127.f)));
+    return simde_mm_castsi128_ps(simde_mm_slli_epi32(t, 23));
+  }
+  // Mantissa in [0.5, 1) and exponent of a positive normal a.
+  static inline V frexp(V a, V &e) {
+    simde__m128i bits = simde_mm_castps_si128(a);
+    e = simde_mm_sub_ps(
+        simde_mm_castsi128_ps(simde_mm_or_si128(
+            simde_mm_srli_epi32(bits, 23), simde_mm_set1_epi32(0x4B000000))),
+        simde_mm_set1_ps(8388608.f + 126.f));
+    return simde_mm_castsi128_ps(simde_mm_or_si128(
+        simde_mm_and_si128(bits, simde_mm_set1_epi32(0x7FFFFF)),
+        simde_mm_set1_epi32(0x3F000000)));
+  }
+};
+
+template <> struct simd_ops<float, 8> {
+  typedef float scalar;
+  typedef simde__m256 mask;
+  typedef simde__m256 V;
+
+  static inline V set1(float a) { return simde_mm256_set1_ps(a); }
+  static inline V add(V a, V b) { return simde_mm256_add_ps(a, b); }
+  static inline V sub(V a, V b) { return simde_mm256_sub_ps(a, b); }
+  static inline V mul(V a, V b) { return simde_mm256_mul_ps(a, b); }
+  static inline V div(V a, V b) { return simde_mm256_div_ps(a, b); }
+  static inline V fmadd(V a, V b, V c) {
+    return simde_mm256_fmadd_ps(a, b, c);
+  }
+  static inline V fnmadd(V a, V b, V c) {
+    return simde_mm256_fnmadd_ps(a, b, c);
+  }
+  static inline V sqrt(V a) { return simde_mm256_sqrt_ps(a); }
+  static inline V min(V a, V b) { return simde_mm256_min_ps(a, b); }
+  static inline V max(V a, V b) { return simde_mm256_max_ps(a, b); }
+  static inline V round(V a) {
+    return simde_mm256_round_ps(a, SIMDE_MM_FROUND_TO_NEAREST_INT |
+                                       SIMDE_MM_FROUND_NO_EXC);
+  }
+  static inline V floor(V a) { return simde_mm256_floor_ps(a); }
+  static inline V abs(V a) { return simde_x_mm256_abs_ps(a); }
+  static inline V xor_sign(V a, mask m) {
+    return simde_mm256_xor_ps(
+        a, simde_mm256_and_ps(m, simde_mm256_set1_ps(-0.0f)));
+  }
+  static inline V copysign(V a, V s) {
+    return simde_mm256_or_ps(
+        abs(a), simde_mm256_and_ps(s, simde_mm256_set1_ps(-0.0f)));
+  }
+  static inline mask lt(V a, V b) {
+    return simde_mm256_cmp_ps(a, b, SIMDE_CMP_LT_OQ);
+  }
+  static inline mask gt(V a, V b) {
+    return simde_mm256_cmp_ps(a, b, SIMDE_CMP_GT_OQ);
+  }
+  static inline mask eq(V a, V b) {
+    return simde_mm256_cmp_ps(a, b, SIMDE_CMP_EQ_OQ);
+  }
+  static inline mask nge(V a, V b) {
+    return simde_mm256_cmp_ps(a, b, SIMDE_CMP_NGE_UQ);
+  }
+  static inline V select(mask m, V a, V b) {
+    return simde_mm256_blendv_ps(b, a, m);
+  }
+  static inline V pow2n(V n) {
+    simde__m256i t = simde_mm256_castps_si256(
+        simde_mm256_add_ps(n, simde_mm256_set1_ps(8388608.f + 127.f)));
+    return simde_mm256_castsi256_ps(simde_mm256_slli_epi32(t, 23));
+  }
+  static inline V frexp(V a, V &e) {
+    simde__m256i bits = simde_mm256_castps_si256(a);
+    e = simde_mm256_sub_ps(
+        simde_mm256_castsi256_ps(
+            simde_mm256_or_si256(simde_mm256_srli_epi32(bits, 23),
+                                 simde_mm256_set1_epi32(0x4B000000))),
+        simde_mm256_set1_ps(8388608.f + 126.f));
+    return simde_mm256_castsi256_ps(simde_mm256_or_si256(
+        simde_mm256_and_si256(bits, simde_mm256_set1_epi32(0x7FFFFF)),
+        simde_mm256_set1_epi32(0x3F000000)));
+  }
+};
+
+template <> struct simd_ops<float, 16> {
+  typedef float scalar;
+  typedef simde__mmask16 mask;
+  typedef simde__m512 V;
+
+  static inline V set1(float a) { return simde_mm512_set1_ps(a); }
+  static inline V add(V a, V b) { return simde_mm512_add_ps(a, b); }
+  static inline V sub(V a, V b) { return simde_mm512_sub_ps(a, b); }
+  static inline V mul(V a, V b) { return simde_mm512_mul_ps(a, b); }
+  static inline V div(V a, V b) { return simde_mm512_div_ps(a, b); }
+  static inline V fmadd(V a, V b, V c) {
+    return simde_mm512_fmadd_ps(a, b, c);
+  }
+  static inline V fnmadd(V a, V b, V c) {
+    return simde_mm512_fnmadd_ps(a, b, c);
+  }
+  static inline V sqrt(V a) { return simde_mm512_sqrt_ps(a); }
+  static inline V min(V a, V b) { return simde_mm512_min_ps(a, b); }
+  static inline V max(V a, V b) { return simde_mm512_max_ps(a, b); }
+  static inline V round(V a) {
+    return simde_mm512_roundscale_ps(a, SIMDE_MM_FROUND_TO_NEAREST_INT |
+                                            SIMDE_MM_FROUND_NO_EXC);
+  }
+  static inline V floor(V a) {
+    return simde_mm512_roundscale_ps(a, SIMDE_MM_FROUND_TO_NEG_INF |
+                                            SIMDE_MM_FROUND_NO_EXC);
+  }
+  static inline V abs(V a) { return simde_mm512_abs_ps(a); }
+  static inline V xor_sign(V a, mask m) {
+    simde__m512i bits = simde_mm512_castps_si512(a);
+    return simde_mm512_castsi512_ps(simde_mm512_mask_xor_epi32(
+        bits, m, bits, simde_mm512_set1_epi32(INT32_MIN)));
+  }
+  static inline V copysign(V a, V s) {
+    return simde_mm512_castsi512_ps(simde_mm512_or_si512(
+        simde_mm512_castps_si512(abs(a)),
+        simde_mm512_and_si512(simde_mm512_castps_si512(s),
+                              simde_mm512_set1_epi32(INT32_MIN))));
+  }
+  static inline mask lt(V a, V b) {
+    return simde_mm512_cmp_ps_mask(a, b, SIMDE_CMP_LT_OQ);
+  }
+  static inline mask gt(V a, V b) {
+    return simde_mm512_cmp_ps_mask(a, b, SIMDE_CMP_GT_OQ);
+  }
+  static inline mask eq(V a, V b) {
+    return simde_mm512_cmp_ps_mask(a, b, SIMDE_CMP_EQ_OQ);
+  }
+  static inline mask nge(V a, V b) {
+    return simde_mm512_cmp_ps_mask(a, b, SIMDE_CMP_NGE_UQ);
+  }
+  static inline V select(mask m, V a, V b) {
+    return simde_mm512_mask_blend_ps(m, b, a);
+  }
+  static inline V pow2n(V n) {
+    simde__m512i t = simde_mm512_castps_si512(
+        simde_mm512_add_ps(n, simde_mm512_set1_ps(8388608.f + 127.f)));
+    return simde_mm512_castsi512_ps(simde_mm512_slli_epi32(t, 23));
+  }
+  static inline V frexp(V a, V &e) {
+    simde__m512i bits = simde_mm512_castps_si512(a);
+    e = simde_mm512_sub_ps(
+        simde_mm512_castsi512_ps(
+            simde_mm512_or_si512(simde_mm512_srli_epi32(bits, 23),
+                                 simde_mm512_set1_epi32(0x4B000000))),
+        simde_mm512_set1_ps(8388608.f + 126.f));
+    return simde_mm512_castsi512_ps(simde_mm512_or_si512(
+        simde_mm512_and_si512(bits, simde_mm512_set1_epi32(0x7FFFFF)),
+        simde_mm512_set1_epi32(0x3F000000)));
+  }
+};
+
+template <> struct simd_ops<double, 4> {
+  typedef double scalar;
+  typedef simde__m256d mask;
+  typedef simde__m256d V;
+
+  static inline V set1(double a) { return simde_mm256_set1_pd(a); }
+  static inline V add(V a, V b) { return simde_mm256_add_pd(a, b); }
+  static inline V sub(V a, V b) { return simde_mm256_sub_pd(a, b); }
+  static inline V mul(V a, V b) { return simde_mm256_mul_pd(a, b); }
+  static inline V div(V a, V b) { return simde_mm256_div_pd(a, b); }
+  static inline V fmadd(V a, V b, V c) {
+    return simde_mm256_fmadd_pd(a, b, c);
+  }
+  static inline V fnmadd(V a, V b, V c) {
+    return simde_mm256_fnmadd_pd(a, b, c);
+  }
+  static inline V sqrt(V a) { return simde_mm256_sqrt_pd(a); }
+  static inline V min(V a, V b) { return simde_mm256_min_pd(a, b); }
+  static inline V max(V a, V b) { return simde_mm256_max_pd(a, b); }
+  static inline V round(V a) {
+    return simde_mm256_round_pd(a, SIMDE_MM_FROUND_TO_NEAREST_INT |
+                                       SIMDE_MM_FROUND_NO_EXC);
+  }
+  static inline V floor(V a) { return simde_mm256_floor_pd(a); }
+  static inline V abs(V a) { return simde_x_mm256_abs_pd(a); }
+  static inline V xor_sign(V a, mask m) {
+    return simde_mm256_xor_pd(a,
+                              simde_mm256_and_pd(m, simde_mm256_set1_pd(-0.0)));
+  }
+  static inline V copysign(V a, V s) {
+    return simde_mm256_or_pd(abs(a),
+                             simde_mm256_and_pd(s, simde_mm256_set1_pd(-0.0)));
+  }
+  static inline mask lt(V a, V b) {
+    return simde_mm256_cmp_pd(a, b, SIMDE_CMP_LT_OQ);
+  }
+  static inline mask gt(V a, V b) {
+    return simde_mm256_cmp_pd(a, b, SIMDE_CMP_GT_OQ);
+  }
+  static inline mask eq(V a, V b) {
+    return simde_mm256_cmp_pd(a, b, SIMDE_CMP_EQ_OQ);
+  }
+  static inline mask nge(V a, V b) {
+    return simde_mm256_cmp_pd(a, b, SIMDE_CMP_NGE_UQ);
+  }
+  static inline V select(mask m, V a, V b) {
+    return simde_mm256_blendv_pd(b, a, m);
+  }
+  // 2^n for integral n in [-1022, 1023]
+  static inline V pow2n(V n) {
+    simde__m256i t = simde_mm256_castpd_si256(simde_mm256_add_pd(
+        n, simde_mm256_set1_pd(4503599627370496.0 + 1023.0)));
+    return simde_mm256_castsi256_pd(simde_mm256_slli_epi64(t, 52));
+  }
+  static inline V frexp(V a, V &e) {
+    simde__m256i bits = simde_mm256_castpd_si256(a);
+    e = simde_mm256_sub_pd(
+        simde_mm256_castsi256_pd(simde_mm256_or_si256(
+            simde_mm256_srli_epi64(bits, 52),
+            simde_mm256_set1_epi64x(0x4330000000000000))),
+        simde_mm256_set1_pd(4503599627370496.0 + 1022.0));
+    return simde_mm256_castsi256_pd(simde_mm256_or_si256(
+        simde_mm256_and_si256(bits,
+                              simde_mm256_set1_epi64x(0xFFFFFFFFFFFFF)),
+        simde_mm256_set1_epi64x(0x3FE0000000000000)));
+  }
+};
+
+// Only declared, for the decltype in simd_ops_of.
+simd_ops<float, 4> simd_ops_for(simde__m128);
+simd_ops<float, 8> simd_ops_for(simde__m256);
+simd_ops<float, 16> simd_ops_for(simde__m512);
+simd_ops<double, 4> simd_ops_for(simde__m256d);
+
+template <typename V> using simd_ops_of = decltype(simd_ops_for(V()));
+
+template <typename S> struct math_coeffs;
+
+template <> struct math_coeffs<float> {
+  // pi/2 split for Cody-Waite reduction
+  static constexpr float pio2[] = {1.57079637050628662109375f,
+                                   -4.37113882867379300296e-8f,
+                                   -1.71512451000588188e-15f};
+  static constexpr float sin[] = {-1.9515295891e-4f, 8.3321608736e-3f,
+                                  -1.6666654611e-1f};
+  static constexpr float cos[] = {2.443315711809948e-5f,
+                                  -1.388731625493765e-3f,
+                                  4.166664568298827e-2f};
+  static constexpr float atan[] = {8.05374449538e-2f, -1.38776856032e-1f,
+                                   1.99777106478e-1f, -3.33329491539e-1f};
+  // atan2 reduces through (a - 1) / (a + 1) above this ratio
+  static constexpr float atan_split = 0.4142135623730950f;
+  static constexpr float asin[] = {4.2163199048e-2f, 2.4181311049e-2f,
+                                   4.5470025998e-2f, 7.4953002686e-2f,
+                                   1.6666752422e-1f};
+  static constexpr float exp[] = {1.9875691500e-4f, 1.3981999507e-3f,
+                                  8.3334519073e-3f, 4.1665795894e-2f,
+                                  1.6666665459e-1f, 5.0000001201e-1f};
+  // exp clamps its input here; the results are 0 and inf past the ends
+  static constexpr float exp_min = -104.f;
+  static constexpr float exp_max = 89.f;
+  static constexpr float log[] = {7.0376836292e-2f,  -1.1514610310e-1f,
+                                  1.1676998740e-1f,  -1.2420140846e-1f,
+                                  1.4249322787e-1f,  -1.6668057665e-1f,
+                                  2.0000714765e-1f,  -2.4999993993e-1f,
+                                  3.3333331174e-1f};
+  // ln(2) = ln2[0] + ln2[1]
+  static constexpr float ln2[] = {0.693359375f, -2.12194440e-4f};
+  static constexpr float min_normal = 1.17549435e-38f;
+  // denormal log inputs are scaled by 2^denormal_shift first
+  static constexpr float denormal_shift = 25.f;
+};
+
+template <> struct math_coeffs<double> {
+  static constexpr double pio2[] = {1.5707963267948966,
+                                    6.123233995736766e-17,
+                                    -1.4973849048591698e-33};
+  static constexpr double sin[] = {
+      1.58962301576546568060e-10, -2.50507477628578072866e-8,
+      2.75573136213857245213e-6,  -1.98412698295895385996e-4,
+      8.33333333332211858878e-3,  -1.66666666666666307295e-1};
+  static constexpr double cos[] = {
+      -1.13585365213876817300e-11, 2.08757008419747316778e-9,
+      -2.75573141792967388112e-7,  2.48015872888517045348e-5,
+      -1.38888888888730564116e-3,  4.16666666666665929218e-2};
+  // atan and asin are rational, p(z) / q(z)
+  static constexpr double atan_p[] = {
+      -8.750608600031904122785e-1, -1.615753718733365076637e1,
+      -7.500855792314704667340e1, -1.228866684490136173410e2,
+      -6.485021904942025371773e1};
+  static constexpr double atan_q[] = {
+      1.0, 2.485846490142306297962e1, 1.650270098316988542046e2,
+      4.328810604912902668951e2, 4.853903996359136964868e2,
+      1.945506571482613964425e2};
+  static constexpr double atan_split = 0.66;
+  static constexpr double asin_p[] = {
+      4.253011369004428248960e-3, -6.019598008014123785661e-1,
+      5.444622390564711410273e0,  -1.626247967210700244449e1,
+      1.956261983317594739197e1,  -8.198089802484824371615e0};
+  static constexpr double asin_q[] = {
+      1.0, -1.474091372988853791896e1, 7.049610280856842141659e1,
+      -1.471791292232726029859e2, 1.395105614657485689735e2,
+      -4.918853881490881290097e1};
+  // exp(r) = 1 + 2 r p(r^2) / (q(r^2) - r p(r^2))
+  static constexpr double exp_p[] = {1.26177193074810590878e-4,
+                                     3.02994407707441961300e-2,
+                                     9.99999999999999999910e-1};
+  static constexpr double exp_q[] = {
+      3.00198505138664455042e-6, 2.52448340349684104192e-3,
+      2.27265548208155028766e-1, 2.00000000000000000009e0};
+  static constexpr double exp_min = -746.;
+  static constexpr double exp_max = 710.;
+  static constexpr double log_p[] = {
+      1.01875663804580931796e-4, 4.97494994976747001425e-1,
+      4.70579119878881725854e0,  1.44989225341610930846e1,
+      1.79368678507819816313e1,  7.70838733755885391666e0};
+  static constexpr double log_q[] = {
+      1.0, 1.12873587189167450590e1, 4.52279145837532221105e1,
+      8.29875266912776603211e1, 7.11544750618563894466e1,
+      2.31251620126765340583e1};
+  static constexpr double ln2[] = {0.693359375, -2.121944400546905827679e-4};
+  static constexpr double min_normal = 2.2250738585072014e-308;
+  static constexpr double denormal_shift = 54.;
+};
+
+// c[0] x^(N-1) + ... + c[N-1]
+template <typename V, typename S, size_t N>
+static inline V simd_poly(V x, const S (&c)[N]) {
+  typedef simd_ops_of<V> O;
+  V r = O::set1(c[0]);
+  for (size_t i = 1; i < N; i++) {
+    r = O::fmadd(r, x, O::set1(c[i]));
+  }
+  return r;
+}
+
+template <typename V> static inline void simd_sincos(V x, V &s, V &c) {
+  typedef simd_ops_of<V> O;
+  typedef typename O::scalar S;
+  typedef math_coeffs<S> K;
+
+  V q = O::round(O::mul(x, O::set1(S(0.63661977236758134308))));
+  V r = O::fnmadd(q, O::set1(K::pio2[0]), x);
+  r = O::fnmadd(q, O::set1(K::pio2[1]), r);
+  r = O::fnmadd(q, O::set1(K::pio2[2]), r);
+
+  V z = O::mul(r, r);
+  V ps = O::fmadd(O::mul(r, z), simd_poly(z, K::sin), r);
+  V pc = O::fmadd(O::mul(z, z), simd_poly(z, K::cos),
+                  O::fnmadd(O::set1(S(0.5)), z, O::set1(S(1))));
+
+  // quadrant q mod 4: odd ones swap sin and cos, sin is negated in 2 and 3,
+  // cos in 1 and 2
+  V quadrant = O::fnmadd(O::floor(O::mul(q, O::set1(S(0.25)))), O::set1(S(4)),
+                         q);
+  auto swap = O::eq(O::abs(O::sub(quadrant, O::set1(S(2)))), O::set1(S(1)));
+  s = O::xor_sign(O::select(swap, pc, ps), O::gt(quadrant, O::set1(S(1.5))));
+  c = O::xor_sign(
+      O::select(swap, ps, pc),
+      O::lt(O::abs(O::sub(quadrant, O::set1(S(1.5)))), O::set1(S(1))));
+}
+
+template <typename V> static inline V simd_sin(V x) {
+  V s, c;
+  simd_sincos(x, s, c);
+  return s;
+}
+
+template <typename V> static inline V simd_cos(V x) {
+  V s, c;
+  simd_sincos(x, s, c);
+  return c;
+}
+
+template <typename V> static inline V simd_tan(V x) {
+  V s, c;
+  simd_sincos(x, s, c);
+  return simd_ops_of<V>::div(s, c);
+}
+
+// atan(t) for |t| <= atan_split.
+template <typename V> static inline V simd_atan_core(V t) {
+  typedef simd_ops_of<V> O;
+  typedef typename O::scalar S;
+  typedef math_coeffs<S> K;
+
+  V z = O::mul(t, t);
+  if constexpr (sizeof(S) == sizeof(float)) {
+    return O::fmadd(O::mul(t, z), simd_poly(z, K::atan), t);
+  } else {
+    return O::fmadd(
+        O::mul(t, z),
+        O::div(simd_poly(z, K::atan_p), simd_poly(z, K::atan_q)), t);
+  }
+}
+
+template <typename V> static inline V simd_atan2(V y, V x) {
+  typedef simd_ops_of<V> O;
+  typedef typename O::scalar S;
+  typedef math_coeffs<S> K;
+  const S pi = S(3.14159265358979323846);
+
+  V ax = O::abs(x), ay = O::abs(y);
+  V hi = O::max(ax, ay);
+  V a = O::div(O::min(ax, ay), hi);
+  a = O::select(O::eq(hi, O::set1(S(0))), O::set1(S(0)), a);
+
+  auto big = O::gt(a, O::set1(K::atan_split));
+  V t = O::select(big,
+                  O::div(O::sub(a, O::set1(S(1))), O::add(a, O::set1(S(1)))),
+                  a);
+  V r = O::add(simd_atan_core(t),
+               O::select(big, O::set1(pi / 4), O::set1(S(0))));
+  r = O::select(O::gt(ay, ax), O::sub(O::set1(pi / 2), r), r);
+  r = O::select(O::lt(x, O::set1(S(0))), O::sub(O::set1(pi), r), r);
+  return O::copysign(r, y);
+}
+
+// asin(t) for |t| <= 0.5.
+template <typename V> static inline V simd_asin_core(V t) {
+  typedef simd_ops_of<V> O;
+  typedef typename O::scalar S;
+  typedef math_coeffs<S> K;
+
+  V z = O::mul(t, t);
+  if constexpr (sizeof(S) == sizeof(float)) {
+    return O::fmadd(O::mul(t, z), simd_poly(z, K::asin), t);
+  } else {
+    return O::fmadd(
+        O::mul(t, z),
+        O::div(simd_poly(z, K::asin_p), simd_poly(z, K::asin_q)), t);
+  }
+}
+
+template <typename V> static inline V simd_acos(V x) {
+  typedef simd_ops_of<V> O;
+  typedef typename O::scalar S;
+  const S pi = S(3.14159265358979323846);
+
+  // |x| > 0.5 goes through acos(x) = 2 asin(sqrt((1 - x) / 2))
+  auto big = O::gt(O::abs(x), O::set1(S(0.5)));
+  V t = O::select(
+      big, O::sqrt(O::mul(O::set1(S(0.5)), O::sub(O::set1(S(1)), O::abs(x)))),
+      x);
+  V p = simd_asin_core(t);
+  V r2 = O::add(p, p);
+  r2 = O::select(O::lt(x, O::set1(S(0))), O::sub(O::set1(pi), r2), r2);
+  return O::select(big, r2, O::sub(O::set1(pi / 2), p));
+}
+
+template <typename V> static inline V simd_exp(V x) {
+  typedef simd_ops_of<V> O;
+  typedef typename O::scalar S;
+  typedef math_coeffs<S> K;
+
+  // the argument order keeps NaN
+  x = O::min(O::set1(K::exp_max), O::max(O::set1(K::exp_min), x));
+  V n = O::round(O::mul(x, O::set1(S(1.44269504088896340736))));
+  V r = O::fnmadd(n, O::set1(K::ln2[0]), x);
+  r = O::fnmadd(n, O::set1(K::ln2[1]), r);
+
+  V p;
+  if constexpr (sizeof(S) == sizeof(float)) {
+    p = O::fmadd(O::mul(r, r), simd_poly(r, K::exp), O::add(r, O::set1(1.f)));
+  } else {
+    V rr = O::mul(r, r);
+    V pr = O::mul(r, simd_poly(rr, K::exp_p));
+    p = O::div(pr, O::sub(simd_poly(rr, K::exp_q), pr));
+    p = O::fmadd(p, O::set1(2.), O::set1(1.));
+  }
+
+  // 2^n in two factors so that results near the ends of the range neither
+  // overflow the exponent field nor skip gradual underflow
+  V n1 = O::floor(O::mul(n, O::set1(S(0.5))));
+  return O::mul(O::mul(p, O::pow2n(n1)), O::pow2n(O::sub(n, n1)));
+}
+
+template <typename V> static inline V simd_log(V x) {
+  typedef simd_ops_of<V> O;
+  typedef typename O::scalar S;
+  typedef math_coeffs<S> K;
+
+  auto denormal = O::lt(x, O::set1(K::min_normal));
+  V xs = O::select(
+      denormal, O::mul(x, O::pow2n(O::set1(K::denormal_shift))), x);
+  V e;
+  V m = O::frexp(xs, e);
+  e = O::sub(e, O::select(denormal, O::set1(K::denormal_shift), O::set1(S(0))));
+
+  // m in [sqrt(0.5), sqrt(2)), log(x) = log(m) + e ln(2)
+  auto low = O::lt(m, O::set1(S(0.70710678118654752440)));
+  m = O::select(low, O::add(m, m), m);
+  e = O::select(low, O::sub(e, O::set1(S(1))), e);
+  V f = O::sub(m, O::set1(S(1)));
+  V z = O::mul(f, f);
+
+  V y;
+  if constexpr (sizeof(S) == sizeof(float)) {
+    y = O::mul(O::mul(f, z), simd_poly(f, K::log));
+  } else {
+    y = O::mul(f, O::div(O::mul(z, simd_poly(f, K::log_p)),
+                         simd_poly(f, K::log_q)));
+  }
+  y = O::fmadd(e, O::set1(K::ln2[1]), y);
+  y = O::fnmadd(O::set1(S(0.5)), z, y);
+  V r = O::fmadd(e, O::set1(K::ln2[0]), O::add(f, y));
+
+  const S inf = std::numeric_limits<S>::infinity();
+  r = O::select(O::eq(x, O::set1(inf)), O::set1(inf), r);
+  r = O::select(O::eq(x, O::set1(S(0))), O::set1(-inf), r);
+  return O::select(O::nge(x, O::set1(S(0))),
+                   O::set1(std::numeric_limits<S>::quiet_NaN()), r);
+}
+
+// sin(x), cos(x), ... for a vector type T with a simd member. sincos shares
+// the range reduction between both results.
+#define FONGE_TRANSCENDENTALS(T)                                               \
+  static inline T sin(T x) { return simd_sin(x.simd); }                       \
+  static inline T cos(T x) { return simd_cos(x.simd); }                       \
+  static inline void sincos(T x, T &s, T &c) {                                 \
+    simd_sincos(x.simd, s.simd, c.simd);                                       \
+  }                                                                            \
+  static inline T tan(T x) { return simd_tan(x.simd); }                       \
+  static inline T atan2(T y, T x) { return simd_atan2(y.simd, x.simd); }      \
+  static inline T acos(T x) { return simd_acos(x.simd); }                     \
+  static inline T exp(T x) { return simd_exp(x.simd); }                       \
+  static inline T log(T x) { return simd_log(x.simd); }
+
+FONGE_TRANSCENDENTALS(float2)
+FONGE_TRANSCENDENTALS(float3)
+FONGE_TRANSCENDENTALS(float4)
+FONGE_TRANSCENDENTALS(double2)
+FONGE_TRANSCENDENTALS(double3)
+FONGE_TRANSCENDENTALS(double4)
+
+} // namespace fonge
@@ -6,6 +6,7 @@
 #include "quaternion_double.hpp"
 #include "quaternion_float.hpp"
 #include "shapes.hpp"
+#include "transcendental.hpp"
 #include "vector_double.hpp"
 #include "vector_float.hpp"
 #include <cmath>
@@ -21,7 +22,9 @@ inline float4x4 translation4f(float3 displacement) {
 }
 
 inline float2x2 rotation2f(float theta) {
-  return float2x2(cosf(theta), -sinf(theta), sinf(theta), cosf(theta));
+  float4 s, c;
+  sincos(float4(theta), s, c);
+  return float2x2(c.x(), -s.x(), s.x(), c.x());
 }
 
 inline float3x3 rotation3f(quat q) { return q.rot_mat3_form(); }
@@ -42,12 +45,30 @@ inline float4x4 scale4f(float4 scale) {
                   scale.z() * float4::z_axis(), scale.w() * float4::w_axis());
 }
 
+inline float3x4 translation3x4f(float3 displacement) {
+  return float3x4(float3x3::identity(), displacement);
+}
+
+inline float3x4 rotation3x4f(quat q) { return q.rot_mat4_form(); }
+
+inline float3x4 scale3x4f(float3 scale) {
+  return float3x4(scale3f(scale), float3());
+}
+
+// Scale, then rotate, then translate.
+inline float3x4 trs3x4f(float3 translation, quat rotation, float3 scale) {
+  float3x3 r = rotation.rot_mat3_form();
+  return float3x4(float3x3(r.col1 * scale.x(), r.col2 * scale.y(),
+                           r.col3 * scale.z()),
+                  translation);
+}
+
 // Reverse-Z perspective projection matrix. If far is 0, interpret as infinite
 // far plane.
 inline float4x4 perspectivef(float h_fov, float aspect, float near,
                              float far = 0) {
   h_fov *= DEG2RAD;
-  float sx = near * tanh(h_fov / 2);
+  float sx = 1 / tan(float4(h_fov / 2)).x();
   float sy = sx / aspect;
 
   if (far == 0.f) {
@@ -74,7 +95,9 @@ inline double4x4 translation4d(double3 displacement) {
 }
 
 inline double2x2 rotation2d(double theta) {
-  return double2x2(cosf(theta), -sinf(theta), sinf(theta), cosf(theta));
+  double4 s, c;
+  sincos(double4(theta), s, c);
+  return double2x2(c.x(), -s.x(), s.x(), c.x());
 }
 
 inline double3x3 rotation3d(dquat q) { return q.rot_mat3_form(); }
@@ -97,12 +120,30 @@ inline double4x4 scale4d(double4 scale) {
                    scale.w() * double4::w_axis());
 }
 
+inline double3x4 translation3x4d(double3 displacement) {
+  return double3x4(double3x3::identity(), displacement);
+}
+
+inline double3x4 rotation3x4d(dquat q) { return q.rot_mat4_form(); }
+
+inline double3x4 scale3x4d(double3 scale) {
+  return double3x4(scale3d(scale), double3());
+}
+
+// Scale, then rotate, then translate.
+inline double3x4 trs3x4d(double3 translation, dquat rotation, double3 scale) {
+  double3x3 r = rotation.rot_mat3_form();
+  return double3x4(double3x3(r.col1 * scale.x(), r.col2 * scale.y(),
+                             r.col3 * scale.z()),
+                   translation);
+}
+
 // Reverse-Z perspective projection matrix. If far is 0, interpret as infinite
 // far plane.
 inline double4x4 perspectived(double h_fov, double aspect, double near,
                               double far = 0) {
   h_fov *= DEG2RAD;
-  double sx = near * tanh(h_fov / 2);
+  double sx = 1 / tan(double4(h_fov / 2)).x();
   double sy = sx / aspect;
 
   if (far == 0.f) {
@@ -1,17 +1,90 @@
 #pragma once
 
+#include "approx.hpp"
+#include "reduce.hpp"
+#include "swizzle.hpp"
 #include <simde/x86/avx512.h>
 
 namespace fonge {
 
+// Full 4-lane permute with a SIMDE_MM_SHUFFLE immediate. Without AVX2 the
+// halves are swapped, both copies are permuted within their lanes and the
+// results are blended.
+#if defined(SIMDE_X86_AVX2_NATIVE) || !defined(SIMDE_X86_AVX_NATIVE)
 #define permute_pd_custom(simdvar, ids)                                        \
-  simde_mm256_shuffle_pd((simdvar), (simdvar), (ids))
+  simde_mm256_permute4x64_pd((simdvar), (ids))
+#else
+#define permute_pd_custom(simdvar, ids)                                        \
+  simde_mm256_blend_pd(                                                        \
+      simde_mm256_permute_pd((simdvar), permute_pd_inlane(ids)),               \
+      simde_mm256_permute_pd(                                                  \
+          simde_mm256_permute2f128_pd((simdvar), (simdvar), 0x01),             \
+          permute_pd_inlane(ids)),                                             \
+      permute_pd_crossing(ids))
+#endif
+
+// permute_pd immediate for the low bit of each index.
+#define permute_pd_inlane(ids)                                                 \
+  (((ids) & 1) | (((ids) >> 1) & 2) | (((ids) >> 2) & 4) | (((ids) >> 3) & 8))
+
+// Lanes whose source is in the other 128-bit half.
+#define permute_pd_crossing(ids)                                               \
+  ((((ids) >> 1) & 1) | (((ids) >> 2) & 2) | ((~(ids) >> 3) & 4) |             \
+   ((~(ids) >> 4) & 8))
 
 typedef double double1;
 struct double2;
 struct double3;
 struct double4;
 
+template <int N> struct double_n;
+template <> struct double_n<1> {
+  typedef double type;
+};
+template <> struct double_n<2> {
+  typedef double2 type;
+};
+template <> struct double_n<3> {
+  typedef double3 type;
+};
+template <> struct double_n<4> {
+  typedef double4 type;
+};
+
+// 128-bit half that lanes (a, b) of a swizzle read as a pair, -1 if either
+// half works and -2 if they do not come from a single half in order.
+constexpr int swizzle_half(int a, int b) {
+  if ((a >= 0 && a % 2 != 0) || (b >= 0 && b % 2 != 1) ||
+      (a >= 0 && b >= 0 && b != a + 1)) {
+    return -2;
+  }
+  return a >= 0 ? a / 2 : b >= 0 ? b / 2 : -1;
+}
+
+// (v[X], v[Y], v[Z], v[W]) with the cheapest instruction for the pattern. -1
+// marks a lane whose value does not matter. Only permute_pd_custom crosses
+// the 128-bit lanes in one step, so in-lane and whole-half patterns use the
+// cheaper permute_pd and permute2f128_pd.
+template <int X, int Y = -1, int Z = -1, int W = -1>
+static inline simde__m256d swizzle_pd(simde__m256d v) {
+  if constexpr (swizzle_matches(X, Y, Z, W, 0, 1, 2, 3)) {
+    return v;
+  } else if constexpr (X < 2 && Y < 2 && (Z < 0 || Z >= 2) &&
+                       (W < 0 || W >= 2)) {
+    return simde_mm256_permute_pd(
+        v, (X & 1) | ((Y & 1) << 1) | ((Z & 1) << 2) | ((W & 1) << 3));
+  } else if constexpr (swizzle_half(X, Y) != -2 && swizzle_half(Z, W) != -2) {
+    return simde_mm256_permute2f128_pd(
+        v, v,
+        (swizzle_half(X, Y) == 1 ? 0x01 : 0x00) |
+            (swizzle_half(Z, W) == 0 ? 0x00 : 0x10));
+  } else {
+    return permute_pd_custom(
+        v, SIMDE_MM_SHUFFLE(swizzle_lane(W, 3), swizzle_lane(Z, 2),
+                            swizzle_lane(Y, 1), swizzle_lane(X, 0)));
+  }
+}
+
 struct double2 {
   inline double2() : simd(simde_mm256_setzero_pd()) {}
 
@@ -91,6 +164,10 @@ struct double2 {
 
   inline double2 abs() { return simde_x_mm256_abs_pd(simd); }
 
+  inline double2 min(double2 rhs) { return simde_mm256_min_pd(simd, rhs.simd); }
+
+  inline double2 max(double2 rhs) { return simde_mm256_max_pd(simd, rhs.simd); }
+
   inline uint32_t mask() { return simde_mm256_movemask_pd(simd) & 0b11; }
 
   inline bool any() { return mask() != 0; }
@@ -104,20 +181,48 @@ struct double2 {
   }
 
   inline double dot(double2 rhs) {
-    double2 out = (*this) * rhs;
-    out = simde_mm256_hadd_pd(out.simd, out.simd);
-    return simde_mm256_cvtsd_f64(out.simd);
+    return dot_pd<2>(simd, rhs.simd);
   }
 
   double2 cross() { return yx() * double2(1, -1); }
 
-#include "swizzles/double2_swizzles_decl"
+  template <int N> using swizzle_type = typename double_n<N>::type;
+
+  template <int X> inline double swizzle() {
+    static_assert(X < 2, "swizzle index out of range");
+    return simde_mm256_cvtsd_f64(swizzle_pd<X>(simd));
+  }
+
+  template <int X, int Y, int... I>
+  inline swizzle_type<2 + sizeof...(I)> swizzle() {
+    static_assert(X < 2 && Y < 2 && ((I < 2) && ...),
+                  "swizzle index out of range");
+    return swizzle_pd<X, Y, I...>(simd);
+  }
+
+  FONGE_SWIZZLES_2(FONGE_SWZ_ALIAS)
 
   inline double len2() { return dot(*this); }
 
-  inline double len() { return sqrtf(len2()); }
+  inline double len() { return sqrt(len2()); }
 
-  inline double2 normalized() { return (*this) / len(); }
+  // 1 / len(), approximated (see approx.hpp).
+  inline double rcp_len() {
+    return simde_mm256_cvtsd_f64(rsqrt_nr_pd(simde_mm256_set1_pd(len2())));
+  }
+
+  inline double2 normalized() {
+#if defined(FONGE_FAST_MATH)
+    return normalized_fast();
+#else
+    return (*this) / len();
+#endif
+  }
+
+  // normalized() with an approximate 1 / len() (see approx.hpp).
+  inline double2 normalized_fast() {
+    return simde_mm256_mul_pd(simd, rsqrt_nr_pd(simde_mm256_set1_pd(len2())));
+  }
 
   static inline double2 one() { return double2(1); }
 
@@ -148,6 +253,15 @@ static inline double2 operator/(double2 lhs, double rhs) {
   return lhs / double2(rhs);
 }
 
+// lhs / rhs with an approximate reciprocal (see approx.hpp).
+static inline double2 fast_div(double2 lhs, double2 rhs) {
+  return simde_mm256_mul_pd(lhs.simd, rcp_nr_pd(rhs.simd));
+}
+
+static inline double2 fast_div(double2 lhs, double rhs) {
+  return fast_div(lhs, double2(rhs));
+}
+
 struct double3 {
   inline double3(double all) : simd(simde_mm256_set1_pd(all)) {}
 
@@ -225,6 +339,10 @@ struct double3 {
 
   inline double3 abs() { return simde_x_mm256_abs_pd(simd); }
 
+  inline double3 min(double3 rhs) { return simde_mm256_min_pd(simd, rhs.simd); }
+
+  inline double3 max(double3 rhs) { return simde_mm256_max_pd(simd, rhs.simd); }
+
   inline uint32_t mask() { return simde_mm256_movemask_pd(simd) & 0b111; }
 
   inline bool any() { return mask() != 0; }
@@ -238,8 +356,7 @@ struct double3 {
   }
 
   inline double dot(double3 rhs) {
-    double3 out = (*this) * rhs;
-    return (out.xxx() + out.yyy() + out.zzz()).x();
+    return dot_pd<3>(simd, rhs.simd);
   }
 
   inline double3(double x, double y, double z) {
@@ -247,8 +364,7 @@ struct double3 {
   }
 
   inline double3(double2 xy, double z = 0.f) {
-    simd = simde_mm256_shuffle_pd(xy.simd, double2(z).simd,
-                                  SIMDE_MM_SHUFFLE(1, 0, 1, 0));
+    simd = simde_mm256_blend_pd(xy.simd, simde_mm256_set1_pd(z), 0b1100);
   }
 
   inline double3(double x, double2 yz) { (*this) = double3(yz, x).zxy(); }
@@ -257,13 +373,43 @@ struct double3 {
     return (zxy() * rhs - (*this) * rhs.zxy()).zxy();
   }
 
-#include "swizzles/double3_swizzles_decl"
+  template <int N> using swizzle_type = typename double_n<N>::type;
+
+  template <int X> inline double swizzle() {
+    static_assert(X < 3, "swizzle index out of range");
+    return simde_mm256_cvtsd_f64(swizzle_pd<X>(simd));
+  }
+
+  template <int X, int Y, int... I>
+  inline swizzle_type<2 + sizeof...(I)> swizzle() {
+    static_assert(X < 3 && Y < 3 && ((I < 3) && ...),
+                  "swizzle index out of range");
+    return swizzle_pd<X, Y, I...>(simd);
+  }
+
+  FONGE_SWIZZLES_3(FONGE_SWZ_ALIAS)
 
   inline double len2() { return dot(*this); }
 
-  inline double len() { return sqrtf(len2()); }
+  inline double len() { return sqrt(len2()); }
+
+  // 1 / len(), approximated (see approx.hpp).
+  inline double rcp_len() {
+    return simde_mm256_cvtsd_f64(rsqrt_nr_pd(simde_mm256_set1_pd(len2())));
+  }
 
-  inline double3 normalized() { return (*this) / len(); }
+  inline double3 normalized() {
+#if defined(FONGE_FAST_MATH)
+    return normalized_fast();
+#else
+    return (*this) / len();
+#endif
+  }
+
+  // normalized() with an approximate 1 / len() (see approx.hpp).
+  inline double3 normalized_fast() {
+    return simde_mm256_mul_pd(simd, rsqrt_nr_pd(simde_mm256_set1_pd(len2())));
+  }
 
   static inline double3 one() { return double3(1); }
 
@@ -300,6 +446,15 @@ static inline double3 operator/(double3 lhs, double rhs) {
   return lhs / double3(rhs);
 }
 
+// lhs / rhs with an approximate reciprocal (see approx.hpp).
+static inline double3 fast_div(double3 lhs, double3 rhs) {
+  return simde_mm256_mul_pd(lhs.simd, rcp_nr_pd(rhs.simd));
+}
+
+static inline double3 fast_div(double3 lhs, double rhs) {
+  return fast_div(lhs, double3(rhs));
+}
+
 struct double4 {
   inline double4(const double4 &other) : simd(other.simd) {}
 
@@ -320,7 +475,7 @@ struct double4 {
   inline double4(double x, double3 yzw) { (*this) = double4(yzw, x).wxyz(); }
 
   inline double4(double2 xy, double2 zw = double2()) {
-    simd = simde_mm256_blend_pd(xy.simd, zw.simd, 0b1100);
+    simd = simde_mm256_permute2f128_pd(xy.simd, zw.simd, 0x20);
   }
 
   inline double4(double2 xy, double z, double w) {
@@ -405,6 +560,10 @@ struct double4 {
 
   inline double4 abs() { return simde_x_mm256_abs_pd(simd); }
 
+  inline double4 min(double4 rhs) { return simde_mm256_min_pd(simd, rhs.simd); }
+
+  inline double4 max(double4 rhs) { return simde_mm256_max_pd(simd, rhs.simd); }
+
   inline uint32_t mask() { return simde_mm256_movemask_pd(simd) & 0b1111; }
 
   inline bool any() { return mask() != 0; }
@@ -418,8 +577,7 @@ struct double4 {
   }
 
   inline double dot(double4 rhs) {
-    double4 out = (*this) * rhs;
-    return (out.xxxx() + out.yyyy() + out.zzzz() + out.wwww()).x();
+    return dot_pd<4>(simd, rhs.simd);
   }
 
   inline double4 cross(double4 mhs, double4 rhs) {
@@ -429,13 +587,43 @@ struct double4 {
            double4(1, -1, 1, -1);
   }
 
-#include "swizzles/double4_swizzles_decl"
+  template <int N> using swizzle_type = typename double_n<N>::type;
+
+  template <int X> inline double swizzle() {
+    static_assert(X < 4, "swizzle index out of range");
+    return simde_mm256_cvtsd_f64(swizzle_pd<X>(simd));
+  }
+
+  template <int X, int Y, int... I>
+  inline swizzle_type<2 + sizeof...(I)> swizzle() {
+    static_assert(X < 4 && Y < 4 && ((I < 4) && ...),
+                  "swizzle index out of range");
+    return swizzle_pd<X, Y, I...>(simd);
+  }
+
+  FONGE_SWIZZLES_4(FONGE_SWZ_ALIAS)
 
   inline double len2() { return dot(*this); }
 
-  inline double len() { return sqrtf(len2()); }
+  inline double len() { return sqrt(len2()); }
+
+  // 1 / len(), approximated (see approx.hpp).
+  inline double rcp_len() {
+    return simde_mm256_cvtsd_f64(rsqrt_nr_pd(simde_mm256_set1_pd(len2())));
+  }
+
+  inline double4 normalized() {
+#if defined(FONGE_FAST_MATH)
+    return normalized_fast();
+#else
+    return (*this) / len();
+#endif
+  }
 
-  inline double4 normalized() { return (*this) / len(); }
+  // normalized() with an approximate 1 / len() (see approx.hpp).
+  inline double4 normalized_fast() {
+    return simde_mm256_mul_pd(simd, rsqrt_nr_pd(simde_mm256_set1_pd(len2())));
+  }
 
   static inline double4 one() { return double4(1); }
 
@@ -474,8 +662,13 @@ static inline double4 operator/(double4 lhs, double rhs) {
   return lhs / double4(rhs);
 }
 
-#include "swizzles/double2_swizzles_impl"
-#include "swizzles/double3_swizzles_impl"
-#include "swizzles/double4_swizzles_impl"
+// lhs / rhs with an approximate reciprocal (see approx.hpp).
+static inline double4 fast_div(double4 lhs, double4 rhs) {
+  return simde_mm256_mul_pd(lhs.simd, rcp_nr_pd(rhs.simd));
+}
+
+static inline double4 fast_div(double4 lhs, double rhs) {
+  return fast_div(lhs, double4(rhs));
+}
 
 } // namespace fonge
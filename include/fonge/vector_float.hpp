@@ -1,5 +1,8 @@
 #pragma once
 
+#include "approx.hpp"
+#include "reduce.hpp"
+#include "swizzle.hpp"
 #include <simde/x86/avx2.h>
 
 namespace fonge {
@@ -12,6 +15,41 @@ struct float2;
 struct float3;
 struct float4;
 
+template <int N> struct float_n;
+template <> struct float_n<1> {
+  typedef float type;
+};
+template <> struct float_n<2> {
+  typedef float2 type;
+};
+template <> struct float_n<3> {
+  typedef float3 type;
+};
+template <> struct float_n<4> {
+  typedef float4 type;
+};
+
+// (v[X], v[Y], v[Z], v[W]) with the cheapest instruction for the pattern. -1
+// marks a lane whose value does not matter.
+template <int X, int Y = -1, int Z = -1, int W = -1>
+static inline simde__m128 swizzle_ps(simde__m128 v) {
+  if constexpr (swizzle_matches(X, Y, Z, W, 0, 1, 2, 3)) {
+    return v;
+  } else if constexpr (swizzle_matches(X, Y, Z, W, 0, 1, 0, 1)) {
+    return simde_mm_movelh_ps(v, v);
+  } else if constexpr (swizzle_matches(X, Y, Z, W, 2, 3, 2, 3)) {
+    return simde_mm_movehl_ps(v, v);
+  } else if constexpr (swizzle_matches(X, Y, Z, W, 0, 0, 2, 2)) {
+    return simde_mm_moveldup_ps(v);
+  } else if constexpr (swizzle_matches(X, Y, Z, W, 1, 1, 3, 3)) {
+    return simde_mm_movehdup_ps(v);
+  } else {
+    return permute_ps_custom(
+        v, SIMDE_MM_SHUFFLE(swizzle_lane(W, 3), swizzle_lane(Z, 2),
+                            swizzle_lane(Y, 1), swizzle_lane(X, 0)));
+  }
+}
+
 struct float2 {
   inline float2(float all) : simd(simde_mm_set1_ps(all)) {}
 
@@ -87,6 +125,10 @@ struct float2 {
 
   inline float2 abs() { return simde_x_mm_abs_ps(simd); }
 
+  inline float2 min(float2 rhs) { return simde_mm_min_ps(simd, rhs.simd); }
+
+  inline float2 max(float2 rhs) { return simde_mm_max_ps(simd, rhs.simd); }
+
   inline bool any() { return mask() != 0; }
 
   inline bool all() { return mask() == 0b11; }
@@ -98,18 +140,48 @@ struct float2 {
   }
 
   inline float dot(float2 rhs) {
-    return simde_mm_cvtss_f32(simde_mm_dp_ps(simd, rhs.simd, 0b00111111));
+    return dot_ps<2>(simd, rhs.simd);
   }
 
   float2 cross() { return yx() * float2(1, -1); }
 
-#include "swizzles/float2_swizzles_decl"
+  template <int N> using swizzle_type = typename float_n<N>::type;
+
+  template <int X> inline float swizzle() {
+    static_assert(X < 2, "swizzle index out of range");
+    return simde_mm_cvtss_f32(swizzle_ps<X>(simd));
+  }
+
+  template <int X, int Y, int... I>
+  inline swizzle_type<2 + sizeof...(I)> swizzle() {
+    static_assert(X < 2 && Y < 2 && ((I < 2) && ...),
+                  "swizzle index out of range");
+    return swizzle_ps<X, Y, I...>(simd);
+  }
+
+  FONGE_SWIZZLES_2(FONGE_SWZ_ALIAS)
 
   inline float len2() { return dot(*this); }
 
   inline float len() { return sqrtf(len2()); }
 
-  inline float2 normalized() { return (*this) / len(); }
+  // 1 / len(), approximated (see approx.hpp).
+  inline float rcp_len() {
+    return simde_mm_cvtss_f32(rsqrt_nr_ps(simde_mm_set1_ps(len2())));
+  }
+
+  inline float2 normalized() {
+#if defined(FONGE_FAST_MATH)
+    return normalized_fast();
+#else
+    return (*this) / len();
+#endif
+  }
+
+  // normalized() with an approximate 1 / len() (see approx.hpp).
+  inline float2 normalized_fast() {
+    return simde_mm_mul_ps(simd, rsqrt_nr_ps(simde_mm_set1_ps(len2())));
+  }
 
   static inline float2 one() { return float2(1); }
 
@@ -140,6 +212,15 @@ static inline float2 operator/(float2 lhs, float rhs) {
   return lhs / float2(rhs);
 }
 
+// lhs / rhs with an approximate reciprocal (see approx.hpp).
+static inline float2 fast_div(float2 lhs, float2 rhs) {
+  return simde_mm_mul_ps(lhs.simd, rcp_nr_ps(rhs.simd));
+}
+
+static inline float2 fast_div(float2 lhs, float rhs) {
+  return fast_div(lhs, float2(rhs));
+}
+
 struct float3 {
   inline float3(float all) : simd(simde_mm_set1_ps(all)) {}
 
@@ -211,6 +292,10 @@ struct float3 {
 
   inline float3 abs() { return simde_x_mm_abs_ps(simd); }
 
+  inline float3 min(float3 rhs) { return simde_mm_min_ps(simd, rhs.simd); }
+
+  inline float3 max(float3 rhs) { return simde_mm_max_ps(simd, rhs.simd); }
+
   inline bool any() { return mask() != 0; }
 
   inline bool all() { return mask() == 0b111; }
@@ -222,7 +307,7 @@ struct float3 {
   }
 
   inline float dot(float3 rhs) {
-    return simde_mm_cvtss_f32(simde_mm_dp_ps(simd, rhs.simd, 0b01111111));
+    return dot_ps<3>(simd, rhs.simd);
   }
 
   inline float3(float x, float y, float z) {
@@ -244,13 +329,43 @@ struct float3 {
     return (zxy() * rhs - (*this) * rhs.zxy()).zxy();
   }
 
-#include "swizzles/float3_swizzles_decl"
+  template <int N> using swizzle_type = typename float_n<N>::type;
+
+  template <int X> inline float swizzle() {
+    static_assert(X < 3, "swizzle index out of range");
+    return simde_mm_cvtss_f32(swizzle_ps<X>(simd));
+  }
+
+  template <int X, int Y, int... I>
+  inline swizzle_type<2 + sizeof...(I)> swizzle() {
+    static_assert(X < 3 && Y < 3 && ((I < 3) && ...),
+                  "swizzle index out of range");
+    return swizzle_ps<X, Y, I...>(simd);
+  }
+
+  FONGE_SWIZZLES_3(FONGE_SWZ_ALIAS)
 
   inline float len2() { return dot(*this); }
 
   inline float len() { return sqrtf(len2()); }
 
-  inline float3 normalized() { return (*this) / len(); }
+  // 1 / len(), approximated (see approx.hpp).
+  inline float rcp_len() {
+    return simde_mm_cvtss_f32(rsqrt_nr_ps(simde_mm_set1_ps(len2())));
+  }
+
+  inline float3 normalized() {
+#if defined(FONGE_FAST_MATH)
+    return normalized_fast();
+#else
+    return (*this) / len();
+#endif
+  }
+
+  // normalized() with an approximate 1 / len() (see approx.hpp).
+  inline float3 normalized_fast() {
+    return simde_mm_mul_ps(simd, rsqrt_nr_ps(simde_mm_set1_ps(len2())));
+  }
 
   static inline float3 one() { return float3(1); }
 
@@ -287,6 +402,15 @@ static inline float3 operator/(float3 lhs, float rhs) {
   return lhs / float3(rhs);
 }
 
+// lhs / rhs with an approximate reciprocal (see approx.hpp).
+static inline float3 fast_div(float3 lhs, float3 rhs) {
+  return simde_mm_mul_ps(lhs.simd, rcp_nr_ps(rhs.simd));
+}
+
+static inline float3 fast_div(float3 lhs, float rhs) {
+  return fast_div(lhs, float3(rhs));
+}
+
 struct float4 {
   inline float4(const float4 &other) : simd(other.simd) {}
 
@@ -391,6 +515,10 @@ struct float4 {
 
   inline float4 abs() { return simde_x_mm_abs_ps(simd); }
 
+  inline float4 min(float4 rhs) { return simde_mm_min_ps(simd, rhs.simd); }
+
+  inline float4 max(float4 rhs) { return simde_mm_max_ps(simd, rhs.simd); }
+
   inline bool any() { return mask() != 0; }
 
   inline bool all() { return mask() >= 0b1111; }
@@ -402,7 +530,7 @@ struct float4 {
   }
 
   inline float dot(float4 rhs) {
-    return simde_mm_cvtss_f32(simde_mm_dp_ps(simd, rhs.simd, 0b11111111));
+    return dot_ps<4>(simd, rhs.simd);
   }
 
   inline float4 cross(float4 mhs, float4 rhs) {
@@ -418,13 +546,43 @@ struct float4 {
            float4(1, -1, 1, -1);
   }
 
-#include "swizzles/float4_swizzles_decl"
+  template <int N> using swizzle_type = typename float_n<N>::type;
+
+  template <int X> inline float swizzle() {
+    static_assert(X < 4, "swizzle index out of range");
+    return simde_mm_cvtss_f32(swizzle_ps<X>(simd));
+  }
+
+  template <int X, int Y, int... I>
+  inline swizzle_type<2 + sizeof...(I)> swizzle() {
+    static_assert(X < 4 && Y < 4 && ((I < 4) && ...),
+                  "swizzle index out of range");
+    return swizzle_ps<X, Y, I...>(simd);
+  }
+
+  FONGE_SWIZZLES_4(FONGE_SWZ_ALIAS)
 
   inline float len2() { return dot(*this); }
 
   inline float len() { return sqrtf(len2()); }
 
-  inline float4 normalized() { return (*this) / len(); }
+  // 1 / len(), approximated (see approx.hpp).
+  inline float rcp_len() {
+    return simde_mm_cvtss_f32(rsqrt_nr_ps(simde_mm_set1_ps(len2())));
+  }
+
+  inline float4 normalized() {
+#if defined(FONGE_FAST_MATH)
+    return normalized_fast();
+#else
+    return (*this) / len();
+#endif
+  }
+
+  // normalized() with an approximate 1 / len() (see approx.hpp).
+  inline float4 normalized_fast() {
+    return simde_mm_mul_ps(simd, rsqrt_nr_ps(simde_mm_set1_ps(len2())));
+  }
 
   static inline float4 one() { return float4(1); }
 
@@ -459,8 +617,17 @@ static inline float4 operator*(float lhs, float4 rhs) {
   return float4(lhs) * rhs;
 }
 
-#include "swizzles/float2_swizzles_impl"
-#include "swizzles/float3_swizzles_impl"
-#include "swizzles/float4_swizzles_impl"
+static inline float4 operator/(float4 lhs, float rhs) {
+  return lhs / float4(rhs);
+}
+
+// lhs / rhs with an approximate reciprocal (see approx.hpp).
+static inline float4 fast_div(float4 lhs, float4 rhs) {
+  return simde_mm_mul_ps(lhs.simd, rcp_nr_ps(rhs.simd));
+}
+
+static inline float4 fast_div(float4 lhs, float rhs) {
+  return fast_div(lhs, float4(rhs));
+}
 
 } // namespace fonge
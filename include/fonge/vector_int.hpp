@@ -0,0 +1,610 @@
+#pragma once
+
+#include "swizzle.hpp"
+#include "vector_float.hpp"
+#include <cstdint>
+
+namespace fonge {
+
+typedef int int1;
+struct int2;
+struct int3;
+struct int4;
+
+template <int N> struct int_n;
+template <> struct int_n<1> {
+  typedef int type;
+};
+template <> struct int_n<2> {
+  typedef int2 type;
+};
+template <> struct int_n<3> {
+  typedef int3 type;
+};
+template <> struct int_n<4> {
+  typedef int4 type;
+};
+
+// (v[X], v[Y], v[Z], v[W]); -1 marks a lane whose value does not matter.
+template <int X, int Y = -1, int Z = -1, int W = -1>
+static inline simde__m128i swizzle_epi32(simde__m128i v) {
+  if constexpr (swizzle_matches(X, Y, Z, W, 0, 1, 2, 3)) {
+    return v;
+  } else {
+    return simde_mm_shuffle_epi32(
+        v, SIMDE_MM_SHUFFLE(swizzle_lane(W, 3), swizzle_lane(Z, 2),
+                            swizzle_lane(Y, 1), swizzle_lane(X, 0)));
+  }
+}
+
+struct int2 {
+  inline int2(int all) : simd(simde_mm_set1_epi32(all)) {}
+
+  inline int2(simde__m128i vec) : simd(vec) {}
+
+  inline int2(int x, int y) { simd = simde_mm_setr_epi32(x, y, 0, 0); }
+
+  inline int2() : simd(simde_mm_setzero_si128()) {}
+
+  inline int2 operator+(int2 rhs) {
+    return simde_mm_add_epi32(simd, rhs.simd);
+  }
+
+  inline int2 operator-(int2 rhs) {
+    return simde_mm_sub_epi32(simd, rhs.simd);
+  }
+
+  inline int2 operator*(int2 rhs) {
+    return simde_mm_mullo_epi32(simd, rhs.simd);
+  }
+
+  inline int2 operator&(int2 rhs) {
+    return simde_mm_and_si128(simd, rhs.simd);
+  }
+
+  inline int2 operator|(int2 rhs) {
+    return simde_mm_or_si128(simd, rhs.simd);
+  }
+
+  inline int2 operator^(int2 rhs) {
+    return simde_mm_xor_si128(simd, rhs.simd);
+  }
+
+  inline int2 operator<<(int rhs) {
+    return simde_mm_sll_epi32(simd, simde_mm_cvtsi32_si128(rhs));
+  }
+
+  // Arithmetic shift.
+  inline int2 operator>>(int rhs) {
+    return simde_mm_sra_epi32(simd, simde_mm_cvtsi32_si128(rhs));
+  }
+
+  inline int2 operator<<(int2 rhs) {
+    return simde_mm_sllv_epi32(simd, rhs.simd);
+  }
+
+  inline int2 operator>>(int2 rhs) {
+    return simde_mm_srav_epi32(simd, rhs.simd);
+  }
+
+  inline int2 &operator+=(int2 rhs) {
+    (*this) = (*this) + rhs;
+    return *this;
+  }
+
+  inline int2 &operator-=(int2 rhs) {
+    (*this) = (*this) - rhs;
+    return *this;
+  }
+
+  inline int2 &operator*=(int2 rhs) {
+    (*this) = (*this) * rhs;
+    return *this;
+  }
+
+  inline int2 &operator<<=(int rhs) {
+    (*this) = (*this) << rhs;
+    return *this;
+  }
+
+  inline int2 &operator>>=(int rhs) {
+    (*this) = (*this) >> rhs;
+    return *this;
+  }
+
+  inline bool operator==(int2 rhs) {
+    return int2(simde_mm_cmpeq_epi32(simd, rhs.simd)).all();
+  }
+
+  inline bool operator!=(int2 rhs) {
+    return !int2(simde_mm_cmpeq_epi32(simd, rhs.simd)).any();
+  }
+
+  inline bool operator<(int2 rhs) {
+    return int2(simde_mm_cmplt_epi32(simd, rhs.simd)).all();
+  }
+
+  inline bool operator<=(int2 rhs) {
+    return !int2(simde_mm_cmpgt_epi32(simd, rhs.simd)).any();
+  }
+
+  inline bool operator>=(int2 rhs) {
+    return !int2(simde_mm_cmplt_epi32(simd, rhs.simd)).any();
+  }
+
+  inline bool operator>(int2 rhs) {
+    return int2(simde_mm_cmpgt_epi32(simd, rhs.simd)).all();
+  }
+
+  inline uint32_t mask() {
+    return simde_mm_movemask_ps(simde_mm_castsi128_ps(simd)) & 0b11;
+  }
+
+  inline int2 operator-() {
+    return simde_mm_sub_epi32(simde_mm_setzero_si128(), simd);
+  }
+
+  inline int2 operator~() {
+    return simde_mm_xor_si128(simd, simde_mm_set1_epi32(-1));
+  }
+
+  inline int2 abs() { return simde_mm_abs_epi32(simd); }
+
+  inline int2 min(int2 rhs) { return simde_mm_min_epi32(simd, rhs.simd); }
+
+  inline int2 max(int2 rhs) { return simde_mm_max_epi32(simd, rhs.simd); }
+
+  inline bool any() { return mask() != 0; }
+
+  inline bool all() { return mask() == 0b11; }
+
+  inline int operator[](size_t i) {
+    alignas(16) int out[4];
+    simde_mm_store_si128(reinterpret_cast<simde__m128i *>(out), simd);
+    return out[i];
+  }
+
+  inline int dot(int2 rhs) {
+    int2 prod = (*this) * rhs;
+    return prod.x() + prod.y();
+  }
+
+  template <int N> using swizzle_type = typename int_n<N>::type;
+
+  template <int X> inline int swizzle() {
+    static_assert(X < 2, "swizzle index out of range");
+    if constexpr (X == 0) {
+      return simde_mm_cvtsi128_si32(simd);
+    } else {
+      return simde_mm_extract_epi32(simd, X);
+    }
+  }
+
+  template <int X, int Y, int... I>
+  inline swizzle_type<2 + sizeof...(I)> swizzle() {
+    static_assert(X < 2 && Y < 2 && ((I < 2) && ...),
+                  "swizzle index out of range");
+    return swizzle_epi32<X, Y, I...>(simd);
+  }
+
+  FONGE_SWIZZLES_2(FONGE_SWZ_ALIAS)
+
+  // Rounds with the current rounding mode (nearest by default).
+  static inline int2 cvt(float2 v) { return simde_mm_cvtps_epi32(v.simd); }
+
+  // Rounds toward zero.
+  static inline int2 cvtt(float2 v) { return simde_mm_cvttps_epi32(v.simd); }
+
+  // Rounds toward negative infinity, e.g. to find the grid cell of a point.
+  static inline int2 floor(float2 v) {
+    return simde_mm_cvttps_epi32(simde_mm_floor_ps(v.simd));
+  }
+
+  inline float2 to_float() { return simde_mm_cvtepi32_ps(simd); }
+
+  static inline int2 one() { return int2(1); }
+
+  static inline int2 x_axis() { return int2(1, 0); }
+
+  static inline int2 y_axis() { return int2(0, 1); }
+
+  simde__m128i simd;
+};
+
+static inline int2 operator*(int2 lhs, int rhs) { return lhs * int2(rhs); }
+
+static inline int2 operator*(int lhs, int2 rhs) { return int2(lhs) * rhs; }
+
+struct int3 {
+  inline int3(int all) : simd(simde_mm_set1_epi32(all)) {}
+
+  inline int3(simde__m128i vec) : simd(vec) {}
+
+  inline int3(int x, int y, int z) { simd = simde_mm_setr_epi32(x, y, z, 0); }
+
+  inline int3() : simd(simde_mm_setzero_si128()) {}
+
+  inline int3(int2 xy, int z = 0) {
+    simd = simde_mm_unpacklo_epi64(xy.simd, simde_mm_set1_epi32(z));
+  }
+
+  inline int3(int x, int2 yz) {
+    simd = simde_mm_shuffle_epi32(
+        simde_mm_unpacklo_epi64(yz.simd, simde_mm_set1_epi32(x)),
+        SIMDE_MM_SHUFFLE(3, 1, 0, 2));
+  }
+
+  inline int3 operator+(int3 rhs) {
+    return simde_mm_add_epi32(simd, rhs.simd);
+  }
+
+  inline int3 operator-(int3 rhs) {
+    return simde_mm_sub_epi32(simd, rhs.simd);
+  }
+
+  inline int3 operator*(int3 rhs) {
+    return simde_mm_mullo_epi32(simd, rhs.simd);
+  }
+
+  inline int3 operator&(int3 rhs) {
+    return simde_mm_and_si128(simd, rhs.simd);
+  }
+
+  inline int3 operator|(int3 rhs) {
+    return simde_mm_or_si128(simd, rhs.simd);
+  }
+
+  inline int3 operator^(int3 rhs) {
+    return simde_mm_xor_si128(simd, rhs.simd);
+  }
+
+  inline int3 operator<<(int rhs) {
+    return simde_mm_sll_epi32(simd, simde_mm_cvtsi32_si128(rhs));
+  }
+
+  // Arithmetic shift.
+  inline int3 operator>>(int rhs) {
+    return simde_mm_sra_epi32(simd, simde_mm_cvtsi32_si128(rhs));
+  }
+
+  inline int3 operator<<(int3 rhs) {
+    return simde_mm_sllv_epi32(simd, rhs.simd);
+  }
+
+  inline int3 operator>>(int3 rhs) {
+    return simde_mm_srav_epi32(simd, rhs.simd);
+  }
+
+  inline int3 &operator+=(int3 rhs) {
+    (*this) = (*this) + rhs;
+    return *this;
+  }
+
+  inline int3 &operator-=(int3 rhs) {
+    (*this) = (*this) - rhs;
+    return *this;
+  }
+
+  inline int3 &operator*=(int3 rhs) {
+    (*this) = (*this) * rhs;
+    return *this;
+  }
+
+  inline int3 &operator<<=(int rhs) {
+    (*this) = (*this) << rhs;
+    return *this;
+  }
+
+  inline int3 &operator>>=(int rhs) {
+    (*this) = (*this) >> rhs;
+    return *this;
+  }
+
+  inline bool operator==(int3 rhs) {
+    return int3(simde_mm_cmpeq_epi32(simd, rhs.simd)).all();
+  }
+
+  inline bool operator!=(int3 rhs) {
+    return !int3(simde_mm_cmpeq_epi32(simd, rhs.simd)).any();
+  }
+
+  inline bool operator<(int3 rhs) {
+    return int3(simde_mm_cmplt_epi32(simd, rhs.simd)).all();
+  }
+
+  inline bool operator<=(int3 rhs) {
+    return !int3(simde_mm_cmpgt_epi32(simd, rhs.simd)).any();
+  }
+
+  inline bool operator>=(int3 rhs) {
+    return !int3(simde_mm_cmplt_epi32(simd, rhs.simd)).any();
+  }
+
+  inline bool operator>(int3 rhs) {
+    return int3(simde_mm_cmpgt_epi32(simd, rhs.simd)).all();
+  }
+
+  inline uint32_t mask() {
+    return simde_mm_movemask_ps(simde_mm_castsi128_ps(simd)) & 0b111;
+  }
+
+  inline int3 operator-() {
+    return simde_mm_sub_epi32(simde_mm_setzero_si128(), simd);
+  }
+
+  inline int3 operator~() {
+    return simde_mm_xor_si128(simd, simde_mm_set1_epi32(-1));
+  }
+
+  inline int3 abs() { return simde_mm_abs_epi32(simd); }
+
+  inline int3 min(int3 rhs) { return simde_mm_min_epi32(simd, rhs.simd); }
+
+  inline int3 max(int3 rhs) { return simde_mm_max_epi32(simd, rhs.simd); }
+
+  inline bool any() { return mask() != 0; }
+
+  inline bool all() { return mask() == 0b111; }
+
+  inline int operator[](size_t i) {
+    alignas(16) int out[4];
+    simde_mm_store_si128(reinterpret_cast<simde__m128i *>(out), simd);
+    return out[i];
+  }
+
+  inline int dot(int3 rhs) {
+    int3 prod = (*this) * rhs;
+    return prod.x() + prod.y() + prod.z();
+  }
+
+  template <int N> using swizzle_type = typename int_n<N>::type;
+
+  template <int X> inline int swizzle() {
+    static_assert(X < 3, "swizzle index out of range");
+    if constexpr (X == 0) {
+      return simde_mm_cvtsi128_si32(simd);
+    } else {
+      return simde_mm_extract_epi32(simd, X);
+    }
+  }
+
+  template <int X, int Y, int... I>
+  inline swizzle_type<2 + sizeof...(I)> swizzle() {
+    static_assert(X < 3 && Y < 3 && ((I < 3) && ...),
+                  "swizzle index out of range");
+    return swizzle_epi32<X, Y, I...>(simd);
+  }
+
+  FONGE_SWIZZLES_3(FONGE_SWZ_ALIAS)
+
+  // Rounds with the current rounding mode (nearest by default).
+  static inline int3 cvt(float3 v) { return simde_mm_cvtps_epi32(v.simd); }
+
+  // Rounds toward zero.
+  static inline int3 cvtt(float3 v) { return simde_mm_cvttps_epi32(v.simd); }
+
+  // Rounds toward negative infinity, e.g. to find the grid cell of a point.
+  static inline int3 floor(float3 v) {
+    return simde_mm_cvttps_epi32(simde_mm_floor_ps(v.simd));
+  }
+
+  inline float3 to_float() { return simde_mm_cvtepi32_ps(simd); }
+
+  static inline int3 one() { return int3(1); }
+
+  static inline int3 x_axis() { return int3(1, 0, 0); }
+
+  static inline int3 y_axis() { return int3(0, 1, 0); }
+
+  static inline int3 z_axis() { return int3(0, 0, 1); }
+
+  simde__m128i simd;
+};
+
+static inline int3 operator*(int3 lhs, int rhs) { return lhs * int3(rhs); }
+
+static inline int3 operator*(int lhs, int3 rhs) { return int3(lhs) * rhs; }
+
+struct int4 {
+  inline int4(int all) : simd(simde_mm_set1_epi32(all)) {}
+
+  inline int4(simde__m128i vec) : simd(vec) {}
+
+  inline int4(int x, int y, int z, int w) {
+    simd = simde_mm_setr_epi32(x, y, z, w);
+  }
+
+  inline int4() : simd(simde_mm_setzero_si128()) {}
+
+  inline int4(int3 xyz, int w = 0) {
+    simd = simde_mm_insert_epi32(xyz.simd, w, 3);
+  }
+
+  inline int4(int x, int3 yzw) { (*this) = int4(yzw, x).wxyz(); }
+
+  inline int4(int2 xy, int2 zw = int2()) {
+    simd = simde_mm_unpacklo_epi64(xy.simd, zw.simd);
+  }
+
+  inline int4(int2 xy, int z, int w) { (*this) = int4(xy, int2(z, w)); }
+
+  inline int4(int x, int2 yz, int w) { (*this) = int4(yz, x, w).zxyw(); }
+
+  inline int4(int x, int y, int2 zw) { (*this) = int4(int2(x, y), zw); }
+
+  inline int4 operator+(int4 rhs) {
+    return simde_mm_add_epi32(simd, rhs.simd);
+  }
+
+  inline int4 operator-(int4 rhs) {
+    return simde_mm_sub_epi32(simd, rhs.simd);
+  }
+
+  inline int4 operator*(int4 rhs) {
+    return simde_mm_mullo_epi32(simd, rhs.simd);
+  }
+
+  inline int4 operator&(int4 rhs) {
+    return simde_mm_and_si128(simd, rhs.simd);
+  }
+
+  inline int4 operator|(int4 rhs) {
+    return simde_mm_or_si128(simd, rhs.simd);
+  }
+
+  inline int4 operator^(int4 rhs) {
+    return simde_mm_xor_si128(simd, rhs.simd);
+  }
+
+  inline int4 operator<<(int rhs) {
+    return simde_mm_sll_epi32(simd, simde_mm_cvtsi32_si128(rhs));
+  }
+
+  // Arithmetic shift.
+  inline int4 operator>>(int rhs) {
+    return simde_mm_sra_epi32(simd, simde_mm_cvtsi32_si128(rhs));
+  }
+
+  inline int4 operator<<(int4 rhs) {
+    return simde_mm_sllv_epi32(simd, rhs.simd);
+  }
+
+  inline int4 operator>>(int4 rhs) {
+    return simde_mm_srav_epi32(simd, rhs.simd);
+  }
+
+  inline int4 &operator+=(int4 rhs) {
+    (*this) = (*this) + rhs;
+    return *this;
+  }
+
+  inline int4 &operator-=(int4 rhs) {
+    (*this) = (*this) - rhs;
+    return *this;
+  }
+
+  inline int4 &operator*=(int4 rhs) {
+    (*this) = (*this) * rhs;
+    return *this;
+  }
+
+  inline int4 &operator<<=(int rhs) {
+    (*this) = (*this) << rhs;
+    return *this;
+  }
+
+  inline int4 &operator>>=(int rhs) {
+    (*this) = (*this) >> rhs;
+    return *this;
+  }
+
+  inline bool operator==(int4 rhs) {
+    return int4(simde_mm_cmpeq_epi32(simd, rhs.simd)).all();
+  }
+
+  inline bool operator!=(int4 rhs) {
+    return !int4(simde_mm_cmpeq_epi32(simd, rhs.simd)).any();
+  }
+
+  inline bool operator<(int4 rhs) {
+    return int4(simde_mm_cmplt_epi32(simd, rhs.simd)).all();
+  }
+
+  inline bool operator<=(int4 rhs) {
+    return !int4(simde_mm_cmpgt_epi32(simd, rhs.simd)).any();
+  }
+
+  inline bool operator>=(int4 rhs) {
+    return !int4(simde_mm_cmplt_epi32(simd, rhs.simd)).any();
+  }
+
+  inline bool operator>(int4 rhs) {
+    return int4(simde_mm_cmpgt_epi32(simd, rhs.simd)).all();
+  }
+
+  inline uint32_t mask() {
+    return simde_mm_movemask_ps(simde_mm_castsi128_ps(simd)) & 0b1111;
+  }
+
+  inline int4 operator-() {
+    return simde_mm_sub_epi32(simde_mm_setzero_si128(), simd);
+  }
+
+  inline int4 operator~() {
+    return simde_mm_xor_si128(simd, simde_mm_set1_epi32(-1));
+  }
+
+  inline int4 abs() { return simde_mm_abs_epi32(simd); }
+
+  inline int4 min(int4 rhs) { return simde_mm_min_epi32(simd, rhs.simd); }
+
+  inline int4 max(int4 rhs) { return simde_mm_max_epi32(simd, rhs.simd); }
+
+  inline bool any() { return mask() != 0; }
+
+  inline bool all() { return mask() == 0b1111; }
+
+  inline int operator[](size_t i) {
+    alignas(16) int out[4];
+    simde_mm_store_si128(reinterpret_cast<simde__m128i *>(out), simd);
+    return out[i];
+  }
+
+  inline int dot(int4 rhs) {
+    simde__m128i prod = simde_mm_mullo_epi32(simd, rhs.simd);
+    prod = simde_mm_add_epi32(prod, swizzle_epi32<2, 3>(prod));
+    return simde_mm_cvtsi128_si32(
+        simde_mm_add_epi32(prod, swizzle_epi32<1>(prod)));
+  }
+
+  template <int N> using swizzle_type = typename int_n<N>::type;
+
+  template <int X> inline int swizzle() {
+    static_assert(X < 4, "swizzle index out of range");
+    if constexpr (X == 0) {
+      return simde_mm_cvtsi128_si32(simd);
+    } else {
+      return simde_mm_extract_epi32(simd, X);
+    }
+  }
+
+  template <int X, int Y, int... I>
+  inline swizzle_type<2 + sizeof...(I)> swizzle() {
+    static_assert(X < 4 && Y < 4 && ((I < 4) && ...),
+                  "swizzle index out of range");
+    return swizzle_epi32<X, Y, I...>(simd);
+  }
+
+  FONGE_SWIZZLES_4(FONGE_SWZ_ALIAS)
+
+  // Rounds with the current rounding mode (nearest by default).
+  static inline int4 cvt(float4 v) { return simde_mm_cvtps_epi32(v.simd); }
+
+  // Rounds toward zero.
+  static inline int4 cvtt(float4 v) { return simde_mm_cvttps_epi32(v.simd); }
+
+  // Rounds toward negative infinity, e.g. to find the grid cell of a point.
+  static inline int4 floor(float4 v) {
+    return simde_mm_cvttps_epi32(simde_mm_floor_ps(v.simd));
+  }
+
+  inline float4 to_float() { return simde_mm_cvtepi32_ps(simd); }
+
+  static inline int4 one() { return int4(1); }
+
+  static inline int4 x_axis() { return int4(1, 0, 0, 0); }
+
+  static inline int4 y_axis() { return int4(0, 1, 0, 0); }
+
+  static inline int4 z_axis() { return int4(0, 0, 1, 0); }
+
+  static inline int4 w_axis() { return int4(0, 0, 0, 1); }
+
+  simde__m128i simd;
+};
+
+static inline int4 operator*(int4 lhs, int rhs) { return lhs * int4(rhs); }
+
+static inline int4 operator*(int lhs, int4 rhs) { return int4(lhs) * rhs; }
+
+} // namespace fonge
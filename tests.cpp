@@ -4,11 +4,54 @@
 #include <fonge/quaternion_double.hpp>
 #include <fonge/constants.hpp>
 #include <fonge/matrix_double.hpp>
+#include <fonge/matrix_float.hpp>
+#include <fonge/soa_float.hpp>
+#include <fonge/packet_float.hpp>
+#include <fonge/transforms.hpp>
+#include <fonge/vector_int.hpp>
+#include <fonge/quaternion_batch.hpp>
+#include <fonge/dual_quaternion_float.hpp>
+#include <fonge/dual_quaternion_double.hpp>
+#include <fonge/pose_blend.hpp>
+#include <fonge/common_ops.hpp>
+#include <fonge/half.hpp>
+#include <fonge/compress.hpp>
+#include <fonge/packed.hpp>
+#include <fonge/mapped_file.hpp>
+#include <fonge/frustum.hpp>
+#include <fonge/bvh.hpp>
+#include <fonge/ray.hpp>
+#include <fonge/overlap.hpp>
+#include <fonge/spatial_grid.hpp>
+#include <fonge/sweep_prune.hpp>
 
+#include <algorithm>
 #include <assert.h>
+#include <stdio.h>
 
 using namespace fonge;
 
+static const float x8_angles[8] = {-7, -1.5f, -0.1f, 0, 0.5f, 2, 3.2f, 90};
+
+// Checks swizzle<X, Y, Z, W>() against the lanes for every pattern from I on.
+template <int I = 0> bool check_swizzles4() {
+    constexpr int x = I & 3, y = (I >> 2) & 3, z = (I >> 4) & 3, w = I >> 6;
+    float4 f(1, 2, 3, 4);
+    double4 d(1, 2, 3, 4);
+    int4 n(1, 2, 3, 4);
+    bool ok = f.swizzle<x, y, z, w>() == float4(f[x], f[y], f[z], f[w]) &&
+              d.swizzle<x, y, z, w>() == double4(d[x], d[y], d[z], d[w]) &&
+              n.swizzle<x, y, z, w>() == int4(n[x], n[y], n[z], n[w]) &&
+              d.swizzle<x, y, z>() == double3(d[x], d[y], d[z]) &&
+              d.swizzle<x, y>() == double2(d[x], d[y]) &&
+              d.swizzle<x>() == d[x] && f.swizzle<w>() == f[w] &&
+              n.swizzle<z>() == n[z];
+    if constexpr (I < 255) {
+        return ok && check_swizzles4<I + 1>();
+    }
+    return ok;
+}
+
 int main(int argc, char *argv[]) {
     if (argc > 1) {
         switch (atoi(argv[1])) {
@@ -116,6 +159,1401 @@ int main(int argc, char *argv[]) {
                 auto tst = quat::from_angle_axis(90*DEG2RAD, float3::y_axis()).rotate(float3::x_axis());
                 break;
             }
+
+            case 4: {
+                // SoA bulk kernels must agree with the per-vector float3/float4 ops
+                float3 pa[13], pb[13];
+                float4 qa[13];
+                for (int i = 0; i < 13; i++) {
+                    pa[i] = float3(i + 1, 2 * i - 5, 3 - i);
+                    pb[i] = float3(7 - i, i * i, 1 + i);
+                    qa[i] = float4(pa[i], i - 2);
+                }
+                float3_soa a(pa, 13), b(pb, 13);
+                float4_soa q(qa, 13);
+                float3_soa sum = a + b, crs, nrm;
+                a.cross(b, crs);
+                a.normalized(nrm);
+                float dots[13], lens[13], qlens[13];
+                a.dot(b, dots);
+                a.len(lens);
+                q.len(qlens);
+                float3 back[13];
+                sum.to_aos(back);
+
+                assert(a.size() == 13);
+                assert(a.padded_size() % SOA_BLOCK == 0);
+                for (int i = 0; i < 13; i++) {
+                    assert((a[i] == pa[i]));
+                    assert((back[i] == pa[i] + pb[i]));
+                    assert((crs[i] == pa[i].cross(pb[i])));
+                    assert(dots[i] == pa[i].dot(pb[i]));
+                    assert(fabsf(lens[i] - pa[i].len()) < 1e-5f);
+                    assert(fabsf(qlens[i] - qa[i].len()) < 1e-5f);
+                    assert(((nrm[i] - pa[i].normalized()).abs() < float3(1e-6f)));
+                }
+                a *= 2;
+                assert((a[12] == pa[12] * 2));
+                break;
+            }
+
+            case 5: {
+                // x8/x16 packets must agree lane by lane with float3/float4
+                float3 pa[16], pb[16], out[16];
+                float4 qa[16];
+                for (int i = 0; i < 16; i++) {
+                    pa[i] = float3(i + 1, 3 - i, 2 * i);
+                    pb[i] = float3(i * i, 5, 1 - i);
+                    qa[i] = float4(pa[i], i);
+                }
+                float3x8 a = float3x8::load(pa), b = float3x8::load(pb);
+                float3x16 c = float3x16::load(pa), d = float3x16::load(pb);
+                float4x16 q = float4x16::load(qa);
+                float3x8 crs = a.cross(b);
+                float1x8 dots = a.dot(b);
+                float1x16 qlen = q.len();
+                (c.zxy() * d + c).store(out);
+                for (int i = 0; i < 8; i++) {
+                    assert((a[i] == pa[i]));
+                    assert((crs[i] == pa[i].cross(pb[i])));
+                    assert(dots[i] == pa[i].dot(pb[i]));
+                    assert((a.yzx()[i] == pa[i].yzx()));
+                    assert((a.xy()[i] == pa[i].xy()));
+                    assert((a.rgbr()[i] == pa[i].xyzx()));
+                    assert(a.z()[i] == pa[i].z());
+                }
+                for (int i = 0; i < 16; i++) {
+                    assert((out[i] == pa[i].zxy() * pb[i] + pa[i]));
+                    assert(fabsf(qlen[i] - qa[i].len()) < 1e-4f);
+                }
+                float3_soa soa(pa, 16);
+                float3x16::load(soa, 0).normalized().store(soa, 0);
+                assert(((soa[3] - pa[3].normalized()).abs() < float3(1e-6f)));
+
+                // scalar literals work as they do on float3
+                auto scaled = [](auto v) { return 2.0f * v * 3.0f / 4.0f; };
+                float3x8 sa = scaled(a);
+                float4x16 sq = scaled(q);
+                float2x8 sxy = scaled(a.xy());
+                for (int i = 0; i < 8; i++) {
+                    assert((sa[i] == scaled(pa[i])));
+                    assert((sq[i] == scaled(qa[i])));
+                    assert((sxy[i] == scaled(pa[i].xy())));
+                }
+
+                // division by a scalar is true division, not a reciprocal
+                float3x8 third = a / 3.0f, lanes = a / float1x8(3);
+                float4x16 qthird = q / 3.0f;
+                float2x8 xythird = a.xy() / 3.0f;
+                for (int i = 0; i < 8; i++) {
+                    assert((third[i] == pa[i] / 3.0f));
+                    assert((lanes[i] == pa[i] / 3.0f));
+                    assert((qthird[i] == qa[i] / 3.0f));
+                    assert((xythird[i] == pa[i].xy() / 3.0f));
+                }
+                break;
+            }
+
+            case 6: {
+                // batched transforms must agree with float4x4 * float4
+                float4x4 m(float4(1, 2, 0, 0), float4(0, 1, 3, 0),
+                           float4(2, 0, 1, 0), float4(5, -4, 7, 1));
+                float3 pts[11], tp[11], td[11];
+                float4 vs[11], tv[11];
+                float raw[11 * 5], traw[11 * 3];
+                for (int i = 0; i < 11; i++) {
+                    pts[i] = float3(i, 1 - i, 2 * i + 3);
+                    vs[i] = float4(pts[i], i % 3);
+                    raw[5 * i] = i;
+                    raw[5 * i + 1] = 1 - i;
+                    raw[5 * i + 2] = 2 * i + 3;
+                }
+                transform_points(m, pts, tp, 11);
+                transform_directions(m, pts, td, 11);
+                transform(m, vs, tv, 11);
+                transform_points(m, raw, 5 * sizeof(float), traw,
+                                 3 * sizeof(float), 11);
+                for (int i = 0; i < 11; i++) {
+                    assert((tp[i] == (m * float4(pts[i], 1)).xyz()));
+                    assert((td[i] == (m * float4(pts[i], 0)).xyz()));
+                    assert((tv[i] == m * vs[i]));
+                    assert((float3(traw[3 * i], traw[3 * i + 1], traw[3 * i + 2]) == tp[i]));
+                }
+                break;
+            }
+
+            case 7: {
+                // multiply_many must agree with float4x4 * float4x4
+                float4x4 a[5], b[5], pairs[5], left[5], right[5];
+                for (int i = 0; i < 5; i++) {
+                    a[i] = float4x4(float4(i, 1, 0, 2), float4(0, 2, i, 0),
+                                    float4(1, 0, 3, -i), float4(i, 4, 0, 1));
+                    b[i] = float4x4(float4(2, -i, 1, 0), float4(1, 0, 0, i),
+                                    float4(0, 3, i, 1), float4(5, 1, 2, 1));
+                }
+                multiply_many(a, b, pairs, 5);
+                multiply_many(a[1], b, left, 5);
+                multiply_many(a, b[2], right, 5);
+                for (int i = 0; i < 5; i++) {
+                    assert((pairs[i] == a[i] * b[i]));
+                    assert((left[i] == a[1] * b[i]));
+                    assert((right[i] == a[i] * b[2]));
+                }
+                multiply_many(a, b, a, 5);
+                assert((a[3] == pairs[3]));
+                break;
+            }
+
+            case 8: {
+                // general, affine and rigid inverses for float4x4/double4x4
+                quat q = quat::from_angle_axis(0.7f, float3(1, 2, 3).normalized());
+                float4x4 rot = q.rot_mat4_form();
+                float4x4 rigid(rot.col1, rot.col2, rot.col3, float4(3, -2, 5, 1));
+                float4x4 affine(float4(2, 1, 0, 0), float4(0, 3, 1, 0),
+                                float4(1, 0, 4, 0), float4(-1, 2, 7, 1));
+                float4x4 general(float4(2, 1, 0, 1), float4(0, 3, 1, 0),
+                                 float4(1, 0, 4, 2), float4(-1, 2, 7, 1));
+                float4x4 ms[3] = {rigid, affine, general};
+                for (int i = 0; i < 3; i++) {
+                    float4x4 p = ms[i] * ms[i].inverse();
+                    for (int c = 0; c < 4; c++) {
+                        assert(((p[c] - float4x4::identity()[c]).abs() < float4(1e-5f)));
+                    }
+                }
+                for (int c = 0; c < 4; c++) {
+                    assert(((affine.inverse_affine()[c] - affine.inverse()[c]).abs() < float4(1e-5f)));
+                    assert(((rigid.inverse_rigid()[c] - rigid.inverse()[c]).abs() < float4(1e-5f)));
+                }
+
+                double4x4 d(double4(2, 1, 0, 1), double4(0, 3, 1, 0),
+                            double4(1, 0, 4, 2), double4(-1, 2, 7, 1));
+                double4x4 da(double4(2, 1, 0, 0), double4(0, 3, 1, 0),
+                             double4(1, 0, 4, 0), double4(-1, 2, 7, 1));
+                double4x4 dr(double4(0, 1, 0, 0), double4(-1, 0, 0, 0),
+                             double4(0, 0, 1, 0), double4(4, 5, 6, 1));
+                double4x4 di = d.inverse(), dai = da.inverse_affine(),
+                          dri = dr.inverse_rigid();
+                assert((d.transposed().transposed() == d));
+                assert((d.transposed()[1] == double4(1, 3, 0, 2)));
+                for (int c = 0; c < 4; c++) {
+                    for (int r = 0; r < 4; r++) {
+                        double p = 0, pa = 0, pr = 0;
+                        for (int k = 0; k < 4; k++) {
+                            p += d[k][r] * di[c][k];
+                            pa += da[k][r] * dai[c][k];
+                            pr += dr[k][r] * dri[c][k];
+                        }
+                        assert(fabs(p - (c == r)) < 1e-12);
+                        assert(fabs(pa - (c == r)) < 1e-12);
+                        assert(fabs(pr - (c == r)) < 1e-12);
+                    }
+                }
+                break;
+            }
+
+            case 9: {
+                // float3x4/double3x4 against the equivalent 4x4 matrices
+                quat q = quat::from_angle_axis(1.1f, float3(-1, 2, 1).normalized());
+                affine3f a = trs3x4f(float3(1, -2, 3), q, float3(2, 1, 0.5f));
+                affine3f b = translation3x4f(float3(4, 5, 6)) * rotation3x4f(q);
+                float4x4 a4 = translation4f(float3(1, -2, 3)) * rotation4f(q) *
+                              scale4f(float4(2, 1, 0.5f, 1));
+                float4x4 b4(b);
+                float4x4 ab4 = a4 * b4, ab(a * b), ai(a.inverse()), bi(b.inverse_rigid());
+                for (int c = 0; c < 4; c++) {
+                    assert(((float4x4(a)[c] - a4[c]).abs() < float4(1e-5f)));
+                    assert(((ab[c] - ab4[c]).abs() < float4(1e-4f)));
+                    assert(((ai[c] - a4.inverse()[c]).abs() < float4(1e-4f)));
+                    assert(((bi[c] - b4.inverse()[c]).abs() < float4(1e-4f)));
+                }
+                assert((affine3f(a4) == a));
+                float3 p(0.5f, -1, 2);
+                assert((((a4 * float4(p, 1)).xyz() - a.transform_point(p)).abs() < float3(1e-5f)));
+                assert((((a4 * float4(p, 0)).xyz() - a.transform_direction(p)).abs() < float3(1e-5f)));
+                assert(((a.translation() - float3(1, -2, 3)).abs() < float3(1e-6f)));
+                assert(fabsf(a.determinant() - 1) < 1e-5f);
+                assert(sizeof(affine3f) == 48);
+
+                double3x4 d(double4(2, 0, 1, 4), double4(1, 3, 0, 5),
+                            double4(0, 1, 4, 6));
+                double3x4 di = d.inverse(), e = d * di, d2 = d * d;
+                double4x4 d4(d);
+                for (int r = 0; r < 3; r++) {
+                    for (int c = 0; c < 4; c++) {
+                        double p = c == 3 ? d[r][3] : 0;
+                        for (int k = 0; k < 3; k++) {
+                            p += d[r][k] * d[k][c];
+                        }
+                        assert(fabs(e[r][c] - (r == c)) < 1e-12);
+                        assert(fabs(d2[r][c] - p) < 1e-12);
+                        assert(d4[c][r] == d[r][c] && d4[c][3] == (c == 3));
+                    }
+                }
+                double3 dp = d.transform_point(double3(1, 2, 3));
+                assert(fabs(dp[0] - 9) < 1e-12 && fabs(dp[1] - 12) < 1e-12 &&
+                       fabs(dp[2] - 20) < 1e-12);
+                double3x4 dr(double4(0, -1, 0, 1), double4(1, 0, 0, 2),
+                             double4(0, 0, 1, 3));
+                double3x4 er = dr * dr.inverse_rigid();
+                for (int r = 0; r < 3; r++) {
+                    for (int c = 0; c < 4; c++) {
+                        assert(fabs(er[r][c] - (r == c)) < 1e-12);
+                    }
+                }
+                break;
+            }
+
+            case 10: {
+                // int2/int3/int4 arithmetic, comparisons and conversions
+                int3 a(1, -2, 3), b(4, 5, -6);
+                assert((a + b == int3(5, 3, -3)));
+                assert((a - b == int3(-3, -7, 9)));
+                assert((a * b == int3(4, -10, -18)));
+                assert((a * 2 == int3(2, -4, 6)));
+                assert((a.dot(b) == -24));
+                assert((a.min(b) == int3(1, -2, -6)));
+                assert((a.max(b) == int3(4, 5, 3)));
+                assert((a.abs() == int3(1, 2, 3)));
+                assert(((a << 2) == int3(4, -8, 12)));
+                assert(((a >> 1) == int3(0, -1, 1)));
+                assert(((b << int3(0, 1, 2)) == int3(4, 10, -24)));
+                assert(((a & int3(1)) == int3(1, 0, 1)));
+                assert((a.zyx() == int3(3, -2, 1)));
+                assert((a.z() == 3 && a[1] == -2));
+                assert((int3(0) < int3(1) && int3(1) <= int3(1)));
+                assert((int3(0, 2, 0) != int3(1, 1, 1)));
+                assert((!(int3(0, 2, 0) != int3(0, 1, 1))));
+
+                int4 c(int2(1, 2), int2(3, 4));
+                assert((c == int4(1, 2, 3, 4)));
+                assert((int4(int3(1, 2, 3), 4) == c));
+                assert((int4(0, int3(1, 2, 3)) == int4(0, 1, 2, 3)));
+                assert((c.wzyx() == int4(4, 3, 2, 1)));
+                assert((c.dot(c) == 30));
+                assert((-c == int4(-1, -2, -3, -4)));
+                assert((int2(3, 4).yx() == int2(4, 3)));
+
+                float3 f(1.5f, -1.5f, 2.7f);
+                assert((int3::cvt(f) == int3(2, -2, 3)));
+                assert((int3::cvtt(f) == int3(1, -1, 2)));
+                assert((int3::floor(f) == int3(1, -2, 2)));
+                assert((int3(1, -2, 3).to_float() == float3(1, -2, 3)));
+                break;
+            }
+
+            case 11: {
+                // lane-crossing double swizzles and constructors
+                double4 v(1, 2, 3, 4);
+                assert((v.x() == 1 && v.y() == 2 && v.z() == 3 && v.w() == 4));
+                assert((v.wzyx() == double4(4, 3, 2, 1)));
+                assert((v.zwxy() == double4(3, 4, 1, 2)));
+                assert((v.yxwz() == double4(2, 1, 4, 3)));
+                assert((v.wwxz() == double4(4, 4, 1, 3)));
+                assert((v.zx() == double2(3, 1)));
+                assert((v.wyz() == double3(4, 2, 3)));
+                assert((v.xyz().zxy() == double3(3, 1, 2)));
+                assert((double4(double2(1, 2), double2(3, 4)) == v));
+                assert((double3(double2(1, 2), 3) == double3(1, 2, 3)));
+                assert((double3(1, double2(2, 3)) == double3(1, 2, 3)));
+                assert((double3(1, 0, 0).cross(double3(0, 1, 0)) ==
+                        double3(0, 0, 1)));
+                assert((v.dot(v) == 30));
+                assert((double4(2, 3, 4, 5).cross(double4(1, 0, 0, 0),
+                                                  double4(0, 1, 0, 0)) ==
+                        double4(0, 0, 5, -4)));
+                break;
+            }
+
+            case 12: {
+                // compile-time swizzles, every 4-lane pattern
+                assert(check_swizzles4());
+                float4 f(1, 2, 3, 4);
+                assert((f.swizzle<3, 2, 1, 0>() == f.wzyx()));
+                assert((f.xyxy() == float4(1, 2, 1, 2) && f.zwzw() == float4(3, 4, 3, 4)));
+                assert((f.xxzz() == float4(1, 1, 3, 3) && f.yyww() == float4(2, 2, 4, 4)));
+                assert((f.xy().yx() == float2(2, 1) && f.bgr() == float3(3, 2, 1)));
+                assert((double3(1, 2, 3).swizzle<2, 2>() == double2(3, 3)));
+                assert((int3(1, 2, 3).zzx() == int3(3, 3, 1)));
+                break;
+            }
+
+            case 13: {
+                // reductions: dot, trace and matrix-vector products
+                assert((float2(1, 2).dot(float2(3, 4)) == 11));
+                assert((float3(1, 2, 3).dot(float3(4, 5, 6)) == 32));
+                assert((float4(1, 2, 3, 4).dot(float4(5, 6, 7, 8)) == 70));
+                assert((double2(1, 2).dot(double2(3, 4)) == 11));
+                assert((double3(1, 2, 3).dot(double3(4, 5, 6)) == 32));
+                assert((double4(1, 2, 3, 4).dot(double4(5, 6, 7, 8)) == 70));
+                assert((int4(1, 2, 3, 4).dot(int4(5, 6, 7, 8)) == 70));
+                // garbage in the unused lanes must not leak into the result
+                assert((float3(simde_mm_setr_ps(1, 2, 3, 100)).dot(float3(1)) == 6));
+                assert((double3(simde_mm256_setr_pd(1, 2, 3, 100)).dot(double3(1)) == 6));
+
+                float4x4 m(float4(1, 2, 3, 4), float4(5, 6, 7, 8),
+                           float4(9, 10, 11, 12), float4(13, 14, 15, 16));
+                float4 v(1, -1, 2, 0.5f);
+                assert((m.trace() == 34));
+                assert((float3x3(m).trace() == 18));
+                assert((float2x2(m).trace() == 7));
+                assert((m * v == float4(20.5f, 23, 25.5f, 28)));
+                assert((v * m == float4(7, 17, 27, 37)));
+                assert((float3(1, -1, 2) * float3x3(m) == float3(5, 13, 21)));
+                assert((float3x3(m) * float3(1, -1, 2) == float3(14, 16, 18)));
+                assert((float2x2(m) * float2(1, -1) == float2(-4, -4)));
+
+                double4x4 d(double4(1, 2, 3, 4), double4(5, 6, 7, 8),
+                            double4(9, 10, 11, 12), double4(13, 14, 15, 16));
+                double4 dv(1, -1, 2, 0.5);
+                assert((d.trace() == 34));
+                assert((double3x3(d).trace() == 18));
+                assert((double2x2(d).trace() == 7));
+                assert((d * dv == double4(20.5, 23, 25.5, 28)));
+                assert((dv * d == double4(7, 17, 27, 37)));
+                assert((double3(1, -1, 2) * double3x3(d) == double3(5, 13, 21)));
+                assert((double3x3(d) * double3(1, -1, 2) == double3(14, 16, 18)));
+                assert((double2x2(d) * double2(1, -1) == double2(-4, -4)));
+                break;
+            }
+
+            case 14: {
+                // approximate rsqrt/rcp paths stay inside the documented bounds
+                float3 f(3, -4, 12);
+                assert(((f.normalized_fast() - float3(3, -4, 12) / 13).abs() < float3(1e-6f)));
+                assert((fabsf(f.rcp_len() * 13 - 1) < 1e-6f));
+                assert(((fast_div(float4(1, 2, 3, 4), float4(3, 7, -9, 0.1f)) -
+                         float4(1, 2, 3, 4) / float4(3, 7, -9, 0.1f)).abs() < float4(1e-5f)));
+                assert(((fast_div(float2(1, 5), 3) - float2(1, 5) / 3).abs() < float2(1e-6f)));
+                double3 d(3, -4, 12);
+                assert(((d.normalized_fast() - double3(3, -4, 12) / 13).abs() < double3(1e-12)));
+                assert((fabs(d.rcp_len() * 13 - 1) < 1e-12));
+                assert(((fast_div(double4(1, 2, 3, 4), double4(3, 7, -9, 0.1)) -
+                         double4(1, 2, 3, 4) / double4(3, 7, -9, 0.1)).abs() < double4(1e-12)));
+
+                float3 pa[16];
+                for (int i = 0; i < 16; i++) {
+                    pa[i] = float3(i + 1, 2 - i, 0.5f * i);
+                }
+                float3x8 p = float3x8::load(pa);
+                float3x8 n = p.normalized_fast();
+                float3_soa soa(pa, 13), soa_n = soa.normalized_fast();
+                for (int i = 0; i < 8; i++) {
+                    assert(((n[i] - pa[i].normalized()).abs() < float3(1e-6f)));
+                    assert(((soa_n[i] - pa[i].normalized()).abs() < float3(1e-6f)));
+                }
+                break;
+            }
+
+            case 15: {
+                // vectorized transcendentals against libm
+                float4 x(-2.5f, 0.3f, 1.7f, 40.f);
+                double4 dx(-2.5, 0.3, 1.7, 40.);
+                float4 s, c;
+                sincos(x, s, c);
+                for (int i = 0; i < 4; i++) {
+                    float xi = x[i];
+                    double di = dx[i];
+                    assert(fabsf(s[i] - sinf(xi)) < 1e-6f && fabsf(c[i] - cosf(xi)) < 1e-6f);
+                    assert(fabsf(sin(x)[i] - sinf(xi)) < 1e-6f);
+                    assert(fabsf(tan(x)[i] - tanf(xi)) < 1e-5f * fabsf(tanf(xi)));
+                    assert(fabsf(exp(x)[i] - expf(xi)) < 1e-6f * expf(xi));
+                    assert(fabsf(log(x.abs())[i] - logf(fabsf(xi))) < 1e-6f);
+                    assert(fabsf(atan2(x, x.wzyx())[i] - atan2f(xi, x[3 - i])) < 1e-6f);
+                    assert(fabs(sin(dx)[i] - ::sin(di)) < 1e-15);
+                    assert(fabs(cos(dx)[i] - ::cos(di)) < 1e-15);
+                    assert(fabs(exp(dx)[i] - ::exp(di)) < 1e-15 * ::exp(di));
+                    assert(fabs(log(dx.abs())[i] - ::log(fabs(di))) < 1e-15);
+                    assert(fabs(atan2(dx, dx.wzyx())[i] - ::atan2(di, dx[3 - i])) < 1e-15);
+                }
+                float4 a(-1, -0.7f, 0.2f, 0.9f);
+                double4 da(-1, -0.7, 0.2, 0.9);
+                for (int i = 0; i < 4; i++) {
+                    assert(fabsf(acos(a)[i] - acosf(a[i])) < 1e-6f);
+                    assert(fabs(acos(da)[i] - ::acos(da[i])) < 1e-15);
+                }
+                assert(std::isinf(exp(float4(100)).x()) && exp(double4(-800)).x() == 0);
+                assert(log(float4(0)).x() == -INFINITY && std::isnan(log(double4(-1)).x()));
+
+                float1x8 p = float1x8::load(x8_angles);
+                for (int i = 0; i < 8; i++) {
+                    assert(fabsf(cos(p)[i] - cosf(x8_angles[i])) < 1e-6f);
+                }
+
+                quat q = quat::from_angle_axis(1.2f, float3::y_axis());
+                assert(((q.vec - float4(0, sinf(0.6f), 0, cosf(0.6f))).abs() < float4(1e-6f)));
+                float2x2 r = rotation2f(0.4f);
+                assert(((r * float2(1, 0) - float2(cosf(0.4f), sinf(0.4f))).abs() < float2(1e-6f)));
+
+                // a 60 degree projection puts the edge of the view at x = +-w
+                float edge = 10 * tanf(float(M_PI / 6));
+                float4 clip = perspectivef(60, 1, 0.1f, 100) * float4(edge, 0, -10, 1);
+                assert(fabsf(clip.x() / clip.w() - 1) < 1e-5f);
+                clip = perspectivef(60, 1, 0.1f) * float4(-edge, 0, -10, 1);
+                assert(fabsf(clip.x() / clip.w() + 1) < 1e-5f);
+                double4 dclip = perspectived(60, 1, 0.1, 100) * double4(edge, 0, -10, 1);
+                assert(fabs(dclip.x() / dclip.w() - 1) < 1e-6);
+                break;
+            }
+
+            case 16: {
+                // quaternion batches must agree with quat/dquat one at a time
+                quat qs[13], ps[13], prod[13];
+                float3 pts[13], one_q[13], per_q[13];
+                dquat dqs[13], dprod[13];
+                double3 dpts[13], done[13], dper[13];
+                for (int i = 0; i < 13; i++) {
+                    qs[i] = quat::from_angle_axis(0.3f * i - 1, float3(1, i, 2 - i).normalized());
+                    ps[i] = quat::from_angle_axis(0.7f - 0.2f * i, float3(i, 1, 3).normalized());
+                    pts[i] = float3(i - 6, 2 * i, 1 - i);
+                    dqs[i] = dquat::from_angle_axis(0.3 * i - 1, double3(1, i, 2 - i).normalized());
+                    dpts[i] = double3(i - 6, 2 * i, 1 - i);
+                }
+                multiply_many(qs, ps, prod, 13);
+                rotate_points(qs[4], pts, one_q, 13);
+                rotate_points(qs, pts, per_q, 13);
+                multiply_many(dqs, dqs, dprod, 13);
+                rotate_points(dqs[4], dpts, done, 13);
+                rotate_points(dqs, dpts, dper, 13);
+
+                quat_soa a(qs, 13), b(ps, 13), soa_prod, soa_conj, soa_nrm;
+                float3_soa p(pts, 13), soa_rot;
+                a.multiply(b, soa_prod);
+                a.conj(soa_conj);
+                soa_prod.normalized(soa_nrm);
+                a.rotate_points(p, soa_rot);
+                for (int i = 0; i < 13; i++) {
+                    quat ref = qs[i] * ps[i];
+                    assert(((prod[i].vec - ref.vec).abs() < float4(1e-6f)));
+                    assert(((soa_prod[i].vec - ref.vec).abs() < float4(1e-6f)));
+                    assert(((soa_nrm[i].vec - ref.normalized().vec).abs() < float4(1e-6f)));
+                    assert((soa_conj[i].vec == qs[i].conj().vec));
+                    assert(((one_q[i] - qs[4].rotate(pts[i])).abs() < float3(1e-4f)));
+                    assert(((per_q[i] - qs[i].rotate(pts[i])).abs() < float3(1e-4f)));
+                    assert(((soa_rot[i] - qs[i].rotate(pts[i])).abs() < float3(1e-4f)));
+                    assert(((dprod[i].vec - (dqs[i] * dqs[i]).vec).abs() < double4(1e-12)));
+                    assert(((done[i] - dqs[4].rotate(dpts[i])).abs() < double3(1e-12)));
+                    assert(((dper[i] - dqs[i].rotate(dpts[i])).abs() < double3(1e-12)));
+                }
+                break;
+            }
+            case 17: {
+                // rotation matrices back to quaternions, one per Shepperd branch
+                quat rots[4] = {quat::from_angle_axis(0.7f, float3(1, 2, 3).normalized()),
+                                quat::from_angle_axis(3.1f, float3::x_axis()),
+                                quat::from_angle_axis(3.1f, float3::y_axis()),
+                                quat::from_angle_axis(3.1f, float3::z_axis())};
+                for (quat q : rots) {
+                    quat r = quat::from_rot_mat(q.rot_mat3_form());
+                    float sign = r.vec.dot(q.vec) < 0 ? -1.0f : 1.0f;
+                    assert(((r.vec * sign - q.vec).abs() < float4(1e-5f)));
+                    dquat dq = dquat(double4(q.vec.x(), q.vec.y(), q.vec.z(), q.vec.w())).normalized();
+                    dquat dr = dquat::from_rot_mat(dq.rot_mat3_form());
+                    double dsign = dr.vec.dot(dq.vec) < 0 ? -1.0 : 1.0;
+                    assert(((dr.vec * dsign - dq.vec).abs() < double4(1e-12)));
+                }
+
+                dual_quat a = dual_quat::from_rotation_translation(rots[0], float3(1, -2, 3));
+                dual_quat b = dual_quat::from_rotation_translation(rots[1], float3(0, 5, 1));
+                float3 p(0.5f, 2, -1);
+                assert(((a.transform_point(p) - (rots[0].rotate(p) + float3(1, -2, 3))).abs() < float3(1e-5f)));
+                assert(((a.translation() - float3(1, -2, 3)).abs() < float3(1e-5f)));
+                assert((((a * b).transform_point(p) - a.transform_point(b.transform_point(p))).abs() < float3(1e-4f)));
+                assert((((a * a.inverse()).transform_point(p) - p).abs() < float3(1e-5f)));
+                assert((((a * 3.0f).normalized().transform_point(p) - a.transform_point(p)).abs() < float3(1e-5f)));
+                assert(((a.mat3x4_form().transform_point(p) - a.transform_point(p)).abs() < float3(1e-5f)));
+                assert(((a.mat4_form() * float4(p, 1) - float4(a.transform_point(p), 1)).abs() < float4(1e-5f)));
+                assert(((dual_quat::from_mat(a.mat4_form()).transform_point(p) - a.transform_point(p)).abs() < float3(1e-5f)));
+                assert(((dual_quat::from_mat(b.mat3x4_form()).transform_point(p) - b.transform_point(p)).abs() < float3(1e-5f)));
+
+                // one full influence matches the bone; b and -b blend to b
+                dual_quat bones[3] = {a, b, b * -1.0f};
+                int4 joints[2] = {int4(0, 1, 2, 0), int4(1, 2, 0, 0)};
+                float4 weights[2] = {float4(1, 0, 0, 0), float4(0.5f, 0.5f, 0, 0)};
+                float3 in[2] = {p, p}, out[2], nrm_in[2] = {float3::y_axis(), float3::y_axis()}, nrm[2];
+                skin_points(bones, joints, weights, in, nrm_in, out, nrm, 2);
+                assert(((out[0] - a.transform_point(p)).abs() < float3(1e-5f)));
+                assert(((out[1] - b.transform_point(p)).abs() < float3(1e-5f)));
+                assert(((nrm[1] - rots[1].rotate(float3::y_axis())).abs() < float3(1e-5f)));
+
+                dual_dquat da = dual_dquat::from_rotation_translation(dquat::from_angle_axis(0.7, double3(1, 2, 3).normalized()), double3(1, -2, 3));
+                dual_dquat dbones[2] = {da, da * -1.0};
+                int4 djoints[1] = {int4(0, 1, 0, 0)};
+                double4 dweights[1] = {double4(0.25, 0.75, 0, 0)};
+                double3 dp[1] = {double3(0.5, 2, -1)}, dout[1];
+                skin_points(dbones, djoints, dweights, dp, dout, 1);
+                assert(((dout[0] - da.transform_point(dp[0])).abs() < double3(1e-12)));
+                assert((((da * da.inverse()).transform_point(dp[0]) - dp[0]).abs() < double3(1e-12)));
+                assert(((dual_dquat::from_mat(da.mat4_form()).transform_point(dp[0]) - da.transform_point(dp[0])).abs() < double3(1e-12)));
+                break;
+            }
+            case 18: {
+                assert((lerp(float3(0), float3(2), 0.25f) == float3(0.5f)));
+                assert((nlerp(float2(1, 0), float2(0, 1), 0.0f) == float2(1, 0)));
+
+                quat qa[13], qb[13], ref[13];
+                float3 ta[13], tb[13];
+                float t[13];
+                for (int i = 0; i < 13; i++) {
+                    qa[i] = quat::from_angle_axis(0.3f * i - 1, float3(1, i % 3, 2).normalized());
+                    qb[i] = quat::from_angle_axis(0.45f * i + 0.2f, float3(i % 4, 1, -1).normalized());
+                    if (i % 2) {
+                        qb[i] = qb[i] * -1.0f; // needs the shortest path fix
+                    }
+                    ta[i] = float3(i, 1, -i);
+                    tb[i] = float3(2, i, 0.5f);
+                    t[i] = i / 12.0f;
+                    quat b = qa[i].vec.dot(qb[i].vec) < 0 ? qb[i] * -1.0f : qb[i];
+                    ref[i] = slerp(qa[i], b, t[i]);
+                }
+                quat a_half = nlerp_shortest(qa[3], qa[3] * -1.0f, 0.5f);
+                assert(((a_half.vec - qa[3].vec).abs() < float4(1e-6f)));
+
+                quat nl[13], sl[13];
+                float3 tl[13];
+                nlerp_many(qa, qb, t, nl, 13);
+                slerp_many(qa, qb, t, sl, 13);
+                lerp_many(ta, tb, t, tl, 13);
+
+                pose_soa pa(13), pb(13), po, po_global;
+                quat_soa soa_nl;
+                for (int i = 0; i < 13; i++) {
+                    pa.rotation.set(i, qa[i]);
+                    pb.rotation.set(i, qb[i]);
+                    pa.translation.set(i, ta[i]);
+                    pb.translation.set(i, tb[i]);
+                    pa.scale.set(i, float3(1));
+                    pb.scale.set(i, float3(3));
+                }
+                blend_poses(pa, pb, t, po);
+                blend_poses(pa, pb, 0.25f, po_global);
+                nlerp_many(pa.rotation, pb.rotation, t, soa_nl);
+                for (int i = 0; i < 13; i++) {
+                    // slerp_approx is within 4e-4 rad of the half angle
+                    assert((std::abs(sl[i].vec.dot(ref[i].vec)) > cosf(5e-4f)));
+                    assert(((nl[i].vec - nlerp_shortest(qa[i], qb[i], t[i]).vec).abs() < float4(1e-6f)));
+                    assert(((soa_nl[i].vec - nl[i].vec).abs() < float4(1e-6f)));
+                    assert(((po.rotation[i].vec - sl[i].vec).abs() < float4(1e-6f)));
+                    assert(((po.translation[i] - tl[i]).abs() < float3(1e-5f)));
+                    assert(((tl[i] - lerp(ta[i], tb[i], t[i])).abs() < float3(1e-5f)));
+                    assert(((po.scale[i] - float3(1 + 2 * t[i])).abs() < float3(1e-5f)));
+                    assert(((po_global.rotation[i].vec - slerp_approx(qa[i], qb[i], 0.25f).vec).abs() < float4(1e-6f)));
+                }
+                break;
+            }
+            case 19: {
+                // exact values survive, the rest round to 11 or 8 significant bits
+                float4 exact(1, -2, 0.5f, 65504);
+                assert((half4(exact).unpack() == exact));
+                assert((bfloat4(float4(1, -2, 0.5f, 3e38f)).unpack() == float4(1, -2, 0.5f, bfloat16_to_float(float_to_bfloat16(3e38f)))));
+                assert(std::isinf(half_to_float(float_to_half(1e5f))));
+                assert(std::isnan(half_to_float(float_to_half(NAN))));
+                assert(std::isnan(bfloat16_to_float(float_to_bfloat16(NAN))));
+                assert(std::isinf(bfloat16_to_float(float_to_bfloat16(INFINITY))));
+                assert(float_to_bfloat16(1.00390625f) == 0x3f80); // tie to even
+                assert(float_to_bfloat16(1.01171875f) == 0x3f82);
+
+                float vals[37];
+                float4 v4[9];
+                float2 v2[9];
+                for (int i = 0; i < 37; i++) {
+                    vals[i] = (i - 18) * 0.37f + 1.0f / (i + 1);
+                }
+                for (int i = 0; i < 9; i++) {
+                    v4[i] = float4(vals[i], vals[i + 9], vals[i + 18], vals[i + 27]);
+                    v2[i] = float2(vals[i], vals[i + 9]);
+                }
+                uint16_t h[37], b[37];
+                float hf[37], bf[37];
+                pack_half(vals, h, 37);
+                pack_bfloat16(vals, b, 37);
+                unpack_half(h, hf, 37);
+                unpack_bfloat16(b, bf, 37);
+                for (int i = 0; i < 37; i++) {
+                    assert(h[i] == float_to_half(vals[i]));
+                    assert(b[i] == float_to_bfloat16(vals[i]));
+                    assert(hf[i] == half_to_float(h[i]));
+                    assert(bf[i] == bfloat16_to_float(b[i]));
+                    assert(fabsf(hf[i] - vals[i]) <= fabsf(vals[i]) * 0x1p-11f);
+                    assert(fabsf(bf[i] - vals[i]) <= fabsf(vals[i]) * 0x1p-8f);
+                }
+
+                half4 h4[9];
+                bfloat4 b4[9];
+                half2 h2[9];
+                bfloat2 b2[9];
+                float4 o4[9], ob4[9];
+                float2 o2[9], ob2[9];
+                pack_half(v4, h4, 9);
+                pack_bfloat16(v4, b4, 9);
+                pack_half(v2, h2, 9);
+                pack_bfloat16(v2, b2, 9);
+                unpack_half(h4, o4, 9);
+                unpack_bfloat16(b4, ob4, 9);
+                unpack_half(h2, o2, 9);
+                unpack_bfloat16(b2, ob2, 9);
+                for (int i = 0; i < 9; i++) {
+                    assert((o4[i] == half4(v4[i]).unpack()));
+                    assert((ob4[i] == bfloat4(v4[i]).unpack()));
+                    assert((o2[i] == half2(v2[i]).unpack()));
+                    assert((ob2[i] == bfloat2(v2[i]).unpack()));
+                    assert((o2[i] == float2(half_to_float(float_to_half(v2[i].x())), half_to_float(float_to_half(v2[i].y())))));
+                    assert((ob4[i] == float4(bf[i], bf[i + 9], bf[i + 18], bf[i + 27])));
+                }
+                break;
+            }
+            case 20: {
+                assert((quat32().unpack().vec == quat().vec));
+                assert((quat48().unpack().vec == quat().vec));
+                // off unit length: codes clamp rather than spill into the index
+                quat drift[8];
+                quat32 d32[8];
+                quat48 d48[8];
+                for (int i = 0; i < 8; i++) {
+                    drift[i] = quat(float4(0.714f, 0.714f, i % 2 ? -0.1f : 0.1f, 0));
+                }
+                pack_quat32(drift, d32, 8);
+                pack_quat48(drift, d48, 8);
+                for (int i = 0; i < 8; i++) {
+                    assert(d32[i].bits == quat32(drift[i]).bits);
+                    assert(d32[i].bits >> 30 == 0);
+                    float4 back = d32[i].unpack().vec;
+                    assert(back.y() > 0.7f && fabsf(back.z() - drift[i].vec.z()) < 2e-3f);
+                    back = d48[i].unpack().vec;
+                    assert(back.y() > 0.7f && fabsf(back.z() - drift[i].vec.z()) < 1e-4f);
+                }
+                float3 axes[6] = {float3::x_axis(), float3::y_axis(), float3::z_axis(),
+                                  -float3::x_axis(), -float3::y_axis(), -float3::z_axis()};
+                for (float3 a : axes) {
+                    assert((oct16(a).unpack() == a));
+                    assert((oct32(a).unpack() == a));
+                }
+
+                quat qs[21], q32[21], q48[21];
+                float3 ns[21], n16[21], n32[21];
+                for (int i = 0; i < 21; i++) {
+                    qs[i] = quat::from_angle_axis(0.7f * i - 7, float3(i % 3 - 1, 1, i % 5 - 2).normalized());
+                    ns[i] = float3(i % 4 - 1.5f, i % 7 - 3, i - 10).normalized();
+                }
+                quat32 p32[21];
+                quat48 p48[21];
+                oct16 o16[21];
+                oct32 o32[21];
+                pack_quat32(qs, p32, 21);
+                pack_quat48(qs, p48, 21);
+                pack_oct16(ns, o16, 21);
+                pack_oct32(ns, o32, 21);
+                unpack_quat32(p32, q32, 21);
+                unpack_quat48(p48, q48, 21);
+                unpack_oct16(o16, n16, 21);
+                unpack_oct32(o32, n32, 21);
+                for (int i = 0; i < 21; i++) {
+                    assert(p32[i].bits == quat32(qs[i]).bits);
+                    assert(o16[i].bits == oct16(ns[i]).bits);
+                    assert(o32[i].bits == oct32(ns[i]).bits);
+                    assert(((q48[i].vec - quat48(qs[i]).unpack().vec).abs() < float4(1e-6f)));
+                    assert(((n16[i] - oct16(ns[i]).unpack()).abs() < float3(1e-6f)));
+                    // rotation error of 0.25 and 0.008 degrees, angle error of 0.96 and 0.004
+                    float s32 = q32[i].vec.dot(qs[i].vec) < 0 ? -1.0f : 1.0f;
+                    float s48 = q48[i].vec.dot(qs[i].vec) < 0 ? -1.0f : 1.0f;
+                    assert(((q32[i].vec * s32 - qs[i].vec).abs() < float4(2.2e-3f)));
+                    assert(((q48[i].vec * s48 - qs[i].vec).abs() < float4(7e-5f)));
+                    assert(((n16[i] - ns[i]).abs() < float3(1.7e-2f)));
+                    assert(((n32[i] - ns[i]).abs() < float3(7e-5f)));
+                }
+                break;
+            }
+            case 21: {
+                packed_float3 pf[21], pf_out[21], pf_soa[21];
+                packed_double3 pd[21], pd_out[21];
+                float3 f[21];
+                double3 d[21];
+                for (int i = 0; i < 21; i++) {
+                    pf[i] = packed_float3(float3(i, 100 + i, -i));
+                    pd[i].store(double3(i, 1e10 + i, -i));
+                }
+                unpack_float3(pf, f, 21);
+                unpack_double3(pd, d, 21);
+                pack_float3(f, pf_out, 21);
+                pack_double3(d, pd_out, 21);
+                float3_soa soa;
+                unpack_float3(pf, soa, 21);
+                pack_float3(soa, pf_soa);
+                for (int i = 0; i < 21; i++) {
+                    // w lanes are cleared, as float3(x, y, z) leaves them
+                    assert((float4(f[i].simd) == float4(i, 100 + i, -i, 0)));
+                    assert((double4(d[i].simd) == double4(i, 1e10 + i, -i, 0)));
+                    assert((soa[i] == float3(i, 100 + i, -i)));
+                    assert((pf_out[i].load() == pf[i].load()));
+                    assert((pf_soa[i].load() == pf[i].load()));
+                    assert((pd_out[i].load() == pd[i].load()));
+                }
+                break;
+            }
+            case 22: {
+                const char *path = "fonge_mapped_test.bin";
+                float4x4 m[3];
+                quat q[5];
+                half4 h[7];
+                packed_float3 p[2];
+                for (int i = 0; i < 5; i++) {
+                    q[i] = quat(float3(0, 0, 1), i * 0.5f);
+                }
+                for (int i = 0; i < 3; i++) {
+                    m[i] = q[i].rot_mat4_form();
+                }
+                for (int i = 0; i < 7; i++) {
+                    h[i] = half4(float4(i, -i, 0.5f * i, 1));
+                }
+                p[0] = packed_float3(float3(1, 2, 3));
+                p[1] = packed_float3(float3(4, 5, 6));
+
+                mapped_file_writer w;
+                assert(w.open(path));
+                w.write("matrices", m, 3);
+                // streamed in two chunks
+                w.begin<quat>("rotations");
+                w.append(q, 2);
+                w.append(q + 2, 3);
+                w.end();
+                w.write("colors", h, 7);
+                w.write("points", p, 2);
+                w.write("empty", p, 0);
+                assert(w.close());
+
+                mapped_file f;
+                assert(f.open(path));
+                assert(f.array_count() == 5);
+                mapped_span<float4x4> ms = f.find<float4x4>("matrices");
+                mapped_span<quat> qs = f.find<quat>("rotations");
+                mapped_span<half4> hs = f.find<half4>("colors");
+                mapped_span<packed_float3> ps = f.at<packed_float3>(3);
+                assert(ms.size() == 3 && qs.size() == 5 && hs.size() == 7);
+                assert(ps.size() == 2 && f.at<packed_float3>(4).empty());
+                assert(f.at<float4x4>(0).data == ms.data);
+                assert(uintptr_t(ms.data) % 64 == 0);
+                assert(uintptr_t(qs.data) % 64 == 0);
+                assert(uintptr_t(hs.data) % 64 == 0);
+                for (int i = 0; i < 3; i++) {
+                    assert(memcmp(&ms[i], &m[i], sizeof(float4x4)) == 0);
+                }
+                for (int i = 0; i < 5; i++) {
+                    quat read = qs[i];
+                    assert((read.vec == q[i].vec));
+                }
+                for (int i = 0; i < 7; i++) {
+                    assert(memcmp(hs[i].bits, h[i].bits, 8) == 0);
+                }
+                assert((ps[1].load() == float3(4, 5, 6)));
+                // wrong type or name
+                assert(f.find<float4>("matrices").empty());
+                assert(f.find<quat>("missing").empty());
+                f.close();
+
+                // a truncated file is rejected
+                assert(truncate(path, 64 + 64 + 100) == 0);
+                assert(!f.open(path) && !f.is_open());
+
+                // sizes that wrap when padded are rejected, even when the
+                // padded size of 0 would land on a valid header
+                uint16_t shorts[32] = {};
+                mapped_array_header inner = {5, 2, 2, 0, 0, 0, ""};
+                memcpy(shorts, &inner, sizeof(inner));
+                assert(w.open(path));
+                w.write("shorts", shorts, 32);
+                assert(w.close());
+                assert(f.open(path) && f.at<uint16_t>(0).size() == 32);
+                f.close();
+                uint32_t one = 1;
+                uint64_t huge[2] = {~0ull, ~0ull};
+                FILE *patch = fopen(path, "r+b");
+                fseek(patch, 64 + 4, SEEK_SET);
+                fwrite(&one, 4, 1, patch);
+                fseek(patch, 64 + 16, SEEK_SET);
+                fwrite(huge, 8, 2, patch);
+                fclose(patch);
+                assert(!f.open(path));
+                remove(path);
+                assert(!f.open(path));
+                break;
+            }
+            case 23: {
+                // 90 degree reverse-Z projections looking down -z
+                frustum inf = frustum::from_matrix(perspectivef(90, 1, 1));
+                frustum fin = frustum::from_matrix(perspectivef(90, 1, 1, 100));
+                assert(inf.contains(float3(0, 0, -1000)));
+                assert(!fin.contains(float3(0, 0, -1000)));
+                assert(fin.contains(float3(0, 0, -50)));
+                assert(!inf.contains(float3(0, 0, 5)));
+                assert(!inf.contains(float3(0, 0, -0.5f)));
+                assert(!inf.contains(float3(-11, 0, -10)));
+                assert(inf.contains(float3(-9, 9, -10)));
+                assert(fin.intersects(float3(0, 0, -102), 3));
+                assert(!fin.intersects(float3(0, 0, -104), 3));
+                AABB3f straddling(float3(8, 0, -9), float3(12, 1, -8));
+                AABB3f beside(float3(10, 0, -9), float3(12, 1, -8));
+                assert(inf.intersects(straddling) && !inf.intersects(beside));
+
+                // 60 degrees with near = 0.1: the sides are at |x|, |y| =
+                // 10 tan 30 = 5.77 at z = -10
+                frustum inf60 = frustum::from_matrix(perspectivef(60, 1, 0.1f));
+                frustum fin60 = frustum::from_matrix(perspectivef(60, 1, 0.1f, 100));
+                for (frustum f : {inf60, fin60}) {
+                    assert(f.contains(float3(5.7f, 0, -10)) && !f.contains(float3(5.85f, 0, -10)));
+                    assert(f.contains(float3(-5.7f, 0, -10)) && !f.contains(float3(-5.85f, 0, -10)));
+                    assert(f.contains(float3(0, 5.7f, -10)) && !f.contains(float3(0, 5.85f, -10)));
+                    assert(f.contains(float3(0, -5.7f, -10)) && !f.contains(float3(0, -5.85f, -10)));
+                    assert(!f.contains(float3(20, 0, -10)));
+                    assert(f.contains(float3(0, 0, -0.2f)) && !f.contains(float3(0, 0, -0.05f)));
+                }
+                assert(inf60.contains(float3(0, 0, -1000)) && !fin60.contains(float3(0, 0, -1000)));
+
+                // clip depth over 0..w against -w..w
+                frustum unit = frustum::from_matrix(float4x4());
+                frustum gl = frustum::from_matrix(float4x4(), true);
+                assert(!unit.contains(float3(0, 0, -0.5f)));
+                assert(gl.contains(float3(0, 0, -0.5f)));
+                assert(!gl.contains(float3(0, 1.5f, 0)));
+
+                // batches agree with the single tests, tails included
+                const size_t n = 203;
+                std::vector<AABB3f> boxes;
+                std::vector<float4> spheres;
+                srand(7);
+                for (size_t i = 0; i < n; i++) {
+                    float3 c(rand() % 61 - 30, rand() % 61 - 30,
+                             -(rand() % 120));
+                    float3 e(rand() % 5 + 1, rand() % 3 + 1, rand() % 7 + 1);
+                    boxes.push_back(AABB3f(c - e, c + e));
+                    spheres.push_back(float4(c, rand() % 9 + 0.5f));
+                }
+                uint8_t box_mask[(n + 7) / 8], sphere_mask[(n + 7) / 8];
+                uint32_t box_ids[n], sphere_ids[n];
+                cull_mask(fin, boxes.data(), n, box_mask);
+                cull_mask(fin, spheres.data(), n, sphere_mask);
+                size_t box_count = cull(fin, boxes.data(), n, box_ids);
+                size_t sphere_count = cull(fin, spheres.data(), n, sphere_ids);
+                size_t boxes_in = 0, spheres_in = 0;
+                for (size_t i = 0; i < n; i++) {
+                    bool box_in = fin.intersects(boxes[i]);
+                    bool sphere_in =
+                        fin.intersects(spheres[i].xyz(), spheres[i].w());
+                    assert(((box_mask[i / 8] >> (i % 8)) & 1) == box_in);
+                    assert(((sphere_mask[i / 8] >> (i % 8)) & 1) == sphere_in);
+                    if (box_in) {
+                        assert(box_ids[boxes_in++] == i);
+                    }
+                    if (sphere_in) {
+                        assert(sphere_ids[spheres_in++] == i);
+                    }
+                }
+                assert(box_count == boxes_in && sphere_count == spheres_in);
+                assert(boxes_in > 0 && boxes_in < n);
+                break;
+            }
+            case 24: {
+                // random boxes, then the same boxes moved; enough of them
+                // for the 4-thread build to split off threads twice
+                const size_t n = 2 * bvh_parallel_min + 2000;
+                std::vector<AABB3f> boxes, moved;
+                srand(11);
+                for (size_t i = 0; i < n; i++) {
+                    float3 c(rand() % 1000, rand() % 1000, rand() % 10 + 40);
+                    float3 e(rand() % 8 + 1, rand() % 8 + 1, rand() % 8 + 1);
+                    boxes.push_back(AABB3f(c - e, c + e));
+                    float3 d(rand() % 21 - 10, rand() % 21 - 10, 0);
+                    moved.push_back(AABB3f(c - e + d, c + e + d));
+                }
+                auto overlaps = [](AABB3f a, AABB3f b) {
+                    return a.min_point <= b.max_point &&
+                           b.min_point <= a.max_point;
+                };
+                auto hits = [](AABB3f b, float3 o, float3 d, float tmax) {
+                    float3 t1 = (b.min_point - o) / d,
+                           t2 = (b.max_point - o) / d;
+                    float tn = 0, tf = tmax;
+                    for (int k = 0; k < 3; k++) {
+                        tn = std::max(tn, std::min(t1[k], t2[k]));
+                        tf = std::min(tf, std::max(t1[k], t2[k]));
+                    }
+                    return tn <= tf;
+                };
+                AABB3f query(float3(200, 300, 10), float3(400, 420, 60));
+                float3 point(500, 500, 50), o(-10, 3, 40), d(1, 0.5f, 0.02f);
+
+                bvh serial(boxes.data(), n, 1), parallel(boxes.data(), n, 4);
+                for (int pass = 0; pass < 2; pass++) {
+                    const std::vector<AABB3f> &prims = pass ? moved : boxes;
+                    if (pass) {
+                        serial.refit(moved.data());
+                        parallel.refit(moved.data());
+                    }
+                    bvh4 tree4(serial);
+                    bvh8 tree8(parallel);
+                    std::vector<int> want_box(n), want_point(n), want_ray(n);
+                    for (size_t i = 0; i < n; i++) {
+                        want_box[i] = overlaps(prims[i], query);
+                        want_point[i] = overlaps(prims[i], AABB3f(point, point));
+                        want_ray[i] = hits(prims[i], o, d, 2000);
+                    }
+                    assert(std::count(want_box.begin(), want_box.end(), 1) > 5);
+                    assert(std::count(want_ray.begin(), want_ray.end(), 1) > 5);
+                    for (int t = 0; t < 4; t++) {
+                        std::vector<int> box(n), pt(n), ray(n);
+                        auto on_box = [&](uint32_t i) { box[i]++; };
+                        auto on_point = [&](uint32_t i) { pt[i]++; };
+                        auto on_ray = [&](uint32_t i, float &) { ray[i]++; };
+                        if (t == 0 || t == 1) {
+                            bvh &tree = t ? parallel : serial;
+                            tree.query_box(query, on_box);
+                            tree.query_point(point, on_point);
+                            tree.query_ray(o, d, 2000, on_ray);
+                        } else if (t == 2) {
+                            tree4.query_box(query, on_box);
+                            tree4.query_point(point, on_point);
+                            tree4.query_ray(o, d, 2000, on_ray);
+                        } else {
+                            tree8.query_box(query, on_box);
+                            tree8.query_point(point, on_point);
+                            tree8.query_ray(o, d, 2000, on_ray);
+                        }
+                        assert(box == want_box && pt == want_point);
+                        assert(ray == want_ray);
+                    }
+                }
+
+                // lowering tmax culls what lies beyond it
+                float nearest = 2000;
+                parallel.query_ray(o, d, 2000, [&](uint32_t i, float &tmax) {
+                    float3 c = moved[i].centroid();
+                    tmax = std::min(tmax, (c - o).len() / d.len());
+                    nearest = tmax;
+                });
+                assert(nearest < 2000);
+
+                // every node is 32 bytes and every primitive in one leaf;
+                // children come after their parent, which refit relies on
+                assert(sizeof(bvh_node) == 32);
+                std::vector<int> seen(n);
+                for (size_t k = 0; k < parallel.nodes.size(); k++) {
+                    const bvh_node &node = parallel.nodes[k];
+                    assert(node.is_leaf() || node.first > k);
+                    for (uint32_t i = 0; node.is_leaf() && i < node.count; i++) {
+                        seen[parallel.indices[node.first + i]]++;
+                    }
+                }
+                assert(std::count(seen.begin(), seen.end(), 1) == int(n));
+
+                bvh empty(boxes.data(), 0);
+                empty.query_box(query, [](uint32_t) { assert(false); });
+                bvh single(boxes.data(), 1);
+                bvh8 single8(single);
+                int found = 0;
+                single8.query_box(boxes[0], [&](uint32_t) { found++; });
+                assert(found == 1);
+
+                // unused wide lanes stay out of unbounded queries
+                bvh five(boxes.data(), 5);
+                bvh8 five8(five);
+                float3 far(INFINITY, INFINITY, INFINITY);
+                std::vector<int> all(5), up(5), want_up(5);
+                five8.query_box(AABB3f(-far, far), [&](uint32_t i) { all[i]++; });
+                assert(std::count(all.begin(), all.end(), 1) == 5);
+                float3 low(0, 0, 0), dir(1, 1, 0.05f);
+                for (size_t i = 0; i < 5; i++) {
+                    want_up[i] = hits(boxes[i], low, dir, INFINITY);
+                }
+                five8.query_ray(low, dir, INFINITY,
+                                [&](uint32_t i, float &) { up[i]++; });
+                assert(up == want_up);
+                break;
+            }
+            case 25: {
+                // rays from around (0, 0, -10) towards the unit square
+                const size_t n = 37;
+                std::vector<ray> rays;
+                srand(5);
+                for (size_t i = 0; i < n; i++) {
+                    float3 o(rand() % 5 - 2, rand() % 5 - 2, -10);
+                    float3 to((rand() % 41 - 20) * 0.1f,
+                              (rand() % 41 - 20) * 0.1f, 0);
+                    rays.push_back(ray(o, to - o, i % 5 ? 100 : 0.5f));
+                }
+                AABB3f box(float3(-1, -1, -1), float3(1, 1, 1));
+                float3 a(-1, -1, 0), b(1, -1, 0), c(-1, 1, 0);
+
+                float box_t[n], tri_t[n];
+                intersect_rays(rays.data(), n, box, box_t);
+                intersect_rays(rays.data(), n, a, b, c, tri_t);
+                int box_hits = 0, tri_hits = 0;
+                for (size_t i = 0; i < n; i++) {
+                    float bt, tt;
+                    bool hb = rays[i].intersects(box, bt);
+                    bool ht = rays[i].intersects(a, b, c, tt);
+                    box_hits += hb;
+                    tri_hits += ht;
+                    assert(hb == (box_t[i] != INFINITY));
+                    assert(ht == (tri_t[i] != INFINITY));
+                    assert(!hb || fabsf(box_t[i] - bt) < 1e-6f);
+                    assert(!ht || fabsf(tri_t[i] - tt) < 1e-6f);
+                    if (ht) {
+                        // on the triangle, inside the box
+                        float3 p = rays[i].at(tt);
+                        assert(fabsf(p.z()) < 1e-5f && p.x() + p.y() <= 1e-5f);
+                        assert(hb && bt <= tt);
+                    }
+                }
+                assert(box_hits > 5 && tri_hits > 2 && box_hits < int(n));
+
+                // 4- and 16-ray packets agree with the scalar tests
+                for (size_t i = 0; i + 16 <= n; i += 16) {
+                    float1x4 t4;
+                    float1x16 t16;
+                    int m4 = ray_packet4::load(&rays[i]).intersects(box, t4);
+                    int m16 = ray_packet16::load(&rays[i]).intersects(a, b, c,
+                                                                       t16);
+                    for (int k = 0; k < 16; k++) {
+                        float t;
+                        assert(((m16 >> k) & 1) ==
+                               rays[i + k].intersects(a, b, c, t));
+                        if (k < 4) {
+                            assert(((m4 >> k) & 1) ==
+                                   rays[i + k].intersects(box, t));
+                            assert(t4[k] == t);
+                        }
+                    }
+                }
+
+                // one ray against a soup of unit triangles along z
+                std::vector<float3> soup;
+                for (int i = 0; i < 21; i++) {
+                    float z = 20 - i * 1.5f;
+                    float3 shift(i % 3 == 0 ? 5.f : 0.f, 0, 0);
+                    soup.push_back(float3(-1, -1, z) + shift);
+                    soup.push_back(float3(1, -1, z) + shift);
+                    soup.push_back(float3(0, 1, z) + shift);
+                }
+                ray r(float3(0, 0, -5), float3(0, 0, 1));
+                float soup_t[21], t;
+                intersect_triangles(r, soup.data(), 21, soup_t);
+                for (int i = 0; i < 21; i++) {
+                    float want = 20 - i * 1.5f + 5;
+                    // shifted off the ray, or behind its origin
+                    assert(i % 3 == 0 || want < 0 ? soup_t[i] == INFINITY
+                                                  : fabsf(soup_t[i] - want) < 1e-5f);
+                }
+                // the nearest in front is triangle 16, at z = -4
+                assert(closest_triangle(r, soup.data(), 21, t) == 16);
+                assert(fabsf(t - 1) < 1e-5f);
+                r.tmax = 0.5f;
+                assert(closest_triangle(r, soup.data(), 21, t) == -1);
+                break;
+            }
+            case 26: {
+                // AABB ops on every instantiation
+                AABB3f b1(float3(0, 0, 0), float3(2, 2, 2)), b2(float3(1, -1, 1), float3(3, 1, 4));
+                AABB3f both = b1.collide(b2), any = b1.merge(b2);
+                assert(both.min_point == float3(1, 0, 1) && both.max_point == float3(2, 1, 2));
+                assert(any.min_point == float3(0, -1, 0) && any.max_point == float3(3, 2, 4));
+                AABB2d d1(double2(0, 0), double2(1, 1));
+                AABB2d d2 = d1.merge(AABB2d(double2(-1, 0.5), double2(0.5, 3)));
+                assert(d2.min_point == double2(-1, 0) && d2.max_point == double2(1, 3));
+                assert(b1.intersects(b2) && !b1.intersects(AABB3f(float3(2.5f, 0, 0), float3(3, 1, 1))));
+
+                // fits of a rotated, elongated point set contain every point
+                quat rot = quat::from_angle_axis(0.7f, float3(1, 2, 3).normalized());
+                std::vector<float3> pts;
+                srand(11);
+                for (int i = 0; i < 200; i++) {
+                    float3 p((rand() % 2001 - 1000) * 0.005f, (rand() % 201 - 100) * 0.005f,
+                             (rand() % 201 - 100) * 0.003f);
+                    pts.push_back(rot.rotate(p) + float3(3, -2, 1));
+                }
+                AABB3f box = AABB3f::from_points(pts.data(), pts.size());
+                sphere sph = sphere::from_points(pts.data(), pts.size());
+                OBB obb = OBB::from_points(pts.data(), pts.size());
+                capsule cap = capsule::from_points(pts.data(), pts.size());
+                for (float3 p : pts) {
+                    assert(p >= box.min_point && p <= box.max_point);
+                    assert((p - sph.center).len() <= sph.radius * 1.0001f);
+                    assert(OBB(obb.center, obb.extent * 1.0001f + float3(1e-5f, 1e-5f, 1e-5f), obb.axes).contains(p));
+                    assert(capsule(cap.a, cap.b, cap.radius * 1.0001f + 1e-5f).contains(p));
+                }
+                float3 dims = box.dimensions(), ext = obb.extent;
+                assert(ext.x() * ext.y() * ext.z() * 8 < 0.5f * dims.x() * dims.y() * dims.z());
+                assert(cap.radius < 0.65f && (cap.b - cap.a).len() > 8);
+                assert(sph.radius < 5.5f);
+
+                // OBB separating axes: a unit cube against one turned 45 degrees
+                OBB cube(float3(0, 0, 0), float3(1, 1, 1), float3x3());
+                quat turn = quat::from_angle_axis(float(M_PI / 4), float3(0, 0, 1));
+                float reach = 1 + sqrtf(2);
+                assert(cube.intersects(OBB(float3(reach - 0.01f, 0, 0), float3(1, 1, 1), turn)));
+                assert(!cube.intersects(OBB(float3(reach + 0.01f, 0, 0), float3(1, 1, 1), turn)));
+                // separated only along an edge-edge axis
+                quat tilt = quat::from_angle_axis(float(M_PI / 4), float3(1, 0, 0));
+                OBB edge(float3(0, 0, 0), float3(1, 1, 1), turn);
+                assert(edge.intersects(OBB(float3(1.9f, 0, 1.9f), float3(1, 1, 1), tilt)));
+                assert(!OBB(float3(0, 0, 0), float3(1, 1, 1), tilt).intersects(OBB(float3(0, 2.9f, 2.9f), float3(1, 1, 1), tilt)));
+                assert(OBB(b1).bounds().min_point == b1.min_point);
+
+                // capsules and planes
+                capsule c1(float3(0, 0, 0), float3(0, 0, 4), 0.5f);
+                assert(c1.intersects(capsule(float3(0.9f, -2, 2), float3(0.9f, 2, 2), 0.5f)));
+                assert(!c1.intersects(capsule(float3(1.1f, -2, 2), float3(1.1f, 2, 2), 0.5f)));
+                assert(c1.intersects(capsule(float3(0, 0, 4.9f), float3(0, 0, 6), 0.5f)));
+                assert(!c1.intersects(sphere(float3(0, 0, 5.1f), 0.5f)));
+                plane ground = plane::from_points(float3(0, 0, 1), float3(1, 0, 1), float3(0, 1, 1));
+                assert(fabsf(ground.distance(float3(5, 5, 3)) - 2) < 1e-6f);
+                assert(ground.intersects(b1) && !ground.intersects(AABB3f(float3(0, 0, 1.5f), float3(1, 1, 2))));
+
+                // batch tests agree with the scalar ones, tail included
+                const size_t n = 45;
+                std::vector<sphere> spheres;
+                std::vector<AABB3f> boxes;
+                std::vector<OBB> obbs;
+                for (size_t i = 0; i < n; i++) {
+                    float3 c((rand() % 200 - 100) * 0.05f, (rand() % 200 - 100) * 0.05f,
+                             (rand() % 200 - 100) * 0.05f);
+                    float3 e((rand() % 100 + 1) * 0.02f, (rand() % 100 + 1) * 0.02f, (rand() % 100 + 1) * 0.02f);
+                    spheres.push_back(sphere(c, e.x()));
+                    boxes.push_back(AABB3f(c - e, c + e));
+                    obbs.push_back(OBB(c, e, quat::from_angle_axis(float(i), e.normalized())));
+                }
+                sphere qs(float3(0.5f, 0, -0.5f), 2.5f);
+                plane qp = plane::from_point_normal(float3(0, 1, 0), float3(1, 1, 0.5f));
+                OBB qo(float3(0, 0.5f, 0), float3(3, 0.5f, 1), rot);
+                uint8_t m1[6], m2[6], m3[6], m4[6];
+                uint32_t list[n];
+                overlap_mask(qs, spheres.data(), n, m1);
+                overlap_mask(qs, boxes.data(), n, m2);
+                overlap_mask(qp, boxes.data(), n, m3);
+                overlap_mask(qo, obbs.data(), n, m4);
+                size_t count = overlap_list(qo, obbs.data(), n, list), seen = 0;
+                int hits[4] = {};
+                for (size_t i = 0; i < n; i++) {
+                    bool h1 = qs.intersects(spheres[i]), h2 = qs.intersects(boxes[i]);
+                    bool h3 = qp.intersects(boxes[i]), h4 = qo.intersects(obbs[i]);
+                    assert(h1 == bool(m1[i / 8] >> (i % 8) & 1));
+                    assert(h2 == bool(m2[i / 8] >> (i % 8) & 1));
+                    assert(h3 == bool(m3[i / 8] >> (i % 8) & 1));
+                    assert(h4 == bool(m4[i / 8] >> (i % 8) & 1));
+                    hits[0] += h1, hits[1] += h2, hits[2] += h3, hits[3] += h4;
+                    if (h4) {
+                        assert(list[seen++] == i);
+                    }
+                }
+                assert(seen == count);
+                for (int h : hits) {
+                    assert(h > 0 && h < int(n));
+                }
+                break;
+            }
+            case 27: {
+                // grid pairs and queries against brute force
+                srand(21);
+                auto random_box = [](float size) {
+                    float3 c(rand() % 1000 * 0.05f, rand() % 1000 * 0.05f, rand() % 1000 * 0.05f);
+                    float3 e(rand() % 100 + 1, rand() % 100 + 1, rand() % 100 + 1);
+                    return AABB3f(c - e * (size / 100), c + e * (size / 100));
+                };
+                spatial_grid grid(2.f);
+                std::vector<uint32_t> ids;
+                for (int i = 0; i < 2000; i++) {
+                    // a few boxes large enough to skip the cells
+                    ids.push_back(grid.insert(random_box(i % 200 == 0 ? 12.f : 1.5f)));
+                }
+                auto check = [&] {
+                    std::vector<std::pair<uint32_t, uint32_t>> want, got;
+                    for (size_t a = 0; a < grid.boxes.size(); a++) {
+                        for (size_t b = a + 1; b < grid.boxes.size(); b++) {
+                            if (grid.ranges[a].cells() && grid.ranges[b].cells() && grid.boxes[a].intersects(grid.boxes[b])) {
+                                want.push_back({uint32_t(a), uint32_t(b)});
+                            }
+                        }
+                    }
+                    size_t calls = 0;
+                    grid.pairs([&](const grid_pair *p, size_t count) {
+                        assert(count > 0 && count <= grid_pair_batch);
+                        calls++;
+                        for (size_t i = 0; i < count; i++) {
+                            got.push_back({std::min(p[i].a, p[i].b), std::max(p[i].a, p[i].b)});
+                        }
+                    });
+                    std::sort(got.begin(), got.end());
+                    assert(got == want);
+                    assert(calls == (want.size() + grid_pair_batch - 1) / grid_pair_batch);
+
+                    for (int q = 0; q < 50; q++) {
+                        AABB3f probe = random_box(q % 10 == 0 ? 30.f : 3.f);
+                        std::vector<uint32_t> hits;
+                        grid.query_box(probe, [&](uint32_t id) { hits.push_back(id); });
+                        std::sort(hits.begin(), hits.end());
+                        std::vector<uint32_t> expect;
+                        for (size_t id = 0; id < grid.boxes.size(); id++) {
+                            if (grid.ranges[id].cells() && grid.boxes[id].intersects(probe)) {
+                                expect.push_back(uint32_t(id));
+                            }
+                        }
+                        assert(hits == expect);
+                    }
+                    return want.size();
+                };
+                size_t before = check();
+                assert(before > 100 && !grid.large.empty());
+
+                // small moves mostly stay in their cells, jumps do not
+                float3 nudge(0.01f, 0, 0);
+                for (size_t i = 0; i < ids.size(); i += 3) {
+                    AABB3f b = grid.boxes[ids[i]];
+                    grid.move(ids[i], AABB3f(b.min_point + nudge, b.max_point + nudge));
+                }
+                check();
+                for (size_t i = 0; i < ids.size(); i += 7) {
+                    grid.move(ids[i], random_box(1.5f));
+                }
+                for (size_t i = 1; i < ids.size(); i += 5) {
+                    grid.remove(ids[i]);
+                }
+                assert(grid.free_ids.size() == 400);
+                check();
+                uint32_t reused = grid.insert(random_box(1.5f));
+                assert(reused == ids[ids.size() - 4]);
+                check();
+
+                // point queries
+                float3 inside = grid.boxes[reused].centroid();
+                bool found = false;
+                grid.query_point(inside, [&](uint32_t id) {
+                    found |= id == reused;
+                    assert(grid.boxes[id].min_point <= inside && inside <= grid.boxes[id].max_point);
+                });
+                assert(found);
+
+                // a threaded rebuild, on four threads and sorting by part
+                // first, matches the serial one
+                spatial_grid big(1.f);
+                for (size_t i = 0; i < 4 * grid_parallel_min; i++) {
+                    big.insert(random_box(0.8f));
+                }
+                big.rebuild(1);
+                std::vector<grid_entry> serial = big.entries;
+                std::vector<uint32_t> serial_offsets = big.offsets;
+                big.rebuild(4);
+                assert(big.offsets.size() > grid_parts + 1);
+                assert(serial_offsets == big.offsets);
+                assert(serial.size() == big.entries.size());
+                for (size_t i = 0; i < serial.size(); i++) {
+                    assert(serial[i].id == big.entries[i].id && serial[i].cell[0] == big.entries[i].cell[0]);
+                }
+                break;
+            }
+            case 28: {
+                // sweep and prune pairs against brute force over moving boxes
+                srand(31);
+                const size_t n = 3000;
+                std::vector<AABB3f> boxes;
+                std::vector<float3> vel;
+                for (size_t i = 0; i < n; i++) {
+                    // spread mostly along z, which becomes the sort axis
+                    float3 c(rand() % 1000 * 0.02f, rand() % 1000 * 0.02f, rand() % 1000 * 0.1f);
+                    float3 e(rand() % 50 + 5, rand() % 50 + 5, rand() % 50 + 5);
+                    boxes.push_back(AABB3f(c - e * 0.08f, c + e * 0.08f));
+                    vel.push_back(float3(rand() % 21 - 10, rand() % 21 - 10, rand() % 21 - 10) * 0.002f);
+                }
+                auto check = [&](sweep_prune &sap, size_t count, sap_pair_pool &pool) {
+                    sap.find_pairs(pool);
+                    std::vector<std::pair<uint32_t, uint32_t>> want, got;
+                    for (size_t a = 0; a < count; a++) {
+                        for (size_t b = a + 1; b < count; b++) {
+                            if (boxes[a].intersects(boxes[b])) {
+                                want.push_back({uint32_t(a), uint32_t(b)});
+                            }
+                        }
+                    }
+                    size_t blocks = 0, total = 0;
+                    pool.for_each_block([&](const sap_pair *p, size_t k) {
+                        blocks++;
+                        total += k;
+                        for (size_t i = 0; i < k; i++) {
+                            got.push_back({std::min(p[i].a, p[i].b), std::max(p[i].a, p[i].b)});
+                        }
+                    });
+                    assert(total == pool.size() && blocks == (total + sap_pair_block - 1) / sap_pair_block);
+                    std::sort(got.begin(), got.end());
+                    assert(got == want);
+                    return want.size();
+                };
+                sweep_prune sap;
+                sap_pair_pool pool;
+                sap.build(boxes.data(), n);
+                assert(sap.axis == 2);
+                assert(check(sap, n, pool) > sap_pair_block);
+                size_t blocks = pool.blocks.size();
+                for (int frame = 0; frame < 5; frame++) {
+                    for (size_t i = 0; i < n; i++) {
+                        boxes[i] = AABB3f(boxes[i].min_point + vel[i], boxes[i].max_point + vel[i]);
+                    }
+                    sap.update(boxes.data());
+                    for (sap_band &band : sap.bands) {
+                        for (size_t i = 1; i < band.ids.size(); i++) {
+                            assert(band.lo[0][i - 1] <= band.lo[0][i]);
+                        }
+                    }
+                    check(sap, n, pool);
+                }
+                // the pool keeps its blocks, and an incoherent frame falls back to a full sort
+                assert(pool.blocks.size() >= blocks);
+                std::reverse(boxes.begin(), boxes.end());
+                sap.update(boxes.data());
+                check(sap, n, pool);
+
+                // fewer boxes than a packet
+                sweep_prune small;
+                small.build(boxes.data(), 5);
+                check(small, 5, pool);
+                small.build(boxes.data(), 0);
+                small.find_pairs(pool);
+                assert(pool.size() == 0);
+
+                // unbounded boxes, on the sort axis and across the bands
+                boxes[3].max_point = float3(boxes[3].max_point.x(), boxes[3].max_point.y(), INFINITY);
+                boxes[17].min_point = float3(-INFINITY, -INFINITY, boxes[17].min_point.z());
+                boxes[17].max_point = float3(INFINITY, INFINITY, boxes[17].max_point.z());
+                sweep_prune strip;
+                strip.build(boxes.data(), 40);
+                check(strip, 40, pool);
+                strip.update(boxes.data());
+                check(strip, 40, pool);
+                break;
+            }
+            case 29: {
+                // run from testing_fast_math, built with FONGE_FAST_MATH:
+                // division stays exact and the approximate reciprocals keep
+                // the results of a division for zero and infinity
+                float3 inv = float3(1) / float3(0, 2, -0.0f);
+                assert(inv.x() == INFINITY && inv.y() == 0.5f && inv.z() == -INFINITY);
+                float3 fast = fast_div(float3(1), float3(0, INFINITY, -0.0f));
+                assert(fast.x() == INFINITY && fast.y() == 0 && fast.z() == -INFINITY);
+                double3 dfast = fast_div(double3(1), double3(0, 4, -0.0));
+                assert(dfast.x() == INFINITY && fabs(dfast.y() - 0.25) < 1e-12);
+                assert(dfast.z() == -INFINITY);
+                assert(float1x4(0.0f).rcp()[0] == INFINITY);
+                assert(float1x8(0.0f).rcp()[0] == INFINITY);
+                assert(float1x16(-0.0f).rcp()[0] == -INFINITY);
+
+                // axis-aligned rays and box centers
+                float t;
+                ray along(float3(-5, 0.5f, 0.5f), float3(1, 0, 0));
+                assert(along.intersects(AABB3f(float3(0, 0, 0), float3(1, 1, 1)), t) && t == 5);
+                assert(!along.intersects(AABB3f(float3(0, 1, 0), float3(1, 2, 1)), t));
+                AABB3f box(float3(0, 0, 0), float3(2, 2, 2));
+                assert((box.centroid() == float3(1, 1, 1)));
+                assert(OBB(box).bounds().min_point == box.min_point);
+
+                float3 n = float3(3, 4, 0).normalized();
+                assert(((n - float3(0.6f, 0.8f, 0)).abs() < float3(1e-6f)));
+                break;
+            }
         }
     }
 }
\ No newline at end of file